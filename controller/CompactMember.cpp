@@ -0,0 +1,811 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2023-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#include "CompactMember.hpp"
+
+#include "../node/Utils.hpp"
+#include "../node/InetAddress.hpp"
+#include "../osdep/OSUtils.hpp"
+
+#include <string.h>
+
+#include <mutex>
+#include <unordered_set>
+
+namespace ZeroTier {
+
+namespace {
+
+// Interned strings are never freed, so only values from a small set that
+// repeat across many members (credential types) are interned.
+static std::unordered_set<std::string> s_interned;
+static std::mutex s_interned_l;
+
+static const std::string *_intern(const std::string &s)
+{
+	std::lock_guard<std::mutex> l(s_interned_l);
+	return &(*(s_interned.insert(s).first));
+}
+
+static inline bool _isU64(const nlohmann::json &j)
+{
+	return ((j.is_number_unsigned())||((j.is_number_integer())&&(j.get<int64_t>() >= 0)));
+}
+
+static inline bool _isU32(const nlohmann::json &j)
+{
+	return ((_isU64(j))&&(j.get<uint64_t>() <= 0xffffffffULL));
+}
+
+static inline bool _isI32(const nlohmann::json &j)
+{
+	if (j.is_number_unsigned())
+		return (j.get<uint64_t>() <= 0x7fffffffULL);
+	if (j.is_number_integer()) {
+		const int64_t i = j.get<int64_t>();
+		return ((i >= -2147483648LL)&&(i <= 2147483647LL));
+	}
+	return false;
+}
+
+static bool _packIps(const nlohmann::json &ips,std::vector<uint32_t> &var)
+{
+	if (!ips.is_array())
+		return false;
+	var.push_back((uint32_t)ips.size());
+	char tmp[64];
+	for(auto i=ips.begin();i!=ips.end();++i) {
+		if (!i->is_string())
+			return false;
+		const std::string &s = i->get_ref<const std::string &>();
+		InetAddress ip;
+		if ((!ip.fromString(s.c_str()))||(ip.port() != 0)||(s != ip.toIpString(tmp)))
+			return false;
+		uint32_t w[4];
+		if (ip.isV4()) {
+			memcpy(w,ip.rawIpData(),4);
+			var.push_back(4);
+			var.push_back(w[0]);
+		} else {
+			memcpy(w,ip.rawIpData(),16);
+			var.push_back(6);
+			var.insert(var.end(),w,w + 4);
+		}
+	}
+	return true;
+}
+
+static bool _packU32Array(const nlohmann::json &a,std::vector<uint32_t> &var)
+{
+	if (!a.is_array())
+		return false;
+	var.push_back((uint32_t)a.size());
+	for(auto i=a.begin();i!=a.end();++i) {
+		if (!_isU32(*i))
+			return false;
+		var.push_back((uint32_t)i->get<uint64_t>());
+	}
+	return true;
+}
+
+static bool _packTags(const nlohmann::json &a,std::vector<uint32_t> &var)
+{
+	if (!a.is_array())
+		return false;
+	var.push_back((uint32_t)a.size());
+	for(auto i=a.begin();i!=a.end();++i) {
+		if ((!i->is_array())||(i->size() != 2)||(!_isU32((*i)[0]))||(!_isU32((*i)[1])))
+			return false;
+		var.push_back((uint32_t)(*i)[0].get<uint64_t>());
+		var.push_back((uint32_t)(*i)[1].get<uint64_t>());
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+const char *const CompactMember::FIELD_NAMES[F_COUNT] = {
+	"id",
+	"address",
+	"nwid",
+	"objtype",
+	"authorized",
+	"activeBridge",
+	"noAutoAssignIps",
+	"revision",
+	"creationTime",
+	"lastAuthorizedTime",
+	"lastDeauthorizedTime",
+	"vMajor",
+	"vMinor",
+	"vRev",
+	"vProto",
+	"remoteTraceLevel",
+	"remoteTraceTarget",
+	"lastAuthorizedCredentialType",
+	"lastAuthorizedCredential",
+	"identity",
+	"ipAssignments",
+	"capabilities",
+	"tags"
+};
+
+CompactMember::CompactMember() :
+	_present(0),
+	_bools(0),
+	_extra((nlohmann::json *)0)
+{
+	memset(_u64,0,sizeof(_u64));
+	memset(_i32,0,sizeof(_i32));
+	memset(_str,0,sizeof(_str));
+	memset(_identity,0,sizeof(_identity));
+}
+
+CompactMember::CompactMember(const CompactMember &m) :
+	_extra((nlohmann::json *)0)
+{
+	memset(_str,0,sizeof(_str));
+	*this = m;
+}
+
+CompactMember::~CompactMember()
+{
+	for(unsigned int i=0;i<3;++i)
+		_setStr(i,(const char *)0,0);
+	delete _extra;
+}
+
+CompactMember &CompactMember::operator=(const CompactMember &m)
+{
+	if (this != &m) {
+		memcpy(_u64,m._u64,sizeof(_u64));
+		memcpy(_i32,m._i32,sizeof(_i32));
+		_present = m._present;
+		_bools = m._bools;
+		for(unsigned int i=0;i<3;++i) {
+			if (m._str[i])
+				_setStr(i,m._str[i]->data(),m._str[i]->length());
+			else _setStr(i,(const char *)0,0);
+		}
+		_var = m._var;
+		memcpy(_identity,m._identity,sizeof(_identity));
+		delete _extra;
+		_extra = (m._extra) ? new nlohmann::json(*m._extra) : (nlohmann::json *)0;
+	}
+	return *this;
+}
+
+void CompactMember::_setStr(const unsigned int i,const char *s,const unsigned long len)
+{
+	if (i != STR_CREDENTIAL_TYPE)
+		delete _str[i];
+	if (!s)
+		_str[i] = (const std::string *)0;
+	else if (i == STR_CREDENTIAL_TYPE)
+		_str[i] = _intern(std::string(s,len));
+	else _str[i] = new std::string(s,len);
+}
+
+unsigned int CompactMember::_fieldIndex(const std::string &k)
+{
+	unsigned int fi = 0;
+	while ((fi < F_COUNT)&&(k != FIELD_NAMES[fi]))
+		++fi;
+	return fi;
+}
+
+bool CompactMember::_setField(const unsigned int fi,const nlohmann::json &v,const char *ids,const char *nwids,std::vector<uint32_t> &ips,std::vector<uint32_t> &caps,std::vector<uint32_t> &tags)
+{
+	bool ok = false;
+	switch(fi) {
+		case F_ID:
+		case F_ADDRESS:
+			ok = ((v.is_string())&&(v.get_ref<const std::string &>() == ids));
+			break;
+		case F_NWID:
+			ok = ((v.is_string())&&(v.get_ref<const std::string &>() == nwids));
+			break;
+		case F_OBJTYPE:
+			ok = ((v.is_string())&&(v.get_ref<const std::string &>() == "member"));
+			break;
+		case F_AUTHORIZED:
+		case F_ACTIVE_BRIDGE:
+		case F_NO_AUTO_ASSIGN_IPS:
+			if (v.is_boolean()) {
+				if (v.get<bool>())
+					_bools |= (1U << fi);
+				ok = true;
+			}
+			break;
+		case F_REVISION:
+		case F_CREATION_TIME:
+		case F_LAST_AUTHORIZED_TIME:
+		case F_LAST_DEAUTHORIZED_TIME:
+			if (_isU64(v)) {
+				_u64[fi - F_REVISION] = v.get<uint64_t>();
+				ok = true;
+			}
+			break;
+		case F_VMAJOR:
+		case F_VMINOR:
+		case F_VREV:
+		case F_VPROTO:
+		case F_REMOTE_TRACE_LEVEL:
+			if (_isI32(v)) {
+				_i32[fi - F_VMAJOR] = (int32_t)v.get<int64_t>();
+				ok = true;
+			}
+			break;
+		case F_REMOTE_TRACE_TARGET:
+		case F_LAST_AUTHORIZED_CREDENTIAL_TYPE:
+		case F_LAST_AUTHORIZED_CREDENTIAL:
+			if (v.is_null()) {
+				_setStr(fi - F_REMOTE_TRACE_TARGET,(const char *)0,0);
+				ok = true;
+			} else if (v.is_string()) {
+				const std::string &vs = v.get_ref<const std::string &>();
+				_setStr(fi - F_REMOTE_TRACE_TARGET,vs.data(),vs.length());
+				ok = true;
+			}
+			break;
+		case F_IDENTITY:
+			if (v.is_string()) {
+				// Only canonical public type 0 identities for this member: "<address>:0:<128 hex digits>"
+				const std::string &s = v.get_ref<const std::string &>();
+				if ((s.length() == 141)&&(!strncmp(s.c_str(),ids,10))&&(!strncmp(s.c_str() + 10,":0:",3))&&(Utils::unhex(s.c_str() + 13,128,_identity,64) == 64)) {
+					char tmp[129];
+					ok = (!strcmp(Utils::hex(_identity,64,tmp),s.c_str() + 13));
+				}
+			}
+			break;
+		case F_IP_ASSIGNMENTS:
+			ok = _packIps(v,ips);
+			break;
+		case F_CAPABILITIES:
+			ok = _packU32Array(v,caps);
+			break;
+		case F_TAGS:
+			ok = _packTags(v,tags);
+			break;
+		default:
+			break;
+	}
+	if (ok)
+		_present |= (1U << fi);
+	return ok;
+}
+
+void CompactMember::_setExtra(const std::string &k,const nlohmann::json &v)
+{
+	if (!_extra)
+		_extra = new nlohmann::json(nlohmann::json::object());
+	(*_extra)[k] = v;
+}
+
+void CompactMember::_packVar(std::vector<uint32_t> &ips,std::vector<uint32_t> &caps,std::vector<uint32_t> &tags)
+{
+	if ((_present & ((1U << F_IP_ASSIGNMENTS)|(1U << F_CAPABILITIES)|(1U << F_TAGS))) != 0) {
+		if ((_present & (1U << F_IP_ASSIGNMENTS)) == 0) ips.assign(1,0);
+		if ((_present & (1U << F_CAPABILITIES)) == 0) caps.assign(1,0);
+		if ((_present & (1U << F_TAGS)) == 0) tags.assign(1,0);
+		_var.reserve(ips.size() + caps.size() + tags.size());
+		_var.insert(_var.end(),ips.begin(),ips.end());
+		_var.insert(_var.end(),caps.begin(),caps.end());
+		_var.insert(_var.end(),tags.begin(),tags.end());
+		_var.shrink_to_fit();
+	}
+}
+
+bool CompactMember::_varValid() const
+{
+	// Same walk as toJson(), checking every count and IP family against the packed size
+	if ((_present >> F_COUNT) != 0)
+		return false;
+	if ((_present & ((1U << F_IP_ASSIGNMENTS)|(1U << F_CAPABILITIES)|(1U << F_TAGS))) == 0)
+		return _var.empty();
+	const unsigned long vs = (unsigned long)_var.size();
+	unsigned long vp = 0;
+	if (vp >= vs)
+		return false;
+	unsigned long n = _var[vp++];
+	if (((_present & (1U << F_IP_ASSIGNMENTS)) == 0)&&(n != 0))
+		return false;
+	for(unsigned long i=0;i<n;++i) {
+		if (vp >= vs)
+			return false;
+		const uint32_t family = _var[vp++];
+		if ((family != 4)&&(family != 6))
+			return false;
+		vp += (family == 4) ? 1 : 4;
+	}
+	if (vp >= vs)
+		return false;
+	n = _var[vp++];
+	if ((((_present & (1U << F_CAPABILITIES)) == 0)&&(n != 0))||(n > (vs - vp)))
+		return false;
+	vp += n;
+	if (vp >= vs)
+		return false;
+	n = _var[vp++];
+	if ((((_present & (1U << F_TAGS)) == 0)&&(n != 0))||(n > ((vs - vp) / 2)))
+		return false;
+	vp += n * 2;
+	return (vp == vs);
+}
+
+const nlohmann::json *CompactMember::_extraField(const char *k) const
+{
+	if (_extra) {
+		auto f = _extra->find(k);
+		if (f != _extra->end())
+			return &(*f);
+	}
+	return (const nlohmann::json *)0;
+}
+
+void CompactMember::fromJson(const uint64_t networkId,const uint64_t memberId,const nlohmann::json &member)
+{
+	_present = 0;
+	_bools = 0;
+	for(unsigned int i=0;i<3;++i)
+		_setStr(i,(const char *)0,0);
+	_var.clear();
+	delete _extra;
+	_extra = (nlohmann::json *)0;
+	if (!member.is_object())
+		return;
+
+	char ids[24],nwids[24];
+	OSUtils::ztsnprintf(ids,sizeof(ids),"%.10llx",(unsigned long long)memberId);
+	OSUtils::ztsnprintf(nwids,sizeof(nwids),"%.16llx",(unsigned long long)networkId);
+
+	std::vector<uint32_t> ips,caps,tags;
+	for(auto f=member.begin();f!=member.end();++f) {
+		if (!_setField(_fieldIndex(f.key()),f.value(),ids,nwids,ips,caps,tags))
+			_setExtra(f.key(),f.value());
+	}
+	_packVar(ips,caps,tags);
+}
+
+/**
+ * SAX handler for fromJsonText()
+ *
+ * Top level scalars go straight into the record. Nested values are built as
+ * JSON with nlohmann's own DOM builder and then handled like fromJson() does.
+ * Fields that need the member ID are held until the end, since keys are not
+ * in any particular order.
+ */
+struct CompactMember::_SaxHandler
+{
+	typedef nlohmann::detail::json_sax_dom_parser<nlohmann::json> DomBuilder;
+
+	_SaxHandler(CompactMember &m) : cm(m),depth(0),fi(F_COUNT),seen(0),dom((DomBuilder *)0) {}
+	~_SaxHandler() { delete dom; }
+
+	inline bool value(const nlohmann::json &v)
+	{
+		switch(fi) {
+			case F_ID:
+			case F_ADDRESS:
+			case F_NWID:
+			case F_IDENTITY:
+				deferred[fi] = v;
+				return true;
+			default:
+				break;
+		}
+		if (!cm._setField(fi,v,(const char *)0,(const char *)0,ips,caps,tags))
+			cm._setExtra(k,v);
+		return true;
+	}
+
+	inline bool scalar(nlohmann::json &&v)
+	{
+		if (depth != 1)
+			return false; // top level must be an object
+		return value(v);
+	}
+
+	inline bool null() { return ((dom) ? dom->null() : scalar(nlohmann::json())); }
+	inline bool boolean(bool val) { return ((dom) ? dom->boolean(val) : scalar(nlohmann::json(val))); }
+	inline bool number_integer(nlohmann::json::number_integer_t val) { return ((dom) ? dom->number_integer(val) : scalar(nlohmann::json(val))); }
+	inline bool number_unsigned(nlohmann::json::number_unsigned_t val) { return ((dom) ? dom->number_unsigned(val) : scalar(nlohmann::json(val))); }
+	inline bool number_float(nlohmann::json::number_float_t val,const std::string &s) { return ((dom) ? dom->number_float(val,s) : scalar(nlohmann::json(val))); }
+	inline bool string(std::string &val)
+	{
+		if (dom)
+			return dom->string(val);
+		if (depth != 1)
+			return false;
+		// Common string fields are set without a JSON value, which leaves the
+		// parser's buffer in place for the next token.
+		switch(fi) {
+			case F_OBJTYPE:
+				if (val != "member")
+					break;
+				cm._present |= (1U << fi);
+				return true;
+			case F_REMOTE_TRACE_TARGET:
+			case F_LAST_AUTHORIZED_CREDENTIAL_TYPE:
+			case F_LAST_AUTHORIZED_CREDENTIAL:
+				cm._setStr(fi - F_REMOTE_TRACE_TARGET,val.data(),val.length());
+				cm._present |= (1U << fi);
+				return true;
+			default:
+				break;
+		}
+		return value(nlohmann::json(val));
+	}
+
+	inline bool start_object(std::size_t elements)
+	{
+		if (depth++ == 0)
+			return true;
+		if (!dom) {
+			nested = nlohmann::json();
+			dom = new DomBuilder(nested,false);
+		}
+		return dom->start_object(elements);
+	}
+
+	inline bool start_array(std::size_t elements)
+	{
+		if (depth++ == 0)
+			return false;
+		if (!dom) {
+			nested = nlohmann::json();
+			dom = new DomBuilder(nested,false);
+		}
+		return dom->start_array(elements);
+	}
+
+	inline bool end_object()
+	{
+		if (--depth == 0)
+			return true;
+		return ((dom->end_object())&&(endNested()));
+	}
+
+	inline bool end_array()
+	{
+		--depth;
+		return ((dom->end_array())&&(endNested()));
+	}
+
+	inline bool endNested()
+	{
+		if (depth != 1)
+			return true;
+		delete dom;
+		dom = (DomBuilder *)0;
+		return value(nested);
+	}
+
+	inline bool key(std::string &val)
+	{
+		if (dom)
+			return dom->key(val);
+		fi = CompactMember::_fieldIndex(val);
+		if (fi < F_COUNT) {
+			if ((seen & (1U << fi)) != 0)
+				return false; // duplicate key, let the DOM decide which one wins
+			seen |= (1U << fi);
+		} else if (cm._extraField(val.c_str())) {
+			return false;
+		}
+		k.assign(val);
+		return true;
+	}
+
+	inline bool parse_error(std::size_t position,const std::string &lastToken,const nlohmann::detail::exception &ex) { return false; }
+
+	CompactMember &cm;
+	unsigned int depth;
+	unsigned int fi;
+	uint32_t seen;
+	std::string k;
+	nlohmann::json nested;
+	DomBuilder *dom;
+	nlohmann::json deferred[F_COUNT];
+	std::vector<uint32_t> ips,caps,tags;
+};
+
+uint64_t CompactMember::fromJsonText(const uint64_t networkId,const char *json,const unsigned long len)
+{
+	_present = 0;
+	_bools = 0;
+	for(unsigned int i=0;i<3;++i)
+		_setStr(i,(const char *)0,0);
+	_var.clear();
+	delete _extra;
+	_extra = (nlohmann::json *)0;
+
+	_SaxHandler h(*this);
+	bool ok = false;
+	try {
+		ok = nlohmann::json::sax_parse(nlohmann::detail::input_adapter(json,(std::size_t)len),&h);
+	} catch ( ... ) {}
+
+	uint64_t memberId = 0;
+	char ids[24],nwids[24];
+	if ((ok)&&(h.deferred[F_ID].is_string())) {
+		const std::string &idstr = h.deferred[F_ID].get_ref<const std::string &>();
+		memberId = Utils::hexStrToU64(idstr.c_str());
+		OSUtils::ztsnprintf(ids,sizeof(ids),"%.10llx",(unsigned long long)memberId);
+		if (idstr != ids)
+			memberId = 0;
+	}
+	if ((memberId)&&(OSUtils::jsonIntHex(h.deferred[F_NWID],0ULL) == networkId)) {
+		OSUtils::ztsnprintf(nwids,sizeof(nwids),"%.16llx",(unsigned long long)networkId);
+		static const unsigned int deferredFields[4] = { F_ID,F_ADDRESS,F_NWID,F_IDENTITY };
+		for(unsigned int i=0;i<4;++i) {
+			const unsigned int fi = deferredFields[i];
+			if ((h.seen & (1U << fi)) != 0) {
+				if (!_setField(fi,h.deferred[fi],ids,nwids,h.ips,h.caps,h.tags))
+					_setExtra(FIELD_NAMES[fi],h.deferred[fi]);
+			}
+		}
+		_packVar(h.ips,h.caps,h.tags);
+		return memberId;
+	}
+
+	_present = 0;
+	_bools = 0;
+	for(unsigned int i=0;i<3;++i)
+		_setStr(i,(const char *)0,0);
+	delete _extra;
+	_extra = (nlohmann::json *)0;
+	return 0;
+}
+
+void CompactMember::toJson(const uint64_t networkId,const uint64_t memberId,nlohmann::json &member) const
+{
+	member = (_extra) ? *_extra : nlohmann::json::object();
+
+	char tmp[160];
+	unsigned long vp = 0;
+	for(unsigned int fi=0;fi<F_COUNT;++fi) {
+		if ((_present & (1U << fi)) == 0)
+			continue;
+		nlohmann::json &v = member[FIELD_NAMES[fi]];
+		switch(fi) {
+			case F_ID:
+			case F_ADDRESS:
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx",(unsigned long long)memberId);
+				v = tmp;
+				break;
+			case F_NWID:
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)networkId);
+				v = tmp;
+				break;
+			case F_OBJTYPE:
+				v = "member";
+				break;
+			case F_AUTHORIZED:
+			case F_ACTIVE_BRIDGE:
+			case F_NO_AUTO_ASSIGN_IPS:
+				v = ((_bools & (1U << fi)) != 0);
+				break;
+			case F_REVISION:
+			case F_CREATION_TIME:
+			case F_LAST_AUTHORIZED_TIME:
+			case F_LAST_DEAUTHORIZED_TIME:
+				v = _u64[fi - F_REVISION];
+				break;
+			case F_VMAJOR:
+			case F_VMINOR:
+			case F_VREV:
+			case F_VPROTO:
+			case F_REMOTE_TRACE_LEVEL:
+				v = _i32[fi - F_VMAJOR];
+				break;
+			case F_REMOTE_TRACE_TARGET:
+			case F_LAST_AUTHORIZED_CREDENTIAL_TYPE:
+			case F_LAST_AUTHORIZED_CREDENTIAL:
+				if (_str[fi - F_REMOTE_TRACE_TARGET])
+					v = *(_str[fi - F_REMOTE_TRACE_TARGET]);
+				else v = nlohmann::json();
+				break;
+			case F_IDENTITY:
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx:0:",(unsigned long long)memberId);
+				Utils::hex(_identity,64,tmp + 13);
+				v = tmp;
+				break;
+			default:
+				break;
+		}
+	}
+
+	// Packed arrays are always laid out as IPs, capabilities, tags
+	if (!_var.empty()) {
+		unsigned long n = _var[vp++];
+		if ((_present & (1U << F_IP_ASSIGNMENTS)) != 0) {
+			nlohmann::json &ips = member["ipAssignments"];
+			ips = nlohmann::json::array();
+			for(unsigned long i=0;i<n;++i) {
+				const uint32_t family = _var[vp++];
+				const InetAddress ip(&(_var[vp]),(family == 4) ? 4 : 16,0);
+				vp += (family == 4) ? 1 : 4;
+				ips.push_back(ip.toIpString(tmp));
+			}
+		}
+		n = _var[vp++];
+		if ((_present & (1U << F_CAPABILITIES)) != 0) {
+			nlohmann::json &caps = member["capabilities"];
+			caps = nlohmann::json::array();
+			for(unsigned long i=0;i<n;++i)
+				caps.push_back(_var[vp++]);
+		}
+		n = _var[vp++];
+		if ((_present & (1U << F_TAGS)) != 0) {
+			nlohmann::json &tags = member["tags"];
+			tags = nlohmann::json::array();
+			for(unsigned long i=0;i<n;++i) {
+				tags.push_back(nlohmann::json::array({ _var[vp],_var[vp + 1] }));
+				vp += 2;
+			}
+		}
+	}
+}
+
+uint64_t CompactMember::revision() const
+{
+	if ((_present & (1U << F_REVISION)) != 0)
+		return _u64[F_REVISION - F_REVISION];
+	if (_extra) {
+		auto r = _extra->find("revision");
+		if (r != _extra->end())
+			return OSUtils::jsonInt(*r,0ULL);
+	}
+	return 0;
+}
+
+bool CompactMember::authorized() const
+{
+	if ((_present & (1U << F_AUTHORIZED)) != 0)
+		return ((_bools & (1U << F_AUTHORIZED)) != 0);
+	const nlohmann::json *const f = _extraField("authorized");
+	return ((f) ? OSUtils::jsonBool(*f,false) : false);
+}
+
+bool CompactMember::activeBridge() const
+{
+	if ((_present & (1U << F_ACTIVE_BRIDGE)) != 0)
+		return ((_bools & (1U << F_ACTIVE_BRIDGE)) != 0);
+	const nlohmann::json *const f = _extraField("activeBridge");
+	return ((f) ? OSUtils::jsonBool(*f,false) : false);
+}
+
+uint64_t CompactMember::lastDeauthorizedTime() const
+{
+	if ((_present & (1U << F_LAST_DEAUTHORIZED_TIME)) != 0)
+		return _u64[F_LAST_DEAUTHORIZED_TIME - F_REVISION];
+	const nlohmann::json *const f = _extraField("lastDeauthorizedTime");
+	return ((f) ? OSUtils::jsonInt(*f,0ULL) : 0ULL);
+}
+
+void CompactMember::ipAssignments(std::vector<InetAddress> &ips) const
+{
+	if ((_present & (1U << F_IP_ASSIGNMENTS)) != 0) {
+		unsigned long vp = 0;
+		const unsigned long n = _var[vp++];
+		for(unsigned long i=0;i<n;++i) {
+			const uint32_t family = _var[vp++];
+			ips.push_back(InetAddress(&(_var[vp]),(family == 4) ? 4 : 16,0));
+			vp += (family == 4) ? 1 : 4;
+		}
+	} else {
+		const nlohmann::json *const f = _extraField("ipAssignments");
+		if ((f)&&(f->is_array())) {
+			for(auto i=f->begin();i!=f->end();++i) {
+				if (i->is_string()) {
+					ips.push_back(InetAddress(i->get_ref<const std::string &>().c_str()));
+					ips.back().setPort(0);
+				}
+			}
+		}
+	}
+}
+
+void CompactMember::serialize(std::string &out) const
+{
+	out.append((const char *)_u64,sizeof(_u64));
+	out.append((const char *)_i32,sizeof(_i32));
+	out.append((const char *)&_present,sizeof(_present));
+	out.append((const char *)&_bools,sizeof(_bools));
+	for(int i=0;i<3;++i) {
+		const uint32_t l = (_str[i]) ? (uint32_t)_str[i]->length() : 0xffffffffU;
+		out.append((const char *)&l,sizeof(l));
+		if (_str[i])
+			out.append(*_str[i]);
+	}
+	const uint32_t vl = (uint32_t)_var.size();
+	out.append((const char *)&vl,sizeof(vl));
+	if (vl)
+		out.append((const char *)_var.data(),vl * sizeof(uint32_t));
+	out.append((const char *)_identity,sizeof(_identity));
+	const std::string extra((_extra) ? _extra->dump() : std::string());
+	const uint32_t el = (uint32_t)extra.length();
+	out.append((const char *)&el,sizeof(el));
+	out.append(extra);
+}
+
+bool CompactMember::deserialize(const char *&p,const char *const eof)
+{
+	_var.clear();
+	delete _extra;
+	_extra = (nlohmann::json *)0;
+
+	uint32_t l;
+	if ((unsigned long)(eof - p) < (sizeof(_u64) + sizeof(_i32) + sizeof(_present) + sizeof(_bools)))
+		return false;
+	memcpy(_u64,p,sizeof(_u64)); p += sizeof(_u64);
+	memcpy(_i32,p,sizeof(_i32)); p += sizeof(_i32);
+	memcpy(&_present,p,sizeof(_present)); p += sizeof(_present);
+	memcpy(&_bools,p,sizeof(_bools)); p += sizeof(_bools);
+	for(int i=0;i<3;++i) {
+		if ((unsigned long)(eof - p) < sizeof(l))
+			return false;
+		memcpy(&l,p,sizeof(l)); p += sizeof(l);
+		if (l == 0xffffffffU) {
+			_setStr(i,(const char *)0,0);
+		} else {
+			if ((unsigned long)(eof - p) < l)
+				return false;
+			_setStr(i,p,l);
+			p += l;
+		}
+	}
+	if ((unsigned long)(eof - p) < sizeof(l))
+		return false;
+	memcpy(&l,p,sizeof(l)); p += sizeof(l);
+	if (((unsigned long)(eof - p) / sizeof(uint32_t)) < l)
+		return false;
+	_var.resize(l);
+	if (l)
+		memcpy(_var.data(),p,l * sizeof(uint32_t));
+	p += l * sizeof(uint32_t);
+	if (!_varValid())
+		return false;
+	if ((unsigned long)(eof - p) < (sizeof(_identity) + sizeof(l)))
+		return false;
+	memcpy(_identity,p,sizeof(_identity)); p += sizeof(_identity);
+	memcpy(&l,p,sizeof(l)); p += sizeof(l);
+	if (l) {
+		if ((unsigned long)(eof - p) < l)
+			return false;
+		try {
+			_extra = new nlohmann::json(OSUtils::jsonParse(std::string(p,l)));
+		} catch ( ... ) {
+			return false;
+		}
+		if (!_extra->is_object())
+			return false;
+		p += l;
+	}
+	return true;
+}
+
+unsigned long CompactMember::memoryUsage() const
+{
+	unsigned long m = (unsigned long)sizeof(CompactMember) + (unsigned long)(_var.capacity() * sizeof(uint32_t));
+	for(unsigned int i=0;i<3;++i) {
+		if ((i != STR_CREDENTIAL_TYPE)&&(_str[i]))
+			m += (unsigned long)(sizeof(std::string) + _str[i]->capacity());
+	}
+	if (_extra)
+		m += (unsigned long)_extra->dump().length() * 2; // rough, the DOM is bigger than its text
+	return m;
+}
+
+} // namespace ZeroTier
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2023-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_CONTROLLER_COMPACTMEMBER_HPP
+#define ZT_CONTROLLER_COMPACTMEMBER_HPP
+
+#include "../node/Constants.hpp"
+#include "../node/InetAddress.hpp"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "../ext/json/json.hpp"
+
+namespace ZeroTier
+{
+
+/**
+ * Compact in-memory form of a controller member record
+ *
+ * A member held as a JSON DOM costs a heap node per field plus its key and
+ * value strings. This keeps the fields the controller knows about in fixed
+ * binary form, with strings that repeat across members (credential types)
+ * interned, and materializes JSON only when asked.
+ *
+ * Conversion is lossless: any field that is unknown, or whose value doesn't
+ * have the expected type or canonical form, is kept as JSON.
+ */
+class CompactMember
+{
+public:
+	CompactMember();
+	CompactMember(const CompactMember &m);
+	~CompactMember();
+	CompactMember &operator=(const CompactMember &m);
+
+	/**
+	 * Set from JSON
+	 *
+	 * @param networkId Network ID (used to compact "nwid")
+	 * @param memberId Member ID (used to compact "id", "address", and "identity")
+	 * @param member Member record
+	 */
+	void fromJson(const uint64_t networkId,const uint64_t memberId,const nlohmann::json &member);
+
+	/**
+	 * Set from JSON text without building a DOM for the record
+	 *
+	 * The result is the same as parsing the text and calling fromJson(), but
+	 * only nested values of unknown or non-canonical fields are ever built as
+	 * JSON. Text this doesn't handle (syntax errors, anything but an object,
+	 * duplicate keys, an "id" that isn't ten lower case hex digits, or a
+	 * "nwid" other than networkId) makes it return 0 and leaves this record
+	 * empty, so the caller can fall back to the DOM.
+	 *
+	 * @param networkId Network ID
+	 * @param json JSON text
+	 * @param len Length of JSON text
+	 * @return Member ID or 0 if text was not handled
+	 */
+	uint64_t fromJsonText(const uint64_t networkId,const char *json,const unsigned long len);
+
+	/**
+	 * Materialize as JSON
+	 *
+	 * @param networkId Network ID
+	 * @param memberId Member ID
+	 * @param member JSON object to fill (any existing contents are replaced)
+	 */
+	void toJson(const uint64_t networkId,const uint64_t memberId,nlohmann::json &member) const;
+
+	/**
+	 * @return Value of "revision" (without materializing JSON)
+	 */
+	uint64_t revision() const;
+
+	/**
+	 * @return Value of "authorized" as OSUtils::jsonBool() would read it (default: false)
+	 */
+	bool authorized() const;
+
+	/**
+	 * @return Value of "activeBridge" as OSUtils::jsonBool() would read it (default: false)
+	 */
+	bool activeBridge() const;
+
+	/**
+	 * @return Value of "lastDeauthorizedTime" as OSUtils::jsonInt() would read it (default: 0)
+	 */
+	uint64_t lastDeauthorizedTime() const;
+
+	/**
+	 * Get string entries in "ipAssignments" as addresses with port 0
+	 *
+	 * @param ips Vector to append to
+	 */
+	void ipAssignments(std::vector<InetAddress> &ips) const;
+
+	/**
+	 * Append a binary form of this record for a local snapshot
+	 *
+	 * The format is host byte order and only meant to be read back by the
+	 * same build on the same machine.
+	 *
+	 * @param out String to append to
+	 */
+	void serialize(std::string &out) const;
+
+	/**
+	 * Read a record appended by serialize()
+	 *
+	 * @param p Read pointer, advanced past the record
+	 * @param eof End of data
+	 * @return False if data is truncated or invalid
+	 */
+	bool deserialize(const char *&p,const char *const eof);
+
+	/**
+	 * @return Approximate heap and inline memory used by this record in bytes
+	 */
+	unsigned long memoryUsage() const;
+
+private:
+	enum {
+		F_ID = 0,
+		F_ADDRESS,
+		F_NWID,
+		F_OBJTYPE,
+		F_AUTHORIZED,
+		F_ACTIVE_BRIDGE,
+		F_NO_AUTO_ASSIGN_IPS,
+		F_REVISION,
+		F_CREATION_TIME,
+		F_LAST_AUTHORIZED_TIME,
+		F_LAST_DEAUTHORIZED_TIME,
+		F_VMAJOR,
+		F_VMINOR,
+		F_VREV,
+		F_VPROTO,
+		F_REMOTE_TRACE_LEVEL,
+		F_REMOTE_TRACE_TARGET,
+		F_LAST_AUTHORIZED_CREDENTIAL_TYPE,
+		F_LAST_AUTHORIZED_CREDENTIAL,
+		F_IDENTITY,
+		F_IP_ASSIGNMENTS,
+		F_CAPABILITIES,
+		F_TAGS,
+		F_COUNT
+	};
+
+	static const char *const FIELD_NAMES[F_COUNT];
+
+	struct _SaxHandler;
+
+	enum { STR_CREDENTIAL_TYPE = F_LAST_AUTHORIZED_CREDENTIAL_TYPE - F_REMOTE_TRACE_TARGET }; // the one interned _str[] entry
+
+	static unsigned int _fieldIndex(const std::string &k);
+	void _setStr(const unsigned int i,const char *s,const unsigned long len);
+	bool _setField(const unsigned int fi,const nlohmann::json &v,const char *ids,const char *nwids,std::vector<uint32_t> &ips,std::vector<uint32_t> &caps,std::vector<uint32_t> &tags);
+	void _setExtra(const std::string &k,const nlohmann::json &v);
+	void _packVar(std::vector<uint32_t> &ips,std::vector<uint32_t> &caps,std::vector<uint32_t> &tags);
+	bool _varValid() const;
+	const nlohmann::json *_extraField(const char *k) const;
+
+	uint64_t _u64[4];         // revision, creationTime, lastAuthorizedTime, lastDeauthorizedTime
+	int32_t _i32[5];          // vMajor, vMinor, vRev, vProto, remoteTraceLevel
+	uint32_t _present;        // bit per field held here rather than in _extra
+	uint32_t _bools;          // bit per boolean field value
+	const std::string *_str[3]; // remoteTraceTarget, lastAuthorizedCredentialType (interned), lastAuthorizedCredential (NULL means JSON null)
+	std::vector<uint32_t> _var; // packed ipAssignments, capabilities, and tags
+	uint8_t _identity[64];    // public key of a canonical type 0 identity
+	nlohmann::json *_extra;   // anything not held above, usually NULL
+};
+
+} // namespace ZeroTier
+
+#endif
@@ -14,6 +14,8 @@
 #include "DB.hpp"
 #include "EmbeddedNetworkController.hpp"
 
+#include <string.h>
+
 #include <chrono>
 #include <algorithm>
 #include <stdexcept>
@@ -22,6 +24,50 @@ using json = nlohmann::json;
 
 namespace ZeroTier {
 
+namespace {
+
+// Field lookup that doesn't insert a null into the record when the field is missing
+static inline const json &_field(const json &o,const char *k)
+{
+	static const json nullJson;
+	auto f = o.find(k);
+	return (f == o.end()) ? nullJson : *f;
+}
+
+#define ZT_DB_SNAPSHOT_MAGIC 0x5a54435302000000ULL // "ZTCS" + format version
+
+template<typename I>
+static inline void _snapshotPut(std::string &out,const I i) { out.append((const char *)&i,sizeof(I)); }
+
+template<typename I>
+static inline bool _snapshotGet(const char *&p,const char *const eof,I &i)
+{
+	if ((unsigned long)(eof - p) < sizeof(I))
+		return false;
+	memcpy(&i,p,sizeof(I));
+	p += sizeof(I);
+	return true;
+}
+
+static inline void _snapshotPutIp(std::string &out,const InetAddress &ip)
+{
+	const uint8_t len = (ip.isV4()) ? 4 : ((ip.isV6()) ? 16 : 0);
+	_snapshotPut(out,len);
+	out.append((const char *)ip.rawIpData(),len);
+}
+
+static inline bool _snapshotGetIp(const char *&p,const char *const eof,InetAddress &ip)
+{
+	uint8_t len = 0;
+	if ((!_snapshotGet(p,eof,len))||((len != 4)&&(len != 16))||((unsigned long)(eof - p) < len))
+		return false;
+	ip.set(p,len,0);
+	p += len;
+	return true;
+}
+
+} // anonymous namespace
+
 void DB::initNetwork(nlohmann::json &network)
 {
 	if (!network.count("private")) network["private"] = true;
@@ -92,9 +138,124 @@ void DB::cleanMember(nlohmann::json &member)
 	member.erase("lastRequestMetaData");
 }
 
-DB::DB() {}
+DB::MemberChange DB::memberChangeType(const nlohmann::json &old,const nlohmann::json &member)
+{
+	if ((!old.is_object())||(old.empty())||(!member.is_object())||(old.size() != member.size()))
+		return MEMBER_CHANGED;
+	MemberChange ch = MEMBER_UNCHANGED;
+	for(auto i=member.begin();i!=member.end();++i) {
+		if (i.key() == "revision")
+			continue;
+		auto o = old.find(i.key());
+		if (o == old.end())
+			return MEMBER_CHANGED;
+		if (*o != i.value()) {
+			if (!isVolatileMemberField(i.key()))
+				return MEMBER_CHANGED;
+			ch = MEMBER_CHANGED_VOLATILE;
+		}
+	}
+	return ch;
+}
+
+void DB::coalesceCommits(std::vector< std::pair<nlohmann::json,bool> > &batch)
+{
+	// key -> (index of latest record, latest record is a delete)
+	std::unordered_map< std::string,std::pair<unsigned long,bool> > latest;
+	std::string key;
+	for(unsigned long i=(unsigned long)batch.size();i>0;) {
+		const nlohmann::json &r = batch[--i].first;
+		if (!r.is_object())
+			continue;
+		const std::string objtype(OSUtils::jsonString(r.value("objtype",nlohmann::json()),""));
+		const std::string id(OSUtils::jsonString(r.value("id",nlohmann::json()),""));
+		const bool del = (objtype.compare(0,8,"_delete_") == 0);
+		if ((objtype == "member")||(objtype == "_delete_member")) {
+			key = "m";
+			key.append(OSUtils::jsonString(r.value("nwid",nlohmann::json()),""));
+			key.push_back('-');
+			key.append(id);
+		} else if ((objtype == "network")||(objtype == "_delete_network")) {
+			key = "n";
+			key.append(id);
+		} else continue;
+		auto l = latest.find(key);
+		if (l == latest.end()) {
+			latest[key] = std::pair<unsigned long,bool>(i,del);
+		} else if ((del)&&(!l->second.second)) {
+			// A delete followed by a re-create must still run (deleting a network
+			// also removes its members), and it replaces anything before it.
+			l->second.first = i;
+			l->second.second = true;
+		} else {
+			batch[l->second.first].second |= batch[i].second;
+			batch[i].first = nlohmann::json();
+		}
+	}
+}
+
+DB::DB() : _journalLatest(0) {}
 DB::~DB() {}
 
+bool DB::changesSince(const uint64_t since,std::vector<Change> &changes,uint64_t &latest) const
+{
+	changes.clear();
+	std::lock_guard<std::mutex> l(_journal_l);
+	latest = _journalLatest;
+	if (since >= _journalLatest)
+		return true;
+	if ((_journalLatest - since) > (uint64_t)_journal.size())
+		return false;
+	changes.reserve((unsigned long)(_journalLatest - since));
+	for(uint64_t s=since+1;s<=_journalLatest;++s)
+		changes.push_back(_journal[(unsigned long)((s - 1) % ZT_DB_CHANGE_JOURNAL_SIZE)]);
+	return true;
+}
+
+void DB::nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress)
+{
+	const int64_t now = OSUtils::now();
+	_OnlineStripe &s = _onlineStripes[(unsigned long)(memberId % ZT_CONTROLLER_ONLINE_STRIPES)];
+	std::lock_guard<std::mutex> l(s.lock);
+	_OnlineStatus &st = s.pending[std::pair<uint64_t,uint64_t>(networkId,memberId)];
+	st.lastSeen = now;
+	if (physicalAddress)
+		st.physicalAddress = physicalAddress;
+}
+
+void DB::_takeOnline(_OnlineMap &online)
+{
+	online.clear();
+	_OnlineMap tmp;
+	for(unsigned int i=0;i<ZT_CONTROLLER_ONLINE_STRIPES;++i) {
+		{
+			std::lock_guard<std::mutex> l(_onlineStripes[i].lock);
+			tmp.swap(_onlineStripes[i].pending);
+		}
+		if (online.empty()) {
+			online.swap(tmp);
+		} else {
+			for(auto o=tmp.begin();o!=tmp.end();++o)
+				online[o->first] = o->second;
+			tmp.clear();
+		}
+	}
+}
+
+void DB::_returnOnline(const _OnlineMap &online)
+{
+	for(auto o=online.begin();o!=online.end();++o) {
+		_OnlineStripe &s = _onlineStripes[(unsigned long)(o->first.second % ZT_CONTROLLER_ONLINE_STRIPES)];
+		std::lock_guard<std::mutex> l(s.lock);
+		auto st = s.pending.find(o->first);
+		if (st == s.pending.end()) {
+			s.pending[o->first] = o->second;
+		} else if (!st->second.physicalAddress) {
+			st->second.physicalAddress = o->second.physicalAddress;
+		}
+	}
+}
+
 bool DB::get(const uint64_t networkId,nlohmann::json &network)
 {
 	waitForReady();
@@ -108,7 +269,7 @@ bool DB::get(const uint64_t networkId,nlohmann::json &network)
 	}
 	{
 		std::lock_guard<std::mutex> l2(nw->lock);
-		network = nw->config;
+		network = *(nw->config);
 	}
 	return true;
 }
@@ -126,16 +287,39 @@ bool DB::get(const uint64_t networkId,nlohmann::json &network,const uint64_t mem
 	}
 	{
 		std::lock_guard<std::mutex> l2(nw->lock);
-		network = nw->config;
+		network = *(nw->config);
 		auto m = nw->members.find(memberId);
 		if (m == nw->members.end())
 			return false;
-		member = m->second;
+		m->second.toJson(networkId,memberId,member);
 	}
 	return true;
 }
 
 bool DB::get(const uint64_t networkId,nlohmann::json &network,const uint64_t memberId,nlohmann::json &member,NetworkSummaryInfo &info)
+{
+	waitForReady();
+	std::shared_ptr<_Network> nw;
+	{
+		std::lock_guard<std::mutex> l(_networks_l);
+		auto nwi = _networks.find(networkId);
+		if (nwi == _networks.end())
+			return false;
+		nw = nwi->second;
+	}
+	{
+		std::lock_guard<std::mutex> l2(nw->lock);
+		network = *(nw->config);
+		_fillSummaryInfo(nw,info);
+		auto m = nw->members.find(memberId);
+		if (m == nw->members.end())
+			return false;
+		m->second.toJson(networkId,memberId,member);
+	}
+	return true;
+}
+
+bool DB::get(const uint64_t networkId,std::shared_ptr<const nlohmann::json> &network,const uint64_t memberId,nlohmann::json &member,NetworkSummaryInfo &info)
 {
 	waitForReady();
 	std::shared_ptr<_Network> nw;
@@ -153,7 +337,7 @@ bool DB::get(const uint64_t networkId,nlohmann::json &network,const uint64_t mem
 		auto m = nw->members.find(memberId);
 		if (m == nw->members.end())
 			return false;
-		member = m->second;
+		m->second.toJson(networkId,memberId,member);
 	}
 	return true;
 }
@@ -171,9 +355,12 @@ bool DB::get(const uint64_t networkId,nlohmann::json &network,std::vector<nlohma
 	}
 	{
 		std::lock_guard<std::mutex> l2(nw->lock);
-		network = nw->config;
-		for(auto m=nw->members.begin();m!=nw->members.end();++m)
-			members.push_back(m->second);
+		network = *(nw->config);
+		members.reserve(members.size() + nw->members.size());
+		for(auto m=nw->members.begin();m!=nw->members.end();++m) {
+			members.emplace_back();
+			m->second.toJson(networkId,m->first,members.back());
+		}
 	}
 	return true;
 }
@@ -186,6 +373,52 @@ void DB::networks(std::set<uint64_t> &networks)
 		networks.insert(n->first);
 }
 
+bool DB::ipAllocated(const uint64_t networkId,const InetAddress &ip)
+{
+	waitForReady();
+	std::shared_ptr<_Network> nw;
+	{
+		std::lock_guard<std::mutex> l(_networks_l);
+		auto nwi = _networks.find(networkId);
+		if (nwi == _networks.end())
+			return false;
+		nw = nwi->second;
+	}
+	InetAddress ipa(ip);
+	ipa.setPort(0);
+	{
+		std::lock_guard<std::mutex> l2(nw->lock);
+		return (nw->allocatedIps.find(ipa) != nw->allocatedIps.end());
+	}
+}
+
+bool DB::isAuthorized(const uint64_t networkId,const uint64_t memberId)
+{
+	waitForReady();
+	std::shared_ptr<_Network> nw;
+	{
+		std::lock_guard<std::mutex> l(_networks_l);
+		auto nwi = _networks.find(networkId);
+		if (nwi == _networks.end())
+			return false;
+		nw = nwi->second;
+	}
+	{
+		std::lock_guard<std::mutex> l2(nw->lock);
+		return (nw->authorizedMembers.find(memberId) != nw->authorizedMembers.end());
+	}
+}
+
+unsigned long DB::saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners)
+{
+	unsigned long n = 0;
+	for(auto r=records.begin();r!=records.end();++r) {
+		if ((r->is_object())&&(OSUtils::jsonIntHex((*r)["nwid"],0ULL) == networkId)&&(save(*r,notifyListeners)))
+			++n;
+	}
+	return n;
+}
+
 void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool notifyListeners)
 {
 	uint64_t memberId = 0;
@@ -219,7 +452,9 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 							const std::string ips = ipj;
 							InetAddress ipa(ips.c_str());
 							ipa.setPort(0);
-							nw->allocatedIps.erase(ipa);
+							auto a = nw->allocatedIps.find(ipa);
+							if ((a != nw->allocatedIps.end())&&(--a->second == 0))
+								nw->allocatedIps.erase(a);
 						}
 					}
 				}
@@ -243,7 +478,7 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 		{
 			std::lock_guard<std::mutex> l(nw->lock);
 
-			nw->members[memberId] = memberConfig;
+			nw->members[memberId].fromJson(networkId,memberId,memberConfig);
 
 			if (OSUtils::jsonBool(memberConfig["activeBridge"],false))
 				nw->activeBridgeMembers.insert(memberId);
@@ -258,7 +493,7 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 						const std::string ips = ipj;
 						InetAddress ipa(ips.c_str());
 						ipa.setPort(0);
-						nw->allocatedIps.insert(ipa);
+						++nw->allocatedIps[ipa];
 					}
 				}
 			}
@@ -270,6 +505,8 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 			}
 		}
 
+		_journalChange(networkId,memberId,OSUtils::jsonInt(_field(memberConfig,"revision"),0ULL));
+
 		if (notifyListeners) {
 			std::lock_guard<std::mutex> ll(_changeListeners_l);
 			for(auto i=_changeListeners.begin();i!=_changeListeners.end();++i) {
@@ -301,6 +538,292 @@ void DB::_memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool no
 	}
 }
 
+void DB::_membersChanged(const uint64_t networkId,std::vector<nlohmann::json> &records,std::vector<unsigned long> &changed,bool notifyListeners)
+{
+	std::shared_ptr<_Network> nw;
+	{
+		std::lock_guard<std::mutex> l(_networks_l);
+		std::shared_ptr<_Network> &nw2 = _networks[networkId];
+		if (!nw2)
+			nw2.reset(new _Network);
+		nw = nw2;
+	}
+
+	std::vector<uint64_t> deauthorized;
+	{
+		json old;
+		std::lock_guard<std::mutex> l(nw->lock);
+		for(unsigned long ri=0;ri<(unsigned long)records.size();++ri) {
+			json &member = records[ri];
+			if (!member.is_object())
+				continue;
+			const uint64_t memberId = OSUtils::jsonIntHex(_field(member,"id"),0ULL);
+			if ((!memberId)||(OSUtils::jsonIntHex(_field(member,"nwid"),0ULL) != networkId))
+				continue;
+
+			auto m = nw->members.find(memberId);
+			bool wasAuth = false;
+			if (m != nw->members.end()) {
+				m->second.toJson(networkId,memberId,old);
+				if (_compareRecords(old,member))
+					continue;
+				if (OSUtils::jsonBool(old["activeBridge"],false))
+					nw->activeBridgeMembers.erase(memberId);
+				wasAuth = OSUtils::jsonBool(old["authorized"],false);
+				if (wasAuth)
+					nw->authorizedMembers.erase(memberId);
+				json &ips = old["ipAssignments"];
+				if (ips.is_array()) {
+					for(auto i=ips.begin();i!=ips.end();++i) {
+						if (i->is_string()) {
+							InetAddress ipa(i->get<std::string>().c_str());
+							ipa.setPort(0);
+							auto a = nw->allocatedIps.find(ipa);
+							if ((a != nw->allocatedIps.end())&&(--a->second == 0))
+								nw->allocatedIps.erase(a);
+						}
+					}
+				}
+			}
+
+			member["revision"] = OSUtils::jsonInt(member["revision"],0ULL) + 1ULL;
+			nw->members[memberId].fromJson(networkId,memberId,member);
+
+			if (OSUtils::jsonBool(_field(member,"activeBridge"),false))
+				nw->activeBridgeMembers.insert(memberId);
+			const bool isAuth = OSUtils::jsonBool(_field(member,"authorized"),false);
+			if (isAuth) {
+				nw->authorizedMembers.insert(memberId);
+			} else {
+				const int64_t ldt = (int64_t)OSUtils::jsonInt(_field(member,"lastDeauthorizedTime"),0ULL);
+				if (ldt > nw->mostRecentDeauthTime)
+					nw->mostRecentDeauthTime = ldt;
+				if (wasAuth)
+					deauthorized.push_back(memberId);
+			}
+			const json &ips = _field(member,"ipAssignments");
+			if (ips.is_array()) {
+				for(auto i=ips.begin();i!=ips.end();++i) {
+					if (i->is_string()) {
+						InetAddress ipa(i->get<std::string>().c_str());
+						ipa.setPort(0);
+						++nw->allocatedIps[ipa];
+					}
+				}
+			}
+
+			changed.push_back(ri);
+		}
+	}
+
+	for(auto c=changed.begin();c!=changed.end();++c)
+		_journalChange(networkId,OSUtils::jsonIntHex(_field(records[*c],"id"),0ULL),OSUtils::jsonInt(_field(records[*c],"revision"),0ULL));
+
+	if (notifyListeners) {
+		std::lock_guard<std::mutex> ll(_changeListeners_l);
+		for(auto c=changed.begin();c!=changed.end();++c) {
+			for(auto i=_changeListeners.begin();i!=_changeListeners.end();++i)
+				(*i)->onNetworkMemberUpdate(this,networkId,OSUtils::jsonIntHex(_field(records[*c],"id"),0ULL),records[*c]);
+		}
+		for(auto d=deauthorized.begin();d!=deauthorized.end();++d) {
+			for(auto i=_changeListeners.begin();i!=_changeListeners.end();++i)
+				(*i)->onNetworkMemberDeauthorize(this,networkId,*d);
+		}
+	}
+}
+
+void DB::_journalChange(const uint64_t networkId,const uint64_t memberId,const uint64_t revision)
+{
+	std::lock_guard<std::mutex> l(_journal_l);
+	Change c;
+	c.sequence = ++_journalLatest;
+	c.networkId = networkId;
+	c.memberId = memberId;
+	c.revision = revision;
+	if (_journal.size() < ZT_DB_CHANGE_JOURNAL_SIZE)
+		_journal.push_back(c);
+	else _journal[(unsigned long)((c.sequence - 1) % ZT_DB_CHANGE_JOURNAL_SIZE)] = c;
+}
+
+void DB::_prepareLoadedMember(const uint64_t networkId,const nlohmann::json &member,_LoadedMember &lm)
+{
+	lm.id = 0;
+	lm.ips.clear();
+	if (!member.is_object())
+		return;
+	const uint64_t memberId = OSUtils::jsonIntHex(_field(member,"id"),0ULL);
+	if ((!memberId)||(OSUtils::jsonIntHex(_field(member,"nwid"),0ULL) != networkId))
+		return;
+	lm.member.fromJson(networkId,memberId,member);
+	lm.authorized = OSUtils::jsonBool(_field(member,"authorized"),false);
+	lm.activeBridge = OSUtils::jsonBool(_field(member,"activeBridge"),false);
+	lm.lastDeauthorizedTime = (lm.authorized) ? 0 : (int64_t)OSUtils::jsonInt(_field(member,"lastDeauthorizedTime"),0ULL);
+	const json &ips = _field(member,"ipAssignments");
+	if (ips.is_array()) {
+		for(auto i=ips.begin();i!=ips.end();++i) {
+			if (i->is_string()) {
+				lm.ips.push_back(InetAddress(i->get_ref<const std::string &>().c_str()));
+				lm.ips.back().setPort(0);
+			}
+		}
+	}
+	lm.id = memberId;
+}
+
+bool DB::_prepareLoadedMember(const uint64_t networkId,const std::string &member,_LoadedMember &lm)
+{
+	lm.ips.clear();
+	lm.id = lm.member.fromJsonText(networkId,member.data(),(unsigned long)member.length());
+	if (!lm.id)
+		return false;
+	lm.authorized = lm.member.authorized();
+	lm.activeBridge = lm.member.activeBridge();
+	lm.lastDeauthorizedTime = (lm.authorized) ? 0 : (int64_t)lm.member.lastDeauthorizedTime();
+	lm.member.ipAssignments(lm.ips);
+	return true;
+}
+
+void DB::_membersLoaded(const uint64_t networkId,std::vector<_LoadedMember> &members)
+{
+	std::shared_ptr<_Network> nw;
+	{
+		std::lock_guard<std::mutex> l(_networks_l);
+		std::shared_ptr<_Network> &nw2 = _networks[networkId];
+		if (!nw2)
+			nw2.reset(new _Network);
+		nw = nw2;
+	}
+
+	std::sort(members.begin(),members.end(),[](const _LoadedMember &a,const _LoadedMember &b) { return (a.id < b.id); });
+
+	std::lock_guard<std::mutex> l(nw->lock);
+	for(auto m=members.begin();m!=members.end();++m) {
+		if (!m->id)
+			continue;
+		if (nw->members.count(m->id)) // ignore duplicate IDs so indexes stay consistent
+			continue;
+		auto mi = nw->members.emplace_hint(nw->members.end(),m->id,CompactMember());
+		std::swap(mi->second,m->member);
+		if (m->authorized)
+			nw->authorizedMembers.insert(m->id);
+		if (m->activeBridge)
+			nw->activeBridgeMembers.insert(m->id);
+		for(auto ip=m->ips.begin();ip!=m->ips.end();++ip)
+			++nw->allocatedIps[*ip];
+		if (m->lastDeauthorizedTime > nw->mostRecentDeauthTime)
+			nw->mostRecentDeauthTime = m->lastDeauthorizedTime;
+	}
+}
+
+void DB::_writeSnapshot(std::string &out,const std::string &fingerprint)
+{
+	std::vector< std::pair< uint64_t,std::shared_ptr<_Network> > > networks;
+	{
+		std::lock_guard<std::mutex> l(_networks_l);
+		for(auto nw=_networks.begin();nw!=_networks.end();++nw)
+			networks.push_back(*nw);
+	}
+
+	_snapshotPut(out,(uint64_t)ZT_DB_SNAPSHOT_MAGIC);
+	_snapshotPut(out,(uint64_t)fingerprint.length());
+	out.append(fingerprint);
+	_snapshotPut(out,(uint64_t)networks.size());
+	for(auto nw=networks.begin();nw!=networks.end();++nw) {
+		std::lock_guard<std::mutex> l(nw->second->lock);
+		_snapshotPut(out,nw->first);
+		const std::string config(OSUtils::jsonDump(*(nw->second->config),-1));
+		_snapshotPut(out,(uint64_t)config.length());
+		out.append(config);
+		_snapshotPut(out,nw->second->mostRecentDeauthTime);
+
+		_snapshotPut(out,(uint64_t)nw->second->members.size());
+		for(auto m=nw->second->members.begin();m!=nw->second->members.end();++m) {
+			_snapshotPut(out,m->first);
+			m->second.serialize(out);
+		}
+		_snapshotPut(out,(uint64_t)nw->second->authorizedMembers.size());
+		for(auto m=nw->second->authorizedMembers.begin();m!=nw->second->authorizedMembers.end();++m)
+			_snapshotPut(out,*m);
+		_snapshotPut(out,(uint64_t)nw->second->activeBridgeMembers.size());
+		for(auto m=nw->second->activeBridgeMembers.begin();m!=nw->second->activeBridgeMembers.end();++m)
+			_snapshotPut(out,*m);
+		_snapshotPut(out,(uint64_t)nw->second->allocatedIps.size());
+		for(auto ip=nw->second->allocatedIps.begin();ip!=nw->second->allocatedIps.end();++ip) {
+			_snapshotPutIp(out,ip->first);
+			_snapshotPut(out,(uint64_t)ip->second);
+		}
+	}
+	_snapshotPut(out,(uint64_t)ZT_DB_SNAPSHOT_MAGIC); // also marks a complete write
+}
+
+bool DB::_readSnapshot(const std::string &in,const std::string &fingerprint)
+{
+	const char *p = in.data();
+	const char *const eof = p + in.length();
+	uint64_t magic = 0,networkCount = 0,n = 0;
+	if ((!_snapshotGet(p,eof,magic))||(magic != ZT_DB_SNAPSHOT_MAGIC)||(in.length() < 16)||(memcmp(eof - 8,&magic,8) != 0)||(!_snapshotGet(p,eof,n)))
+		return false;
+	if ((n != (uint64_t)fingerprint.length())||((uint64_t)(eof - p) < n)||(memcmp(p,fingerprint.data(),(std::size_t)n) != 0))
+		return false; // storage changed since the snapshot was written
+	p += n;
+	if (!_snapshotGet(p,eof,networkCount))
+		return false;
+
+	std::vector< std::pair< uint64_t,std::shared_ptr<_Network> > > networks;
+	for(uint64_t k=0;k<networkCount;++k) {
+		uint64_t networkId = 0,id = 0;
+		std::shared_ptr<_Network> nw(new _Network);
+		if ((!_snapshotGet(p,eof,networkId))||(!_snapshotGet(p,eof,n))||((uint64_t)(eof - p) < n))
+			return false;
+		try {
+			nw->config.reset(new nlohmann::json(OSUtils::jsonParse(std::string(p,(std::size_t)n))));
+		} catch ( ... ) {
+			return false;
+		}
+		p += n;
+		if ((!_snapshotGet(p,eof,nw->mostRecentDeauthTime))||(!_snapshotGet(p,eof,n)))
+			return false;
+		for(uint64_t i=0;i<n;++i) {
+			if (!_snapshotGet(p,eof,id))
+				return false;
+			auto m = nw->members.emplace_hint(nw->members.end(),id,CompactMember());
+			if (!m->second.deserialize(p,eof))
+				return false;
+		}
+		if (!_snapshotGet(p,eof,n))
+			return false;
+		for(uint64_t i=0;i<n;++i) {
+			if (!_snapshotGet(p,eof,id))
+				return false;
+			nw->authorizedMembers.insert(id);
+		}
+		if (!_snapshotGet(p,eof,n))
+			return false;
+		for(uint64_t i=0;i<n;++i) {
+			if (!_snapshotGet(p,eof,id))
+				return false;
+			nw->activeBridgeMembers.insert(id);
+		}
+		if (!_snapshotGet(p,eof,n))
+			return false;
+		for(uint64_t i=0;i<n;++i) {
+			InetAddress ip;
+			uint64_t count = 0;
+			if ((!_snapshotGetIp(p,eof,ip))||(!_snapshotGet(p,eof,count)))
+				return false;
+			nw->allocatedIps.emplace_hint(nw->allocatedIps.end(),ip,(unsigned long)count);
+		}
+		networks.push_back(std::pair< uint64_t,std::shared_ptr<_Network> >(networkId,nw));
+	}
+	if ((!_snapshotGet(p,eof,magic))||(p != eof))
+		return false;
+
+	std::lock_guard<std::mutex> l(_networks_l);
+	for(auto nw=networks.begin();nw!=networks.end();++nw)
+		_networks[nw->first] = nw->second;
+	return true;
+}
+
 void DB::_networkChanged(nlohmann::json &old,nlohmann::json &networkConfig,bool notifyListeners)
 {
 	if (networkConfig.is_object()) {
@@ -315,10 +838,12 @@ void DB::_networkChanged(nlohmann::json &old,nlohmann::json &networkConfig,bool
 					nw2.reset(new _Network);
 				nw = nw2;
 			}
+			std::shared_ptr<const nlohmann::json> config(new nlohmann::json(networkConfig));
 			{
 				std::lock_guard<std::mutex> l2(nw->lock);
-				nw->config = networkConfig;
+				nw->config.swap(config);
 			}
+			_journalChange(networkId,0,OSUtils::jsonInt(_field(networkConfig,"revision"),0ULL));
 			if (notifyListeners) {
 				std::lock_guard<std::mutex> ll(_changeListeners_l);
 				for(auto i=_changeListeners.begin();i!=_changeListeners.end();++i) {
@@ -341,9 +866,6 @@ void DB::_fillSummaryInfo(const std::shared_ptr<_Network> &nw,NetworkSummaryInfo
 	for(auto ab=nw->activeBridgeMembers.begin();ab!=nw->activeBridgeMembers.end();++ab)
 		info.activeBridges.push_back(Address(*ab));
 	std::sort(info.activeBridges.begin(),info.activeBridges.end());
-	for(auto ip=nw->allocatedIps.begin();ip!=nw->allocatedIps.end();++ip)
-		info.allocatedIps.push_back(*ip);
-	std::sort(info.allocatedIps.begin(),info.allocatedIps.end());
 	info.authorizedMemberCount = (unsigned long)nw->authorizedMembers.size();
 	info.totalMemberCount = (unsigned long)nw->members.size();
 	info.mostRecentDeauthTime = nw->mostRecentDeauthTime;
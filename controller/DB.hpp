@@ -21,6 +21,7 @@
 #include "../node/InetAddress.hpp"
 #include "../osdep/OSUtils.hpp"
 #include "../osdep/BlockingQueue.hpp"
+#include "CompactMember.hpp"
 
 #include <memory>
 #include <string>
@@ -31,9 +32,19 @@
 #include <atomic>
 #include <mutex>
 #include <set>
+#include <map>
 
 #include "../ext/json/json.hpp"
 
+// Number of independently locked stripes online status updates are spread over
+#define ZT_CONTROLLER_ONLINE_STRIPES 16
+
+// How often backends flush aggregated online status (ms)
+#define ZT_CONTROLLER_ONLINE_FLUSH_PERIOD 1000
+
+// Number of recent network and member changes each DB remembers for incremental sync
+#define ZT_DB_CHANGE_JOURNAL_SIZE 65536
+
 namespace ZeroTier
 {
 
@@ -57,17 +68,78 @@ public:
 	{
 		NetworkSummaryInfo() : authorizedMemberCount(0),totalMemberCount(0),mostRecentDeauthTime(0) {}
 		std::vector<Address> activeBridges;
-		std::vector<InetAddress> allocatedIps;
 		unsigned long authorizedMemberCount;
 		unsigned long totalMemberCount;
 		int64_t mostRecentDeauthTime;
 	};
 
+	/**
+	 * How a member record differs from its previously stored version
+	 */
+	enum MemberChange
+	{
+		MEMBER_UNCHANGED = 0,
+		MEMBER_CHANGED_VOLATILE = 1, // only fields that are refreshed on every request (e.g. client version)
+		MEMBER_CHANGED = 2
+	};
+
+	/**
+	 * A network or member change recorded in a DB's change journal
+	 */
+	struct Change
+	{
+		uint64_t sequence;
+		uint64_t networkId;
+		uint64_t memberId; // zero for network changes
+		uint64_t revision;
+	};
+
+	/**
+	 * Hash for (network ID, member ID) keys in unordered containers
+	 */
+	struct PairHasher
+	{
+		inline std::size_t operator()(const std::pair<uint64_t,uint64_t> &p) const { return (std::size_t)(p.first ^ p.second); }
+	};
+
 	static void initNetwork(nlohmann::json &network);
 	static void initMember(nlohmann::json &member);
 	static void cleanNetwork(nlohmann::json &network);
 	static void cleanMember(nlohmann::json &member);
 
+	/**
+	 * Classify the difference between a stored member record and a new one
+	 *
+	 * The revision counter is ignored. A null or empty old record is always
+	 * a material change.
+	 *
+	 * @param old Member as previously stored
+	 * @param member Member about to be saved
+	 * @return Kind of change
+	 */
+	static MemberChange memberChangeType(const nlohmann::json &old,const nlohmann::json &member);
+
+	/**
+	 * Drop queued commit records that a later record in the same batch replaces
+	 *
+	 * Records are keyed by objtype ("member", "network", "_delete_member" or
+	 * "_delete_network") and ID. Replaced records are set to null in place so
+	 * queue order is kept, and the surviving record notifies listeners if any
+	 * record it replaced would have. A delete is never replaced by a later
+	 * upsert of the same object.
+	 *
+	 * @param batch Batch of (record, notify) pairs in queue order
+	 */
+	static void coalesceCommits(std::vector< std::pair<nlohmann::json,bool> > &batch);
+
+	/**
+	 * @return True if a member field is volatile (see memberChangeType())
+	 */
+	static inline bool isVolatileMemberField(const std::string &k)
+	{
+		return ((k == "vMajor")||(k == "vMinor")||(k == "vRev")||(k == "vProto"));
+	}
+
 	DB();
 	virtual ~DB();
 
@@ -85,27 +157,149 @@ public:
 	bool get(const uint64_t networkId,nlohmann::json &network,const uint64_t memberId,nlohmann::json &member,NetworkSummaryInfo &info);
 	bool get(const uint64_t networkId,nlohmann::json &network,std::vector<nlohmann::json> &members);
 
+	/**
+	 * Get a network and member without copying the network record
+	 *
+	 * The network is returned as a shared immutable snapshot. Saves replace
+	 * the snapshot rather than modifying it, so it can be read without a lock
+	 * for as long as the caller holds it.
+	 *
+	 * @param networkId Network ID
+	 * @param network Set to network snapshot if network exists
+	 * @param memberId Member ID
+	 * @param member Member record to fill
+	 * @param info Network summary info to fill
+	 * @return True if network and member were both found
+	 */
+	bool get(const uint64_t networkId,std::shared_ptr<const nlohmann::json> &network,const uint64_t memberId,nlohmann::json &member,NetworkSummaryInfo &info);
+
 	void networks(std::set<uint64_t> &networks);
 
+	/**
+	 * Check whether an IP is assigned to any member of a network
+	 *
+	 * This is a lookup in an index maintained as members change, so it does
+	 * not copy or sort the network's allocated IPs.
+	 *
+	 * @param networkId Network ID
+	 * @param ip IP address (port is ignored)
+	 * @return True if IP is assigned to at least one member
+	 */
+	bool ipAllocated(const uint64_t networkId,const InetAddress &ip);
+
+	/**
+	 * @param networkId Network ID
+	 * @param memberId Member ID
+	 * @return True if member exists and is authorized
+	 */
+	bool isAuthorized(const uint64_t networkId,const uint64_t memberId);
+
+	/**
+	 * Visit a network's members in ascending ID order without materializing them
+	 *
+	 * The network is locked while visiting, so the function should be quick
+	 * and must not call back into this DB.
+	 *
+	 * @param networkId Network ID
+	 * @param after Start after this member ID (0 to start at the first member)
+	 * @param authorizedOnly If true, skip members that are not authorized
+	 * @param minRevision Skip members whose revision is lower than this
+	 * @param f Function called with (member ID, revision, authorized), returns false to stop
+	 * @return False if network was not found
+	 */
+	template<typename F>
+	inline bool eachMember(const uint64_t networkId,const uint64_t after,const bool authorizedOnly,const uint64_t minRevision,F f)
+	{
+		waitForReady();
+		std::shared_ptr<_Network> nw;
+		{
+			std::lock_guard<std::mutex> l(_networks_l);
+			auto nwi = _networks.find(networkId);
+			if (nwi == _networks.end())
+				return false;
+			nw = nwi->second;
+		}
+		std::lock_guard<std::mutex> l2(nw->lock);
+		for(auto m=((after) ? nw->members.upper_bound(after) : nw->members.begin());m!=nw->members.end();++m) {
+			const bool authorized = (nw->authorizedMembers.find(m->first) != nw->authorizedMembers.end());
+			if ((authorizedOnly)&&(!authorized))
+				continue;
+			const uint64_t revision = m->second.revision();
+			if (revision < minRevision)
+				continue;
+			if (!f(m->first,revision,authorized))
+				break;
+		}
+		return true;
+	}
+
 	template<typename F>
 	inline void each(F f)
 	{
-		nlohmann::json nullJson;
+		nlohmann::json nullJson,member;
 		std::lock_guard<std::mutex> lck(_networks_l);
 		for(auto nw=_networks.begin();nw!=_networks.end();++nw) {
-			f(nw->first,nw->second->config,0,nullJson); // first provide network with 0 for member ID
+			f(nw->first,*(nw->second->config),0,nullJson); // first provide network with 0 for member ID
 			for(auto m=nw->second->members.begin();m!=nw->second->members.end();++m) {
-				f(nw->first,nw->second->config,m->first,m->second);
+				m->second.toJson(nw->first,m->first,member);
+				f(nw->first,*(nw->second->config),m->first,member);
 			}
 		}
 	}
 
+	/**
+	 * Get network and member changes recorded after a journal sequence number
+	 *
+	 * The journal keeps the last ZT_DB_CHANGE_JOURNAL_SIZE changes. Records
+	 * loaded at startup are not journaled.
+	 *
+	 * @param since Sequence number of the last change already seen (0 for none)
+	 * @param changes Vector to fill with changes in sequence order (existing contents are replaced)
+	 * @param latest Set to the sequence number of the most recent change
+	 * @return False if changes after 'since' have already been dropped from the journal
+	 */
+	bool changesSince(const uint64_t since,std::vector<Change> &changes,uint64_t &latest) const;
+
+	/**
+	 * @return Sequence number of the most recent change (0 if none)
+	 */
+	inline uint64_t latestChange() const
+	{
+		std::lock_guard<std::mutex> l(_journal_l);
+		return _journalLatest;
+	}
+
 	virtual bool save(nlohmann::json &record,bool notifyListeners) = 0;
 
+	/**
+	 * Save a batch of member records belonging to one network
+	 *
+	 * The default implementation saves records one at a time. Backends
+	 * override this to apply the whole batch under one network lock and
+	 * persist it in as few writes or transactions as they can.
+	 *
+	 * @param networkId Network ID
+	 * @param records Member records (revision is incremented in changed records)
+	 * @param notifyListeners If true, notify change listeners
+	 * @return Number of records that changed
+	 */
+	virtual unsigned long saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners);
+
 	virtual void eraseNetwork(const uint64_t networkId) = 0;
 	virtual void eraseMember(const uint64_t networkId,const uint64_t memberId) = 0;
 
-	virtual void nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress) = 0;
+	/**
+	 * Note that a member has just been seen online
+	 *
+	 * This is called on every network config request, so it only records the
+	 * most recent time and address per member in memory. Backends collect
+	 * these with _takeOnline() and persist them periodically in bulk.
+	 *
+	 * @param networkId Network ID
+	 * @param memberId Member ID
+	 * @param physicalAddress Physical address (if nil the last known address is kept)
+	 */
+	virtual void nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress);
 
 	inline void addListener(DB::ChangeListener *const listener)
 	{
@@ -114,6 +308,35 @@ public:
 	}
 
 protected:
+	struct _OnlineStatus
+	{
+		_OnlineStatus() : lastSeen(0),physicalAddress() {}
+		int64_t lastSeen;
+		InetAddress physicalAddress;
+	};
+
+	typedef std::unordered_map< std::pair<uint64_t,uint64_t>,_OnlineStatus,PairHasher > _OnlineMap;
+
+	/**
+	 * Take online status recorded since the last call
+	 *
+	 * Pending status is moved out of each stripe under that stripe's lock, so
+	 * this blocks nodeIsOnline() only briefly and never all at once.
+	 *
+	 * @param online Map to fill with (network ID, member ID) -> most recent status (existing contents are replaced)
+	 */
+	void _takeOnline(_OnlineMap &online);
+
+	/**
+	 * Put back status taken with _takeOnline() that could not be persisted
+	 *
+	 * The next _takeOnline() returns it again. Status recorded since it was
+	 * taken is newer and wins, but keeps a returned address if it has none.
+	 *
+	 * @param online Status to return
+	 */
+	void _returnOnline(const _OnlineMap &online);
+
 	static inline bool _compareRecords(const nlohmann::json &a,const nlohmann::json &b)
 	{
 		if (a.is_object() == b.is_object()) {
@@ -138,18 +361,57 @@ protected:
 
 	struct _Network
 	{
-		_Network() : mostRecentDeauthTime(0) {}
-		nlohmann::json config;
-		std::unordered_map<uint64_t,nlohmann::json> members;
+		_Network() : config(new nlohmann::json()),mostRecentDeauthTime(0) {}
+		std::shared_ptr<const nlohmann::json> config; // replaced, never modified, on save
+		std::map<uint64_t,CompactMember> members; // ordered for paging, materialized as JSON on access
 		std::unordered_set<uint64_t> activeBridgeMembers;
 		std::unordered_set<uint64_t> authorizedMembers;
-		std::unordered_set<InetAddress,InetAddress::Hasher> allocatedIps;
+		std::map<InetAddress,unsigned long> allocatedIps; // IP -> number of members assigned it
 		int64_t mostRecentDeauthTime;
 		std::mutex lock;
 	};
 
 	void _memberChanged(nlohmann::json &old,nlohmann::json &memberConfig,bool notifyListeners);
+
+	// Applies a batch of member records for one network under one lock, skipping records
+	// that differ only in revision and incrementing the revision of the rest. Indices of
+	// changed records are appended to 'changed'.
+	void _membersChanged(const uint64_t networkId,std::vector<nlohmann::json> &records,std::vector<unsigned long> &changed,bool notifyListeners);
+
+	/**
+	 * A member record prepared for bulk loading, see _membersLoaded()
+	 */
+	struct _LoadedMember
+	{
+		_LoadedMember() : id(0),lastDeauthorizedTime(0),authorized(false),activeBridge(false) {}
+		uint64_t id; // zero if record was invalid
+		CompactMember member;
+		std::vector<InetAddress> ips;
+		int64_t lastDeauthorizedTime;
+		bool authorized;
+		bool activeBridge;
+	};
+
+	// Converts a member record for _membersLoaded(). This touches no DB state, so
+	// loaders can call it from many threads at once.
+	static void _prepareLoadedMember(const uint64_t networkId,const nlohmann::json &member,_LoadedMember &lm);
+
+	// Same as above straight from JSON text without a DOM. Returns false for text
+	// CompactMember::fromJsonText() doesn't handle; parse it and use the above then.
+	static bool _prepareLoadedMember(const uint64_t networkId,const std::string &member,_LoadedMember &lm);
+
+	// Adds members read from storage at startup under one network lock, building the
+	// network's indexes in one pass. Listeners are not notified and revisions are kept.
+	void _membersLoaded(const uint64_t networkId,std::vector<_LoadedMember> &members);
+
+	// Appends all networks, members, and indexes to a binary snapshot, or restores them
+	// from one so that startup can skip parsing individual records. The fingerprint
+	// describes the backing storage; a snapshot is only restored if it still matches.
+	void _writeSnapshot(std::string &out,const std::string &fingerprint);
+	bool _readSnapshot(const std::string &in,const std::string &fingerprint);
+
 	void _networkChanged(nlohmann::json &old,nlohmann::json &networkConfig,bool notifyListeners);
+	void _journalChange(const uint64_t networkId,const uint64_t memberId,const uint64_t revision);
 	void _fillSummaryInfo(const std::shared_ptr<_Network> &nw,NetworkSummaryInfo &info);
 
 	std::vector<DB::ChangeListener *> _changeListeners;
@@ -157,6 +419,18 @@ protected:
 	std::unordered_multimap< uint64_t,uint64_t > _networkByMember;
 	mutable std::mutex _changeListeners_l;
 	mutable std::mutex _networks_l;
+
+private:
+	struct _OnlineStripe
+	{
+		_OnlineMap pending;
+		std::mutex lock;
+	};
+	_OnlineStripe _onlineStripes[ZT_CONTROLLER_ONLINE_STRIPES];
+
+	std::vector<Change> _journal; // ring buffer, grows to ZT_DB_CHANGE_JOURNAL_SIZE
+	uint64_t _journalLatest;
+	mutable std::mutex _journal_l;
 };
 
 } // namespace ZeroTier
@@ -13,6 +13,8 @@
 
 #include "DBMirrorSet.hpp"
 
+#include <algorithm>
+
 namespace ZeroTier {
 
 DBMirrorSet::DBMirrorSet(DB::ChangeListener *listener) :
@@ -26,44 +28,7 @@ DBMirrorSet::DBMirrorSet(DB::ChangeListener *listener) :
 					return;
 				std::this_thread::sleep_for(std::chrono::milliseconds(500));
 			}
-
-			std::vector< std::shared_ptr<DB> > dbs;
-			{
-				std::lock_guard<std::mutex> l(_dbs_l);
-				if (_dbs.size() <= 1)
-					continue; // no need to do this if there's only one DB, so skip the iteration
-				dbs = _dbs;
-			}
-
-			for(auto db=dbs.begin();db!=dbs.end();++db) {
-				(*db)->each([this,&dbs,&db](uint64_t networkId,const nlohmann::json &network,uint64_t memberId,const nlohmann::json &member) {
-					try {
-						if (network.is_object()) {
-							if (memberId == 0) {
-								for(auto db2=dbs.begin();db2!=dbs.end();++db2) {
-									if (db->get() != db2->get()) {
-										nlohmann::json nw2;
-										if ((!(*db2)->get(networkId,nw2))||((nw2.is_object())&&(OSUtils::jsonInt(nw2["revision"],0) < OSUtils::jsonInt(network["revision"],0)))) {
-											nw2 = network;
-											(*db2)->save(nw2,false);
-										}
-									}
-								}
-							} else if (member.is_object()) {
-								for(auto db2=dbs.begin();db2!=dbs.end();++db2) {
-									if (db->get() != db2->get()) {
-										nlohmann::json nw2,m2;
-										if ((!(*db2)->get(networkId,nw2,memberId,m2))||((m2.is_object())&&(OSUtils::jsonInt(m2["revision"],0) < OSUtils::jsonInt(member["revision"],0)))) {
-											m2 = member;
-											(*db2)->save(m2,false);
-										}
-									}
-								}
-							}
-						}
-					} catch ( ... ) {} // skip entries that generate JSON errors
-				});
-			}
+			sync();
 		}
 	});
 }
@@ -74,6 +39,77 @@ DBMirrorSet::~DBMirrorSet()
 	_syncCheckerThread.join();
 }
 
+void DBMirrorSet::sync()
+{
+	std::lock_guard<std::mutex> sl(_sync_l);
+
+	std::vector< std::shared_ptr<DB> > dbs;
+	{
+		std::lock_guard<std::mutex> l(_dbs_l);
+		if (_dbs.size() <= 1)
+			return; // no need to do this if there's only one DB
+		dbs = _dbs;
+	}
+
+	std::vector<DB::Change> changes;
+	std::unordered_set< std::pair<uint64_t,uint64_t>,DB::PairHasher > seen;
+	for(auto db=dbs.begin();db!=dbs.end();++db) {
+		uint64_t latest = 0;
+		auto synced = _synced.find(db->get());
+		if ((synced == _synced.end())||(!(*db)->changesSince(synced->second,changes,latest))) {
+			// First sync of this DB or its journal overflowed, so compare everything. Changes
+			// made during the scan are after 'latest' and will be seen next time.
+			latest = (*db)->latestChange();
+			(*db)->each([this,&dbs,&db](uint64_t networkId,const nlohmann::json &network,uint64_t memberId,const nlohmann::json &member) {
+				_syncRecord(dbs,db->get(),networkId,network,memberId,member);
+			});
+		} else {
+			seen.clear();
+			for(auto c=changes.rbegin();c!=changes.rend();++c) { // newest first, later changes to the same record are skipped
+				if (!seen.insert(std::pair<uint64_t,uint64_t>(c->networkId,c->memberId)).second)
+					continue;
+				nlohmann::json network,member;
+				if (c->memberId) {
+					if ((*db)->get(c->networkId,network,c->memberId,member))
+						_syncRecord(dbs,db->get(),c->networkId,network,c->memberId,member);
+				} else if ((*db)->get(c->networkId,network)) {
+					_syncRecord(dbs,db->get(),c->networkId,network,0,member);
+				}
+			}
+		}
+		_synced[db->get()] = latest;
+	}
+}
+
+void DBMirrorSet::_syncRecord(const std::vector< std::shared_ptr<DB> > &dbs,const DB *db,const uint64_t networkId,const nlohmann::json &network,const uint64_t memberId,const nlohmann::json &member)
+{
+	try {
+		if (network.is_object()) {
+			if (memberId == 0) {
+				for(auto db2=dbs.begin();db2!=dbs.end();++db2) {
+					if (db != db2->get()) {
+						nlohmann::json nw2;
+						if ((!(*db2)->get(networkId,nw2))||((nw2.is_object())&&(OSUtils::jsonInt(nw2["revision"],0) < OSUtils::jsonInt(network["revision"],0)))) {
+							nw2 = network;
+							(*db2)->save(nw2,false);
+						}
+					}
+				}
+			} else if (member.is_object()) {
+				for(auto db2=dbs.begin();db2!=dbs.end();++db2) {
+					if (db != db2->get()) {
+						nlohmann::json nw2,m2;
+						if ((!(*db2)->get(networkId,nw2,memberId,m2))||((m2.is_object())&&(OSUtils::jsonInt(m2["revision"],0) < OSUtils::jsonInt(member["revision"],0)))) {
+							m2 = member;
+							(*db2)->save(m2,false);
+						}
+					}
+				}
+			}
+		}
+	} catch ( ... ) {} // skip entries that generate JSON errors
+}
+
 bool DBMirrorSet::hasNetwork(const uint64_t networkId) const
 {
 	std::lock_guard<std::mutex> l(_dbs_l);
@@ -125,6 +161,16 @@ bool DBMirrorSet::get(const uint64_t networkId,nlohmann::json &network,std::vect
 	return false;
 }
 
+bool DBMirrorSet::get(const uint64_t networkId,std::shared_ptr<const nlohmann::json> &network,const uint64_t memberId,nlohmann::json &member,DB::NetworkSummaryInfo &info)
+{
+	std::lock_guard<std::mutex> l(_dbs_l);
+	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
+		if ((*d)->get(networkId,network,memberId,member,info))
+			return true;
+	}
+	return false;
+}
+
 void DBMirrorSet::networks(std::set<uint64_t> &networks)
 {
 	std::lock_guard<std::mutex> l(_dbs_l);
@@ -133,6 +179,26 @@ void DBMirrorSet::networks(std::set<uint64_t> &networks)
 	}
 }
 
+bool DBMirrorSet::ipAllocated(const uint64_t networkId,const InetAddress &ip)
+{
+	std::lock_guard<std::mutex> l(_dbs_l);
+	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
+		if ((*d)->hasNetwork(networkId))
+			return (*d)->ipAllocated(networkId,ip);
+	}
+	return false;
+}
+
+bool DBMirrorSet::isAuthorized(const uint64_t networkId,const uint64_t memberId)
+{
+	std::lock_guard<std::mutex> l(_dbs_l);
+	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
+		if ((*d)->hasNetwork(networkId))
+			return (*d)->isAuthorized(networkId,memberId);
+	}
+	return false;
+}
+
 bool DBMirrorSet::waitForReady()
 {
 	bool r = false;
@@ -175,6 +241,28 @@ bool DBMirrorSet::save(nlohmann::json &record,bool notifyListeners)
 	}
 }
 
+unsigned long DBMirrorSet::saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners)
+{
+	std::vector< std::shared_ptr<DB> > dbs;
+	{
+		std::lock_guard<std::mutex> l(_dbs_l);
+		dbs = _dbs;
+	}
+	if (notifyListeners) {
+		for(auto d=dbs.begin();d!=dbs.end();++d) {
+			const unsigned long n = (*d)->saveMembers(networkId,records,true);
+			if (n)
+				return n;
+		}
+		return 0;
+	} else {
+		unsigned long n = 0;
+		for(auto d=dbs.begin();d!=dbs.end();++d)
+			n = std::max(n,(*d)->saveMembers(networkId,records,false));
+		return n;
+	}
+}
+
 void DBMirrorSet::eraseNetwork(const uint64_t networkId)
 {
 	std::lock_guard<std::mutex> l(_dbs_l);
@@ -202,10 +290,12 @@ void DBMirrorSet::nodeIsOnline(const uint64_t networkId,const uint64_t memberId,
 void DBMirrorSet::onNetworkUpdate(const void *db,uint64_t networkId,const nlohmann::json &network)
 {
 	nlohmann::json record(network);
-	std::lock_guard<std::mutex> l(_dbs_l);
-	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
-		if (d->get() != db) {
-			(*d)->save(record,false);
+	{
+		std::lock_guard<std::mutex> l(_dbs_l);
+		for(auto d=_dbs.begin();d!=_dbs.end();++d) {
+			if (d->get() != db) {
+				(*d)->save(record,false);
+			}
 		}
 	}
 	_listener->onNetworkUpdate(this,networkId,network);
@@ -214,12 +304,15 @@ void DBMirrorSet::onNetworkUpdate(const void *db,uint64_t networkId,const nlohma
 void DBMirrorSet::onNetworkMemberUpdate(const void *db,uint64_t networkId,uint64_t memberId,const nlohmann::json &member)
 {
 	nlohmann::json record(member);
-	std::lock_guard<std::mutex> l(_dbs_l);
-	for(auto d=_dbs.begin();d!=_dbs.end();++d) {
-		if (d->get() != db) {
-			(*d)->save(record,false);
+	{
+		std::lock_guard<std::mutex> l(_dbs_l);
+		for(auto d=_dbs.begin();d!=_dbs.end();++d) {
+			if (d->get() != db) {
+				(*d)->save(record,false);
+			}
 		}
 	}
+	// The listener may call back into this set (e.g. to queue a request)
 	_listener->onNetworkMemberUpdate(this,networkId,memberId,member);
 }
 
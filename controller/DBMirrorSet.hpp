@@ -21,6 +21,8 @@
 #include <mutex>
 #include <set>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace ZeroTier {
 
@@ -30,18 +32,43 @@ public:
 	DBMirrorSet(DB::ChangeListener *listener);
 	virtual ~DBMirrorSet();
 
+	/**
+	 * Copy records that are missing or older in some DBs from the DBs that have them
+	 *
+	 * Each DB is scanned in full the first time. After that only the changes
+	 * in its journal since the last sync are compared, unless the journal
+	 * overflowed in between. A background thread calls this every minute.
+	 */
+	void sync();
+
 	bool hasNetwork(const uint64_t networkId) const;
 
 	bool get(const uint64_t networkId,nlohmann::json &network);
 	bool get(const uint64_t networkId,nlohmann::json &network,const uint64_t memberId,nlohmann::json &member);
 	bool get(const uint64_t networkId,nlohmann::json &network,const uint64_t memberId,nlohmann::json &member,DB::NetworkSummaryInfo &info);
 	bool get(const uint64_t networkId,nlohmann::json &network,std::vector<nlohmann::json> &members);
+	bool get(const uint64_t networkId,std::shared_ptr<const nlohmann::json> &network,const uint64_t memberId,nlohmann::json &member,DB::NetworkSummaryInfo &info);
+
+	template<typename F>
+	inline bool eachMember(const uint64_t networkId,const uint64_t after,const bool authorizedOnly,const uint64_t minRevision,F f)
+	{
+		std::lock_guard<std::mutex> l(_dbs_l);
+		for(auto d=_dbs.begin();d!=_dbs.end();++d) {
+			if ((*d)->eachMember(networkId,after,authorizedOnly,minRevision,f))
+				return true;
+		}
+		return false;
+	}
 
 	void networks(std::set<uint64_t> &networks);
 
+	bool ipAllocated(const uint64_t networkId,const InetAddress &ip);
+	bool isAuthorized(const uint64_t networkId,const uint64_t memberId);
+
 	bool waitForReady();
 	bool isReady();
 	bool save(nlohmann::json &record,bool notifyListeners);
+	unsigned long saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners);
 	void eraseNetwork(const uint64_t networkId);
 	void eraseMember(const uint64_t networkId,const uint64_t memberId);
 	void nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress);
@@ -59,11 +86,15 @@ public:
 	}
 
 private:
+	void _syncRecord(const std::vector< std::shared_ptr<DB> > &dbs,const DB *db,const uint64_t networkId,const nlohmann::json &network,const uint64_t memberId,const nlohmann::json &member);
+
 	DB::ChangeListener *const _listener;
 	std::atomic_bool _running;
 	std::thread _syncCheckerThread;
 	std::vector< std::shared_ptr< DB > > _dbs;
 	mutable std::mutex _dbs_l;
+	std::unordered_map<const DB *,uint64_t> _synced; // last journal sequence synced from each DB
+	std::mutex _sync_l;
 };
 
 } // namespace ZeroTier
@@ -28,6 +28,7 @@
 #include <map>
 #include <thread>
 #include <memory>
+#include <chrono>
 
 #include "../include/ZeroTierOne.h"
 #include "../version.h"
@@ -56,10 +57,29 @@ using json = nlohmann::json;
 // Global maximum size of arrays in JSON objects
 #define ZT_CONTROLLER_MAX_ARRAY_SIZE 16384
 
+// Default interval for flushing buffered volatile member fields to the DB (ms)
+#define ZT_CONTROLLER_DEFAULT_VOLATILE_WRITE_INTERVAL 30000
+
+// Default window over which config pushes after a network edit are spread (ms)
+#define ZT_CONTROLLER_DEFAULT_PUSH_WINDOW 10000
+
+// Online members pushed to at once after a network edit, before the rest are spread over the window
+#define ZT_CONTROLLER_PUSH_BURST 256
+
 namespace ZeroTier {
 
 namespace {
 
+// Field lookup that doesn't insert a null, for reading shared network snapshots
+static inline const json &_field(const json &o,const char *k)
+{
+	static const json nullJson;
+	if (!o.is_object())
+		return nullJson;
+	auto f = o.find(k);
+	return (f == o.end()) ? nullJson : *f;
+}
+
 static json _renderRule(ZT_VirtualNetworkRule &rule)
 {
 	char tmp[128];
@@ -248,18 +268,18 @@ static json _renderRule(ZT_VirtualNetworkRule &rule)
 	return r;
 }
 
-static bool _parseRule(json &r,ZT_VirtualNetworkRule &rule)
+static bool _parseRule(const json &r,ZT_VirtualNetworkRule &rule)
 {
 	if (!r.is_object())
 		return false;
 
-	const std::string t(OSUtils::jsonString(r["type"],""));
+	const std::string t(OSUtils::jsonString(_field(r,"type"),""));
 	memset(&rule,0,sizeof(ZT_VirtualNetworkRule));
 
-	if (OSUtils::jsonBool(r["not"],false))
+	if (OSUtils::jsonBool(_field(r,"not"),false))
 		rule.t = 0x80;
 	else rule.t = 0x00;
-	if (OSUtils::jsonBool(r["or"],false))
+	if (OSUtils::jsonBool(_field(r,"or"),false))
 		rule.t |= 0x40;
 
 	bool tag = false;
@@ -271,100 +291,100 @@ static bool _parseRule(json &r,ZT_VirtualNetworkRule &rule)
 		return true;
 	} else if (t == "ACTION_TEE") {
 		rule.t |= ZT_NETWORK_RULE_ACTION_TEE;
-		rule.v.fwd.address = Utils::hexStrToU64(OSUtils::jsonString(r["address"],"0").c_str()) & 0xffffffffffULL;
-		rule.v.fwd.flags = (uint32_t)(OSUtils::jsonInt(r["flags"],0ULL) & 0xffffffffULL);
-		rule.v.fwd.length = (uint16_t)(OSUtils::jsonInt(r["length"],0ULL) & 0xffffULL);
+		rule.v.fwd.address = Utils::hexStrToU64(OSUtils::jsonString(_field(r,"address"),"0").c_str()) & 0xffffffffffULL;
+		rule.v.fwd.flags = (uint32_t)(OSUtils::jsonInt(_field(r,"flags"),0ULL) & 0xffffffffULL);
+		rule.v.fwd.length = (uint16_t)(OSUtils::jsonInt(_field(r,"length"),0ULL) & 0xffffULL);
 		return true;
 	} else if (t == "ACTION_WATCH") {
 		rule.t |= ZT_NETWORK_RULE_ACTION_WATCH;
-		rule.v.fwd.address = Utils::hexStrToU64(OSUtils::jsonString(r["address"],"0").c_str()) & 0xffffffffffULL;
-		rule.v.fwd.flags = (uint32_t)(OSUtils::jsonInt(r["flags"],0ULL) & 0xffffffffULL);
-		rule.v.fwd.length = (uint16_t)(OSUtils::jsonInt(r["length"],0ULL) & 0xffffULL);
+		rule.v.fwd.address = Utils::hexStrToU64(OSUtils::jsonString(_field(r,"address"),"0").c_str()) & 0xffffffffffULL;
+		rule.v.fwd.flags = (uint32_t)(OSUtils::jsonInt(_field(r,"flags"),0ULL) & 0xffffffffULL);
+		rule.v.fwd.length = (uint16_t)(OSUtils::jsonInt(_field(r,"length"),0ULL) & 0xffffULL);
 		return true;
 	} else if (t == "ACTION_REDIRECT") {
 		rule.t |= ZT_NETWORK_RULE_ACTION_REDIRECT;
-		rule.v.fwd.address = Utils::hexStrToU64(OSUtils::jsonString(r["address"],"0").c_str()) & 0xffffffffffULL;
-		rule.v.fwd.flags = (uint32_t)(OSUtils::jsonInt(r["flags"],0ULL) & 0xffffffffULL);
+		rule.v.fwd.address = Utils::hexStrToU64(OSUtils::jsonString(_field(r,"address"),"0").c_str()) & 0xffffffffffULL;
+		rule.v.fwd.flags = (uint32_t)(OSUtils::jsonInt(_field(r,"flags"),0ULL) & 0xffffffffULL);
 		return true;
 	} else if (t == "ACTION_BREAK") {
 		rule.t |= ZT_NETWORK_RULE_ACTION_BREAK;
 		return true;
 	} else if (t == "MATCH_SOURCE_ZEROTIER_ADDRESS") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_SOURCE_ZEROTIER_ADDRESS;
-		rule.v.zt = Utils::hexStrToU64(OSUtils::jsonString(r["zt"],"0").c_str()) & 0xffffffffffULL;
+		rule.v.zt = Utils::hexStrToU64(OSUtils::jsonString(_field(r,"zt"),"0").c_str()) & 0xffffffffffULL;
 		return true;
 	} else if (t == "MATCH_DEST_ZEROTIER_ADDRESS") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_DEST_ZEROTIER_ADDRESS;
-		rule.v.zt = Utils::hexStrToU64(OSUtils::jsonString(r["zt"],"0").c_str()) & 0xffffffffffULL;
+		rule.v.zt = Utils::hexStrToU64(OSUtils::jsonString(_field(r,"zt"),"0").c_str()) & 0xffffffffffULL;
 		return true;
 	} else if (t == "MATCH_VLAN_ID") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_VLAN_ID;
-		rule.v.vlanId = (uint16_t)(OSUtils::jsonInt(r["vlanId"],0ULL) & 0xffffULL);
+		rule.v.vlanId = (uint16_t)(OSUtils::jsonInt(_field(r,"vlanId"),0ULL) & 0xffffULL);
 		return true;
 	} else if (t == "MATCH_VLAN_PCP") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_VLAN_PCP;
-		rule.v.vlanPcp = (uint8_t)(OSUtils::jsonInt(r["vlanPcp"],0ULL) & 0xffULL);
+		rule.v.vlanPcp = (uint8_t)(OSUtils::jsonInt(_field(r,"vlanPcp"),0ULL) & 0xffULL);
 		return true;
 	} else if (t == "MATCH_VLAN_DEI") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_VLAN_DEI;
-		rule.v.vlanDei = (uint8_t)(OSUtils::jsonInt(r["vlanDei"],0ULL) & 0xffULL);
+		rule.v.vlanDei = (uint8_t)(OSUtils::jsonInt(_field(r,"vlanDei"),0ULL) & 0xffULL);
 		return true;
 	} else if (t == "MATCH_MAC_SOURCE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_MAC_SOURCE;
-		const std::string mac(OSUtils::jsonString(r["mac"],"0"));
+		const std::string mac(OSUtils::jsonString(_field(r,"mac"),"0"));
 		Utils::unhex(mac.c_str(),(unsigned int)mac.length(),rule.v.mac,6);
 		return true;
 	} else if (t == "MATCH_MAC_DEST") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_MAC_DEST;
-		const std::string mac(OSUtils::jsonString(r["mac"],"0"));
+		const std::string mac(OSUtils::jsonString(_field(r,"mac"),"0"));
 		Utils::unhex(mac.c_str(),(unsigned int)mac.length(),rule.v.mac,6);
 		return true;
 	} else if (t == "MATCH_IPV4_SOURCE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IPV4_SOURCE;
-		InetAddress ip(OSUtils::jsonString(r["ip"],"0.0.0.0").c_str());
+		InetAddress ip(OSUtils::jsonString(_field(r,"ip"),"0.0.0.0").c_str());
 		rule.v.ipv4.ip = reinterpret_cast<struct sockaddr_in *>(&ip)->sin_addr.s_addr;
 		rule.v.ipv4.mask = Utils::ntoh(reinterpret_cast<struct sockaddr_in *>(&ip)->sin_port) & 0xff;
 		if (rule.v.ipv4.mask > 32) rule.v.ipv4.mask = 32;
 		return true;
 	} else if (t == "MATCH_IPV4_DEST") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IPV4_DEST;
-		InetAddress ip(OSUtils::jsonString(r["ip"],"0.0.0.0").c_str());
+		InetAddress ip(OSUtils::jsonString(_field(r,"ip"),"0.0.0.0").c_str());
 		rule.v.ipv4.ip = reinterpret_cast<struct sockaddr_in *>(&ip)->sin_addr.s_addr;
 		rule.v.ipv4.mask = Utils::ntoh(reinterpret_cast<struct sockaddr_in *>(&ip)->sin_port) & 0xff;
 		if (rule.v.ipv4.mask > 32) rule.v.ipv4.mask = 32;
 		return true;
 	} else if (t == "MATCH_IPV6_SOURCE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IPV6_SOURCE;
-		InetAddress ip(OSUtils::jsonString(r["ip"],"::0").c_str());
+		InetAddress ip(OSUtils::jsonString(_field(r,"ip"),"::0").c_str());
 		memcpy(rule.v.ipv6.ip,reinterpret_cast<struct sockaddr_in6 *>(&ip)->sin6_addr.s6_addr,16);
 		rule.v.ipv6.mask = Utils::ntoh(reinterpret_cast<struct sockaddr_in6 *>(&ip)->sin6_port) & 0xff;
 		if (rule.v.ipv6.mask > 128) rule.v.ipv6.mask = 128;
 		return true;
 	} else if (t == "MATCH_IPV6_DEST") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IPV6_DEST;
-		InetAddress ip(OSUtils::jsonString(r["ip"],"::0").c_str());
+		InetAddress ip(OSUtils::jsonString(_field(r,"ip"),"::0").c_str());
 		memcpy(rule.v.ipv6.ip,reinterpret_cast<struct sockaddr_in6 *>(&ip)->sin6_addr.s6_addr,16);
 		rule.v.ipv6.mask = Utils::ntoh(reinterpret_cast<struct sockaddr_in6 *>(&ip)->sin6_port) & 0xff;
 		if (rule.v.ipv6.mask > 128) rule.v.ipv6.mask = 128;
 		return true;
 	} else if (t == "MATCH_IP_TOS") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IP_TOS;
-		rule.v.ipTos.mask = (uint8_t)(OSUtils::jsonInt(r["mask"],0ULL) & 0xffULL);
-		rule.v.ipTos.value[0] = (uint8_t)(OSUtils::jsonInt(r["start"],0ULL) & 0xffULL);
-		rule.v.ipTos.value[1] = (uint8_t)(OSUtils::jsonInt(r["end"],0ULL) & 0xffULL);
+		rule.v.ipTos.mask = (uint8_t)(OSUtils::jsonInt(_field(r,"mask"),0ULL) & 0xffULL);
+		rule.v.ipTos.value[0] = (uint8_t)(OSUtils::jsonInt(_field(r,"start"),0ULL) & 0xffULL);
+		rule.v.ipTos.value[1] = (uint8_t)(OSUtils::jsonInt(_field(r,"end"),0ULL) & 0xffULL);
 		return true;
 	} else if (t == "MATCH_IP_PROTOCOL") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IP_PROTOCOL;
-		rule.v.ipProtocol = (uint8_t)(OSUtils::jsonInt(r["ipProtocol"],0ULL) & 0xffULL);
+		rule.v.ipProtocol = (uint8_t)(OSUtils::jsonInt(_field(r,"ipProtocol"),0ULL) & 0xffULL);
 		return true;
 	} else if (t == "MATCH_ETHERTYPE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_ETHERTYPE;
-		rule.v.etherType = (uint16_t)(OSUtils::jsonInt(r["etherType"],0ULL) & 0xffffULL);
+		rule.v.etherType = (uint16_t)(OSUtils::jsonInt(_field(r,"etherType"),0ULL) & 0xffffULL);
 		return true;
 	} else if (t == "MATCH_ICMP") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_ICMP;
-		rule.v.icmp.type = (uint8_t)(OSUtils::jsonInt(r["icmpType"],0ULL) & 0xffULL);
-		json &code = r["icmpCode"];
+		rule.v.icmp.type = (uint8_t)(OSUtils::jsonInt(_field(r,"icmpType"),0ULL) & 0xffULL);
+		const json &code = _field(r,"icmpCode");
 		if (code.is_null()) {
 			rule.v.icmp.code = 0;
 			rule.v.icmp.flags = 0x00;
@@ -375,18 +395,18 @@ static bool _parseRule(json &r,ZT_VirtualNetworkRule &rule)
 		return true;
 	} else if (t == "MATCH_IP_SOURCE_PORT_RANGE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IP_SOURCE_PORT_RANGE;
-		rule.v.port[0] = (uint16_t)(OSUtils::jsonInt(r["start"],0ULL) & 0xffffULL);
-		rule.v.port[1] = (uint16_t)(OSUtils::jsonInt(r["end"],(uint64_t)rule.v.port[0]) & 0xffffULL);
+		rule.v.port[0] = (uint16_t)(OSUtils::jsonInt(_field(r,"start"),0ULL) & 0xffffULL);
+		rule.v.port[1] = (uint16_t)(OSUtils::jsonInt(_field(r,"end"),(uint64_t)rule.v.port[0]) & 0xffffULL);
 		return true;
 	} else if (t == "MATCH_IP_DEST_PORT_RANGE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_IP_DEST_PORT_RANGE;
-		rule.v.port[0] = (uint16_t)(OSUtils::jsonInt(r["start"],0ULL) & 0xffffULL);
-		rule.v.port[1] = (uint16_t)(OSUtils::jsonInt(r["end"],(uint64_t)rule.v.port[0]) & 0xffffULL);
+		rule.v.port[0] = (uint16_t)(OSUtils::jsonInt(_field(r,"start"),0ULL) & 0xffffULL);
+		rule.v.port[1] = (uint16_t)(OSUtils::jsonInt(_field(r,"end"),(uint64_t)rule.v.port[0]) & 0xffffULL);
 		return true;
 	} else if (t == "MATCH_CHARACTERISTICS") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_CHARACTERISTICS;
 		if (r.count("mask")) {
-			json &v = r["mask"];
+			const json &v = _field(r,"mask");
 			if (v.is_number()) {
 				rule.v.characteristics = v;
 			} else {
@@ -397,12 +417,12 @@ static bool _parseRule(json &r,ZT_VirtualNetworkRule &rule)
 		return true;
 	} else if (t == "MATCH_FRAME_SIZE_RANGE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_FRAME_SIZE_RANGE;
-		rule.v.frameSize[0] = (uint16_t)(OSUtils::jsonInt(r["start"],0ULL) & 0xffffULL);
-		rule.v.frameSize[1] = (uint16_t)(OSUtils::jsonInt(r["end"],(uint64_t)rule.v.frameSize[0]) & 0xffffULL);
+		rule.v.frameSize[0] = (uint16_t)(OSUtils::jsonInt(_field(r,"start"),0ULL) & 0xffffULL);
+		rule.v.frameSize[1] = (uint16_t)(OSUtils::jsonInt(_field(r,"end"),(uint64_t)rule.v.frameSize[0]) & 0xffffULL);
 		return true;
 	} else if (t == "MATCH_RANDOM") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_RANDOM;
-		rule.v.randomProbability = (uint32_t)(OSUtils::jsonInt(r["probability"],0ULL) & 0xffffffffULL);
+		rule.v.randomProbability = (uint32_t)(OSUtils::jsonInt(_field(r,"probability"),0ULL) & 0xffffffffULL);
 		return true;
 	} else if (t == "MATCH_TAGS_DIFFERENCE") {
 		rule.t |= ZT_NETWORK_RULE_MATCH_TAGS_DIFFERENCE;
@@ -426,34 +446,118 @@ static bool _parseRule(json &r,ZT_VirtualNetworkRule &rule)
 		rule.t |= ZT_NETWORK_RULE_MATCH_TAG_RECEIVER;
 		tag = true;
 	} else if (t == "INTEGER_RANGE") {
-		json &s = r["start"];
+		const json &s = _field(r,"start");
 		if (s.is_string()) {
 			std::string tmp = s;
 			rule.v.intRange.start = Utils::hexStrToU64(tmp.c_str());
 		} else {
 			rule.v.intRange.start = OSUtils::jsonInt(s,0ULL);
 		}
-		json &e = r["end"];
+		const json &e = _field(r,"end");
 		if (e.is_string()) {
 			std::string tmp = e;
 			rule.v.intRange.end = (uint32_t)(Utils::hexStrToU64(tmp.c_str()) - rule.v.intRange.start);
 		} else {
 			rule.v.intRange.end = (uint32_t)(OSUtils::jsonInt(e,0ULL) - rule.v.intRange.start);
 		}
-		rule.v.intRange.idx = (uint16_t)OSUtils::jsonInt(r["idx"],0ULL);
-		rule.v.intRange.format = (OSUtils::jsonBool(r["little"],false)) ? 0x80 : 0x00;
-		rule.v.intRange.format |= (uint8_t)((OSUtils::jsonInt(r["bits"],1ULL) - 1) & 63);
+		rule.v.intRange.idx = (uint16_t)OSUtils::jsonInt(_field(r,"idx"),0ULL);
+		rule.v.intRange.format = (OSUtils::jsonBool(_field(r,"little"),false)) ? 0x80 : 0x00;
+		rule.v.intRange.format |= (uint8_t)((OSUtils::jsonInt(_field(r,"bits"),1ULL) - 1) & 63);
 	}
 
 	if (tag) {
-		rule.v.tag.id = (uint32_t)(OSUtils::jsonInt(r["id"],0ULL) & 0xffffffffULL);
-		rule.v.tag.value = (uint32_t)(OSUtils::jsonInt(r["value"],0ULL) & 0xffffffffULL);
+		rule.v.tag.id = (uint32_t)(OSUtils::jsonInt(_field(r,"id"),0ULL) & 0xffffffffULL);
+		rule.v.tag.value = (uint32_t)(OSUtils::jsonInt(_field(r,"value"),0ULL) & 0xffffffffULL);
 		return true;
 	}
 
 	return false;
 }
 
+// Applies member fields settable through the API from a request body (may throw on bad input)
+static void _setMemberFields(json &member,json &b,const int64_t now)
+{
+	if (b.count("activeBridge")) member["activeBridge"] = OSUtils::jsonBool(b["activeBridge"],false);
+	if (b.count("noAutoAssignIps")) member["noAutoAssignIps"] = OSUtils::jsonBool(b["noAutoAssignIps"],false);
+
+	if (b.count("remoteTraceTarget")) {
+		const std::string rtt(OSUtils::jsonString(b["remoteTraceTarget"],""));
+		if (rtt.length() == 10) {
+			member["remoteTraceTarget"] = rtt;
+		} else {
+			member["remoteTraceTarget"] = json();
+		}
+	}
+	if (b.count("remoteTraceLevel")) member["remoteTraceLevel"] = OSUtils::jsonInt(b["remoteTraceLevel"],0ULL);
+
+	if (b.count("authorized")) {
+		const bool newAuth = OSUtils::jsonBool(b["authorized"],false);
+		if (newAuth != OSUtils::jsonBool(member["authorized"],false)) {
+			member["authorized"] = newAuth;
+			member[((newAuth) ? "lastAuthorizedTime" : "lastDeauthorizedTime")] = now;
+			if (newAuth) {
+				member["lastAuthorizedCredentialType"] = "api";
+				member["lastAuthorizedCredential"] = json();
+			}
+		}
+	}
+
+	if (b.count("ipAssignments")) {
+		json &ipa = b["ipAssignments"];
+		if (ipa.is_array()) {
+			json mipa(json::array());
+			for(unsigned long i=0;i<ipa.size();++i) {
+				std::string ips = ipa[i];
+				InetAddress ip(ips.c_str());
+				if ((ip.ss_family == AF_INET)||(ip.ss_family == AF_INET6)) {
+					char tmpip[64];
+					mipa.push_back(ip.toIpString(tmpip));
+					if (mipa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
+						break;
+				}
+			}
+			member["ipAssignments"] = mipa;
+		}
+	}
+
+	if (b.count("tags")) {
+		json &tags = b["tags"];
+		if (tags.is_array()) {
+			std::map<uint64_t,uint64_t> mtags;
+			for(unsigned long i=0;i<tags.size();++i) {
+				json &tag = tags[i];
+				if ((tag.is_array())&&(tag.size() == 2))
+					mtags[OSUtils::jsonInt(tag[0],0ULL) & 0xffffffffULL] = OSUtils::jsonInt(tag[1],0ULL) & 0xffffffffULL;
+			}
+			json mtagsa = json::array();
+			for(std::map<uint64_t,uint64_t>::iterator t(mtags.begin());t!=mtags.end();++t) {
+				json ta = json::array();
+				ta.push_back(t->first);
+				ta.push_back(t->second);
+				mtagsa.push_back(ta);
+				if (mtagsa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
+					break;
+			}
+			member["tags"] = mtagsa;
+		}
+	}
+
+	if (b.count("capabilities")) {
+		json &capabilities = b["capabilities"];
+		if (capabilities.is_array()) {
+			json mcaps = json::array();
+			for(unsigned long i=0;i<capabilities.size();++i) {
+				mcaps.push_back(OSUtils::jsonInt(capabilities[i],0ULL));
+				if (mcaps.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
+					break;
+			}
+			std::sort(mcaps.begin(),mcaps.end());
+			mcaps.erase(std::unique(mcaps.begin(),mcaps.end()),mcaps.end());
+			member["capabilities"] = mcaps;
+		}
+	}
+}
+
 } // anonymous namespace
 
 EmbeddedNetworkController::EmbeddedNetworkController(Node *node,const char *ztPath,const char *dbPath, int listenPort, MQConfig *mqc) :
@@ -464,16 +568,55 @@ EmbeddedNetworkController::EmbeddedNetworkController(Node *node,const char *ztPa
 	_path(dbPath),
 	_sender((NetworkController::Sender *)0),
 	_db(this),
+	_rqRevocationsQueued(0),
+	_rqDeduplicated(0),
+	_rqTurn(0),
+	_rqRunning(true),
+	_templateHits(0),
+	_templateMisses(0),
+	_fullConfigsSent(0),
+	_fullConfigBytes(0),
+	_deltaConfigsSent(0),
+	_deltaConfigBytes(0),
+	_requestsHandled(0),
+	_requestMicros(0),
+	_requestMaxMicros(0),
+	_memberSaves(0),
+	_memberWrites(0),
+	_memberWritesSkipped(0),
+	_memberWritesDeferred(0),
+	_memberWritesCoalesced(0),
+	_memberWritesFlushed(0),
+	_volatileWriteInterval(ZT_CONTROLLER_DEFAULT_VOLATILE_WRITE_INTERVAL),
+	_running(true),
+	_pushWindow(ZT_CONTROLLER_DEFAULT_PUSH_WINDOW),
+	_pushesScheduled(0),
+	_pushesMerged(0),
+	_pushesSuperseded(0),
+	_pushesReleased(0),
+	_pushRate(0.0),
+	_pushRunning(true),
 	_mqc(mqc)
 {
+	_rqCapacity[ZT_CONTROLLER_RQ_CLASS_AUTHORIZED] = ZT_CONTROLLER_RQ_MAX_AUTHORIZED;
+	_rqCapacity[ZT_CONTROLLER_RQ_CLASS_NEW_MEMBER] = ZT_CONTROLLER_RQ_MAX_NEW_MEMBER;
+	_rqCapacity[ZT_CONTROLLER_RQ_CLASS_UNKNOWN_NETWORK] = ZT_CONTROLLER_RQ_MAX_UNKNOWN_NETWORK;
 }
 
 EmbeddedNetworkController::~EmbeddedNetworkController()
 {
-	std::lock_guard<std::mutex> l(_threads_l);
-	_queue.stop();
-	for(auto t=_threads.begin();t!=_threads.end();++t)
-		t->join();
+	{
+		std::lock_guard<std::mutex> l(_push_l);
+		_pushRunning = false;
+	}
+	_push_c.notify_all();
+	if (_pushThread.joinable())
+		_pushThread.join();
+	_rqStop();
+	_running = false;
+	if (_volatileWriteThread.joinable())
+		_volatileWriteThread.join();
+	_flushVolatileMemberWrites();
 }
 
 void EmbeddedNetworkController::init(const Identity &signingId,Sender *sender)
@@ -483,22 +626,32 @@ void EmbeddedNetworkController::init(const Identity &signingId,Sender *sender)
 	_sender = sender;
 	_signingIdAddressString = signingId.address().toString(tmp);
 
+	std::string lfJSON;
+	OSUtils::readFile((_ztPath + ZT_PATH_SEPARATOR_S "local.conf").c_str(),lfJSON);
+	nlohmann::json lfConfig;
+	bool snapshot = false;
+	if (lfJSON.length() > 0) {
+		lfConfig = OSUtils::jsonParse(lfJSON);
+		if ((lfConfig.is_object())&&(lfConfig["settings"].is_object()))
+			snapshot = OSUtils::jsonBool(lfConfig["settings"]["controllerSnapshot"],false);
+	}
+
 #ifdef ZT_CONTROLLER_USE_LIBPQ
 	if ((_path.length() > 9)&&(_path.substr(0,9) == "postgres:")) {
 		_db.addDB(std::shared_ptr<DB>(new PostgreSQL(_signingId,_path.substr(9).c_str(), _listenPort, _mqc)));
 	} else {
 #endif
-		_db.addDB(std::shared_ptr<DB>(new FileDB(_path.c_str())));
+		_db.addDB(std::shared_ptr<DB>(new FileDB(_path.c_str(),snapshot)));
 #ifdef ZT_CONTROLLER_USE_LIBPQ
 	}
 #endif
 
-	std::string lfJSON;
-	OSUtils::readFile((_ztPath + ZT_PATH_SEPARATOR_S "local.conf").c_str(),lfJSON);
 	if (lfJSON.length() > 0) {
-		nlohmann::json lfConfig(OSUtils::jsonParse(lfJSON));
 		nlohmann::json &settings = lfConfig["settings"];
 		if (settings.is_object()) {
+			_volatileWriteInterval = OSUtils::jsonInt(settings["controllerVolatileWriteInterval"],(uint64_t)ZT_CONTROLLER_DEFAULT_VOLATILE_WRITE_INTERVAL);
+			_pushWindow = OSUtils::jsonInt(settings["controllerPushWindow"],(uint64_t)ZT_CONTROLLER_DEFAULT_PUSH_WINDOW);
+
 			nlohmann::json &controllerDb = settings["controllerDb"];
 			if (controllerDb.is_object()) {
 				std::string type = controllerDb["type"];
@@ -524,6 +677,57 @@ void EmbeddedNetworkController::init(const Identity &signingId,Sender *sender)
 	}
 
 	_db.waitForReady();
+
+	if (_volatileWriteInterval > 0) {
+		_volatileWriteThread = std::thread([this]() {
+			int64_t lastFlush = OSUtils::now();
+			while (_running) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(250));
+				const int64_t now = OSUtils::now();
+				if ((now - lastFlush) >= _volatileWriteInterval) {
+					lastFlush = now;
+					_flushVolatileMemberWrites();
+				}
+			}
+		});
+	}
+
+	if (_pushWindow > 0) {
+		_pushThread = std::thread([this]() {
+			std::vector<_MemberStatusKey> due;
+			int64_t rateStart = OSUtils::now();
+			uint64_t rateReleased = 0;
+			std::unique_lock<std::mutex> l(_push_l);
+			while (_pushRunning) {
+				const int64_t now = OSUtils::now();
+				if ((now - rateStart) >= 1000) {
+					_pushRate = ((double)rateReleased * 1000.0) / (double)(now - rateStart);
+					rateStart = now;
+					rateReleased = 0;
+				}
+
+				due.clear();
+				while ((!_pushSchedule.empty())&&(_pushSchedule.begin()->first <= now)) {
+					due.push_back(_pushSchedule.begin()->second);
+					_pushPending.erase(_pushSchedule.begin()->second);
+					_pushSchedule.erase(_pushSchedule.begin());
+				}
+				if (!due.empty()) {
+					_pushesReleased += due.size();
+					rateReleased += due.size();
+					l.unlock();
+					_releasePushes(due);
+					l.lock();
+					continue;
+				}
+
+				int64_t wake = rateStart + 1000;
+				if ((!_pushSchedule.empty())&&(_pushSchedule.begin()->first < wake))
+					wake = _pushSchedule.begin()->first;
+				_push_c.wait_for(l,std::chrono::milliseconds(std::max(wake - now,(int64_t)1)));
+			}
+		});
+	}
 }
 
 void EmbeddedNetworkController::request(
@@ -536,14 +740,53 @@ void EmbeddedNetworkController::request(
 	if (((!_signingId)||(!_signingId.hasPrivate()))||(_signingId.address().toInt() != (nwid >> 24))||(!_sender))
 		return;
 	_startThreads();
-	_RQEntry *qe = new _RQEntry;
-	qe->nwid = nwid;
-	qe->requestPacketId = requestPacketId;
-	qe->fromAddr = fromAddr;
-	qe->identity = identity;
-	qe->metaData = metaData;
-	qe->type = _RQEntry::RQENTRY_TYPE_REQUEST;
-	_queue.post(qe);
+
+	const uint64_t memberId = identity.address().toInt();
+	unsigned int rqClass;
+	if (!_db.isReady()) // don't block the caller on isAuthorized() while the DB is still loading
+		rqClass = ZT_CONTROLLER_RQ_CLASS_NEW_MEMBER;
+	else if (!_db.hasNetwork(nwid))
+		rqClass = ZT_CONTROLLER_RQ_CLASS_UNKNOWN_NETWORK;
+	else if (_db.isAuthorized(nwid,memberId))
+		rqClass = ZT_CONTROLLER_RQ_CLASS_AUTHORIZED;
+	else rqClass = ZT_CONTROLLER_RQ_CLASS_NEW_MEMBER;
+	const _MemberStatusKey k(nwid,memberId);
+
+	{
+		std::lock_guard<std::mutex> l(_rq_l);
+		if (!_rqRunning)
+			return;
+
+		// If this member already has a request waiting, answer only the newest
+		auto p = _rqPending.find(k);
+		if ((p != _rqPending.end())&&(p->second->identity == identity)) {
+			p->second->requestPacketId = requestPacketId;
+			p->second->fromAddr = fromAddr;
+			p->second->metaData = metaData;
+			++_rqDeduplicated;
+			return;
+		}
+
+		if (_rq[rqClass].size() >= _rqCapacity[rqClass]) {
+			++_rqStats[rqClass].dropped;
+			return;
+		}
+
+		_RQEntry *qe = new _RQEntry;
+		qe->nwid = nwid;
+		qe->requestPacketId = requestPacketId;
+		qe->fromAddr = fromAddr;
+		qe->identity = identity;
+		qe->metaData = metaData;
+		qe->type = _RQEntry::RQENTRY_TYPE_REQUEST;
+		qe->rqClass = rqClass;
+		qe->queuedAt = (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		_rq[rqClass].push_back(qe);
+		if (p == _rqPending.end())
+			_rqPending[k] = qe;
+		++_rqStats[rqClass].queued;
+	}
+	_rq_c.notify_one();
 }
 
 unsigned int EmbeddedNetworkController::handleControlPlaneHttpGET(
@@ -577,21 +820,45 @@ unsigned int EmbeddedNetworkController::handleControlPlaneHttpGET(
 						responseContentType = "application/json";
 
 					} else {
-						// List members and their revisions
-
-						responseBody = "{";
-						std::vector<json> members;
-						if (_db.get(nwid,network,members)) {
-							responseBody.reserve((members.size() + 2) * 32);
-							std::string mid;
-							for(auto member=members.begin();member!=members.end();++member) {
-								mid = (*member)["id"];
-								char tmp[128];
-								OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s\"%s\":%llu",(responseBody.length() > 1) ? "," : "",mid.c_str(),(unsigned long long)OSUtils::jsonInt((*member)["revision"],0));
+						// List members and their revisions, optionally filtered and paged
+
+						std::map<std::string,std::string>::const_iterator a;
+						const bool paged = ((urlArgs.count("limit"))||(urlArgs.count("after")));
+						unsigned long limit = ZT_CONTROLLER_MEMBER_LIST_MAX_PAGE;
+						if (((a = urlArgs.find("limit")) != urlArgs.end())&&(!a->second.empty()))
+							limit = std::max(1UL,std::min((unsigned long)Utils::strToU64(a->second.c_str()),limit));
+						const uint64_t after = ((a = urlArgs.find("after")) != urlArgs.end()) ? Utils::hexStrToU64(a->second.c_str()) : 0ULL;
+						const bool authorizedOnly = (((a = urlArgs.find("authorized")) != urlArgs.end())&&((a->second == "1")||(a->second == "true")));
+						uint64_t minRevision = 0;
+						if ((a = urlArgs.find("revision")) != urlArgs.end())
+							minRevision = Utils::strToU64(a->second.c_str()) + 1ULL; // changed since revision N
+
+						responseBody = (paged) ? "{\"members\":{" : "{";
+						const std::string::size_type start = responseBody.length();
+						unsigned long count = 0;
+						uint64_t last = 0;
+						bool more = false;
+						char tmp[64];
+						_db.eachMember(nwid,after,authorizedOnly,minRevision,[&](const uint64_t memberId,const uint64_t revision,const bool authorized) -> bool {
+							if ((paged)&&(count >= limit)) {
+								more = true;
+								return false;
+							}
+							OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s\"%.10llx\":%llu",(responseBody.length() > start) ? "," : "",(unsigned long long)memberId,(unsigned long long)revision);
+							responseBody.append(tmp);
+							last = memberId;
+							++count;
+							return true;
+						});
+						responseBody.push_back('}');
+						if (paged) {
+							if (more) {
+								OSUtils::ztsnprintf(tmp,sizeof(tmp),",\"next\":\"%.10llx\"}",(unsigned long long)last);
 								responseBody.append(tmp);
+							} else {
+								responseBody.append(",\"next\":null}");
 							}
 						}
-						responseBody.push_back('}');
 						responseContentType = "application/json";
 
 					}
@@ -631,10 +898,67 @@ unsigned int EmbeddedNetworkController::handleControlPlaneHttpGET(
 	} else {
 		// Controller status
 
-		char tmp[4096];
 		const bool dbOk = _db.isReady();
-		OSUtils::ztsnprintf(tmp,sizeof(tmp),"{\n\t\"controller\": true,\n\t\"apiVersion\": %d,\n\t\"clock\": %llu,\n\t\"databaseReady\": %s\n}\n",ZT_NETCONF_CONTROLLER_API_VERSION,(unsigned long long)OSUtils::now(),dbOk ? "true" : "false");
-		responseBody = tmp;
+		json status;
+		status["controller"] = true;
+		status["apiVersion"] = ZT_NETCONF_CONTROLLER_API_VERSION;
+		status["clock"] = OSUtils::now();
+		status["databaseReady"] = dbOk;
+		{
+			std::lock_guard<std::mutex> l(_stats_l);
+			json &rq = status["requests"];
+			rq["handled"] = _requestsHandled;
+			rq["meanLatencyMicros"] = (_requestsHandled) ? (_requestMicros / _requestsHandled) : 0ULL;
+			rq["maxLatencyMicros"] = _requestMaxMicros;
+			rq["templateCacheHits"] = _templateHits;
+			rq["templateCacheMisses"] = _templateMisses;
+			rq["fullConfigsSent"] = _fullConfigsSent;
+			rq["fullConfigBytes"] = _fullConfigBytes;
+			rq["deltaConfigsSent"] = _deltaConfigsSent;
+			rq["deltaConfigBytes"] = _deltaConfigBytes;
+			json &mw = status["memberWrites"];
+			mw["saves"] = _memberSaves;
+			mw["written"] = _memberWrites;
+			mw["skipped"] = _memberWritesSkipped;
+			mw["deferred"] = _memberWritesDeferred;
+			mw["coalesced"] = _memberWritesCoalesced;
+			mw["flushed"] = _memberWritesFlushed;
+			mw["writeAmplification"] = (_memberSaves) ? ((double)(_memberWrites + _memberWritesFlushed) / (double)_memberSaves) : 0.0;
+		}
+		{
+			std::lock_guard<std::mutex> l(_volatileWrites_l);
+			status["memberWrites"]["pending"] = (unsigned long)_volatileWrites.size();
+		}
+		{
+			std::lock_guard<std::mutex> l(_push_l);
+			json &p = status["pushes"];
+			p["window"] = _pushWindow;
+			p["pending"] = (unsigned long)_pushPending.size();
+			p["scheduled"] = _pushesScheduled;
+			p["merged"] = _pushesMerged;
+			p["superseded"] = _pushesSuperseded;
+			p["released"] = _pushesReleased;
+			p["rate"] = _pushRate;
+		}
+		{
+			static const char *const classNames[ZT_CONTROLLER_RQ_CLASS_COUNT] = { "authorized","newMember","unknownNetwork" };
+			std::lock_guard<std::mutex> l(_rq_l);
+			json &q = status["queue"];
+			q["deduplicated"] = _rqDeduplicated;
+			status["pushes"]["revocationsPending"] = (unsigned long)_rqRevocations.size();
+			status["pushes"]["revocationsQueued"] = _rqRevocationsQueued;
+			for(unsigned int c=0;c<ZT_CONTROLLER_RQ_CLASS_COUNT;++c) {
+				json &qc = q[classNames[c]];
+				qc["depth"] = (unsigned long)_rq[c].size();
+				qc["capacity"] = _rqCapacity[c];
+				qc["queued"] = _rqStats[c].queued;
+				qc["dropped"] = _rqStats[c].dropped;
+				qc["dequeued"] = _rqStats[c].dequeued;
+				qc["meanWaitMicros"] = (_rqStats[c].dequeued) ? (_rqStats[c].waitMicros / _rqStats[c].dequeued) : 0ULL;
+				qc["maxWaitMicros"] = _rqStats[c].maxWaitMicros;
+			}
+		}
+		responseBody = OSUtils::jsonDump(status);
 		responseContentType = "application/json";
 		return dbOk ? 200 : 503;
 
@@ -654,6 +978,12 @@ unsigned int EmbeddedNetworkController::handleControlPlaneHttpPOST(
 	if (path.empty())
 		return 404;
 
+	if ((path.size() == 3)&&(path[0] == "network")&&(path[1].length() == 16)&&(path[2] == "member")) {
+		// Bulk member create/update, body is one JSON object per line
+		responseContentType = "application/json";
+		return _bulkMemberPost(Utils::hexStrToU64(path[1].c_str()),body,responseBody);
+	}
+
 	json b;
 	try {
 		b = OSUtils::jsonParse(body);
@@ -688,85 +1018,7 @@ unsigned int EmbeddedNetworkController::handleControlPlaneHttpPOST(
 					DB::initMember(member);
 
 					try {
-						if (b.count("activeBridge")) member["activeBridge"] = OSUtils::jsonBool(b["activeBridge"],false);
-						if (b.count("noAutoAssignIps")) member["noAutoAssignIps"] = OSUtils::jsonBool(b["noAutoAssignIps"],false);
-
-						if (b.count("remoteTraceTarget")) {
-							const std::string rtt(OSUtils::jsonString(b["remoteTraceTarget"],""));
-							if (rtt.length() == 10) {
-								member["remoteTraceTarget"] = rtt;
-							} else {
-								member["remoteTraceTarget"] = json();
-							}
-						}
-						if (b.count("remoteTraceLevel")) member["remoteTraceLevel"] = OSUtils::jsonInt(b["remoteTraceLevel"],0ULL);
-
-						if (b.count("authorized")) {
-							const bool newAuth = OSUtils::jsonBool(b["authorized"],false);
-							if (newAuth != OSUtils::jsonBool(member["authorized"],false)) {
-								member["authorized"] = newAuth;
-								member[((newAuth) ? "lastAuthorizedTime" : "lastDeauthorizedTime")] = now;
-								if (newAuth) {
-									member["lastAuthorizedCredentialType"] = "api";
-									member["lastAuthorizedCredential"] = json();
-								}
-							}
-						}
-
-						if (b.count("ipAssignments")) {
-							json &ipa = b["ipAssignments"];
-							if (ipa.is_array()) {
-								json mipa(json::array());
-								for(unsigned long i=0;i<ipa.size();++i) {
-									std::string ips = ipa[i];
-									InetAddress ip(ips.c_str());
-									if ((ip.ss_family == AF_INET)||(ip.ss_family == AF_INET6)) {
-										char tmpip[64];
-										mipa.push_back(ip.toIpString(tmpip));
-										if (mipa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
-											break;
-									}
-								}
-								member["ipAssignments"] = mipa;
-							}
-						}
-
-						if (b.count("tags")) {
-							json &tags = b["tags"];
-							if (tags.is_array()) {
-								std::map<uint64_t,uint64_t> mtags;
-								for(unsigned long i=0;i<tags.size();++i) {
-									json &tag = tags[i];
-									if ((tag.is_array())&&(tag.size() == 2))
-										mtags[OSUtils::jsonInt(tag[0],0ULL) & 0xffffffffULL] = OSUtils::jsonInt(tag[1],0ULL) & 0xffffffffULL;
-								}
-								json mtagsa = json::array();
-								for(std::map<uint64_t,uint64_t>::iterator t(mtags.begin());t!=mtags.end();++t) {
-									json ta = json::array();
-									ta.push_back(t->first);
-									ta.push_back(t->second);
-									mtagsa.push_back(ta);
-									if (mtagsa.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
-										break;
-								}
-								member["tags"] = mtagsa;
-							}
-						}
-
-						if (b.count("capabilities")) {
-							json &capabilities = b["capabilities"];
-							if (capabilities.is_array()) {
-								json mcaps = json::array();
-								for(unsigned long i=0;i<capabilities.size();++i) {
-									mcaps.push_back(OSUtils::jsonInt(capabilities[i],0ULL));
-									if (mcaps.size() >= ZT_CONTROLLER_MAX_ARRAY_SIZE)
-										break;
-								}
-								std::sort(mcaps.begin(),mcaps.end());
-								mcaps.erase(std::unique(mcaps.begin(),mcaps.end()),mcaps.end());
-								member["capabilities"] = mcaps;
-							}
-						}
+						_setMemberFields(member,b,now);
 					} catch ( ... ) {
 						responseBody = "{ \"message\": \"exception while processing parameters in JSON body\" }";
 						responseContentType = "application/json";
@@ -1053,6 +1305,95 @@ unsigned int EmbeddedNetworkController::handleControlPlaneHttpPOST(
 	return 404;
 }
 
+unsigned int EmbeddedNetworkController::_bulkMemberPost(const uint64_t nwid,const std::string &body,std::string &responseBody)
+{
+	json network;
+	if (!_db.get(nwid,network))
+		return 404;
+
+	const int64_t now = OSUtils::now();
+	char nwids[24],addrs[24];
+	OSUtils::ztsnprintf(nwids,sizeof(nwids),"%.16llx",(unsigned long long)nwid);
+
+	std::vector<json> batch;
+	std::set<uint64_t> batchIds;
+	batch.reserve(ZT_CONTROLLER_BULK_BATCH_SIZE);
+	unsigned long lineNo = 0,received = 0,changed = 0,failed = 0;
+	json errors = json::array();
+
+	std::string::size_type eol = 0;
+	for(std::string::size_type p=0;p<body.length();p=eol+1) {
+		eol = body.find('\n',p);
+		if (eol == std::string::npos)
+			eol = body.length();
+		++lineNo;
+		if (body.find_first_not_of(" \t\r",p) >= eol)
+			continue;
+		++received;
+
+		try {
+			json b(OSUtils::jsonParse(body.substr(p,eol - p)));
+			if (!b.is_object())
+				throw std::runtime_error("line is not a JSON object");
+			const std::string ids(OSUtils::jsonString(b.count("id") ? b["id"] : b["address"],""));
+			const uint64_t address = Utils::hexStrToU64(ids.c_str());
+			if ((ids.length() != 10)||(!address))
+				throw std::runtime_error("missing or invalid member id");
+
+			// A member can only appear once per batch since later lines build on its saved state
+			if (batchIds.count(address)) {
+				changed += _db.saveMembers(nwid,batch,true);
+				batch.clear();
+				batchIds.clear();
+			}
+
+			json member;
+			_db.get(nwid,network,address,member);
+			DB::initMember(member);
+			_setMemberFields(member,b,now);
+			OSUtils::ztsnprintf(addrs,sizeof(addrs),"%.10llx",(unsigned long long)address);
+			member["id"] = addrs;
+			member["address"] = addrs; // legacy
+			member["nwid"] = nwids;
+			DB::cleanMember(member);
+
+			batch.push_back(member);
+			batchIds.insert(address);
+			if (batch.size() >= ZT_CONTROLLER_BULK_BATCH_SIZE) {
+				changed += _db.saveMembers(nwid,batch,true);
+				batch.clear();
+				batchIds.clear();
+			}
+		} catch (std::exception &e) {
+			if (errors.size() < 100) {
+				json err;
+				err["line"] = lineNo;
+				err["message"] = e.what();
+				errors.push_back(err);
+			}
+			++failed;
+		} catch ( ... ) {
+			if (errors.size() < 100) {
+				json err;
+				err["line"] = lineNo;
+				err["message"] = "exception while processing line";
+				errors.push_back(err);
+			}
+			++failed;
+		}
+	}
+	if (!batch.empty())
+		changed += _db.saveMembers(nwid,batch,true);
+
+	json result;
+	result["received"] = received;
+	result["changed"] = changed;
+	result["failed"] = failed;
+	result["errors"] = errors;
+	responseBody = OSUtils::jsonDump(result);
+	return 200;
+}
+
 unsigned int EmbeddedNetworkController::handleControlPlaneHttpDELETE(
 	const std::vector<std::string> &path,
 	const std::map<std::string,std::string> &urlArgs,
@@ -1090,6 +1431,7 @@ unsigned int EmbeddedNetworkController::handleControlPlaneHttpDELETE(
 				json network;
 				_db.get(nwid,network);
 				_db.eraseNetwork(nwid);
+				_forgetNetworkTemplate(nwid);
 
 				{
 					std::lock_guard<std::mutex> l(_memberStatus_l);
@@ -1117,38 +1459,17 @@ void EmbeddedNetworkController::handleRemoteTrace(const ZT_RemoteTrace &rt)
 {
 	static volatile unsigned long idCounter = 0;
 	char id[128],tmp[128];
-	std::string k,v;
 
 	try {
 		// Convert Dictionary into JSON object
 		json d;
-		char *saveptr = (char *)0;
-		for(char *l=Utils::stok(rt.data,"\n",&saveptr);(l);l=Utils::stok((char *)0,"\n",&saveptr)) {
-			char *eq = strchr(l,'=');
-			if (eq > l) {
-				k.assign(l,(unsigned long)(eq - l));
-				v.clear();
-				++eq;
-				while (*eq) {
-					if (*eq == '\\') {
-						++eq;
-						if (*eq) {
-							switch(*eq) {
-								case 'r': v.push_back('\r'); break;
-								case 'n': v.push_back('\n'); break;
-								case '0': v.push_back((char)0); break;
-								case 'e': v.push_back('='); break;
-								default: v.push_back(*eq); break;
-							}
-							++eq;
-						}
-					} else {
-						v.push_back(*(eq++));
-					}
-				}
-				if ((k.length() > 0)&&(v.length() > 0))
-					d[k] = v;
-			}
+		const DictionaryIndex rtd(rt.data,rt.len);
+		std::unique_ptr<char[]> v(new char[ZT_MAX_REMOTE_TRACE_SIZE + 1]);
+		for(unsigned int i=0;i<rtd.size();++i) {
+			const DictionaryIndex::Entry &e = rtd.entry(i);
+			const int vlen = DictionaryIndex::value(e,v.get(),ZT_MAX_REMOTE_TRACE_SIZE + 1);
+			if ((e.klen > 0)&&(vlen > 0))
+				d[std::string(e.k,e.klen)] = std::string(v.get(),(unsigned long)vlen);
 		}
 
 		const int64_t now = OSUtils::now();
@@ -1165,13 +1486,37 @@ void EmbeddedNetworkController::handleRemoteTrace(const ZT_RemoteTrace &rt)
 
 void EmbeddedNetworkController::onNetworkUpdate(const void *db,uint64_t networkId,const nlohmann::json &network)
 {
-	// Send an update to all members of the network that are online
-	const int64_t now = OSUtils::now();
-	std::lock_guard<std::mutex> l(_memberStatus_l);
-	for(auto i=_memberStatus.begin();i!=_memberStatus.end();++i) {
-		if ((i->first.networkId == networkId)&&(i->second.online(now))&&(i->second.lastRequestMetaData))
-			request(networkId,InetAddress(),0,i->second.identity,i->second.lastRequestMetaData);
+	if ((!network.is_object())||(network.empty())) { // network deleted
+		_forgetNetworkTemplate(networkId);
+		return;
 	}
+
+	{
+		// Keep the rules members have now so the new ones can be pushed as a patch
+		std::lock_guard<std::mutex> l(_networkTemplates_l);
+		auto t = _networkTemplates.find(networkId);
+		if (t != _networkTemplates.end()) {
+			_previousRulesEntries[networkId] = t->second->rulesEntry;
+			_networkTemplates.erase(t);
+		}
+	}
+
+	// Send an update to all members of the network that are online, paced
+	// unless the push window is disabled
+	std::vector<uint64_t> online;
+	{
+		const int64_t now = OSUtils::now();
+		std::lock_guard<std::mutex> l(_memberStatus_l);
+		for(auto i=_memberStatus.begin();i!=_memberStatus.end();++i) {
+			if ((i->first.networkId == networkId)&&(i->second.online(now))&&(i->second.lastRequestMetaData)) {
+				if (_pushWindow > 0)
+					online.push_back(i->first.nodeId);
+				else request(networkId,InetAddress(),0,i->second.identity,i->second.lastRequestMetaData);
+			}
+		}
+	}
+	if (!online.empty())
+		_schedulePushes(networkId,online);
 }
 
 void EmbeddedNetworkController::onNetworkMemberUpdate(const void *db,uint64_t networkId,uint64_t memberId,const nlohmann::json &member)
@@ -1180,23 +1525,57 @@ void EmbeddedNetworkController::onNetworkMemberUpdate(const void *db,uint64_t ne
 	try {
 		std::lock_guard<std::mutex> l(_memberStatus_l);
 		_MemberStatus &ms = _memberStatus[_MemberStatusKey(networkId,memberId)];
-		if ((ms.online(OSUtils::now()))&&(ms.lastRequestMetaData))
+		if ((ms.online(OSUtils::now()))&&(ms.lastRequestMetaData)) {
+			_cancelPush(networkId,memberId);
 			request(networkId,InetAddress(),0,ms.identity,ms.lastRequestMetaData);
+		}
 	} catch ( ... ) {}
 }
 
 void EmbeddedNetworkController::onNetworkMemberDeauthorize(const void *db,uint64_t networkId,uint64_t memberId)
 {
+	if (!_sender)
+		return;
+	_startThreads();
+
 	const int64_t now = OSUtils::now();
-	Revocation rev((uint32_t)_node->prng(),networkId,0,now,ZT_REVOCATION_FLAG_FAST_PROPAGATE,Address(memberId),Revocation::CREDENTIAL_TYPE_COM);
+	uint32_t revId;
+	if (_node)
+		revId = (uint32_t)_node->prng();
+	else Utils::getSecureRandom(&revId,sizeof(revId));
+	Revocation rev(revId,networkId,0,now,ZT_REVOCATION_FLAG_FAST_PROPAGATE,Address(memberId),Revocation::CREDENTIAL_TYPE_COM);
 	rev.sign(_signingId);
+
+	// Revocations skip push pacing and go out ahead of all queued requests
+	std::vector<Identity> online;
 	{
 		std::lock_guard<std::mutex> l(_memberStatus_l);
 		for(auto i=_memberStatus.begin();i!=_memberStatus.end();++i) {
 			if ((i->first.networkId == networkId)&&(i->second.online(now)))
-				_node->ncSendRevocation(Address(i->first.nodeId),rev);
+				online.push_back(i->second.identity);
+		}
+	}
+	if (online.empty())
+		return;
+	{
+		const int64_t queuedAt = (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		std::lock_guard<std::mutex> l(_rq_l);
+		if (!_rqRunning)
+			return;
+		for(auto i=online.begin();i!=online.end();++i) {
+			_RQEntry *qe = new _RQEntry;
+			qe->nwid = networkId;
+			qe->requestPacketId = 0;
+			qe->identity = *i;
+			qe->revocation = rev;
+			qe->type = _RQEntry::RQENTRY_TYPE_REVOCATION;
+			qe->rqClass = ZT_CONTROLLER_RQ_CLASS_AUTHORIZED;
+			qe->queuedAt = queuedAt;
+			_rqRevocations.push_back(qe);
 		}
+		_rqRevocationsQueued += online.size();
 	}
+	_rq_c.notify_all();
 }
 
 void EmbeddedNetworkController::_request(
@@ -1208,7 +1587,8 @@ void EmbeddedNetworkController::_request(
 {
 	char nwids[24];
 	DB::NetworkSummaryInfo ns;
-	json network,member;
+	std::shared_ptr<const json> networkSnapshot;
+	json member;
 
 	if (((!_signingId)||(!_signingId.hasPrivate()))||(_signingId.address().toInt() != (nwid >> 24))||(!_sender))
 		return;
@@ -1223,14 +1603,19 @@ void EmbeddedNetworkController::_request(
 		ms.lastRequestTime = now;
 	}
 
+	// A member answered now doesn't need a paced push of the same config later
+	_cancelPush(nwid,identity.address().toInt());
+
 	_db.nodeIsOnline(nwid,identity.address().toInt(),fromAddr);
 
 	Utils::hex(nwid,nwids);
-	_db.get(nwid,network,identity.address().toInt(),member,ns);
-	if ((!network.is_object())||(network.size() == 0)) {
+	_db.get(nwid,networkSnapshot,identity.address().toInt(),member,ns);
+	const json storedMember(member);
+	if ((!networkSnapshot)||(!networkSnapshot->is_object())||(networkSnapshot->size() == 0)) {
 		_sender->ncSendError(nwid,requestPacketId,identity.address(),NetworkController::NC_ERROR_OBJECT_NOT_FOUND);
 		return;
 	}
+	const json &network = *networkSnapshot; // shared with the DB, so read it with _field() only
 	const bool newMember = ((!member.is_object())||(member.size() == 0));
 	DB::initMember(member);
 
@@ -1271,7 +1656,7 @@ void EmbeddedNetworkController::_request(
 	json autoAuthCredentialType,autoAuthCredential;
 	if (OSUtils::jsonBool(member["authorized"],false)) {
 		authorized = true;
-	} else if (!OSUtils::jsonBool(network["private"],true)) {
+	} else if (!OSUtils::jsonBool(_field(network,"private"),true)) {
 		authorized = true;
 		autoAuthorized = true;
 		autoAuthCredentialType = "public";
@@ -1281,8 +1666,7 @@ void EmbeddedNetworkController::_request(
 			presentedAuth[511] = (char)0; // sanity check
 			if ((strlen(presentedAuth) > 6)&&(!strncmp(presentedAuth,"token:",6))) {
 				const char *const presentedToken = presentedAuth + 6;
-				json authTokens(network["authTokens"]);
-				json &tokenExpires = authTokens[presentedToken];
+				const json &tokenExpires = _field(_field(network,"authTokens"),presentedToken);
 				if (tokenExpires.is_number()) {
 					if ((tokenExpires == 0)||(tokenExpires > now)) {
 						authorized = true;
@@ -1331,7 +1715,7 @@ void EmbeddedNetworkController::_request(
 	} else {
 		// If they are not authorized, STOP!
 		DB::cleanMember(member);
-		_db.save(member,true);
+		_saveMember(storedMember,member);
 		_sender->ncSendError(nwid,requestPacketId,identity.address(),NetworkController::NC_ERROR_ACCESS_DENIED);
 		return;
 	}
@@ -1356,43 +1740,46 @@ void EmbeddedNetworkController::_request(
 	std::unique_ptr<NetworkConfig> nc(new NetworkConfig());
 
 	nc->networkId = nwid;
-	nc->type = OSUtils::jsonBool(network["private"],true) ? ZT_NETWORK_TYPE_PRIVATE : ZT_NETWORK_TYPE_PUBLIC;
+	nc->type = OSUtils::jsonBool(_field(network,"private"),true) ? ZT_NETWORK_TYPE_PRIVATE : ZT_NETWORK_TYPE_PUBLIC;
 	nc->timestamp = now;
 	nc->credentialTimeMaxDelta = credentialtmd;
-	nc->revision = OSUtils::jsonInt(network["revision"],0ULL);
+	nc->revision = OSUtils::jsonInt(_field(network,"revision"),0ULL);
 	nc->issuedTo = identity.address();
-	if (OSUtils::jsonBool(network["enableBroadcast"],true)) nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_BROADCAST;
-	Utils::scopy(nc->name,sizeof(nc->name),OSUtils::jsonString(network["name"],"").c_str());
-	nc->mtu = std::max(std::min((unsigned int)OSUtils::jsonInt(network["mtu"],ZT_DEFAULT_MTU),(unsigned int)ZT_MAX_MTU),(unsigned int)ZT_MIN_MTU);
-	nc->multicastLimit = (unsigned int)OSUtils::jsonInt(network["multicastLimit"],32ULL);
+	if (OSUtils::jsonBool(_field(network,"enableBroadcast"),true)) nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_BROADCAST;
+	Utils::scopy(nc->name,sizeof(nc->name),OSUtils::jsonString(_field(network,"name"),"").c_str());
+	nc->mtu = std::max(std::min((unsigned int)OSUtils::jsonInt(_field(network,"mtu"),ZT_DEFAULT_MTU),(unsigned int)ZT_MAX_MTU),(unsigned int)ZT_MIN_MTU);
+	nc->multicastLimit = (unsigned int)OSUtils::jsonInt(_field(network,"multicastLimit"),32ULL);
 
 	std::string rtt(OSUtils::jsonString(member["remoteTraceTarget"],""));
 	if (rtt.length() == 10) {
 		nc->remoteTraceTarget = Address(Utils::hexStrToU64(rtt.c_str()));
 		nc->remoteTraceLevel = (Trace::Level)OSUtils::jsonInt(member["remoteTraceLevel"],0ULL);
 	} else {
-		rtt = OSUtils::jsonString(network["remoteTraceTarget"],"");
+		rtt = OSUtils::jsonString(_field(network,"remoteTraceTarget"),"");
 		if (rtt.length() == 10) {
 			nc->remoteTraceTarget = Address(Utils::hexStrToU64(rtt.c_str()));
 		} else {
 			nc->remoteTraceTarget.zero();
 		}
-		nc->remoteTraceLevel = (Trace::Level)OSUtils::jsonInt(network["remoteTraceLevel"],0ULL);
+		nc->remoteTraceLevel = (Trace::Level)OSUtils::jsonInt(_field(network,"remoteTraceLevel"),0ULL);
 	}
 
 	for(std::vector<Address>::const_iterator ab(ns.activeBridges.begin());ab!=ns.activeBridges.end();++ab)
 		nc->addSpecialist(*ab,ZT_NETWORKCONFIG_SPECIALIST_TYPE_ACTIVE_BRIDGE);
 
-	json &v4AssignMode = network["v4AssignMode"];
-	json &v6AssignMode = network["v6AssignMode"];
-	json &ipAssignmentPools = network["ipAssignmentPools"];
-	json &routes = network["routes"];
-	json &rules = network["rules"];
-	json &capabilities = network["capabilities"];
-	json &tags = network["tags"];
+	const json &v4AssignMode = _field(network,"v4AssignMode");
+	const json &v6AssignMode = _field(network,"v6AssignMode");
+	const json &ipAssignmentPools = _field(network,"ipAssignmentPools");
+	const json &capabilities = _field(network,"capabilities");
+	const json &tags = _field(network,"tags");
 	json &memberCapabilities = member["capabilities"];
 	json &memberTags = member["tags"];
 
+	const std::shared_ptr<const _NetworkTemplate> tmpl(_getNetworkTemplate(nwid,network));
+	const bool sendLegacyFormatConfig = (metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_VERSION,0) < 6);
+	const bool hashTreeChunks = ((metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_FLAGS,0) & ZT_NETWORKCONFIG_REQUEST_FLAG_HASH_TREE_CHUNKS) != 0);
+	bool useRulesEntry = false;
+
 	if (metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_RULES_ENGINE_REV,0) <= 0) {
 		// Old versions with no rules engine support get an allow everything rule.
 		// Since rules are enforced bidirectionally, newer versions *will* still
@@ -1400,25 +1787,20 @@ void EmbeddedNetworkController::_request(
 		nc->ruleCount = 1;
 		nc->rules[0].t = ZT_NETWORK_RULE_ACTION_ACCEPT;
 	} else {
-		if (rules.is_array()) {
-			for(unsigned long i=0;i<rules.size();++i) {
-				if (nc->ruleCount >= ZT_MAX_NETWORK_RULES)
-					break;
-				if (_parseRule(rules[i],nc->rules[nc->ruleCount]))
-					++nc->ruleCount;
-			}
+		useRulesEntry = ((!sendLegacyFormatConfig)&&(identity.address() != _signingId.address())&&(!tmpl->rulesEntry.empty()));
+		if (!useRulesEntry) {
+			nc->ruleCount = (unsigned int)tmpl->rules.size();
+			nc->rules.assign(tmpl->rules.data(),nc->ruleCount);
 		}
 
-		std::map< uint64_t,json * > capsById;
 		if (!memberCapabilities.is_array())
 			memberCapabilities = json::array();
-		if (capabilities.is_array()) {
+		if ((newMember)&&(capabilities.is_array())) {
 			for(unsigned long i=0;i<capabilities.size();++i) {
-				json &cap = capabilities[i];
+				const json &cap = capabilities[i];
 				if (cap.is_object()) {
-					const uint64_t id = OSUtils::jsonInt(cap["id"],0ULL) & 0xffffffffULL;
-					capsById[id] = &cap;
-					if ((newMember)&&(OSUtils::jsonBool(cap["default"],false))) {
+					const uint64_t id = OSUtils::jsonInt(_field(cap,"id"),0ULL) & 0xffffffffULL;
+					if (OSUtils::jsonBool(_field(cap,"default"),false)) {
 						bool have = false;
 						for(unsigned long i=0;i<memberCapabilities.size();++i) {
 							if (id == (OSUtils::jsonInt(memberCapabilities[i],0ULL) & 0xffffffffULL)) {
@@ -1433,28 +1815,14 @@ void EmbeddedNetworkController::_request(
 			}
 		}
 		for(unsigned long i=0;i<memberCapabilities.size();++i) {
-			const uint64_t capId = OSUtils::jsonInt(memberCapabilities[i],0ULL) & 0xffffffffULL;
-			std::map< uint64_t,json * >::const_iterator ctmp = capsById.find(capId);
-			if (ctmp != capsById.end()) {
-				json *cap = ctmp->second;
-				if ((cap)&&(cap->is_object())&&(cap->size() > 0)) {
-					ZT_VirtualNetworkRule capr[ZT_MAX_CAPABILITY_RULES];
-					unsigned int caprc = 0;
-					json &caprj = (*cap)["rules"];
-					if ((caprj.is_array())&&(caprj.size() > 0)) {
-						for(unsigned long j=0;j<caprj.size();++j) {
-							if (caprc >= ZT_MAX_CAPABILITY_RULES)
-								break;
-							if (_parseRule(caprj[j],capr[caprc]))
-								++caprc;
-						}
-					}
-					nc->capabilities[nc->capabilityCount] = Capability((uint32_t)capId,nwid,now,1,capr,caprc);
-					if (nc->capabilities[nc->capabilityCount].sign(_signingId,identity.address()))
-						++nc->capabilityCount;
-					if (nc->capabilityCount >= ZT_MAX_NETWORK_CAPABILITIES)
-						break;
-				}
+			const uint32_t capId = (uint32_t)(OSUtils::jsonInt(memberCapabilities[i],0ULL) & 0xffffffffULL);
+			std::map< uint32_t,std::vector<ZT_VirtualNetworkRule> >::const_iterator ctmp = tmpl->capabilityRules.find(capId);
+			if (ctmp != tmpl->capabilityRules.end()) {
+				nc->capabilities[nc->capabilityCount] = Capability(capId,nwid,now,1,ctmp->second.data(),(unsigned int)ctmp->second.size());
+				if (nc->capabilities[nc->capabilityCount].sign(_signingId,identity.address()))
+					++nc->capabilityCount;
+				if (nc->capabilityCount >= ZT_MAX_NETWORK_CAPABILITIES)
+					break;
 			}
 		}
 
@@ -1468,10 +1836,10 @@ void EmbeddedNetworkController::_request(
 		}
 		if (tags.is_array()) { // check network tags array for defaults that are not present in member tags
 			for(unsigned long i=0;i<tags.size();++i) {
-				json &t = tags[i];
+				const json &t = tags[i];
 				if (t.is_object()) {
-					const uint32_t id = (uint32_t)(OSUtils::jsonInt(t["id"],0) & 0xffffffffULL);
-					json &dfl = t["default"];
+					const uint32_t id = (uint32_t)(OSUtils::jsonInt(_field(t,"id"),0) & 0xffffffffULL);
+					const json &dfl = _field(t,"default");
 					if ((dfl.is_number())&&(memberTagsById.find(id) == memberTagsById.end())) {
 						memberTagsById[id] = (uint32_t)(OSUtils::jsonInt(dfl,0) & 0xffffffffULL);
 						json mt = json::array();
@@ -1491,36 +1859,18 @@ void EmbeddedNetworkController::_request(
 		}
 	}
 
-	if (routes.is_array()) {
-		for(unsigned long i=0;i<routes.size();++i) {
-			if (nc->routeCount >= ZT_MAX_NETWORK_ROUTES)
-				break;
-			json &route = routes[i];
-			json &target = route["target"];
-			json &via = route["via"];
-			if (target.is_string()) {
-				const InetAddress t(target.get<std::string>().c_str());
-				InetAddress v;
-				if (via.is_string()) v.fromString(via.get<std::string>().c_str());
-				if ((t.ss_family == AF_INET)||(t.ss_family == AF_INET6)) {
-					ZT_VirtualNetworkRoute *r = &(nc->routes[nc->routeCount]);
-					*(reinterpret_cast<InetAddress *>(&(r->target))) = t;
-					if (v.ss_family == t.ss_family)
-						*(reinterpret_cast<InetAddress *>(&(r->via))) = v;
-					++nc->routeCount;
-				}
-			}
-		}
-	}
+	nc->routeCount = (unsigned int)tmpl->routes.size();
+	for(unsigned int i=0;i<nc->routeCount;++i)
+		nc->routes[i] = tmpl->routes[i];
 
 	const bool noAutoAssignIps = OSUtils::jsonBool(member["noAutoAssignIps"],false);
 
 	if ((v6AssignMode.is_object())&&(!noAutoAssignIps)) {
-		if ((OSUtils::jsonBool(v6AssignMode["rfc4193"],false))&&(nc->staticIpCount < ZT_MAX_ZT_ASSIGNED_ADDRESSES)) {
+		if ((OSUtils::jsonBool(_field(v6AssignMode,"rfc4193"),false))&&(nc->staticIpCount < ZT_MAX_ZT_ASSIGNED_ADDRESSES)) {
 			nc->staticIps[nc->staticIpCount++] = InetAddress::makeIpv6rfc4193(nwid,identity.address().toInt());
 			nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_IPV6_NDP_EMULATION;
 		}
-		if ((OSUtils::jsonBool(v6AssignMode["6plane"],false))&&(nc->staticIpCount < ZT_MAX_ZT_ASSIGNED_ADDRESSES)) {
+		if ((OSUtils::jsonBool(_field(v6AssignMode,"6plane"),false))&&(nc->staticIpCount < ZT_MAX_ZT_ASSIGNED_ADDRESSES)) {
 			nc->staticIps[nc->staticIpCount++] = InetAddress::makeIpv66plane(nwid,identity.address().toInt());
 			nc->flags |= ZT_NETWORKCONFIG_FLAG_ENABLE_IPV6_NDP_EMULATION;
 		}
@@ -1560,12 +1910,12 @@ void EmbeddedNetworkController::_request(
 		ipAssignments = json::array();
 	}
 
-	if ( (ipAssignmentPools.is_array()) && ((v6AssignMode.is_object())&&(OSUtils::jsonBool(v6AssignMode["zt"],false))) && (!haveManagedIpv6AutoAssignment) && (!noAutoAssignIps) ) {
+	if ( (ipAssignmentPools.is_array()) && ((v6AssignMode.is_object())&&(OSUtils::jsonBool(_field(v6AssignMode,"zt"),false))) && (!haveManagedIpv6AutoAssignment) && (!noAutoAssignIps) ) {
 		for(unsigned long p=0;((p<ipAssignmentPools.size())&&(!haveManagedIpv6AutoAssignment));++p) {
-			json &pool = ipAssignmentPools[p];
+			const json &pool = ipAssignmentPools[p];
 			if (pool.is_object()) {
-				InetAddress ipRangeStart(OSUtils::jsonString(pool["ipRangeStart"],"").c_str());
-				InetAddress ipRangeEnd(OSUtils::jsonString(pool["ipRangeEnd"],"").c_str());
+				InetAddress ipRangeStart(OSUtils::jsonString(_field(pool,"ipRangeStart"),"").c_str());
+				InetAddress ipRangeEnd(OSUtils::jsonString(_field(pool,"ipRangeEnd"),"").c_str());
 				if ( (ipRangeStart.ss_family == AF_INET6) && (ipRangeEnd.ss_family == AF_INET6) ) {
 					uint64_t s[2],e[2],x[2],xx[2];
 					memcpy(s,ipRangeStart.rawIpData(),16);
@@ -1605,7 +1955,7 @@ void EmbeddedNetworkController::_request(
 						}
 
 						// If it's routed, then try to claim and assign it and if successful end loop
-						if ( (routedNetmaskBits > 0) && (!std::binary_search(ns.allocatedIps.begin(),ns.allocatedIps.end(),ip6)) ) {
+						if ( (routedNetmaskBits > 0) && (!_db.ipAllocated(nwid,ip6)) ) {
 							char tmpip[64];
 							const std::string ipStr(ip6.toIpString(tmpip));
 							if (std::find(ipAssignments.begin(),ipAssignments.end(),ipStr) == ipAssignments.end()) {
@@ -1624,12 +1974,12 @@ void EmbeddedNetworkController::_request(
 		}
 	}
 
-	if ( (ipAssignmentPools.is_array()) && ((v4AssignMode.is_object())&&(OSUtils::jsonBool(v4AssignMode["zt"],false))) && (!haveManagedIpv4AutoAssignment) && (!noAutoAssignIps) ) {
+	if ( (ipAssignmentPools.is_array()) && ((v4AssignMode.is_object())&&(OSUtils::jsonBool(_field(v4AssignMode,"zt"),false))) && (!haveManagedIpv4AutoAssignment) && (!noAutoAssignIps) ) {
 		for(unsigned long p=0;((p<ipAssignmentPools.size())&&(!haveManagedIpv4AutoAssignment));++p) {
-			json &pool = ipAssignmentPools[p];
+			const json &pool = ipAssignmentPools[p];
 			if (pool.is_object()) {
-				InetAddress ipRangeStartIA(OSUtils::jsonString(pool["ipRangeStart"],"").c_str());
-				InetAddress ipRangeEndIA(OSUtils::jsonString(pool["ipRangeEnd"],"").c_str());
+				InetAddress ipRangeStartIA(OSUtils::jsonString(_field(pool,"ipRangeStart"),"").c_str());
+				InetAddress ipRangeEndIA(OSUtils::jsonString(_field(pool,"ipRangeEnd"),"").c_str());
 				if ( (ipRangeStartIA.ss_family == AF_INET) && (ipRangeEndIA.ss_family == AF_INET) ) {
 					uint32_t ipRangeStart = Utils::ntoh((uint32_t)(reinterpret_cast<struct sockaddr_in *>(&ipRangeStartIA)->sin_addr.s_addr));
 					uint32_t ipRangeEnd = Utils::ntoh((uint32_t)(reinterpret_cast<struct sockaddr_in *>(&ipRangeEndIA)->sin_addr.s_addr));
@@ -1663,7 +2013,7 @@ void EmbeddedNetworkController::_request(
 
 						// If it's routed, then try to claim and assign it and if successful end loop
 						const InetAddress ip4(Utils::hton(ip),0);
-						if ( (routedNetmaskBits > 0) && (!std::binary_search(ns.allocatedIps.begin(),ns.allocatedIps.end(),ip4)) ) {
+						if ( (routedNetmaskBits > 0) && (!_db.ipAllocated(nwid,ip4)) ) {
 							char tmpip[64];
 							const std::string ipStr(ip4.toIpString(tmpip));
 							if (std::find(ipAssignments.begin(),ipAssignments.end(),ipStr) == ipAssignments.end()) {
@@ -1703,8 +2053,354 @@ void EmbeddedNetworkController::_request(
 	}
 
 	DB::cleanMember(member);
-	_db.save(member,true);
-	_sender->ncSendConfig(nwid,requestPacketId,identity.address(),*(nc.get()),metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_VERSION,0) < 6);
+	_saveMember(storedMember,member);
+
+	const bool deltaConfigs = ((!sendLegacyFormatConfig)&&(identity.address() != _signingId.address())&&((metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_FLAGS,0) & ZT_NETWORKCONFIG_REQUEST_FLAG_DELTA_CONFIGS) != 0));
+	if ((useRulesEntry)||(deltaConfigs)) {
+		// Encode member-specific fields, then append the network's pre-encoded rules
+		std::unique_ptr< Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> > dconf(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>());
+		if ((nc->toDictionary(*dconf,false))&&((!useRulesEntry)||(dconf->addEncoded(tmpl->rulesEntry.data(),(unsigned int)tmpl->rulesEntry.length())))) {
+			if (deltaConfigs)
+				_sendConfigDictionary(nwid,requestPacketId,identity,metaData,*dconf,*tmpl,hashTreeChunks);
+			else _sender->ncSendConfigDictionary(nwid,requestPacketId,identity.address(),*dconf,hashTreeChunks);
+		}
+	} else {
+		_sender->ncSendConfig(nwid,requestPacketId,identity.address(),*(nc.get()),sendLegacyFormatConfig,hashTreeChunks);
+	}
+}
+
+void EmbeddedNetworkController::_forgetNetworkTemplate(uint64_t nwid)
+{
+	std::lock_guard<std::mutex> l(_networkTemplates_l);
+	_networkTemplates.erase(nwid);
+	_previousRulesEntries.erase(nwid);
+}
+
+std::shared_ptr<const EmbeddedNetworkController::_NetworkTemplate> EmbeddedNetworkController::_getNetworkTemplate(uint64_t nwid,const nlohmann::json &network)
+{
+	const uint64_t revision = OSUtils::jsonInt(_field(network,"revision"),0ULL);
+	{
+		std::lock_guard<std::mutex> l(_networkTemplates_l);
+		auto t = _networkTemplates.find(nwid);
+		if ((t != _networkTemplates.end())&&(t->second->revision == revision)) {
+			std::lock_guard<std::mutex> l2(_stats_l);
+			++_templateHits;
+			return t->second;
+		}
+	}
+
+	std::shared_ptr<_NetworkTemplate> tmpl(new _NetworkTemplate());
+	tmpl->revision = revision;
+
+	const json &rules = _field(network,"rules");
+	if (rules.is_array()) {
+		for(unsigned long i=0;i<rules.size();++i) {
+			if (tmpl->rules.size() >= ZT_MAX_NETWORK_RULES)
+				break;
+			ZT_VirtualNetworkRule r;
+			if (_parseRule(rules[i],r))
+				tmpl->rules.push_back(r);
+		}
+	}
+
+	const json &capabilities = _field(network,"capabilities");
+	if (capabilities.is_array()) {
+		for(unsigned long i=0;i<capabilities.size();++i) {
+			const json &cap = capabilities[i];
+			if ((cap.is_object())&&(cap.size() > 0)) {
+				std::vector<ZT_VirtualNetworkRule> &capr = tmpl->capabilityRules[(uint32_t)(OSUtils::jsonInt(_field(cap,"id"),0ULL) & 0xffffffffULL)];
+				capr.clear();
+				const json &caprj = _field(cap,"rules");
+				if (caprj.is_array()) {
+					for(unsigned long j=0;j<caprj.size();++j) {
+						if (capr.size() >= ZT_MAX_CAPABILITY_RULES)
+							break;
+						ZT_VirtualNetworkRule r;
+						if (_parseRule(caprj[j],r))
+							capr.push_back(r);
+					}
+				}
+			}
+		}
+	}
+
+	const json &routes = _field(network,"routes");
+	if (routes.is_array()) {
+		for(unsigned long i=0;i<routes.size();++i) {
+			if (tmpl->routes.size() >= ZT_MAX_NETWORK_ROUTES)
+				break;
+			const json &route = routes[i];
+			const json &target = _field(route,"target");
+			const json &via = _field(route,"via");
+			if (target.is_string()) {
+				const InetAddress t(target.get<std::string>().c_str());
+				InetAddress v;
+				if (via.is_string()) v.fromString(via.get<std::string>().c_str());
+				if ((t.ss_family == AF_INET)||(t.ss_family == AF_INET6)) {
+					ZT_VirtualNetworkRoute r;
+					memset(&r,0,sizeof(r));
+					*(reinterpret_cast<InetAddress *>(&(r.target))) = t;
+					if (v.ss_family == t.ss_family)
+						*(reinterpret_cast<InetAddress *>(&(r.via))) = v;
+					tmpl->routes.push_back(r);
+				}
+			}
+		}
+	}
+
+	if (!tmpl->rules.empty()) {
+		std::unique_ptr< Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY> > tmp(new Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY>());
+		Capability::serializeRules(*tmp,tmpl->rules.data(),(unsigned int)tmpl->rules.size());
+		std::unique_ptr< Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> > d(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>());
+		if (d->add(ZT_NETWORKCONFIG_DICT_KEY_RULES,*tmp))
+			tmpl->rulesEntry.assign(d->data(),d->sizeBytes());
+	}
+
+	{
+		std::lock_guard<std::mutex> l(_networkTemplates_l);
+		auto p = _previousRulesEntries.find(nwid);
+		if (p != _previousRulesEntries.end()) {
+			if (p->second != tmpl->rulesEntry)
+				tmpl->previousRulesEntry = p->second;
+			_previousRulesEntries.erase(p);
+		}
+		_networkTemplates[nwid] = tmpl;
+	}
+	{
+		std::lock_guard<std::mutex> l(_stats_l);
+		++_templateMisses;
+	}
+
+	return tmpl;
+}
+
+void EmbeddedNetworkController::_sendConfigDictionary(uint64_t nwid,uint64_t requestPacketId,const Identity &identity,const Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> &metaData,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &dconf,const _NetworkTemplate &tmpl,bool hashTreeChunks)
+{
+	const unsigned int fullSize = dconf.sizeBytes();
+	std::vector<NetworkConfig::DictionaryEntryHash> entries;
+	const uint64_t fullHash = (NetworkConfig::dictionaryEntryHashes(dconf.data(),fullSize,entries)) ? NetworkConfig::dictionaryHash(dconf.data(),fullSize) : 0;
+
+	// Remember what this member will have next, and take what we think it has now
+	uint64_t baseHash;
+	std::vector<NetworkConfig::DictionaryEntryHash> baseEntries;
+	{
+		std::lock_guard<std::mutex> l(_memberStatus_l);
+		_MemberStatus &ms = _memberStatus[_MemberStatusKey(nwid,identity.address().toInt())];
+		baseHash = ms.configHash;
+		baseEntries.swap(ms.configEntries);
+		ms.configHash = fullHash;
+		ms.configEntries.swap(entries);
+	}
+
+	// A request says which config the member has; pushes assume it got the last one, and
+	// if it didn't it will fail to apply the delta and ask for a full config.
+	if ((requestPacketId)&&(metaData.getUI(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_CONFIG_HASH,0) != baseHash))
+		baseHash = 0;
+
+	if ((baseHash)&&(fullHash)) {
+		std::unique_ptr< Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> > delta(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>());
+		if (NetworkConfig::encodeDelta(dconf,baseHash,baseEntries,tmpl.previousRulesEntry.data(),(unsigned int)tmpl.previousRulesEntry.length(),*delta)) {
+			{
+				std::lock_guard<std::mutex> l(_stats_l);
+				++_deltaConfigsSent;
+				_deltaConfigBytes += delta->sizeBytes();
+			}
+			_sender->ncSendConfigDictionary(nwid,requestPacketId,identity.address(),*delta,hashTreeChunks);
+			return;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> l(_stats_l);
+		++_fullConfigsSent;
+		_fullConfigBytes += fullSize;
+	}
+	_sender->ncSendConfigDictionary(nwid,requestPacketId,identity.address(),dconf,hashTreeChunks);
+}
+
+void EmbeddedNetworkController::_saveMember(const nlohmann::json &old,nlohmann::json &member)
+{
+	const DB::MemberChange ch = DB::memberChangeType(old,member);
+	const _MemberStatusKey k(OSUtils::jsonIntHex(member["nwid"],0ULL),OSUtils::jsonIntHex(member["id"],0ULL));
+
+	if ((ch == DB::MEMBER_CHANGED)||((ch == DB::MEMBER_CHANGED_VOLATILE)&&(_volatileWriteInterval <= 0))) {
+		{
+			// The full record supersedes any buffered volatile fields
+			std::lock_guard<std::mutex> l(_volatileWrites_l);
+			_volatileWrites.erase(k);
+		}
+		_db.save(member,true);
+		std::lock_guard<std::mutex> l(_stats_l);
+		++_memberSaves;
+		++_memberWrites;
+	} else if (ch == DB::MEMBER_CHANGED_VOLATILE) {
+		// Only buffer the volatile fields themselves so a flush can never
+		// overwrite changes made to the record in the meantime.
+		json fields = json::object();
+		for(auto f=member.begin();f!=member.end();++f) {
+			if (DB::isVolatileMemberField(f.key()))
+				fields[f.key()] = f.value();
+		}
+		bool coalesced;
+		{
+			std::lock_guard<std::mutex> l(_volatileWrites_l);
+			json &pending = _volatileWrites[k];
+			coalesced = pending.is_object();
+			pending = fields;
+		}
+		std::lock_guard<std::mutex> l(_stats_l);
+		++_memberSaves;
+		if (coalesced)
+			++_memberWritesCoalesced;
+		else ++_memberWritesDeferred;
+	} else {
+		std::lock_guard<std::mutex> l(_stats_l);
+		++_memberSaves;
+		++_memberWritesSkipped;
+	}
+}
+
+void EmbeddedNetworkController::_flushVolatileMemberWrites()
+{
+	std::unordered_map< _MemberStatusKey,nlohmann::json,_MemberStatusHash > pending;
+	{
+		std::lock_guard<std::mutex> l(_volatileWrites_l);
+		pending.swap(_volatileWrites);
+	}
+	uint64_t flushed = 0;
+	for(auto p=pending.begin();p!=pending.end();++p) {
+		json network,member;
+		if (!_db.get(p->first.networkId,network,p->first.nodeId,member))
+			continue; // member was deleted since
+		bool changed = false;
+		for(auto f=p->second.begin();f!=p->second.end();++f) {
+			json &v = member[f.key()];
+			if (v != f.value()) {
+				v = f.value();
+				changed = true;
+			}
+		}
+		if (changed) {
+			_db.save(member,true);
+			++flushed;
+		}
+	}
+	if (flushed) {
+		std::lock_guard<std::mutex> l(_stats_l);
+		_memberWritesFlushed += flushed;
+	}
+}
+
+void EmbeddedNetworkController::_schedulePushes(uint64_t nwid,const std::vector<uint64_t> &memberIds)
+{
+	// The first ZT_CONTROLLER_PUSH_BURST members are due now and the rest are
+	// spread evenly over the window. A member that already has a push waiting
+	// keeps its place.
+	const int64_t now = OSUtils::now();
+	const unsigned long spread = (memberIds.size() > ZT_CONTROLLER_PUSH_BURST) ? (unsigned long)(memberIds.size() - ZT_CONTROLLER_PUSH_BURST) : 0;
+	{
+		std::lock_guard<std::mutex> l(_push_l);
+		for(unsigned long i=0;i<(unsigned long)memberIds.size();++i) {
+			const _MemberStatusKey k(nwid,memberIds[i]);
+			if (_pushPending.find(k) != _pushPending.end()) {
+				++_pushesMerged;
+				continue;
+			}
+			const int64_t due = (i < ZT_CONTROLLER_PUSH_BURST) ? now : (now + ((_pushWindow * (int64_t)(i - ZT_CONTROLLER_PUSH_BURST + 1)) / (int64_t)spread));
+			_pushPending[k] = _pushSchedule.insert(std::pair< int64_t,_MemberStatusKey >(due,k));
+			++_pushesScheduled;
+		}
+	}
+	_push_c.notify_one();
+}
+
+void EmbeddedNetworkController::_releasePushes(const std::vector<_MemberStatusKey> &due)
+{
+	const int64_t now = OSUtils::now();
+	std::lock_guard<std::mutex> l(_memberStatus_l);
+	for(auto k=due.begin();k!=due.end();++k) {
+		auto ms = _memberStatus.find(*k);
+		if ((ms != _memberStatus.end())&&(ms->second.online(now))&&(ms->second.lastRequestMetaData))
+			request(k->networkId,InetAddress(),0,ms->second.identity,ms->second.lastRequestMetaData);
+	}
+}
+
+void EmbeddedNetworkController::_cancelPush(uint64_t nwid,uint64_t memberId)
+{
+	std::lock_guard<std::mutex> l(_push_l);
+	auto p = _pushPending.find(_MemberStatusKey(nwid,memberId));
+	if (p != _pushPending.end()) {
+		_pushSchedule.erase(p->second);
+		_pushPending.erase(p);
+		++_pushesSuperseded;
+	}
+}
+
+EmbeddedNetworkController::_RQEntry *EmbeddedNetworkController::_rqGet()
+{
+	std::unique_lock<std::mutex> l(_rq_l);
+	while (_rqRunning) {
+		if (!_rqRevocations.empty()) {
+			_RQEntry *const qe = _rqRevocations.front();
+			_rqRevocations.pop_front();
+			return qe;
+		}
+
+		// Weighted so a flood of one class can't starve the others: out of every
+		// 16 turns authorized members get 12, new members 3 and unknown networks 1,
+		// with unused turns going to the highest priority class with work.
+		const unsigned long turn = (_rqTurn++) & 15;
+		unsigned int c = (turn == 15) ? ZT_CONTROLLER_RQ_CLASS_UNKNOWN_NETWORK : (((turn & 3) == 3) ? ZT_CONTROLLER_RQ_CLASS_NEW_MEMBER : ZT_CONTROLLER_RQ_CLASS_AUTHORIZED);
+		if (_rq[c].empty()) {
+			c = 0;
+			while ((c < ZT_CONTROLLER_RQ_CLASS_COUNT)&&(_rq[c].empty()))
+				++c;
+		}
+
+		if (c < ZT_CONTROLLER_RQ_CLASS_COUNT) {
+			_RQEntry *const qe = _rq[c].front();
+			_rq[c].pop_front();
+			auto p = _rqPending.find(_MemberStatusKey(qe->nwid,qe->identity.address().toInt()));
+			if ((p != _rqPending.end())&&(p->second == qe))
+				_rqPending.erase(p);
+
+			const int64_t now = (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			const uint64_t waited = (now > qe->queuedAt) ? (uint64_t)(now - qe->queuedAt) : 0;
+			_RQStats &st = _rqStats[c];
+			++st.dequeued;
+			st.waitMicros += waited;
+			if (waited > st.maxWaitMicros)
+				st.maxWaitMicros = waited;
+			return qe;
+		}
+
+		_rq_c.wait(l);
+	}
+	return (_RQEntry *)0;
+}
+
+void EmbeddedNetworkController::_rqStop()
+{
+	{
+		std::lock_guard<std::mutex> l(_rq_l);
+		_rqRunning = false;
+	}
+	_rq_c.notify_all();
+	{
+		std::lock_guard<std::mutex> l(_threads_l);
+		for(auto t=_threads.begin();t!=_threads.end();++t)
+			t->join();
+	}
+	std::lock_guard<std::mutex> l(_rq_l);
+	for(unsigned int c=0;c<ZT_CONTROLLER_RQ_CLASS_COUNT;++c) {
+		for(auto qe=_rq[c].begin();qe!=_rq[c].end();++qe)
+			delete *qe;
+		_rq[c].clear();
+	}
+	for(auto qe=_rqRevocations.begin();qe!=_rqRevocations.end();++qe)
+		delete *qe;
+	_rqRevocations.clear();
+	_rqPending.clear();
 }
 
 void EmbeddedNetworkController::_startThreads()
@@ -1716,13 +2412,23 @@ void EmbeddedNetworkController::_startThreads()
 	for(long t=0;t<hwc;++t) {
 		_threads.emplace_back([this]() {
 			for(;;) {
-				_RQEntry *qe = (_RQEntry *)0;
-				if (!_queue.get(qe))
+				_RQEntry *qe = _rqGet();
+				if (!qe)
 					break;
 				try {
-					if (qe) {
+					if (qe->type == _RQEntry::RQENTRY_TYPE_REVOCATION) {
+						_sender->ncSendRevocation(qe->identity.address(),qe->revocation);
+						delete qe;
+					} else {
+						const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
 						_request(qe->nwid,qe->fromAddr,qe->requestPacketId,qe->identity,qe->metaData);
 						delete qe;
+						const uint64_t micros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+						std::lock_guard<std::mutex> l(_stats_l);
+						++_requestsHandled;
+						_requestMicros += micros;
+						if (micros > _requestMaxMicros)
+							_requestMaxMicros = micros;
 					}
 				} catch (std::exception &e) {
 					fprintf(stderr,"ERROR: exception in controller request handling thread: %s" ZT_EOL_S,e.what());
@@ -21,25 +21,46 @@
 #include <vector>
 #include <set>
 #include <list>
+#include <deque>
 #include <thread>
+#include <condition_variable>
 #include <unordered_map>
 #include <atomic>
+#include <memory>
+#include <mutex>
 
 #include "../node/Constants.hpp"
 #include "../node/NetworkController.hpp"
 #include "../node/Utils.hpp"
 #include "../node/Address.hpp"
 #include "../node/InetAddress.hpp"
+#include "../node/Revocation.hpp"
 
 #include "../osdep/OSUtils.hpp"
 #include "../osdep/Thread.hpp"
-#include "../osdep/BlockingQueue.hpp"
 
 #include "../ext/json/json.hpp"
 
 #include "DB.hpp"
 #include "DBMirrorSet.hpp"
 
+// Request scheduling classes, highest priority first
+#define ZT_CONTROLLER_RQ_CLASS_AUTHORIZED 0      // refresh from an already authorized member
+#define ZT_CONTROLLER_RQ_CLASS_NEW_MEMBER 1      // new or unauthorized member of a known network
+#define ZT_CONTROLLER_RQ_CLASS_UNKNOWN_NETWORK 2 // network not hosted here
+#define ZT_CONTROLLER_RQ_CLASS_COUNT 3
+
+// Maximum queued requests per class, beyond which new requests are dropped
+#define ZT_CONTROLLER_RQ_MAX_AUTHORIZED 65536
+#define ZT_CONTROLLER_RQ_MAX_NEW_MEMBER 16384
+#define ZT_CONTROLLER_RQ_MAX_UNKNOWN_NETWORK 1024
+
+// Member records saved per DB batch by bulk member POSTs
+#define ZT_CONTROLLER_BULK_BATCH_SIZE 1024
+
+// Maximum (and default) number of members per page when listing members with paging
+#define ZT_CONTROLLER_MEMBER_LIST_MAX_PAGE 10000
+
 namespace ZeroTier {
 
 class Node;
@@ -94,7 +115,26 @@ public:
 	virtual void onNetworkMemberDeauthorize(const void *db,uint64_t networkId,uint64_t memberId);
 
 private:
+	// Parts of a network's config that are the same for every member, parsed
+	// and encoded once per network revision instead of once per request.
+	struct _NetworkTemplate
+	{
+		_NetworkTemplate() : revision(0) {}
+		uint64_t revision;
+		std::vector<ZT_VirtualNetworkRule> rules;
+		std::vector<ZT_VirtualNetworkRoute> routes;
+		std::map< uint32_t,std::vector<ZT_VirtualNetworkRule> > capabilityRules;
+		std::string rulesEntry; // rules already encoded as a config dictionary entry
+		std::string previousRulesEntry; // rulesEntry of the revision this replaced, if known, for delta configs
+	};
+
 	void _request(uint64_t nwid,const InetAddress &fromAddr,uint64_t requestPacketId,const Identity &identity,const Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> &metaData);
+	std::shared_ptr<const _NetworkTemplate> _getNetworkTemplate(uint64_t nwid,const nlohmann::json &network);
+	void _forgetNetworkTemplate(uint64_t nwid);
+	void _sendConfigDictionary(uint64_t nwid,uint64_t requestPacketId,const Identity &identity,const Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> &metaData,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &dconf,const _NetworkTemplate &tmpl,bool hashTreeChunks);
+	void _saveMember(const nlohmann::json &old,nlohmann::json &member);
+	unsigned int _bulkMemberPost(const uint64_t nwid,const std::string &body,std::string &responseBody);
+	void _flushVolatileMemberWrites();
 	void _startThreads();
 
 	struct _RQEntry
@@ -104,10 +144,26 @@ private:
 		InetAddress fromAddr;
 		Identity identity;
 		Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> metaData;
+		Revocation revocation;
 		enum {
-			RQENTRY_TYPE_REQUEST = 0
+			RQENTRY_TYPE_REQUEST = 0,
+			RQENTRY_TYPE_REVOCATION = 1 // send revocation to identity's address
 		} type;
+		unsigned int rqClass;
+		int64_t queuedAt; // steady clock, microseconds
+	};
+	struct _RQStats
+	{
+		_RQStats() : queued(0),dropped(0),dequeued(0),waitMicros(0),maxWaitMicros(0) {}
+		uint64_t queued;
+		uint64_t dropped;
+		uint64_t dequeued;
+		uint64_t waitMicros;
+		uint64_t maxWaitMicros;
 	};
+
+	_RQEntry *_rqGet();
+	void _rqStop();
 	struct _MemberStatusKey
 	{
 		_MemberStatusKey() : networkId(0),nodeId(0) {}
@@ -118,11 +174,13 @@ private:
 	};
 	struct _MemberStatus
 	{
-		_MemberStatus() : lastRequestTime(0),vMajor(-1),vMinor(-1),vRev(-1),vProto(-1) {}
+		_MemberStatus() : lastRequestTime(0),vMajor(-1),vMinor(-1),vRev(-1),vProto(-1),configHash(0) {}
 		uint64_t lastRequestTime;
 		int vMajor,vMinor,vRev,vProto;
 		Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> lastRequestMetaData;
 		Identity identity;
+		uint64_t configHash; // hash of the last full config sent, the base for the next delta (0 if none)
+		std::vector<NetworkConfig::DictionaryEntryHash> configEntries;
 		inline bool online(const int64_t now) const { return ((now - lastRequestTime) < (ZT_NETWORK_AUTOCONF_DELAY * 2)); }
 	};
 	struct _MemberStatusHash
@@ -133,6 +191,10 @@ private:
 		}
 	};
 
+	void _schedulePushes(uint64_t nwid,const std::vector<uint64_t> &memberIds);
+	void _releasePushes(const std::vector<_MemberStatusKey> &due);
+	void _cancelPush(uint64_t nwid,uint64_t memberId);
+
 	const int64_t _startTime;
 	int _listenPort;
 	Node *const _node;
@@ -143,7 +205,6 @@ private:
 	NetworkController::Sender *_sender;
 
 	DBMirrorSet _db;
-	BlockingQueue< _RQEntry * > _queue;
 
 	std::vector<std::thread> _threads;
 	std::mutex _threads_l;
@@ -151,6 +212,65 @@ private:
 	std::unordered_map< _MemberStatusKey,_MemberStatus,_MemberStatusHash > _memberStatus;
 	std::mutex _memberStatus_l;
 
+	// Bounded per-class request queues consumed by the worker threads, with
+	// queued requests indexed by member so repeated requests can be merged.
+	std::deque< _RQEntry * > _rq[ZT_CONTROLLER_RQ_CLASS_COUNT];
+	unsigned long _rqCapacity[ZT_CONTROLLER_RQ_CLASS_COUNT];
+	_RQStats _rqStats[ZT_CONTROLLER_RQ_CLASS_COUNT];
+	std::unordered_map< _MemberStatusKey,_RQEntry *,_MemberStatusHash > _rqPending;
+	std::deque< _RQEntry * > _rqRevocations; // served before any request class
+	uint64_t _rqRevocationsQueued;
+	uint64_t _rqDeduplicated;
+	unsigned long _rqTurn;
+	bool _rqRunning;
+	std::mutex _rq_l;
+	std::condition_variable _rq_c;
+
+	std::unordered_map< uint64_t,std::shared_ptr<const _NetworkTemplate> > _networkTemplates;
+	std::unordered_map< uint64_t,std::string > _previousRulesEntries; // rulesEntry of invalidated templates
+	std::mutex _networkTemplates_l;
+
+	// Request handling statistics, reported by the controller status endpoint
+	uint64_t _templateHits;
+	uint64_t _templateMisses;
+	uint64_t _fullConfigsSent;       // configs sent whole to members that accept deltas
+	uint64_t _fullConfigBytes;
+	uint64_t _deltaConfigsSent;      // ... and sent as a delta against the member's last config
+	uint64_t _deltaConfigBytes;
+	uint64_t _requestsHandled;
+	uint64_t _requestMicros;
+	uint64_t _requestMaxMicros;
+	uint64_t _memberSaves;           // member saves requested by config requests
+	uint64_t _memberWrites;          // ... written immediately (material change)
+	uint64_t _memberWritesSkipped;   // ... dropped as unchanged
+	uint64_t _memberWritesDeferred;  // ... buffered as volatile-only changes
+	uint64_t _memberWritesCoalesced; // ... merged into an already buffered change
+	uint64_t _memberWritesFlushed;   // buffered changes later written to the DB
+	std::mutex _stats_l;
+
+	// Volatile member fields (see DB::memberChangeType()) waiting to be
+	// written, flushed every _volatileWriteInterval ms.
+	std::unordered_map< _MemberStatusKey,nlohmann::json,_MemberStatusHash > _volatileWrites;
+	std::mutex _volatileWrites_l;
+	int64_t _volatileWriteInterval;
+	std::thread _volatileWriteThread;
+	std::atomic_bool _running;
+
+	// Config pushes to online members after a network edit, due times spread
+	// over _pushWindow ms and released into the request queue by _pushThread.
+	std::multimap< int64_t,_MemberStatusKey > _pushSchedule;
+	std::unordered_map< _MemberStatusKey,std::multimap< int64_t,_MemberStatusKey >::iterator,_MemberStatusHash > _pushPending;
+	int64_t _pushWindow;
+	uint64_t _pushesScheduled;
+	uint64_t _pushesMerged;     // ... already pending for the member
+	uint64_t _pushesSuperseded; // ... canceled because the member got a config some other way
+	uint64_t _pushesReleased;
+	double _pushRate;           // pushes released per second, measured over the last second
+	bool _pushRunning;
+	std::mutex _push_l;
+	std::condition_variable _push_c;
+	std::thread _pushThread;
+
 	MQConfig *_mqc;
 };
 
@@ -13,51 +13,81 @@
 
 #include "FileDB.hpp"
 
+#include <algorithm>
+
 namespace ZeroTier
 {
 
-FileDB::FileDB(const char *path) :
+FileDB::FileDB(const char *path,const bool snapshot) :
 	DB(),
 	_path(path),
 	_networksPath(_path + ZT_PATH_SEPARATOR_S + "network"),
 	_tracePath(_path + ZT_PATH_SEPARATOR_S + "trace"),
-	_running(true)
+	_onlinePath(_path + ZT_PATH_SEPARATOR_S + "online.json"),
+	_snapshotPath(_path + ZT_PATH_SEPARATOR_S + "snapshot.bin"),
+	_onlineDirty(false),
+	_lastOnlineExpire(0),
+	_running(true),
+	_snapshot(snapshot)
 {
 	OSUtils::mkdir(_path.c_str());
 	OSUtils::lockDownFile(_path.c_str(),true);
 	OSUtils::mkdir(_networksPath.c_str());
 	OSUtils::mkdir(_tracePath.c_str());
 
-	std::vector<std::string> networks(OSUtils::listDirectory(_networksPath.c_str(),false));
 	std::string buf;
-	for(auto n=networks.begin();n!=networks.end();++n) {
-		buf.clear();
-		if ((n->length() == 21)&&(OSUtils::readFile((_networksPath + ZT_PATH_SEPARATOR_S + *n).c_str(),buf))) {
-			try {
-				nlohmann::json network(OSUtils::jsonParse(buf));
-				const std::string nwids = network["id"];
-				if (nwids.length() == 16) {
-					nlohmann::json nullJson;
-					_networkChanged(nullJson,network,false);
-					std::string membersPath(_networksPath + ZT_PATH_SEPARATOR_S + nwids + ZT_PATH_SEPARATOR_S "member");
-					std::vector<std::string> members(OSUtils::listDirectory(membersPath.c_str(),false));
-					for(auto m=members.begin();m!=members.end();++m) {
-						buf.clear();
-						if ((m->length() == 15)&&(OSUtils::readFile((membersPath + ZT_PATH_SEPARATOR_S + *m).c_str(),buf))) {
-							try {
-								nlohmann::json member(OSUtils::jsonParse(buf));
-								const std::string addrs = member["id"];
-								if (addrs.length() == 10) {
-									nlohmann::json nullJson2;
-									_memberChanged(nullJson2,member,false);
-								}
-							} catch ( ... ) {}
+	if (OSUtils::readFile(_snapshotPath.c_str(),buf)) {
+		// A snapshot is only current until something changes, so it's used at most once and
+		// only if no record file was added, removed, or modified since it was written
+		OSUtils::rm(_snapshotPath.c_str());
+		std::string fingerprint;
+		if (_snapshot)
+			_fingerprint(fingerprint);
+		if ((!_snapshot)||(!_readSnapshot(buf,fingerprint)))
+			_load();
+	} else {
+		_load();
+	}
+
+	// Online status is one compact file: { "<nwid>": { "<member id>": [ <last seen>, "<address>" ], ... }, ... }
+	buf.clear();
+	if (OSUtils::readFile(_onlinePath.c_str(),buf)) {
+		try {
+			nlohmann::json online(OSUtils::jsonParse(buf));
+			for(auto n=online.begin();n!=online.end();++n) {
+				const uint64_t nwid = Utils::hexStrToU64(n.key().c_str());
+				if ((nwid)&&(n.value().is_object())) {
+					_OnlineNetwork &onw = _online[nwid];
+					for(auto m=n.value().begin();m!=n.value().end();++m) {
+						const uint64_t id = Utils::hexStrToU64(m.key().c_str());
+						if ((id)&&(m.value().is_array())&&(m.value().size() == 2)) {
+							_OnlineStatus &st = onw.members[id];
+							st.lastSeen = OSUtils::jsonInt(m.value()[0],0LL);
+							st.physicalAddress.fromString(OSUtils::jsonString(m.value()[1],"").c_str());
 						}
 					}
 				}
-			} catch ( ... ) {}
-		}
+			}
+		} catch ( ... ) {}
 	}
+
+	_onlineUpdateThread = std::thread([this]() {
+		int64_t lastFlush = OSUtils::now();
+		for(;;) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			{
+				std::lock_guard<std::mutex> l(_online_l);
+				if (!_running)
+					break;
+			}
+			const int64_t now = OSUtils::now();
+			if ((now - lastFlush) >= ZT_FILEDB_ONLINE_FLUSH_PERIOD) {
+				lastFlush = now;
+				_flushOnline();
+			}
+		}
+		_flushOnline();
+	});
 }
 
 FileDB::~FileDB()
@@ -68,6 +98,13 @@ FileDB::~FileDB()
 		_online_l.unlock();
 		_onlineUpdateThread.join();
 	} catch ( ... ) {}
+	if (_snapshot) {
+		std::string s,fingerprint;
+		_fingerprint(fingerprint);
+		_writeSnapshot(s,fingerprint);
+		if (!OSUtils::writeFile(_snapshotPath.c_str(),s))
+			fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,_snapshotPath.c_str());
+	}
 }
 
 bool FileDB::waitForReady() { return true; }
@@ -123,6 +160,26 @@ bool FileDB::save(nlohmann::json &record,bool notifyListeners)
 	return modified;
 }
 
+unsigned long FileDB::saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners)
+{
+	char p1[4096],pb[4096];
+	std::vector<unsigned long> changed;
+	_membersChanged(networkId,records,changed,notifyListeners);
+	if (!changed.empty()) {
+		OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.16llx",_networksPath.c_str(),(unsigned long long)networkId);
+		OSUtils::mkdir(p1);
+		OSUtils::ztsnprintf(pb,sizeof(pb),"%s" ZT_PATH_SEPARATOR_S "member",p1);
+		OSUtils::mkdir(pb);
+		for(auto c=changed.begin();c!=changed.end();++c) {
+			nlohmann::json &record = records[*c];
+			OSUtils::ztsnprintf(p1,sizeof(p1),"%s" ZT_PATH_SEPARATOR_S "%.10llx.json",pb,(unsigned long long)OSUtils::jsonIntHex(record["id"],0ULL));
+			if (!OSUtils::writeFile(p1,OSUtils::jsonDump(record,-1)))
+				fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,p1);
+		}
+	}
+	return (unsigned long)changed.size();
+}
+
 void FileDB::eraseNetwork(const uint64_t networkId)
 {
 	nlohmann::json network,nullJson;
@@ -134,7 +191,8 @@ void FileDB::eraseNetwork(const uint64_t networkId)
 	OSUtils::rmDashRf(p);
 	_networkChanged(network,nullJson,true);
 	std::lock_guard<std::mutex> l(this->_online_l);
-	this->_online.erase(networkId);
+	if (this->_online.erase(networkId))
+		this->_onlineDirty = true;
 }
 
 void FileDB::eraseMember(const uint64_t networkId,const uint64_t memberId)
@@ -147,16 +205,179 @@ void FileDB::eraseMember(const uint64_t networkId,const uint64_t memberId)
 	OSUtils::rm(p);
 	_memberChanged(member,nullJson,true);
 	std::lock_guard<std::mutex> l(this->_online_l);
-	this->_online[networkId].erase(memberId);
+	auto onw = this->_online.find(networkId);
+	if ((onw != this->_online.end())&&(onw->second.members.erase(memberId))) {
+		onw->second.dirty = true;
+		this->_onlineDirty = true;
+	}
 }
 
-void FileDB::nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress)
+void FileDB::_fingerprint(std::string &fp)
 {
-	char mid[32],atmp[64];
-	OSUtils::ztsnprintf(mid,sizeof(mid),"%.10llx",(unsigned long long)memberId);
-	physicalAddress.toString(atmp);
-	std::lock_guard<std::mutex> l(this->_online_l);
-	this->_online[networkId][memberId][OSUtils::now()] = physicalAddress;
+	// Newest modification time of the network files, then file count and newest
+	// modification time of each network's member directory. Adding, removing, or
+	// editing a record file while the controller is down changes this.
+	std::vector<std::string> networks(OSUtils::listDirectory(_networksPath.c_str(),false));
+	std::sort(networks.begin(),networks.end());
+	char tmp[128];
+	uint64_t newest = 0;
+	for(auto n=networks.begin();n!=networks.end();++n)
+		newest = std::max(newest,OSUtils::getLastModified((_networksPath + ZT_PATH_SEPARATOR_S + *n).c_str()));
+	OSUtils::ztsnprintf(tmp,sizeof(tmp),"%lu,%llx;",(unsigned long)networks.size(),(unsigned long long)newest);
+	fp = tmp;
+	for(auto n=networks.begin();n!=networks.end();++n) {
+		if (n->length() != 21)
+			continue;
+		const std::string membersPath(_networksPath + ZT_PATH_SEPARATOR_S + n->substr(0,16) + ZT_PATH_SEPARATOR_S "member");
+		const std::vector<std::string> members(OSUtils::listDirectory(membersPath.c_str(),false));
+		newest = 0;
+		for(auto m=members.begin();m!=members.end();++m)
+			newest = std::max(newest,OSUtils::getLastModified((membersPath + ZT_PATH_SEPARATOR_S + *m).c_str()));
+		OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s:%lu,%llx;",n->substr(0,16).c_str(),(unsigned long)members.size(),(unsigned long long)newest);
+		fp.append(tmp);
+	}
+}
+
+void FileDB::_load()
+{
+	// Networks are read here, while member files (usually the vast majority) are listed
+	// and then read, parsed, and converted by a pool of threads.
+	std::vector< std::pair< uint64_t,std::vector<_LoadedMember> > > loaded;
+	std::vector< std::pair< std::string,std::pair<unsigned long,unsigned long> > > files; // path, (index in loaded, index in member vector)
+	std::vector<std::string> networks(OSUtils::listDirectory(_networksPath.c_str(),false));
+	std::string buf;
+	for(auto n=networks.begin();n!=networks.end();++n) {
+		buf.clear();
+		if ((n->length() == 21)&&(OSUtils::readFile((_networksPath + ZT_PATH_SEPARATOR_S + *n).c_str(),buf))) {
+			try {
+				nlohmann::json network(OSUtils::jsonParse(buf));
+				const std::string nwids = network["id"];
+				if (nwids.length() == 16) {
+					nlohmann::json nullJson;
+					_networkChanged(nullJson,network,false);
+					std::string membersPath(_networksPath + ZT_PATH_SEPARATOR_S + nwids + ZT_PATH_SEPARATOR_S "member");
+					std::vector<std::string> members(OSUtils::listDirectory(membersPath.c_str(),false));
+					loaded.push_back(std::pair< uint64_t,std::vector<_LoadedMember> >(Utils::hexStrToU64(nwids.c_str()),std::vector<_LoadedMember>()));
+					unsigned long count = 0;
+					for(auto m=members.begin();m!=members.end();++m) {
+						if (m->length() == 15)
+							files.push_back(std::pair< std::string,std::pair<unsigned long,unsigned long> >(membersPath + ZT_PATH_SEPARATOR_S + *m,std::pair<unsigned long,unsigned long>((unsigned long)loaded.size() - 1,count++)));
+					}
+					loaded.back().second.resize(count);
+				}
+			} catch ( ... ) {}
+		}
+	}
+
+	unsigned long threadCount = std::min((unsigned long)std::max(std::thread::hardware_concurrency(),1U),(unsigned long)ZT_FILEDB_LOAD_THREADS);
+	threadCount = std::min(threadCount,((unsigned long)files.size() / ZT_FILEDB_LOAD_CHUNK) + 1);
+	std::atomic<unsigned long> next(0);
+	std::vector<std::thread> threads;
+	for(unsigned long t=0;t<threadCount;++t) {
+		threads.push_back(std::thread([this,&loaded,&files,&next]() {
+			std::string buf;
+			for(;;) {
+				const unsigned long start = next.fetch_add(ZT_FILEDB_LOAD_CHUNK);
+				if (start >= (unsigned long)files.size())
+					break;
+				const unsigned long end = std::min(start + ZT_FILEDB_LOAD_CHUNK,(unsigned long)files.size());
+				for(unsigned long i=start;i<end;++i) {
+					buf.clear();
+					if (OSUtils::readFile(files[i].first.c_str(),buf)) {
+						std::pair< uint64_t,std::vector<_LoadedMember> > &nw = loaded[files[i].second.first];
+						if (_prepareLoadedMember(nw.first,buf,nw.second[files[i].second.second]))
+							continue;
+						try {
+							nlohmann::json member(OSUtils::jsonParse(buf));
+							const std::string addrs = member["id"];
+							if (addrs.length() == 10)
+								_prepareLoadedMember(nw.first,member,nw.second[files[i].second.second]);
+						} catch ( ... ) {}
+					}
+				}
+			}
+		}));
+	}
+	for(auto t=threads.begin();t!=threads.end();++t)
+		t->join();
+
+	for(auto nw=loaded.begin();nw!=loaded.end();++nw)
+		_membersLoaded(nw->first,nw->second);
+}
+
+void FileDB::_flushOnline()
+{
+	_OnlineMap pending;
+	_takeOnline(pending);
+
+	// Only networks with changed status are serialized again, and the file is
+	// written beside online.json and renamed over it so it's never left partial.
+	std::string out;
+	{
+		std::lock_guard<std::mutex> l(_online_l);
+		for(auto p=pending.begin();p!=pending.end();++p) {
+			if (hasNetwork(p->first.first)) { // skip members trying to join networks that don't exist
+				_OnlineNetwork &onw = _online[p->first.first];
+				_OnlineStatus &st = onw.members[p->first.second];
+				st.lastSeen = p->second.lastSeen;
+				if (p->second.physicalAddress)
+					st.physicalAddress = p->second.physicalAddress;
+				onw.dirty = true;
+				_onlineDirty = true;
+			}
+		}
+
+		const int64_t now = OSUtils::now();
+		if ((now - _lastOnlineExpire) >= ZT_FILEDB_ONLINE_EXPIRE_PERIOD) {
+			_lastOnlineExpire = now;
+			for(auto onw=_online.begin();onw!=_online.end();++onw) {
+				for(auto m=onw->second.members.begin();m!=onw->second.members.end();) {
+					if ((now - m->second.lastSeen) >= ZT_FILEDB_ONLINE_EXPIRE) {
+						onw->second.members.erase(m++);
+						onw->second.dirty = true;
+						_onlineDirty = true;
+					} else ++m;
+				}
+			}
+		}
+
+		if (!_onlineDirty)
+			return;
+		_onlineDirty = false;
+
+		char ids[16],atmp[64];
+		out.push_back('{');
+		for(auto onw=_online.begin();onw!=_online.end();) {
+			if (onw->second.members.empty()) {
+				_online.erase(onw++);
+				continue;
+			}
+			if (onw->second.dirty) {
+				nlohmann::json members = nlohmann::json::object();
+				for(auto m=onw->second.members.begin();m!=onw->second.members.end();++m) {
+					OSUtils::ztsnprintf(ids,sizeof(ids),"%.10llx",(unsigned long long)m->first);
+					nlohmann::json &st = members[ids];
+					st.push_back(m->second.lastSeen);
+					if (m->second.physicalAddress)
+						st.push_back(m->second.physicalAddress.toString(atmp));
+					else st.push_back("");
+				}
+				OSUtils::ztsnprintf(atmp,sizeof(atmp),"\"%.16llx\":",(unsigned long long)onw->first);
+				onw->second.json = atmp;
+				onw->second.json.append(OSUtils::jsonDump(members,-1));
+				onw->second.dirty = false;
+			}
+			if (out.length() > 1)
+				out.push_back(',');
+			out.append(onw->second.json);
+			++onw;
+		}
+		out.push_back('}');
+	}
+
+	const std::string tmpPath(_onlinePath + ".tmp");
+	if ((!OSUtils::writeFile(tmpPath.c_str(),out))||(!OSUtils::rename(tmpPath.c_str(),_onlinePath.c_str())))
+		fprintf(stderr,"WARNING: controller unable to write to path: %s" ZT_EOL_S,_onlinePath.c_str());
 }
 
 } // namespace ZeroTier
@@ -16,30 +16,65 @@
 
 #include "DB.hpp"
 
+// How often member online status is written to disk (ms)
+#define ZT_FILEDB_ONLINE_FLUSH_PERIOD 10000
+
+// Member online status not updated for this long is forgotten (ms)
+#define ZT_FILEDB_ONLINE_EXPIRE 2592000000LL
+
+// How often expired member online status is looked for (ms)
+#define ZT_FILEDB_ONLINE_EXPIRE_PERIOD 3600000
+
+// Maximum threads used to read member files at startup
+#define ZT_FILEDB_LOAD_THREADS 16
+
+// Member files each load thread takes at a time
+#define ZT_FILEDB_LOAD_CHUNK 256
+
 namespace ZeroTier
 {
 
 class FileDB : public DB
 {
 public:
-	FileDB(const char *path);
+	/**
+	 * @param path Base path for controller data
+	 * @param snapshot If true, write a binary snapshot on shutdown and start from it if present
+	 */
+	FileDB(const char *path,const bool snapshot = false);
 	virtual ~FileDB();
 
 	virtual bool waitForReady();
 	virtual bool isReady();
 	virtual bool save(nlohmann::json &record,bool notifyListeners);
+	virtual unsigned long saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners);
 	virtual void eraseNetwork(const uint64_t networkId);
 	virtual void eraseMember(const uint64_t networkId,const uint64_t memberId);
-	virtual void nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress);
 
 protected:
+	void _fingerprint(std::string &fp);
+	void _load();
+	void _flushOnline();
+
 	std::string _path;
 	std::string _networksPath;
 	std::string _tracePath;
+	std::string _onlinePath;
+	std::string _snapshotPath;
 	std::thread _onlineUpdateThread;
-	std::map< uint64_t,std::map<uint64_t,std::map<int64_t,InetAddress> > > _online;
+	struct _OnlineNetwork
+	{
+		_OnlineNetwork() : members(),json(),dirty(true) {}
+		std::unordered_map<uint64_t,_OnlineStatus> members;
+		std::string json; // this network's entry in _onlinePath, rebuilt only when dirty
+		bool dirty;
+	};
+	std::unordered_map<uint64_t,_OnlineNetwork> _online; // all known online status by network, written to _onlinePath
+	bool _onlineDirty;
+	int64_t _lastOnlineExpire;
 	std::mutex _online_l;
 	bool _running;
+	bool _snapshot;
 };
 
 } // namespace ZeroTier
@@ -35,144 +35,42 @@ LFDB::LFDB(const Identity &myId,const char *path,const char *lfOwnerPrivate,cons
 	_ready(false),
 	_storeOnlineState(storeOnlineState)
 {
+	char controllerAddress[24];
+	_myId.address().toString(controllerAddress);
+	_networksSelectorName = "com.zerotier.controller.lfdb:"; _networksSelectorName.append(controllerAddress); _networksSelectorName.append("/network");
+	_onlineSelectorPrefix = "com.zerotier.controller.lfdb:"; _onlineSelectorPrefix.append(controllerAddress); _onlineSelectorPrefix.append("/network/");
+
+	// LF record masking key is the first 32 bytes of SHA512(controller private key) in hex,
+	// hiding record values from anything but the controller or someone who has its key.
+	uint8_t sha512pk[64];
+	_myId.sha512PrivateKey(sha512pk);
+	char maskingKey[128];
+	Utils::hex(sha512pk,32,maskingKey);
+	_maskingKey = maskingKey;
+
+	// Records are submitted by a pool of writers so that a slow LF node doesn't hold
+	// up the sync loop, and several submissions are in flight at once.
+	for(int t=0;t<ZT_LFDB_WRITE_THREADS;++t) {
+		_writeThreads[t] = std::thread([this]() {
+			httplib::Client htcli(_lfNodeHost.c_str(),_lfNodePort,600);
+			_Write w;
+			while ((_writeQueue.get(w))&&(w.type != _Write::STOP))
+				_writeDone(w,_write(htcli,w));
+		});
+	}
+
 	_syncThread = std::thread([this]() {
-		char controllerAddress[24];
 		const uint64_t controllerAddressInt = _myId.address().toInt();
-		_myId.address().toString(controllerAddress);
-		std::string networksSelectorName("com.zerotier.controller.lfdb:"); networksSelectorName.append(controllerAddress); networksSelectorName.append("/network");
-
-		// LF record masking key is the first 32 bytes of SHA512(controller private key) in hex,
-		// hiding record values from anything but the controller or someone who has its key.
-		uint8_t sha512pk[64];
-		_myId.sha512PrivateKey(sha512pk);
-		char maskingKey [128];
-		Utils::hex(sha512pk,32,maskingKey);
+		const std::string &networksSelectorName = _networksSelectorName;
+		const char *const maskingKey = _maskingKey.c_str();
 
 		httplib::Client htcli(_lfNodeHost.c_str(),_lfNodePort,600);
 		int64_t timeRangeStart = 0;
+		DB::_OnlineMap online;
 		while (_running.load()) {
-			{
-				std::lock_guard<std::mutex> sl(_state_l);
-				for(auto ns=_state.begin();ns!=_state.end();++ns) {
-					if (ns->second.dirty) {
-						nlohmann::json network;
-						if (get(ns->first,network)) {
-							nlohmann::json newrec,selector0;
-							selector0["Name"] = networksSelectorName;
-							selector0["Ordinal"] = ns->first;
-							newrec["Selectors"].push_back(selector0);
-							newrec["Value"] = network.dump();
-							newrec["OwnerPrivate"] = _lfOwnerPrivate;
-							newrec["MaskingKey"] = maskingKey;
-							newrec["PulseIfUnchanged"] = true;
-							try {
-								auto resp = htcli.Post("/makerecord",newrec.dump(),"application/json");
-								if (resp) {
-									if (resp->status == 200) {
-										ns->second.dirty = false;
-										//printf("SET network %.16llx %s\n",ns->first,resp->body.c_str());
-									} else {
-										fprintf(stderr,"ERROR: LFDB: %d from node (create/update network): %s" ZT_EOL_S,resp->status,resp->body.c_str());
-									}
-								} else {
-									fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
-								}
-							} catch (std::exception &e) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update network): %s" ZT_EOL_S,e.what());
-							} catch ( ... ) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update network): unknown exception" ZT_EOL_S);
-							}
-						}
-					}
+			_takeOnline(online);
 
-					for(auto ms=ns->second.members.begin();ms!=ns->second.members.end();++ms) {
-						if ((_storeOnlineState)&&(ms->second.lastOnlineDirty)&&(ms->second.lastOnlineAddress)) {
-							nlohmann::json newrec,selector0,selector1,selectors,ip;
-							char tmp[1024],tmp2[128];
-							OSUtils::ztsnprintf(tmp,sizeof(tmp),"com.zerotier.controller.lfdb:%s/network/%.16llx/online",controllerAddress,(unsigned long long)ns->first);
-							ms->second.lastOnlineAddress.toIpString(tmp2);
-							selector0["Name"] = tmp;
-							selector0["Ordinal"] = ms->first;
-							selector1["Name"] = tmp2;
-							selector1["Ordinal"] = 0;
-							selectors.push_back(selector0);
-							selectors.push_back(selector1);
-							newrec["Selectors"] = selectors;
-							const uint8_t *const rawip = (const uint8_t *)ms->second.lastOnlineAddress.rawIpData();
-							switch(ms->second.lastOnlineAddress.ss_family) {
-								case AF_INET:
-									for(int j=0;j<4;++j)
-										ip.push_back((unsigned int)rawip[j]);
-									break;
-								case AF_INET6:
-									for(int j=0;j<16;++j)
-										ip.push_back((unsigned int)rawip[j]);
-									break;
-								default:
-									ip = tmp2; // should never happen since only IP transport is currently supported
-									break;
-							}
-							newrec["Value"] = ip;
-							newrec["OwnerPrivate"] = _lfOwnerPrivate;
-							newrec["MaskingKey"] = maskingKey;
-							newrec["Timestamp"] = ms->second.lastOnlineTime;
-							newrec["PulseIfUnchanged"] = true;
-							try {
-								auto resp = htcli.Post("/makerecord",newrec.dump(),"application/json");
-								if (resp) {
-									if (resp->status == 200) {
-										ms->second.lastOnlineDirty = false;
-										//printf("SET member online %.16llx %.10llx %s\n",ns->first,ms->first,resp->body.c_str());
-									} else {
-										fprintf(stderr,"ERROR: LFDB: %d from node (create/update member online status): %s" ZT_EOL_S,resp->status,resp->body.c_str());
-									}
-								} else {
-									fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
-								}
-							} catch (std::exception &e) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member online status): %s" ZT_EOL_S,e.what());
-							} catch ( ... ) {
-								fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member online status): unknown exception" ZT_EOL_S);
-							}
-						}
-
-						if (ms->second.dirty) {
-							nlohmann::json network,member;
-							if (get(ns->first,network,ms->first,member)) {
-								nlohmann::json newrec,selector0,selector1,selectors;
-								selector0["Name"] = networksSelectorName;
-								selector0["Ordinal"] = ns->first;
-								selector1["Name"] = "member";
-								selector1["Ordinal"] = ms->first;
-								selectors.push_back(selector0);
-								selectors.push_back(selector1);
-								newrec["Selectors"] = selectors;
-								newrec["Value"] = member.dump();
-								newrec["OwnerPrivate"] = _lfOwnerPrivate;
-								newrec["MaskingKey"] = maskingKey;
-								newrec["PulseIfUnchanged"] = true;
-								try {
-									auto resp = htcli.Post("/makerecord",newrec.dump(),"application/json");
-									if (resp) {
-										if (resp->status == 200) {
-											ms->second.dirty = false;
-											//printf("SET member %.16llx %.10llx %s\n",ns->first,ms->first,resp->body.c_str());
-										} else {
-											fprintf(stderr,"ERROR: LFDB: %d from node (create/update member): %s" ZT_EOL_S,resp->status,resp->body.c_str());
-										}
-									} else {
-										fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
-									}
-								} catch (std::exception &e) {
-									fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member): %s" ZT_EOL_S,e.what());
-								} catch ( ... ) {
-									fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (create/update member): unknown exception" ZT_EOL_S);
-								}
-							}
-						}
-					}
-				}
-			}
+			_queueWrites(online);
 
 			try {
 				std::ostringstream query;
@@ -324,6 +222,172 @@ LFDB::~LFDB()
 {
 	_running.store(false);
 	_syncThread.join();
+
+	// Queue anything changed since the last sync pass, then one stop record per
+	// writer behind it, so everything queued is sent before the writers exit.
+	DB::_OnlineMap online;
+	_takeOnline(online);
+	_queueWrites(online);
+	for(int t=0;t<ZT_LFDB_WRITE_THREADS;++t)
+		_writeQueue.post(_Write(_Write::STOP,0,0));
+	for(int t=0;t<ZT_LFDB_WRITE_THREADS;++t)
+		_writeThreads[t].join();
+}
+
+void LFDB::_queueWrites(const DB::_OnlineMap &online)
+{
+	// Take what needs writing and release the state lock right away, so saves
+	// never wait on LF. A record is only ever in one write at a time.
+	std::vector<_Write> writes;
+	{
+		std::lock_guard<std::mutex> sl(_state_l);
+		if (_storeOnlineState) {
+			for(auto o=online.begin();o!=online.end();++o) {
+				auto nw = _state.find(o->first.first);
+				if (nw != _state.end()) {
+					auto m = nw->second.members.find(o->first.second);
+					if (m != nw->second.members.end()) {
+						m->second.lastOnlineTime = o->second.lastSeen;
+						if (o->second.physicalAddress)
+							m->second.lastOnlineAddress = o->second.physicalAddress;
+						m->second.lastOnlineDirty = true;
+					}
+				}
+			}
+		}
+
+		for(auto ns=_state.begin();ns!=_state.end();++ns) {
+			if ((ns->second.dirty)&&(!ns->second.writing)) {
+				ns->second.dirty = false;
+				ns->second.writing = true;
+				writes.push_back(_Write(_Write::NETWORK,ns->first,0));
+			}
+			for(auto ms=ns->second.members.begin();ms!=ns->second.members.end();++ms) {
+				if ((_storeOnlineState)&&(ms->second.lastOnlineDirty)&&(!ms->second.lastOnlineWriting)&&(ms->second.lastOnlineAddress)) {
+					ms->second.lastOnlineDirty = false;
+					ms->second.lastOnlineWriting = true;
+					writes.push_back(_Write(_Write::ONLINE,ns->first,ms->first));
+					writes.back().lastOnlineTime = ms->second.lastOnlineTime;
+					writes.back().lastOnlineAddress = ms->second.lastOnlineAddress;
+				}
+				if ((ms->second.dirty)&&(!ms->second.writing)) {
+					ms->second.dirty = false;
+					ms->second.writing = true;
+					writes.push_back(_Write(_Write::MEMBER,ns->first,ms->first));
+				}
+			}
+		}
+	}
+	for(auto w=writes.begin();w!=writes.end();++w)
+		_writeQueue.post(*w);
+}
+
+bool LFDB::_write(httplib::Client &htcli,const _Write &w)
+{
+	nlohmann::json newrec,selector0,selectors;
+	const char *what;
+	switch(w.type) {
+		case _Write::NETWORK: {
+			nlohmann::json network;
+			if (!get(w.networkId,network))
+				return true; // deleted since it was changed, nothing to write
+			selector0["Name"] = _networksSelectorName;
+			selector0["Ordinal"] = w.networkId;
+			selectors.push_back(selector0);
+			newrec["Value"] = network.dump();
+			what = "create/update network";
+		}	break;
+
+		case _Write::MEMBER: {
+			nlohmann::json network,member,selector1;
+			if (!get(w.networkId,network,w.memberId,member))
+				return true;
+			selector0["Name"] = _networksSelectorName;
+			selector0["Ordinal"] = w.networkId;
+			selector1["Name"] = "member";
+			selector1["Ordinal"] = w.memberId;
+			selectors.push_back(selector0);
+			selectors.push_back(selector1);
+			newrec["Value"] = member.dump();
+			what = "create/update member";
+		}	break;
+
+		default: {
+			nlohmann::json selector1,ip;
+			char tmp[1024],tmp2[128];
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s%.16llx/online",_onlineSelectorPrefix.c_str(),(unsigned long long)w.networkId);
+			w.lastOnlineAddress.toIpString(tmp2);
+			selector0["Name"] = tmp;
+			selector0["Ordinal"] = w.memberId;
+			selector1["Name"] = tmp2;
+			selector1["Ordinal"] = 0;
+			selectors.push_back(selector0);
+			selectors.push_back(selector1);
+			const uint8_t *const rawip = (const uint8_t *)w.lastOnlineAddress.rawIpData();
+			switch(w.lastOnlineAddress.ss_family) {
+				case AF_INET:
+					for(int j=0;j<4;++j)
+						ip.push_back((unsigned int)rawip[j]);
+					break;
+				case AF_INET6:
+					for(int j=0;j<16;++j)
+						ip.push_back((unsigned int)rawip[j]);
+					break;
+				default:
+					ip = tmp2; // should never happen since only IP transport is currently supported
+					break;
+			}
+			newrec["Value"] = ip;
+			newrec["Timestamp"] = w.lastOnlineTime;
+			what = "create/update member online status";
+		}	break;
+	}
+	newrec["Selectors"] = selectors;
+	newrec["OwnerPrivate"] = _lfOwnerPrivate;
+	newrec["MaskingKey"] = _maskingKey;
+	newrec["PulseIfUnchanged"] = true;
+
+	try {
+		auto resp = htcli.Post("/makerecord",newrec.dump(),"application/json");
+		if (resp) {
+			if (resp->status == 200)
+				return true;
+			fprintf(stderr,"ERROR: LFDB: %d from node (%s): %s" ZT_EOL_S,resp->status,what,resp->body.c_str());
+		} else {
+			fprintf(stderr,"ERROR: LFDB: node is offline" ZT_EOL_S);
+		}
+	} catch (std::exception &e) {
+		fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (%s): %s" ZT_EOL_S,what,e.what());
+	} catch ( ... ) {
+		fprintf(stderr,"ERROR: LFDB: unexpected exception querying node (%s): unknown exception" ZT_EOL_S,what);
+	}
+	return false;
+}
+
+void LFDB::_writeDone(const _Write &w,const bool ok)
+{
+	std::lock_guard<std::mutex> l(_state_l);
+	auto ns = _state.find(w.networkId);
+	if (ns == _state.end())
+		return;
+	if (w.type == _Write::NETWORK) {
+		ns->second.writing = false;
+		if (!ok)
+			ns->second.dirty = true;
+	} else {
+		auto ms = ns->second.members.find(w.memberId);
+		if (ms == ns->second.members.end())
+			return;
+		if (w.type == _Write::MEMBER) {
+			ms->second.writing = false;
+			if (!ok)
+				ms->second.dirty = true;
+		} else {
+			ms->second.lastOnlineWriting = false;
+			if (!ok)
+				ms->second.lastOnlineDirty = true;
+		}
+	}
 }
 
 bool LFDB::waitForReady()
@@ -378,29 +442,27 @@ bool LFDB::save(nlohmann::json &record,bool notifyListeners)
 	return modified;
 }
 
-void LFDB::eraseNetwork(const uint64_t networkId)
+unsigned long LFDB::saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners)
 {
-	// TODO
+	std::vector<unsigned long> changed;
+	_membersChanged(networkId,records,changed,notifyListeners);
+	if (!changed.empty()) {
+		std::lock_guard<std::mutex> l(_state_l);
+		_NetworkState &ns = _state[networkId];
+		for(auto c=changed.begin();c!=changed.end();++c)
+			ns.members[OSUtils::jsonIntHex(records[*c]["id"],0ULL)].dirty = true;
+	}
+	return (unsigned long)changed.size();
 }
 
-void LFDB::eraseMember(const uint64_t networkId,const uint64_t memberId)
+void LFDB::eraseNetwork(const uint64_t networkId)
 {
 	// TODO
 }
 
-void LFDB::nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress)
+void LFDB::eraseMember(const uint64_t networkId,const uint64_t memberId)
 {
-	std::lock_guard<std::mutex> l(_state_l);
-	auto nw = _state.find(networkId);
-	if (nw != _state.end()) {
-		auto m = nw->second.members.find(memberId);
-		if (m != nw->second.members.end()) {
-			m->second.lastOnlineTime = OSUtils::now();
-			if (physicalAddress)
-				m->second.lastOnlineAddress = physicalAddress;
-			m->second.lastOnlineDirty = true;
-		}
-	}
+	// TODO
 }
 
 } // namespace ZeroTier
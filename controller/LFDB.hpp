@@ -20,6 +20,14 @@
 #include <string>
 #include <unordered_map>
 #include <atomic>
+#include <vector>
+
+// Concurrent record submissions to the LF node
+#define ZT_LFDB_WRITE_THREADS 8
+
+namespace httplib {
+class Client;
+}
 
 namespace ZeroTier {
 
@@ -44,9 +52,9 @@ public:
 	virtual bool waitForReady();
 	virtual bool isReady();
 	virtual bool save(nlohmann::json &record,bool notifyListeners);
+	virtual unsigned long saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners);
 	virtual void eraseNetwork(const uint64_t networkId);
 	virtual void eraseMember(const uint64_t networkId,const uint64_t memberId);
-	virtual void nodeIsOnline(const uint64_t networkId,const uint64_t memberId,const InetAddress &physicalAddress);
 
 protected:
 	const Identity _myId;
@@ -61,23 +69,53 @@ protected:
 			lastOnlineAddress(),
 			lastOnlineTime(0),
 			dirty(false),
-			lastOnlineDirty(false) {}
+			lastOnlineDirty(false),
+			writing(false),
+			lastOnlineWriting(false) {}
 		InetAddress lastOnlineAddress;
 		int64_t lastOnlineTime;
 		bool dirty;
 		bool lastOnlineDirty;
+		bool writing; // member record currently being submitted
+		bool lastOnlineWriting; // online record currently being submitted
 	};
 	struct _NetworkState
 	{
 		_NetworkState() :
 			members(),
-			dirty(false) {}
+			dirty(false),
+			writing(false) {}
 		std::unordered_map<uint64_t,_MemberState> members;
 		bool dirty;
+		bool writing;
 	};
 	std::unordered_map<uint64_t,_NetworkState> _state;
 	std::mutex _state_l;
 
+	// A record to submit, taken from _state by the sync thread. Network and member
+	// values are read at send time so the newest revision is what gets written.
+	struct _Write
+	{
+		enum Type { NETWORK,MEMBER,ONLINE,STOP }; // STOP ends a writer thread
+		_Write() : type(NETWORK),networkId(0),memberId(0),lastOnlineTime(0),lastOnlineAddress() {}
+		_Write(const Type t,const uint64_t nwid,const uint64_t mid) : type(t),networkId(nwid),memberId(mid),lastOnlineTime(0),lastOnlineAddress() {}
+		Type type;
+		uint64_t networkId;
+		uint64_t memberId;
+		int64_t lastOnlineTime;
+		InetAddress lastOnlineAddress;
+	};
+
+	void _queueWrites(const DB::_OnlineMap &online);
+	bool _write(httplib::Client &htcli,const _Write &w);
+	void _writeDone(const _Write &w,const bool ok);
+
+	std::string _networksSelectorName;
+	std::string _onlineSelectorPrefix;
+	std::string _maskingKey;
+	BlockingQueue<_Write> _writeQueue;
+	std::thread _writeThreads[ZT_LFDB_WRITE_THREADS];
+
 	std::atomic_bool _running;
 	std::atomic_bool _ready;
 	std::thread _syncThread;
@@ -31,6 +31,35 @@ namespace {
 
 static const int DB_MINIMUM_VERSION = 5;
 
+// Member upsert for a number of rows, 17 parameters per row
+static std::string _memberUpsertQuery(const unsigned int rows)
+{
+	std::string q(
+		"INSERT INTO ztc_member (id, network_id, active_bridge, authorized, capabilities, "
+		"identity, last_authorized_time, last_deauthorized_time, no_auto_assign_ips, "
+		"remote_trace_level, remote_trace_target, revision, tags, v_major, v_minor, v_rev, v_proto) VALUES ");
+	char tmp[512];
+	for(unsigned int r=0;r<rows;++r) {
+		const unsigned int b = r * 17;
+		snprintf(tmp,sizeof(tmp),
+			"%s($%u, $%u, $%u, $%u, $%u, $%u, "
+			"TO_TIMESTAMP($%u::double precision/1000), TO_TIMESTAMP($%u::double precision/1000), "
+			"$%u, $%u, $%u, $%u, $%u, $%u, $%u, $%u, $%u)",
+			(r > 0) ? ", " : "",
+			b + 1,b + 2,b + 3,b + 4,b + 5,b + 6,b + 7,b + 8,b + 9,b + 10,b + 11,b + 12,b + 13,b + 14,b + 15,b + 16,b + 17);
+		q.append(tmp);
+	}
+	q.append(
+		" ON CONFLICT (network_id, id) DO UPDATE SET "
+		"active_bridge = EXCLUDED.active_bridge, authorized = EXCLUDED.authorized, capabilities = EXCLUDED.capabilities, "
+		"identity = EXCLUDED.identity, last_authorized_time = EXCLUDED.last_authorized_time, "
+		"last_deauthorized_time = EXCLUDED.last_deauthorized_time, no_auto_assign_ips = EXCLUDED.no_auto_assign_ips, "
+		"remote_trace_level = EXCLUDED.remote_trace_level, remote_trace_target = EXCLUDED.remote_trace_target, "
+		"revision = EXCLUDED.revision+1, tags = EXCLUDED.tags, v_major = EXCLUDED.v_major, "
+		"v_minor = EXCLUDED.v_minor, v_rev = EXCLUDED.v_rev, v_proto = EXCLUDED.v_proto");
+	return q;
+}
+
 static const char *_timestr()
 {
 	time_t t = time(0);
@@ -222,16 +251,6 @@ void PostgreSQL::eraseMember(const uint64_t networkId, const uint64_t memberId)
 	_commitQueue.post(tmp);
 }
 
-void PostgreSQL::nodeIsOnline(const uint64_t networkId, const uint64_t memberId, const InetAddress &physicalAddress)
-{
-	std::lock_guard<std::mutex> l(_lastOnline_l);
-	std::pair<int64_t, InetAddress> &i = _lastOnline[std::pair<uint64_t,uint64_t>(networkId, memberId)];
-	i.first = OSUtils::now();
-	if (physicalAddress) {
-		i.second = physicalAddress;
-	}
-}
-
 void PostgreSQL::initializeNetworks(PGconn *conn)
 {
 	try {
@@ -848,340 +867,460 @@ void PostgreSQL::commitThread()
 		exit(1);
 	}
 
-	std::pair<nlohmann::json,bool> qitem;
-	while(_commitQueue.get(qitem)&(_run == 1)) {
-		if (!qitem.first.is_object()) {
-			continue;
+	// Named prepared statements don't survive PgBouncer's transaction pooling, so
+	// statements are only prepared on direct connections.
+	_CommitStatements st;
+	st.prepared = (getenv("PGBOUNCER_CONNSTR") == NULL);
+	st.upsertOne = _memberUpsertQuery(1);
+	st.upsertMany = _memberUpsertQuery(ZT_CENTRAL_CONTROLLER_COMMIT_INSERT_ROWS);
+	st.ipDelete =
+		"DELETE FROM ztc_member_ip_assignment a USING "
+		"(SELECT unnest($1::text[]) AS member_id, unnest($2::text[]) AS network_id) d "
+		"WHERE a.member_id = d.member_id AND a.network_id = d.network_id";
+	if (st.prepared) {
+		const char *const names[3] = { "ztc_member_upsert_1","ztc_member_upsert_n","ztc_member_ip_delete" };
+		const std::string *const queries[3] = { &st.upsertOne,&st.upsertMany,&st.ipDelete };
+		const int nParams[3] = { 17,17 * ZT_CENTRAL_CONTROLLER_COMMIT_INSERT_ROWS,2 };
+		for(int i=0;i<3;++i) {
+			PGresult *res = PQprepare(conn,names[i],queries[i]->c_str(),nParams[i],NULL);
+			if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+				fprintf(stderr, "ERROR: Error preparing statement %s: %s\n", names[i], PQresultErrorMessage(res));
+				PQclear(res);
+				PQfinish(conn);
+				exit(1);
+			}
+			PQclear(res);
 		}
+	}
+
+	std::vector< std::pair<nlohmann::json,bool> > batch;
+	std::vector< std::pair<nlohmann::json,bool> * > members;
+	while(_commitQueue.getBatch(batch,ZT_CENTRAL_CONTROLLER_COMMIT_BATCH_SIZE)&(_run == 1)) {
 		if (PQstatus(conn) == CONNECTION_BAD) {
 			fprintf(stderr, "ERROR: Connection to database failed: %s\n", PQerrorMessage(conn));
 			PQfinish(conn);
 			exit(1);
 		}
-		try {
-			nlohmann::json *config = &(qitem.first);
-			const std::string objtype = (*config)["objtype"];
-			if (objtype == "member") {
-				try {
-					std::string memberId = (*config)["id"];
-					std::string networkId = (*config)["nwid"];
-					std::string identity = (*config)["identity"];
-					std::string target = "NULL";
-
-					if (!(*config)["remoteTraceTarget"].is_null()) {
-						target = (*config)["remoteTraceTarget"];
-					}
-
-					std::string caps = OSUtils::jsonDump((*config)["capabilities"], -1);
-					std::string lastAuthTime = std::to_string((long long)(*config)["lastAuthorizedTime"]);
-					std::string lastDeauthTime = std::to_string((long long)(*config)["lastDeauthorizedTime"]);
-					std::string rtraceLevel = std::to_string((int)(*config)["remoteTraceLevel"]);
-					std::string rev = std::to_string((unsigned long long)(*config)["revision"]);
-					std::string tags = OSUtils::jsonDump((*config)["tags"], -1);
-					std::string vmajor = std::to_string((int)(*config)["vMajor"]);
-					std::string vminor = std::to_string((int)(*config)["vMinor"]);
-					std::string vrev = std::to_string((int)(*config)["vRev"]);
-					std::string vproto = std::to_string((int)(*config)["vProto"]);
-					const char *values[19] = {
-						memberId.c_str(),
-						networkId.c_str(),
-						((*config)["activeBridge"] ? "true" : "false"),
-						((*config)["authorized"] ? "true" : "false"),
-						caps.c_str(),
-						identity.c_str(),
-						lastAuthTime.c_str(),
-						lastDeauthTime.c_str(),
-						((*config)["noAutoAssignIps"] ? "true" : "false"),
-						rtraceLevel.c_str(),
-						(target == "NULL") ? NULL : target.c_str(),
-						rev.c_str(),
-						tags.c_str(),
-						vmajor.c_str(),
-						vminor.c_str(),
-						vrev.c_str(),
-						vproto.c_str()
-					};
 
-					PGresult *res = PQexecParams(conn,
-						"INSERT INTO ztc_member (id, network_id, active_bridge, authorized, capabilities, "
-						"identity, last_authorized_time, last_deauthorized_time, no_auto_assign_ips, "
-						"remote_trace_level, remote_trace_target, revision, tags, v_major, v_minor, v_rev, v_proto) "
-						"VALUES ($1, $2, $3, $4, $5, $6, "
-						"TO_TIMESTAMP($7::double precision/1000), TO_TIMESTAMP($8::double precision/1000), "
-						"$9, $10, $11, $12, $13, $14, $15, $16, $17) ON CONFLICT (network_id, id) DO UPDATE SET "
-						"active_bridge = EXCLUDED.active_bridge, authorized = EXCLUDED.authorized, capabilities = EXCLUDED.capabilities, "
-						"identity = EXCLUDED.identity, last_authorized_time = EXCLUDED.last_authorized_time, "
-						"last_deauthorized_time = EXCLUDED.last_deauthorized_time, no_auto_assign_ips = EXCLUDED.no_auto_assign_ips, "
-						"remote_trace_level = EXCLUDED.remote_trace_level, remote_trace_target = EXCLUDED.remote_trace_target, "
-						"revision = EXCLUDED.revision+1, tags = EXCLUDED.tags, v_major = EXCLUDED.v_major, "
-						"v_minor = EXCLUDED.v_minor, v_rev = EXCLUDED.v_rev, v_proto = EXCLUDED.v_proto",
-						17,
-						NULL,
-						values,
-						NULL,
-						NULL,
-						0);
+		coalesceCommits(batch);
 
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error updating member: %s\n", PQresultErrorMessage(res));
-						fprintf(stderr, "%s", OSUtils::jsonDump(*config, 2).c_str());
-						PQclear(res);
-						delete config;
-						config = nullptr;
-						continue;
-					}
+		// Runs of member records are committed together; other records are rare and
+		// are committed one at a time in queue order.
+		members.clear();
+		for(auto qitem=batch.begin();qitem!=batch.end();++qitem) {
+			if (!qitem->first.is_object())
+				continue;
+			try {
+				const std::string objtype = qitem->first["objtype"];
+				if (objtype == "member") {
+					members.push_back(&(*qitem));
+				} else {
+					_commitMembers(conn,st,members);
+					members.clear();
+					_commitRecord(conn,*qitem);
+				}
+			} catch (std::exception &e) {
+				fprintf(stderr, "ERROR: Error getting objtype: %s\n", e.what());
+			}
+		}
+		_commitMembers(conn,st,members);
 
-					PQclear(res);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
 
-					res = PQexec(conn, "BEGIN");
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error beginning transaction: %s\n", PQresultErrorMessage(res));
-						PQclear(res);
-						delete config;
-						config = nullptr;
-						continue;
-					}
+	PQfinish(conn);
+	if (_run == 1) {
+		fprintf(stderr, "ERROR: %s commitThread should still be running! Exiting Controller.\n", _myAddressStr.c_str());
+		exit(7);
+	}
+}
 
-					PQclear(res);
+void PostgreSQL::_commitMembers(PGconn *conn,const _CommitStatements &st,std::vector< std::pair<nlohmann::json,bool> * > &members)
+{
+	if (members.empty())
+		return;
+
+	// Parameters for each member row, 17 per row in the order of _memberUpsertQuery()
+	std::vector< std::pair<nlohmann::json,bool> * > rows;
+	std::vector<std::string> v;
+	std::vector<bool> vNull; // parameters sent as SQL NULL
+	std::string ipMemberIds("{"),ipNetworkIds("{"),ipCopy;
+	rows.reserve(members.size());
+	v.reserve(members.size() * 17);
+	vNull.reserve(members.size() * 17);
+	for(auto m=members.begin();m!=members.end();++m) {
+		nlohmann::json *config = &((*m)->first);
+		try {
+			std::string memberId = (*config)["id"];
+			std::string networkId = (*config)["nwid"];
+			std::string identity = (*config)["identity"];
+			const bool noTarget = (*config)["remoteTraceTarget"].is_null();
+			std::string target;
+			if (!noTarget)
+				target = (*config)["remoteTraceTarget"];
+			std::string row[17] = {
+				memberId,
+				networkId,
+				((bool)(*config)["activeBridge"] ? "true" : "false"),
+				((bool)(*config)["authorized"] ? "true" : "false"),
+				OSUtils::jsonDump((*config)["capabilities"], -1),
+				identity,
+				std::to_string((long long)(*config)["lastAuthorizedTime"]),
+				std::to_string((long long)(*config)["lastDeauthorizedTime"]),
+				((bool)(*config)["noAutoAssignIps"] ? "true" : "false"),
+				std::to_string((int)(*config)["remoteTraceLevel"]),
+				target,
+				std::to_string((unsigned long long)(*config)["revision"]),
+				OSUtils::jsonDump((*config)["tags"], -1),
+				std::to_string((int)(*config)["vMajor"]),
+				std::to_string((int)(*config)["vMinor"]),
+				std::to_string((int)(*config)["vRev"]),
+				std::to_string((int)(*config)["vProto"])
+			};
 
-					const char *v2[2] = {
-						memberId.c_str(),
-						networkId.c_str()
-					};
+			std::vector<std::string> assignments;
+			nlohmann::json &ipa = (*config)["ipAssignments"];
+			if (ipa.is_array()) {
+				for (auto i = ipa.begin(); i != ipa.end(); ++i) {
+					std::string addr = *i;
+					if ((addr.find_first_of("\t\n\\") != std::string::npos)||(std::find(assignments.begin(), assignments.end(), addr) != assignments.end()))
+						continue;
+					assignments.push_back(addr);
+				}
+			}
 
-					res = PQexecParams(conn,
-						"DELETE FROM ztc_member_ip_assignment WHERE member_id = $1 AND network_id = $2",
-						2,
-						NULL,
-						v2,
-						NULL,
-						NULL,
-						0);
+			for(int i=0;i<17;++i) {
+				v.push_back(row[i]);
+				vNull.push_back((i == 10)&&(noTarget)); // remote_trace_target
+			}
+			if (rows.size() > 0) {
+				ipMemberIds.push_back(',');
+				ipNetworkIds.push_back(',');
+			}
+			ipMemberIds.append(memberId);
+			ipNetworkIds.append(networkId);
+			for(auto a=assignments.begin();a!=assignments.end();++a) {
+				ipCopy.append(memberId);
+				ipCopy.push_back('\t');
+				ipCopy.append(networkId);
+				ipCopy.push_back('\t');
+				ipCopy.append(*a);
+				ipCopy.push_back('\n');
+			}
+			rows.push_back(*m);
+		} catch (std::exception &e) {
+			fprintf(stderr, "ERROR: Error updating member: %s\n", e.what());
+		}
+	}
+	ipMemberIds.push_back('}');
+	ipNetworkIds.push_back('}');
+	if (rows.empty())
+		return;
+
+	std::vector<const char *> values(v.size());
+	for(unsigned long i=0;i<(unsigned long)v.size();++i)
+		values[i] = (vNull[i]) ? (const char *)0 : v[i].c_str();
+
+	PGresult *res = PQexec(conn, "BEGIN");
+	if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+		fprintf(stderr, "ERROR: Error beginning transaction: %s\n", PQresultErrorMessage(res));
+		PQclear(res);
+		return;
+	}
+	PQclear(res);
 
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error updating IP address assignments: %s\n", PQresultErrorMessage(res));
-						PQclear(res);
-						PQclear(PQexec(conn, "ROLLBACK"));;
-						delete config;
-						config = nullptr;
-						continue;
-					}
+	bool ok = true;
+	for(unsigned long r=0;(ok)&&(r<(unsigned long)rows.size());) {
+		const bool many = (((unsigned long)rows.size() - r) >= ZT_CENTRAL_CONTROLLER_COMMIT_INSERT_ROWS);
+		const int nParams = (many) ? (17 * ZT_CENTRAL_CONTROLLER_COMMIT_INSERT_ROWS) : 17;
+		if (st.prepared)
+			res = PQexecPrepared(conn,(many) ? "ztc_member_upsert_n" : "ztc_member_upsert_1",nParams,values.data() + (r * 17),NULL,NULL,0);
+		else res = PQexecParams(conn,((many) ? st.upsertMany : st.upsertOne).c_str(),nParams,NULL,values.data() + (r * 17),NULL,NULL,0);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+			fprintf(stderr, "ERROR: Error updating member: %s\n", PQresultErrorMessage(res));
+			ok = false;
+		}
+		PQclear(res);
+		r += (many) ? ZT_CENTRAL_CONTROLLER_COMMIT_INSERT_ROWS : 1;
+	}
 
-					PQclear(res);
+	if (ok) {
+		const char *v2[2] = {
+			ipMemberIds.c_str(),
+			ipNetworkIds.c_str()
+		};
+		if (st.prepared)
+			res = PQexecPrepared(conn,"ztc_member_ip_delete",2,v2,NULL,NULL,0);
+		else res = PQexecParams(conn,st.ipDelete.c_str(),2,NULL,v2,NULL,NULL,0);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+			fprintf(stderr, "ERROR: Error updating IP address assignments: %s\n", PQresultErrorMessage(res));
+			ok = false;
+		}
+		PQclear(res);
+	}
 
-					std::vector<std::string> assignments;
-					for (auto i = (*config)["ipAssignments"].begin(); i != (*config)["ipAssignments"].end(); ++i) {
-						std::string addr = *i;
-
-						if (std::find(assignments.begin(), assignments.end(), addr) != assignments.end()) {
-							continue;
-						}
-
-						const char *v3[3] = {
-							memberId.c_str(),
-							networkId.c_str(),
-							addr.c_str()
-						};
-
-						res = PQexecParams(conn,
-							"INSERT INTO ztc_member_ip_assignment (member_id, network_id, address) VALUES ($1, $2, $3)",
-							3,
-							NULL,
-							v3,
-							NULL,
-							NULL,
-							0);
-
-						if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-							fprintf(stderr, "ERROR: Error setting IP addresses for member: %s\n", PQresultErrorMessage(res));
-							PQclear(res);
-							PQclear(PQexec(conn, "ROLLBACK"));
-							break;;
-						}
-					}
+	if ((ok)&&(!ipCopy.empty())) {
+		res = PQexec(conn, "COPY ztc_member_ip_assignment (member_id, network_id, address) FROM STDIN");
+		if (PQresultStatus(res) == PGRES_COPY_IN) {
+			PQclear(res);
+			if ((PQputCopyData(conn,ipCopy.data(),(int)ipCopy.length()) != 1)||(PQputCopyEnd(conn,NULL) != 1))
+				ok = false;
+			while ((res = PQgetResult(conn)) != NULL) {
+				if (PQresultStatus(res) != PGRES_COMMAND_OK)
+					ok = false;
+				if (!ok)
+					fprintf(stderr, "ERROR: Error setting IP addresses for members: %s\n", PQresultErrorMessage(res));
+				PQclear(res);
+			}
+		} else {
+			fprintf(stderr, "ERROR: Error setting IP addresses for members: %s\n", PQresultErrorMessage(res));
+			PQclear(res);
+			ok = false;
+		}
+	}
 
-					res = PQexec(conn, "COMMIT");
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error committing ip address data: %s\n", PQresultErrorMessage(res));
-					}
+	if (ok) {
+		res = PQexec(conn, "COMMIT");
+		if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+			fprintf(stderr, "ERROR: Error committing member data: %s\n", PQresultErrorMessage(res));
+			ok = false;
+		}
+		PQclear(res);
+	} else {
+		PQclear(PQexec(conn, "ROLLBACK"));
+	}
 
-					PQclear(res);
+	if (!ok) {
+		// Retry a failed batch one member at a time so one bad record can't take the others with it
+		if (rows.size() > 1) {
+			std::vector< std::pair<nlohmann::json,bool> * > one(1);
+			for(auto m=rows.begin();m!=rows.end();++m) {
+				one[0] = *m;
+				_commitMembers(conn,st,one);
+			}
+		} else {
+			fprintf(stderr, "%s", OSUtils::jsonDump(rows[0]->first, 2).c_str());
+		}
+		return;
+	}
 
-					const uint64_t nwidInt = OSUtils::jsonIntHex((*config)["nwid"], 0ULL);
-					const uint64_t memberidInt = OSUtils::jsonIntHex((*config)["id"], 0ULL);
-					if (nwidInt && memberidInt) {
-						nlohmann::json nwOrig;
-						nlohmann::json memOrig;
+	for(auto m=rows.begin();m!=rows.end();++m) {
+		nlohmann::json *config = &((*m)->first);
+		const uint64_t nwidInt = OSUtils::jsonIntHex((*config)["nwid"], 0ULL);
+		const uint64_t memberidInt = OSUtils::jsonIntHex((*config)["id"], 0ULL);
+		if (nwidInt && memberidInt) {
+			nlohmann::json nwOrig;
+			nlohmann::json memOrig;
 
-						nlohmann::json memNew(*config);
+			nlohmann::json memNew(*config);
 
-						get(nwidInt, nwOrig, memberidInt, memOrig);
+			get(nwidInt, nwOrig, memberidInt, memOrig);
 
-						_memberChanged(memOrig, memNew, qitem.second);
-					} else {
-						fprintf(stderr, "Can't notify of change.  Error parsing nwid or memberid: %llu-%llu\n", (unsigned long long)nwidInt, (unsigned long long)memberidInt);
-					}
+			_memberChanged(memOrig, memNew, (*m)->second);
+		} else {
+			fprintf(stderr, "Can't notify of change.  Error parsing nwid or memberid: %llu-%llu\n", (unsigned long long)nwidInt, (unsigned long long)memberidInt);
+		}
+	}
+}
 
-				} catch (std::exception &e) {
-					fprintf(stderr, "ERROR: Error updating member: %s\n", e.what());
+void PostgreSQL::_commitRecord(PGconn *conn,std::pair<nlohmann::json,bool> &qitem)
+{
+	try {
+		nlohmann::json *config = &(qitem.first);
+		const std::string objtype = (*config)["objtype"];
+		if (objtype == "network") {
+			try {
+				std::string id = (*config)["id"];
+				std::string controllerId = _myAddressStr.c_str();
+				std::string name = (*config)["name"];
+				std::string remoteTraceTarget("NULL");
+				if (!(*config)["remoteTraceTarget"].is_null()) {
+					remoteTraceTarget = (*config)["remoteTraceTarget"];
+				}
+				std::string rulesSource;
+				if ((*config)["rulesSource"].is_string()) {
+					rulesSource = (*config)["rulesSource"];
+				}
+				std::string caps = OSUtils::jsonDump((*config)["capabilitles"], -1);
+				std::string now = std::to_string(OSUtils::now());
+				std::string mtu = std::to_string((int)(*config)["mtu"]);
+				std::string mcastLimit = std::to_string((int)(*config)["multicastLimit"]);
+				std::string rtraceLevel = std::to_string((int)(*config)["remoteTraceLevel"]);
+				std::string rules = OSUtils::jsonDump((*config)["rules"], -1);
+				std::string tags = OSUtils::jsonDump((*config)["tags"], -1);
+				std::string v4mode = OSUtils::jsonDump((*config)["v4AssignMode"],-1);
+				std::string v6mode = OSUtils::jsonDump((*config)["v6AssignMode"], -1);
+				bool enableBroadcast = (*config)["enableBroadcast"];
+				bool isPrivate = (*config)["private"];
+
+				const char *values[16] = {
+					id.c_str(),
+					controllerId.c_str(),
+					caps.c_str(),
+					enableBroadcast ? "true" : "false",
+					now.c_str(),
+					mtu.c_str(),
+					mcastLimit.c_str(),
+					name.c_str(),
+					isPrivate ? "true" : "false",
+					rtraceLevel.c_str(),
+					(remoteTraceTarget == "NULL" ? NULL : remoteTraceTarget.c_str()),
+					rules.c_str(),
+					rulesSource.c_str(),
+					tags.c_str(),
+					v4mode.c_str(),
+					v6mode.c_str(),
+				};
+
+				// This ugly query exists because when we want to mirror networks to/from
+				// another data store (e.g. FileDB or LFDB) it is possible to get a network
+				// that doesn't exist in Central's database. This does an upsert and sets
+				// the owner_id to the "first" global admin in the user DB if the record
+				// did not previously exist. If the record already exists owner_id is left
+				// unchanged, so owner_id should be left out of the update clause.
+				PGresult *res = PQexecParams(conn,
+					"INSERT INTO ztc_network (id, creation_time, owner_id, controller_id, capabilities, enable_broadcast, "
+					"last_modified, mtu, multicast_limit, name, private, "
+					"remote_trace_level, remote_trace_target, rules, rules_source, "
+					"tags, v4_assign_mode, v6_assign_mode) VALUES ("
+					"$1, TO_TIMESTAMP($5::double precision/1000), "
+					"(SELECT user_id AS owner_id FROM ztc_global_permissions WHERE authorize = true AND del = true AND modify = true AND read = true LIMIT 1),"
+					"$2, $3, $4, TO_TIMESTAMP($5::double precision/1000), "
+					"$6, $7, $8, $9, $10, $11, $12, $13, $14, $15, $16) "
+					"ON CONFLICT (id) DO UPDATE set controller_id = EXCLUDED.controller_id, "
+					"capabilities = EXCLUDED.capabilities, enable_broadcast = EXCLUDED.enable_broadcast, "
+					"last_modified = EXCLUDED.last_modified, mtu = EXCLUDED.mtu, "
+					"multicast_limit = EXCLUDED.multicast_limit, name = EXCLUDED.name, "
+					"private = EXCLUDED.private, remote_trace_level = EXCLUDED.remote_trace_level, "
+					"remote_trace_target = EXCLUDED.remote_trace_target, rules = EXCLUDED.rules, "
+					"rules_source = EXCLUDED.rules_source, tags = EXCLUDED.tags, "
+					"v4_assign_mode = EXCLUDED.v4_assign_mode, v6_assign_mode = EXCLUDED.v6_assign_mode",
+					16,
+					NULL,
+					values,
+					NULL,
+					NULL,
+					0);
+
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error updating network record: %s\n", PQresultErrorMessage(res));
+					PQclear(res);
+					return;
 				}
-			} else if (objtype == "network") {
-				try {
-					std::string id = (*config)["id"];
-					std::string controllerId = _myAddressStr.c_str();
-					std::string name = (*config)["name"];
-					std::string remoteTraceTarget("NULL");
-					if (!(*config)["remoteTraceTarget"].is_null()) {
-						remoteTraceTarget = (*config)["remoteTraceTarget"];
-					}
-					std::string rulesSource;
-					if ((*config)["rulesSource"].is_string()) {
-						rulesSource = (*config)["rulesSource"];
-					}
-					std::string caps = OSUtils::jsonDump((*config)["capabilitles"], -1);
-					std::string now = std::to_string(OSUtils::now());
-					std::string mtu = std::to_string((int)(*config)["mtu"]);
-					std::string mcastLimit = std::to_string((int)(*config)["multicastLimit"]);
-					std::string rtraceLevel = std::to_string((int)(*config)["remoteTraceLevel"]);
-					std::string rules = OSUtils::jsonDump((*config)["rules"], -1);
-					std::string tags = OSUtils::jsonDump((*config)["tags"], -1);
-					std::string v4mode = OSUtils::jsonDump((*config)["v4AssignMode"],-1);
-					std::string v6mode = OSUtils::jsonDump((*config)["v6AssignMode"], -1);
-					bool enableBroadcast = (*config)["enableBroadcast"];
-					bool isPrivate = (*config)["private"];
-
-					const char *values[16] = {
-						id.c_str(),
-						controllerId.c_str(),
-						caps.c_str(),
-						enableBroadcast ? "true" : "false",
-						now.c_str(),
-						mtu.c_str(),
-						mcastLimit.c_str(),
-						name.c_str(),
-						isPrivate ? "true" : "false",
-						rtraceLevel.c_str(),
-						(remoteTraceTarget == "NULL" ? NULL : remoteTraceTarget.c_str()),
-						rules.c_str(),
-						rulesSource.c_str(),
-						tags.c_str(),
-						v4mode.c_str(),
-						v6mode.c_str(),
-					};
-
-					// This ugly query exists because when we want to mirror networks to/from
-					// another data store (e.g. FileDB or LFDB) it is possible to get a network
-					// that doesn't exist in Central's database. This does an upsert and sets
-					// the owner_id to the "first" global admin in the user DB if the record
-					// did not previously exist. If the record already exists owner_id is left
-					// unchanged, so owner_id should be left out of the update clause.
-					PGresult *res = PQexecParams(conn,
-						"INSERT INTO ztc_network (id, creation_time, owner_id, controller_id, capabilities, enable_broadcast, "
-						"last_modified, mtu, multicast_limit, name, private, "
-						"remote_trace_level, remote_trace_target, rules, rules_source, "
-						"tags, v4_assign_mode, v6_assign_mode) VALUES ("
-						"$1, TO_TIMESTAMP($5::double precision/1000), "
-						"(SELECT user_id AS owner_id FROM ztc_global_permissions WHERE authorize = true AND del = true AND modify = true AND read = true LIMIT 1),"
-						"$2, $3, $4, TO_TIMESTAMP($5::double precision/1000), "
-						"$6, $7, $8, $9, $10, $11, $12, $13, $14, $15, $16) "
-						"ON CONFLICT (id) DO UPDATE set controller_id = EXCLUDED.controller_id, "
-						"capabilities = EXCLUDED.capabilities, enable_broadcast = EXCLUDED.enable_broadcast, "
-						"last_modified = EXCLUDED.last_modified, mtu = EXCLUDED.mtu, "
-						"multicast_limit = EXCLUDED.multicast_limit, name = EXCLUDED.name, "
-						"private = EXCLUDED.private, remote_trace_level = EXCLUDED.remote_trace_level, "
-						"remote_trace_target = EXCLUDED.remote_trace_target, rules = EXCLUDED.rules, "
-						"rules_source = EXCLUDED.rules_source, tags = EXCLUDED.tags, "
-						"v4_assign_mode = EXCLUDED.v4_assign_mode, v6_assign_mode = EXCLUDED.v6_assign_mode",
-						16,
-						NULL,
-						values,
-						NULL,
-						NULL,
-						0);
 
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error updating network record: %s\n", PQresultErrorMessage(res));
-						PQclear(res);
-						delete config;
-						config = nullptr;
-						continue;
-					}
+				PQclear(res);
 
+				res = PQexec(conn, "BEGIN");
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error beginnning transaction: %s\n", PQresultErrorMessage(res));
 					PQclear(res);
+					return;
+				}
 
-					res = PQexec(conn, "BEGIN");
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error beginnning transaction: %s\n", PQresultErrorMessage(res));
-						PQclear(res);
-						delete config;
-						config = nullptr;
-						continue;
-					}
+				PQclear(res);
 
+				const char *params[1] = {
+					id.c_str()
+				};
+				res = PQexecParams(conn,
+					"DELETE FROM ztc_network_assignment_pool WHERE network_id = $1",
+					1,
+					NULL,
+					params,
+					NULL,
+					NULL,
+					0);
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error updating assignment pool: %s\n", PQresultErrorMessage(res));
 					PQclear(res);
+					PQclear(PQexec(conn, "ROLLBACK"));
+					return;
+				}
 
-					const char *params[1] = {
-						id.c_str()
+				PQclear(res);
+
+				auto pool = (*config)["ipAssignmentPools"];
+				bool err = false;
+				for (auto i = pool.begin(); i != pool.end(); ++i) {
+					std::string start = (*i)["ipRangeStart"];
+					std::string end = (*i)["ipRangeEnd"];
+					const char *p[3] = {
+						id.c_str(),
+						start.c_str(),
+						end.c_str()
 					};
+
 					res = PQexecParams(conn,
-						"DELETE FROM ztc_network_assignment_pool WHERE network_id = $1",
-						1,
+						"INSERT INTO ztc_network_assignment_pool (network_id, ip_range_start, ip_range_end) "
+						"VALUES ($1, $2, $3)",
+						3,
 						NULL,
-						params,
+						p,
 						NULL,
 						NULL,
 						0);
 					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
 						fprintf(stderr, "ERROR: Error updating assignment pool: %s\n", PQresultErrorMessage(res));
 						PQclear(res);
-						PQclear(PQexec(conn, "ROLLBACK"));
-						delete config;
-						config = nullptr;
-						continue;
+						err = true;
+						break;
 					}
+					PQclear(res);
+				}
+				if (err) {
+					PQclear(PQexec(conn, "ROLLBACK"));
+					return;
+				}
 
+				res = PQexecParams(conn,
+					"DELETE FROM ztc_network_route WHERE network_id = $1",
+					1,
+					NULL,
+					params,
+					NULL,
+					NULL,
+					0);
+
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error updating routes: %s\n", PQresultErrorMessage(res));
 					PQclear(res);
+					PQclear(PQexec(conn, "ROLLBACK"));
+					return;
+				}
 
-					auto pool = (*config)["ipAssignmentPools"];
-					bool err = false;
-					for (auto i = pool.begin(); i != pool.end(); ++i) {
-						std::string start = (*i)["ipRangeStart"];
-						std::string end = (*i)["ipRangeEnd"];
-						const char *p[3] = {
-							id.c_str(),
-							start.c_str(),
-							end.c_str()
-						};
-
-						res = PQexecParams(conn,
-							"INSERT INTO ztc_network_assignment_pool (network_id, ip_range_start, ip_range_end) "
-							"VALUES ($1, $2, $3)",
-							3,
-							NULL,
-							p,
-							NULL,
-							NULL,
-							0);
-						if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-							fprintf(stderr, "ERROR: Error updating assignment pool: %s\n", PQresultErrorMessage(res));
-							PQclear(res);
-							err = true;
-							break;
-						}
-						PQclear(res);
+
+				auto routes = (*config)["routes"];
+				err = false;
+				for (auto i = routes.begin(); i != routes.end(); ++i) {
+					std::string t = (*i)["target"];
+					std::vector<std::string> target;
+					std::istringstream f(t);
+					std::string s;
+					while(std::getline(f, s, '/')) {
+						target.push_back(s);
 					}
-					if (err) {
-						PQclear(PQexec(conn, "ROLLBACK"));
-						delete config;
-						config = nullptr;
+					if (target.empty() || target.size() != 2) {
 						continue;
 					}
+					std::string targetAddr = target[0];
+					std::string targetBits = target[1];
+					std::string via = "NULL";
+					if (!(*i)["via"].is_null()) {
+						via = (*i)["via"];
+					}
+
+					const char *p[4] = {
+						id.c_str(),
+						targetAddr.c_str(),
+						targetBits.c_str(),
+						(via == "NULL" ? NULL : via.c_str()),
+					};
 
 					res = PQexecParams(conn,
-						"DELETE FROM ztc_network_route WHERE network_id = $1",
-						1,
+						"INSERT INTO ztc_network_route (network_id, address, bits, via) VALUES ($1, $2, $3, $4)",
+						4,
 						NULL,
-						params,
+						p,
 						NULL,
 						NULL,
 						0);
@@ -1189,149 +1328,92 @@ void PostgreSQL::commitThread()
 					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
 						fprintf(stderr, "ERROR: Error updating routes: %s\n", PQresultErrorMessage(res));
 						PQclear(res);
-						PQclear(PQexec(conn, "ROLLBACK"));
-						delete config;
-						config = nullptr;
-						continue;
-					}
-
-
-					auto routes = (*config)["routes"];
-					err = false;
-					for (auto i = routes.begin(); i != routes.end(); ++i) {
-						std::string t = (*i)["target"];
-						std::vector<std::string> target;
-						std::istringstream f(t);
-						std::string s;
-						while(std::getline(f, s, '/')) {
-							target.push_back(s);
-						}
-						if (target.empty() || target.size() != 2) {
-							continue;
-						}
-						std::string targetAddr = target[0];
-						std::string targetBits = target[1];
-						std::string via = "NULL";
-						if (!(*i)["via"].is_null()) {
-							via = (*i)["via"];
-						}
-
-						const char *p[4] = {
-							id.c_str(),
-							targetAddr.c_str(),
-							targetBits.c_str(),
-							(via == "NULL" ? NULL : via.c_str()),
-						};
-
-						res = PQexecParams(conn,
-							"INSERT INTO ztc_network_route (network_id, address, bits, via) VALUES ($1, $2, $3, $4)",
-							4,
-							NULL,
-							p,
-							NULL,
-							NULL,
-							0);
-
-						if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-							fprintf(stderr, "ERROR: Error updating routes: %s\n", PQresultErrorMessage(res));
-							PQclear(res);
-							err = true;
-							break;
-						}
-						PQclear(res);
-					}
-					if (err) {
-						PQclear(PQexec(conn, "ROLLBACK"));
-						delete config;
-						config = nullptr;
-						continue;
-					}
-
-					res = PQexec(conn, "COMMIT");
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error committing network update: %s\n", PQresultErrorMessage(res));
+						err = true;
+						break;
 					}
 					PQclear(res);
+				}
+				if (err) {
+					PQclear(PQexec(conn, "ROLLBACK"));
+					return;
+				}
 
-					const uint64_t nwidInt = OSUtils::jsonIntHex((*config)["nwid"], 0ULL);
-					if (nwidInt) {
-						nlohmann::json nwOrig;
-						nlohmann::json nwNew(*config);
+				res = PQexec(conn, "COMMIT");
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error committing network update: %s\n", PQresultErrorMessage(res));
+				}
+				PQclear(res);
 
-						get(nwidInt, nwOrig);
+				const uint64_t nwidInt = OSUtils::jsonIntHex((*config)["nwid"], 0ULL);
+				if (nwidInt) {
+					nlohmann::json nwOrig;
+					nlohmann::json nwNew(*config);
 
-						_networkChanged(nwOrig, nwNew, qitem.second);
-					} else {
-						fprintf(stderr, "Can't notify network changed: %llu\n", (unsigned long long)nwidInt);
-					}
+					get(nwidInt, nwOrig);
 
-				} catch (std::exception &e) {
-					fprintf(stderr, "ERROR: Error updating member: %s\n", e.what());
+					_networkChanged(nwOrig, nwNew, qitem.second);
+				} else {
+					fprintf(stderr, "Can't notify network changed: %llu\n", (unsigned long long)nwidInt);
 				}
-			} else if (objtype == "_delete_network") {
-				try {
-					std::string networkId = (*config)["nwid"];
-					const char *values[1] = {
-						networkId.c_str()
-					};
-					PGresult * res = PQexecParams(conn,
-						"UPDATE ztc_network SET deleted = true WHERE id = $1",
-						1,
-						NULL,
-						values,
-						NULL,
-						NULL,
-						0);
 
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error deleting network: %s\n", PQresultErrorMessage(res));
-					}
-
-					PQclear(res);
-				} catch (std::exception &e) {
-					fprintf(stderr, "ERROR: Error deleting network: %s\n", e.what());
+			} catch (std::exception &e) {
+				fprintf(stderr, "ERROR: Error updating member: %s\n", e.what());
+			}
+		} else if (objtype == "_delete_network") {
+			try {
+				std::string networkId = (*config)["nwid"];
+				const char *values[1] = {
+					networkId.c_str()
+				};
+				PGresult * res = PQexecParams(conn,
+					"UPDATE ztc_network SET deleted = true WHERE id = $1",
+					1,
+					NULL,
+					values,
+					NULL,
+					NULL,
+					0);
+
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error deleting network: %s\n", PQresultErrorMessage(res));
 				}
-			} else if (objtype == "_delete_member") {
-				try {
-					std::string memberId = (*config)["id"];
-					std::string networkId = (*config)["nwid"];
-
-					const char *values[2] = {
-						memberId.c_str(),
-						networkId.c_str()
-					};
 
-					PGresult *res = PQexecParams(conn,
-						"UPDATE ztc_member SET hidden = true, deleted = true WHERE id = $1 AND network_id = $2",
-						2,
-						NULL,
-						values,
-						NULL,
-						NULL,
-						0);
-
-					if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-						fprintf(stderr, "ERROR: Error deleting member: %s\n", PQresultErrorMessage(res));
-					}
-
-					PQclear(res);
-				} catch (std::exception &e) {
-					fprintf(stderr, "ERROR: Error deleting member: %s\n", e.what());
+				PQclear(res);
+			} catch (std::exception &e) {
+				fprintf(stderr, "ERROR: Error deleting network: %s\n", e.what());
+			}
+		} else if (objtype == "_delete_member") {
+			try {
+				std::string memberId = (*config)["id"];
+				std::string networkId = (*config)["nwid"];
+
+				const char *values[2] = {
+					memberId.c_str(),
+					networkId.c_str()
+				};
+
+				PGresult *res = PQexecParams(conn,
+					"UPDATE ztc_member SET hidden = true, deleted = true WHERE id = $1 AND network_id = $2",
+					2,
+					NULL,
+					values,
+					NULL,
+					NULL,
+					0);
+
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error deleting member: %s\n", PQresultErrorMessage(res));
 				}
-			} else {
-				fprintf(stderr, "ERROR: unknown objtype");
+
+				PQclear(res);
+			} catch (std::exception &e) {
+				fprintf(stderr, "ERROR: Error deleting member: %s\n", e.what());
 			}
-		} catch (std::exception &e) {
-			fprintf(stderr, "ERROR: Error getting objtype: %s\n", e.what());
+		} else {
+			fprintf(stderr, "ERROR: unknown objtype");
 		}
-
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
-	}
-
-	PQfinish(conn);
-	if (_run == 1) {
-		fprintf(stderr, "ERROR: %s commitThread should still be running! Exiting Controller.\n", _myAddressStr.c_str());
-		exit(7);
+	} catch (std::exception &e) {
+		fprintf(stderr, "ERROR: Error getting objtype: %s\n", e.what());
 	}
 }
 
@@ -1345,9 +1427,8 @@ void PostgreSQL::onlineNotificationThread()
 	}
 	_connected = 1;
 
-	//int64_t	lastUpdatedNetworkStatus = 0;
-	std::unordered_map< std::pair<uint64_t,uint64_t>,int64_t,_PairHasher > lastOnlineCumulative;
-
+	_OnlineMap online;
+	std::string copy;
 	while (_run == 1) {
 		if (PQstatus(conn) != CONNECTION_OK) {
 			fprintf(stderr, "ERROR: Online Notification thread lost connection to Postgres.");
@@ -1355,103 +1436,94 @@ void PostgreSQL::onlineNotificationThread()
 			exit(5);
 		}
 
-		// map used to send notifications to front end
-		std::unordered_map<std::string, std::vector<std::string>> updateMap;
-
-		std::unordered_map< std::pair<uint64_t,uint64_t>,std::pair<int64_t,InetAddress>,_PairHasher > lastOnline;
+		// Status is aggregated in memory by DB::nodeIsOnline() and flushed here as one
+		// COPY into a staging table followed by one upsert, so the cost of a flush depends
+		// on how many members were seen and not on how often they asked for config.
+		_takeOnline(online);
+		copy.clear();
 		{
-			std::lock_guard<std::mutex> l(_lastOnline_l);
-			lastOnline.swap(_lastOnline);
-		}
-
-		PGresult *res = NULL;
-
-		std::stringstream memberUpdate;
-		memberUpdate << "INSERT INTO ztc_member_status (network_id, member_id, address, last_updated) VALUES ";
-		bool firstRun = true;
-		bool memberAdded = false;
-		for (auto i=lastOnline.begin(); i != lastOnline.end(); ++i) {
-			uint64_t nwid_i = i->first.first;
-			char nwidTmp[64];
-			char memTmp[64];
-			char ipTmp[64];
-			OSUtils::ztsnprintf(nwidTmp,sizeof(nwidTmp), "%.16llx", nwid_i);
-			OSUtils::ztsnprintf(memTmp,sizeof(memTmp), "%.10llx", i->first.second);
-
-			auto found = _networks.find(nwid_i);
-			if (found == _networks.end()) {
-				continue; // skip members trying to join non-existant networks
+			char line[256],ipTmp[64];
+			std::lock_guard<std::mutex> l(_networks_l);
+			for (auto i=online.begin(); i != online.end(); ++i) {
+				if (_networks.find(i->first.first) == _networks.end())
+					continue; // skip members trying to join non-existant networks
+				const time_t secs = (time_t)(i->second.lastSeen / 1000);
+				struct tm t;
+				gmtime_r(&secs, &t);
+				const char *ipAddr = "\\N";
+				if (i->second.physicalAddress) {
+					i->second.physicalAddress.toIpString(ipTmp);
+					if (ipTmp[0])
+						ipAddr = ipTmp;
+				}
+				OSUtils::ztsnprintf(line, sizeof(line), "%.16llx\t%.10llx\t%s\t%04d-%02d-%02d %02d:%02d:%02d.%03d+00\n",
+					(unsigned long long)i->first.first,
+					(unsigned long long)i->first.second,
+					ipAddr,
+					t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
+					(int)(i->second.lastSeen % 1000));
+				copy.append(line);
 			}
+		}
 
-			std::string networkId(nwidTmp);
-			std::string memberId(memTmp);
-
-			std::vector<std::string> &members = updateMap[networkId];
-			members.push_back(memberId);
-
-			lastOnlineCumulative[i->first] = i->second.first;
-
-
-			const char *qvals[2] = {
-				networkId.c_str(),
-				memberId.c_str()
+		if (!copy.empty()) {
+			bool ok = true;
+			const char *const setup[3] = {
+				"BEGIN",
+				"SET LOCAL client_min_messages = warning",
+				"CREATE TEMP TABLE IF NOT EXISTS ztc_member_status_staging (LIKE ztc_member_status INCLUDING DEFAULTS) ON COMMIT DELETE ROWS"
 			};
-
-			res = PQexecParams(conn,
-				"SELECT id, network_id FROM ztc_member WHERE network_id = $1 AND id = $2",
-				2,
-				NULL,
-				qvals,
-				NULL,
-				NULL,
-				0);
-
-			if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-				fprintf(stderr, "Member count failed: %s", PQerrorMessage(conn));
+			for (int i = 0; (ok)&&(i < 3); ++i) {
+				PGresult *res = PQexec(conn, setup[i]);
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "ERROR: Error preparing member status update: %s\n", PQresultErrorMessage(res));
+					ok = false;
+				}
 				PQclear(res);
-				continue;
 			}
 
-			int nrows = PQntuples(res);
-			PQclear(res);
-
-			if (nrows == 1) {
-				int64_t ts = i->second.first;
-				std::string ipAddr = i->second.second.toIpString(ipTmp);
-				std::string timestamp = std::to_string(ts);
-
-				if (firstRun) {
-					firstRun = false;
+			if (ok) {
+				PGresult *res = PQexec(conn, "COPY ztc_member_status_staging (network_id, member_id, address, last_updated) FROM STDIN");
+				if (PQresultStatus(res) == PGRES_COPY_IN) {
+					PQclear(res);
+					if ((PQputCopyData(conn, copy.data(), (int)copy.length()) != 1)||(PQputCopyEnd(conn, NULL) != 1))
+						ok = false;
+					while ((res = PQgetResult(conn)) != NULL) {
+						if (PQresultStatus(res) != PGRES_COMMAND_OK)
+							ok = false;
+						PQclear(res);
+					}
 				} else {
-					memberUpdate << ", ";
+					PQclear(res);
+					ok = false;
 				}
+				if (!ok)
+					fprintf(stderr, "ERROR: Error copying member status: %s\n", PQerrorMessage(conn));
+			}
 
-				memberUpdate << "('" << networkId << "', '" << memberId << "', ";
-				if (ipAddr.empty()) {
-					memberUpdate << "NULL, ";
-				} else {
-					memberUpdate << "'" << ipAddr << "', ";
+			if (ok) {
+				PGresult *res = PQexec(conn,
+					"INSERT INTO ztc_member_status (network_id, member_id, address, last_updated) "
+					"SELECT s.network_id, s.member_id, s.address, s.last_updated FROM ztc_member_status_staging s "
+					"JOIN ztc_member m ON m.network_id = s.network_id AND m.id = s.member_id "
+					"ON CONFLICT (network_id, member_id) DO UPDATE SET address = EXCLUDED.address, last_updated = EXCLUDED.last_updated");
+				if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+					fprintf(stderr, "Multiple insert failed: %s", PQerrorMessage(conn));
+					ok = false;
 				}
-				memberUpdate << "TO_TIMESTAMP(" << timestamp << "::double precision/1000))";
-				memberAdded = true;
-			} else if (nrows > 1) {
-				fprintf(stderr, "nrows > 1?!?");
-				continue;
-			} else {
-				continue;
+				PQclear(res);
 			}
-		}
-		memberUpdate << " ON CONFLICT (network_id, member_id) DO UPDATE SET address = EXCLUDED.address, last_updated = EXCLUDED.last_updated;";
 
-		if (memberAdded) {
-			res = PQexec(conn, memberUpdate.str().c_str());
-			if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-				fprintf(stderr, "Multiple insert failed: %s", PQerrorMessage(conn));
-			}
+			PGresult *res = PQexec(conn, (ok) ? "COMMIT" : "ROLLBACK");
+			if (PQresultStatus(res) != PGRES_COMMAND_OK)
+				ok = false;
 			PQclear(res);
+			if (!ok)
+				_returnOnline(online); // retried with the next batch
 		}
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		for (int k = 0; (k < (ZT_CONTROLLER_ONLINE_FLUSH_PERIOD / 100))&&(_run == 1); ++k)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	}
 	fprintf(stderr, "%s: Fell out of run loop in onlineNotificationThread\n", _myAddressStr.c_str());
 	PQfinish(conn);
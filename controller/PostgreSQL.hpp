@@ -20,6 +20,12 @@
 
 #define ZT_CENTRAL_CONTROLLER_COMMIT_THREADS 4
 
+// Maximum records taken from the commit queue and committed in one transaction
+#define ZT_CENTRAL_CONTROLLER_COMMIT_BATCH_SIZE 256
+
+// Rows per multi-row member upsert statement
+#define ZT_CENTRAL_CONTROLLER_COMMIT_INSERT_ROWS 32
+
 extern "C" {
 typedef struct pg_conn PGconn;
 }
@@ -45,13 +51,6 @@ public:
 	virtual bool save(nlohmann::json &record,bool notifyListeners);
 	virtual void eraseNetwork(const uint64_t networkId);
 	virtual void eraseMember(const uint64_t networkId, const uint64_t memberId);
-	virtual void nodeIsOnline(const uint64_t networkId, const uint64_t memberId, const InetAddress &physicalAddress);
-
-protected:
-	struct _PairHasher
-	{
-		inline std::size_t operator()(const std::pair<uint64_t,uint64_t> &p) const { return (std::size_t)(p.first ^ p.second); }
-	};
 
 private:
 	void initializeNetworks(PGconn *conn);
@@ -64,7 +63,17 @@ private:
 	void _networksWatcher_Postgres(PGconn *conn);
 	void _networksWatcher_RabbitMQ();
 
+	struct _CommitStatements
+	{
+		bool prepared;
+		std::string upsertOne;
+		std::string upsertMany;
+		std::string ipDelete;
+	};
+
 	void commitThread();
+	void _commitMembers(PGconn *conn,const _CommitStatements &st,std::vector< std::pair<nlohmann::json,bool> * > &members);
+	void _commitRecord(PGconn *conn,std::pair<nlohmann::json,bool> &qitem);
 	void onlineNotificationThread();
 
 	enum OverrideMode {
@@ -87,9 +96,6 @@ private:
 	std::thread _commitThread[ZT_CENTRAL_CONTROLLER_COMMIT_THREADS];
 	std::thread _onlineNotificationThread;
 
-	std::unordered_map< std::pair<uint64_t,uint64_t>,std::pair<int64_t,InetAddress>,_PairHasher > _lastOnline;
-
-	mutable std::mutex _lastOnline_l;
 	mutable std::mutex _readyLock;
 	std::atomic<int> _ready, _connected, _run;
 	mutable volatile bool _waitNoticePrinted;
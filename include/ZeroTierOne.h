@@ -1209,6 +1209,125 @@ typedef struct
 	unsigned long networkCount;
 } ZT_VirtualNetworkList;
 
+/**
+ * Replication statistics for a multicast group
+ *
+ * These are only collected by nodes acting as designated multicast
+ * replicators for a network, and count frames replicated on behalf of
+ * other members of the group.
+ */
+typedef struct
+{
+	/**
+	 * Multicast group MAC in lower 48 bits
+	 */
+	uint64_t mac;
+
+	/**
+	 * Multicast group additional distinguishing information
+	 */
+	uint32_t adi;
+
+	/**
+	 * Number of frames replicated to this group
+	 */
+	uint64_t frames;
+
+	/**
+	 * Total number of packets sent while replicating frames (fan-out)
+	 */
+	uint64_t packets;
+
+	/**
+	 * Number of packets sent directly rather than queued for a path or WHOIS
+	 */
+	uint64_t directPackets;
+
+	/**
+	 * Total time spent replicating frames in microseconds
+	 */
+	uint64_t totalMicros;
+
+	/**
+	 * Longest time spent replicating a single frame in microseconds
+	 */
+	uint64_t maxMicros;
+
+	/**
+	 * Time of last replicated frame in ms since epoch
+	 */
+	int64_t lastReplicated;
+} ZT_MulticastReplicationStats;
+
+/**
+ * A list of multicast replication statistics
+ */
+typedef struct
+{
+	ZT_MulticastReplicationStats *groups;
+	unsigned long groupCount;
+} ZT_MulticastReplicationStatsList;
+
+/**
+ * A trace event kept in the node's local trace history
+ */
+typedef struct
+{
+	/**
+	 * Sequence number of this event in the local history, starting at 1
+	 */
+	uint64_t sequence;
+
+	/**
+	 * Time of event in ms since epoch
+	 */
+	int64_t timestamp;
+
+	/**
+	 * Event type (one of ZT_REMOTE_TRACE_EVENT__*)
+	 */
+	unsigned int event;
+
+	/**
+	 * Event fields as a dictionary in the same format sent to remote trace targets
+	 */
+	const char *data;
+
+	/**
+	 * Length of data in bytes (not including terminating 0)
+	 */
+	unsigned int len;
+} ZT_TraceEvent;
+
+/**
+ * A list of trace events from the local trace history and trace counters
+ */
+typedef struct
+{
+	ZT_TraceEvent *events;
+	unsigned long eventCount;
+
+	/**
+	 * Number of events recorded since the node started
+	 */
+	uint64_t recorded;
+
+	/**
+	 * Number of events dropped because they came faster than they were flushed
+	 */
+	uint64_t dropped;
+
+	/**
+	 * Number of events sent to remote trace targets
+	 */
+	uint64_t remoteRecords;
+
+	/**
+	 * Number of VERB_REMOTE_TRACE packets those were sent in
+	 */
+	uint64_t remotePackets;
+} ZT_TraceEventList;
+
 /**
  * Physical path configuration
  */
@@ -1359,6 +1478,21 @@ typedef struct
 	 * Known network paths to peer
 	 */
 	ZT_PeerPhysicalPath paths[ZT_MAX_PEER_NETWORK_PATHS];
+
+	/**
+	 * Number of frames sent to this peer that were compressed
+	 */
+	uint64_t compressionHits;
+
+	/**
+	 * Number of frames sent to this peer on which compression was tried but did not help
+	 */
+	uint64_t compressionMisses;
+
+	/**
+	 * Number of frames sent to this peer without trying compression since it was not helping
+	 */
+	uint64_t compressionSkipped;
 } ZT_Peer;
 
 /**
@@ -1925,6 +2059,45 @@ ZT_SDK_API ZT_VirtualNetworkConfig *ZT_Node_networkConfig(ZT_Node *node,uint64_t
  */
 ZT_SDK_API ZT_VirtualNetworkList *ZT_Node_networks(ZT_Node *node);
 
+/**
+ * Get multicast replication statistics for a network
+ *
+ * Groups appear here only if this node is a designated multicast replicator
+ * for the network and has replicated frames to them.
+ *
+ * The pointer returned here must be freed with freeQueryResult()
+ * when you are done with it.
+ *
+ * @param node Node instance
+ * @param nwid 64-bit network ID
+ * @return List of per-group statistics or NULL on failure
+ */
+ZT_SDK_API ZT_MulticastReplicationStatsList *ZT_Node_multicastReplicationStats(ZT_Node *node,uint64_t nwid);
+
+/**
+ * Set the level at which trace events are kept in the local trace history
+ *
+ * Events at or below this level are kept for ZT_Node_traceEvents(), in
+ * addition to being sent to any remote trace targets. The history holds
+ * the most recent events only. Use -1 (the default) to disable it.
+ *
+ * @param node Node instance
+ * @param level Trace level or -1 to disable
+ */
+ZT_SDK_API void ZT_Node_setLocalTraceLevel(ZT_Node *node,int level);
+
+/**
+ * Get events from the local trace history
+ *
+ * The pointer returned here must be freed with freeQueryResult()
+ * when you are done with it.
+ *
+ * @param node Node instance
+ * @param since Only return events with a sequence number greater than this (0 for all)
+ * @return List of events or NULL on failure
+ */
+ZT_SDK_API ZT_TraceEventList *ZT_Node_traceEvents(ZT_Node *node,uint64_t since);
+
 /**
  * Free a query result buffer
  *
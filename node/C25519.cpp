@@ -2521,25 +2521,16 @@ void C25519::sign(const C25519::Private &myPrivate,const C25519::Public &myPubli
 #endif
 }
 
-bool C25519::verify(const C25519::Public &their,const void *msg,unsigned int len,const void *signature)
+// Ed25519 verification of sig[0..63] against public key pk given hram = SHA-512(R || A || M)
+static inline bool _ed25519VerifyHram(const unsigned char *pk,const unsigned char *sig,const unsigned char *hram)
 {
-	const unsigned char *const sig = (const unsigned char *)signature;
-	unsigned char digest[64]; // we sign the first 32 bytes of SHA-512(msg)
-	SHA512::hash(digest,msg,len);
-	if (!Utils::secureEq(sig + 64,digest,32))
-		return false;
-
 	unsigned char t2[32];
 	ge25519 get1, get2;
 	sc25519 schram, scs;
-	unsigned char hram[crypto_hash_sha512_BYTES];
-	unsigned char m[96];
 
-	if (ge25519_unpackneg_vartime(&get1,their.data + 32))
+	if (ge25519_unpackneg_vartime(&get1,pk))
 		return false;
 
-	get_hram(hram,sig,their.data + 32,m,96);
-
 	sc25519_from64bytes(&schram, hram);
 
 	sc25519_from32bytes(&scs, sig+32);
@@ -2550,6 +2541,68 @@ bool C25519::verify(const C25519::Public &their,const void *msg,unsigned int len
 	return Utils::secureEq(sig,t2,32);
 }
 
+bool C25519::verify(const C25519::Public &their,const void *msg,unsigned int len,const void *signature)
+{
+	const unsigned char *const sig = (const unsigned char *)signature;
+	unsigned char digest[64]; // we sign the first 32 bytes of SHA-512(msg)
+	SHA512::hash(digest,msg,len);
+	if (!Utils::secureEq(sig + 64,digest,32))
+		return false;
+
+	unsigned char hram[crypto_hash_sha512_BYTES];
+	unsigned char m[96];
+	get_hram(hram,sig,their.data + 32,m,96);
+
+	return _ed25519VerifyHram(their.data + 32,sig,hram);
+}
+
+bool C25519::verifyMany(const Public *const their[],const void *const msg[],const unsigned int len[],const void *const signature[],unsigned int count)
+{
+	unsigned char digest[4][64];
+	unsigned char hram[4][crypto_hash_sha512_BYTES];
+	unsigned char m[4][96];
+	void *digestp[4];
+	void *hramp[4];
+	const void *in[4];
+	unsigned int inlen[4];
+
+	for(unsigned int i=0;i<count;i+=4) {
+		// Unused lanes in the last group just repeat the first signature in the group
+		unsigned int lane[4];
+		for(unsigned int l=0;l<4;++l)
+			lane[l] = ((i + l) < count) ? (i + l) : i;
+
+		for(unsigned int l=0;l<4;++l) {
+			digestp[l] = digest[l];
+			in[l] = msg[lane[l]];
+			inlen[l] = len[lane[l]];
+		}
+		SHA512::hash4(digestp,in,inlen);
+
+		for(unsigned int l=0;l<4;++l) {
+			const unsigned char *const sig = (const unsigned char *)signature[lane[l]];
+			if (!Utils::secureEq(sig + 64,digest[l],32))
+				return false;
+			memcpy(m[l],sig,32);
+			memcpy(m[l] + 32,their[lane[l]]->data + 32,32);
+			memcpy(m[l] + 64,sig + 64,32);
+			hramp[l] = hram[l];
+			in[l] = m[l];
+			inlen[l] = 96;
+		}
+		SHA512::hash4(hramp,in,inlen);
+
+		for(unsigned int l=0;l<4;++l) {
+			if ((l > 0)&&(lane[l] == i))
+				break;
+			if (!_ed25519VerifyHram(their[lane[l]]->data + 32,(const unsigned char *)signature[lane[l]],hram[l]))
+				return false;
+		}
+	}
+
+	return true;
+}
+
 void C25519::_calcPubDH(C25519::Pair &kp)
 {
 	// First 32 bytes of pub and priv are the keys for ECDH key
@@ -28,32 +28,44 @@ int Capability::verify(const RuntimeEnvironment *RR,void *tPtr) const
 		if ((_maxCustodyChainLength < 1)||(_maxCustodyChainLength > ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH))
 			return -1;
 
-		// Validate all entries in chain of custody
 		Buffer<(sizeof(Capability) * 2)> tmp;
 		this->serialize(tmp,true);
+
+		// Every entry in the chain of custody signs the same serialized capability,
+		// so check structure and look up signers first and then verify as a batch.
+		Identity ids[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		const C25519::Public *pub[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		const void *msg[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		unsigned int len[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		const void *sig[ZT_MAX_CAPABILITY_CUSTODY_CHAIN_LENGTH];
+		unsigned int n = 0;
 		for(unsigned int c=0;c<_maxCustodyChainLength;++c) {
 			if (c == 0) {
 				if ((!_custody[c].to)||(!_custody[c].from)||(_custody[c].from != Network::controllerFor(_nwid)))
 					return -1; // the first entry must be present and from the network's controller
 			} else {
 				if (!_custody[c].to)
-					return 0; // all previous entries were valid, so we are valid
+					break; // end of chain
 				else if ((!_custody[c].from)||(_custody[c].from != _custody[c-1].to))
 					return -1; // otherwise if we have another entry it must be from the previous holder in the chain
 			}
 
-			const Identity id(RR->topology->getIdentity(tPtr,_custody[c].from));
-			if (id) {
-				if (!id.verify(tmp.data(),tmp.size(),_custody[c].signature))
+			ids[n] = RR->topology->getIdentity(tPtr,_custody[c].from);
+			if (!ids[n]) {
+				// Only go looking for this signer if everything before it is valid
+				if (!C25519::verifyMany(pub,msg,len,sig,n))
 					return -1;
-			} else {
 				RR->sw->requestWhois(tPtr,RR->node->now(),_custody[c].from);
 				return 1;
 			}
+			pub[n] = &(ids[n].publicKey());
+			msg[n] = tmp.data();
+			len[n] = tmp.size();
+			sig[n] = _custody[c].signature.data;
+			++n;
 		}
 
-		// We reached max custody chain length and everything was valid
-		return 0;
+		return (C25519::verifyMany(pub,msg,len,sig,n) ? 0 : -1);
 	} catch ( ... ) {}
 	return -1;
 }
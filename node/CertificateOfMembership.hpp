@@ -100,7 +100,10 @@ public:
 	 * Create an empty certificate of membership
 	 */
 	CertificateOfMembership() :
-		_qualifierCount(0) {}
+		_qualifierCount(0)
+	{
+		memset(_signature.data,0,ZT_C25519_SIGNATURE_LEN);
+	}
 
 	/**
 	 * Create from required fields common to all networks
@@ -322,7 +325,7 @@ public:
 			if ((a.id != b.id)||(a.value != b.value)||(a.maxDelta != b.maxDelta))
 				return false;
 		}
-		return (memcmp(_signature.data,c._signature.data,ZT_C25519_SIGNATURE_LEN) == 0);
+		return ((!_signedBy)||(memcmp(_signature.data,c._signature.data,ZT_C25519_SIGNATURE_LEN) == 0)); // no signature if unsigned
 	}
 	inline bool operator!=(const CertificateOfMembership &c) const { return (!(*this == c)); }
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2023-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_COMPRESSIONTRACKER_HPP
+#define ZT_COMPRESSIONTRACKER_HPP
+
+#include <stdint.h>
+
+#include "Constants.hpp"
+#include "Packet.hpp"
+
+namespace ZeroTier {
+
+/**
+ * Decides whether compressing packets to a given destination is worth trying
+ *
+ * Traffic that is already compressed or encrypted (TLS, media, etc.) will
+ * never shrink, so running LZ4 over it just burns CPU. After a run of
+ * ZT_PEER_COMPRESSION_MISS_THRESHOLD packets that fail to compress, this
+ * stops trying except for one probe packet every
+ * ZT_PEER_COMPRESSION_PROBE_INTERVAL. Any packet that compresses resets it.
+ *
+ * This is not locked. Races between threads can only cost a redundant or
+ * skipped compression attempt or a miscounted statistic.
+ */
+class CompressionTracker
+{
+public:
+	CompressionTracker() :
+		_nextProbe(0),
+		_missStreak(0),
+		_hits(0),
+		_misses(0),
+		_skipped(0)
+	{
+	}
+
+	/**
+	 * Compress a packet unless compression has recently been ineffective
+	 *
+	 * @param outp Packet to compress (must be unencrypted)
+	 * @param now Current time
+	 * @return True if packet was compressed
+	 */
+	inline bool compress(Packet &outp,const int64_t now)
+	{
+		if (outp.size() <= (ZT_PACKET_IDX_PAYLOAD + ZT_PROTO_MIN_COMPRESSIBLE_PAYLOAD_LENGTH))
+			return false; // too small to try, so does not count as a miss
+
+		if (_missStreak >= ZT_PEER_COMPRESSION_MISS_THRESHOLD) {
+			if (now < _nextProbe) {
+				++_skipped;
+				return false;
+			}
+			_nextProbe = now + ZT_PEER_COMPRESSION_PROBE_INTERVAL;
+		}
+
+		if (outp.compress()) {
+			_missStreak = 0;
+			++_hits;
+			return true;
+		}
+
+		if (++_missStreak == ZT_PEER_COMPRESSION_MISS_THRESHOLD)
+			_nextProbe = now + ZT_PEER_COMPRESSION_PROBE_INTERVAL;
+		++_misses;
+		return false;
+	}
+
+	/**
+	 * @return True if compression is currently being bypassed
+	 */
+	inline bool bypassed() const { return (_missStreak >= ZT_PEER_COMPRESSION_MISS_THRESHOLD); }
+
+	/**
+	 * @return Number of packets that were compressed
+	 */
+	inline uint64_t hits() const { return _hits; }
+
+	/**
+	 * @return Number of packets on which compression was tried but did not reduce size
+	 */
+	inline uint64_t misses() const { return _misses; }
+
+	/**
+	 * @return Number of packets on which compression was not tried because it was bypassed
+	 */
+	inline uint64_t skipped() const { return _skipped; }
+
+private:
+	int64_t _nextProbe;
+	unsigned int _missStreak;
+	uint64_t _hits;
+	uint64_t _misses;
+	uint64_t _skipped;
+};
+
+} // namespace ZeroTier
+
+#endif
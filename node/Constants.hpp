@@ -475,6 +475,16 @@
 #define ZT_PEER_ACTIVITY_TIMEOUT 30000
 #endif
 
+/**
+ * Consecutive packets to a peer that must fail to compress before compression is bypassed
+ */
+#define ZT_PEER_COMPRESSION_MISS_THRESHOLD 16
+
+/**
+ * While compression to a peer is bypassed, try it on one packet this often (ms)
+ */
+#define ZT_PEER_COMPRESSION_PROBE_INTERVAL 2000
+
 /**
  * General rate limit timeout for multiple packet types (HELLO, etc.)
  */
@@ -35,7 +35,8 @@ namespace ZeroTier {
  * contains these characters it may not be retrievable. This is not checked.
  *
  * Lookup is via linear search and will be slow with a lot of keys. It's
- * designed for small things.
+ * designed for small things. To read many keys from one dictionary, build a
+ * DictionaryIndex over it and look them up there instead.
  *
  * There is code to test and fuzz this in selftest.cpp. Fuzzing a blob of
  * pointer tricks like this is important after any modifications.
@@ -417,6 +418,27 @@ public:
 		return this->add(key,(const char *)value.data(),(int)value.size());
 	}
 
+	/**
+	 * Append entries that are already encoded, e.g. taken from another dictionary
+	 *
+	 * @param entries Encoded entries (the contents of another dictionary's data())
+	 * @param len Length of entries in bytes, not including any terminating NULL
+	 * @return True if there was enough room to append the entries
+	 */
+	inline bool addEncoded(const char *entries,unsigned int len)
+	{
+		if (!len)
+			return true;
+		unsigned int j = sizeBytes();
+		if ((j + ((j > 0) ? 1 : 0) + len) >= C)
+			return false;
+		if (j > 0)
+			_d[j++] = (char)10;
+		memcpy(_d + j,entries,len);
+		_d[j + len] = (char)0;
+		return true;
+	}
+
 	/**
 	 * @param key Key to check
 	 * @return True if key is present
@@ -439,6 +461,297 @@ private:
 	char _d[C];
 };
 
+/**
+ * Maximum number of distinct keys held in a DictionaryIndex's hash table
+ *
+ * Keys past this are still found, by scanning the rest of the dictionary.
+ */
+#define ZT_DICTIONARY_INDEX_MAX_KEYS 128
+
+/**
+ * Read-only key index over the encoded form of a Dictionary
+ *
+ * Dictionary::get() scans from the start for every key and unescapes the
+ * value each time, which adds up when a network config is parsed. This
+ * tokenizes the dictionary once, recording where each key's value starts
+ * and ends, and hashes the keys so a lookup doesn't touch the text of any
+ * other entry. Values stay in place and are only unescaped when read.
+ *
+ * Lookups return the same results as the corresponding Dictionary methods,
+ * including returning the first of any duplicate keys. The index points
+ * into the dictionary, which must not change or go away while it's used.
+ */
+class DictionaryIndex
+{
+public:
+	/**
+	 * A key=value entry, pointing into the dictionary
+	 */
+	struct Entry
+	{
+		const char *k;     // key, not terminated
+		const char *v;     // value as encoded, not terminated
+		unsigned int klen;
+		unsigned int vlen; // length of encoded value
+		uint32_t hash;     // hash of key
+		bool escaped;      // value contains escapes and must be unescaped to be read
+	};
+
+	/**
+	 * @param d Encoded dictionary
+	 * @param len Length of d[] (indexing also stops at a NULL)
+	 */
+	DictionaryIndex(const char *d,const unsigned int len) { _index(d,len); }
+
+	/**
+	 * @param d Dictionary to index
+	 * @tparam C Dictionary capacity (usually inferred)
+	 */
+	template<unsigned int C>
+	DictionaryIndex(const Dictionary<C> &d) { _index(d.data(),C); }
+
+	/**
+	 * @return Number of entries in the hash table (see entry())
+	 */
+	inline unsigned int size() const { return _count; }
+
+	/**
+	 * @param i Index from 0 to size()-1, in dictionary order
+	 * @return Entry
+	 */
+	inline const Entry &entry(const unsigned int i) const { return _e[i]; }
+
+	/**
+	 * Find an entry
+	 *
+	 * @param key Key to look up
+	 * @param e Entry to fill (only valid if key was found, may point into e itself)
+	 * @return Entry or NULL if key is not present
+	 */
+	inline const Entry *find(const char *key,Entry &e) const
+	{
+		const unsigned int klen = (unsigned int)strlen(key);
+		const uint32_t h = _hash(key,klen);
+		for(unsigned int s=h;;++s) {
+			const unsigned int ei = _slots[s & (sizeof(_slots) - 1)];
+			if (!ei)
+				break;
+			const Entry &ie = _e[ei - 1];
+			if ((ie.hash == h)&&(ie.klen == klen)&&(!memcmp(ie.k,key,klen)))
+				return &ie;
+		}
+
+		if (_rest) { // past the last key we had room for, fall back to a scan
+			const char *p = _rest;
+			while (p < _eof) {
+				p = _next(p,_eof,e);
+				if ((e.k)&&(e.klen == klen)&&(!memcmp(e.k,key,klen)))
+					return &e;
+			}
+		}
+
+		return (const Entry *)0;
+	}
+
+	/**
+	 * Unescape an entry's value
+	 *
+	 * Truncation and termination are as described for Dictionary::get().
+	 *
+	 * @param e Entry
+	 * @param dest Destination buffer
+	 * @param destlen Size of destination buffer
+	 * @return -1 if destlen is zero, or number of bytes stored in dest[] minus trailing 0
+	 */
+	static inline int value(const Entry &e,char *dest,const unsigned int destlen)
+	{
+		if (!destlen)
+			return -1;
+		if ((!e.escaped)&&(e.vlen < destlen)) {
+			memcpy(dest,e.v,e.vlen);
+			dest[e.vlen] = (char)0;
+			return (int)e.vlen;
+		}
+
+		int j = 0;
+		bool esc = false;
+		for(unsigned int i=0;i<e.vlen;++i) {
+			const char c = e.v[i];
+			if (esc) {
+				esc = false;
+				switch(c) {
+					case 'r': dest[j++] = 13; break;
+					case 'n': dest[j++] = 10; break;
+					case '0': dest[j++] = (char)0; break;
+					case 'e': dest[j++] = '='; break;
+					default: dest[j++] = c; break;
+				}
+			} else if (c == '\\') {
+				esc = true;
+				continue;
+			} else {
+				dest[j++] = c;
+			}
+			if (j == (int)destlen) {
+				dest[j-1] = (char)0;
+				return j-1;
+			}
+		}
+		dest[j] = (char)0;
+		return j;
+	}
+
+	/**
+	 * Get an entry (same as Dictionary::get())
+	 */
+	inline int get(const char *key,char *dest,const unsigned int destlen) const
+	{
+		Entry tmp;
+		const Entry *const e = find(key,tmp);
+		if (!e) {
+			if (destlen)
+				dest[0] = (char)0;
+			return -1;
+		}
+		return value(*e,dest,destlen);
+	}
+
+	/**
+	 * Get the contents of a key into a buffer (same as Dictionary::get())
+	 */
+	template<unsigned int BC>
+	inline bool get(const char *key,Buffer<BC> &dest) const
+	{
+		const int r = this->get(key,const_cast<char *>(reinterpret_cast<const char *>(dest.data())),BC);
+		if (r >= 0) {
+			dest.setSize((unsigned int)r);
+			return true;
+		} else {
+			dest.clear();
+			return false;
+		}
+	}
+
+	/**
+	 * Get a boolean value (same as Dictionary::getB())
+	 */
+	inline bool getB(const char *key,bool dfl = false) const
+	{
+		char tmp[4];
+		if (this->get(key,tmp,sizeof(tmp)) >= 0)
+			return ((*tmp == '1')||(*tmp == 't')||(*tmp == 'T'));
+		return dfl;
+	}
+
+	/**
+	 * Get an unsigned int64 stored as hex (same as Dictionary::getUI())
+	 */
+	inline uint64_t getUI(const char *key,uint64_t dfl = 0) const
+	{
+		char tmp[128];
+		if (this->get(key,tmp,sizeof(tmp)) >= 1)
+			return Utils::hexStrToU64(tmp);
+		return dfl;
+	}
+
+	/**
+	 * Get a signed int64 stored as hex (same as Dictionary::getI())
+	 */
+	inline int64_t getI(const char *key,int64_t dfl = 0) const
+	{
+		char tmp[128];
+		if (this->get(key,tmp,sizeof(tmp)) >= 1)
+			return Utils::hexStrTo64(tmp);
+		return dfl;
+	}
+
+	/**
+	 * @param key Key to check
+	 * @return True if key is present
+	 */
+	inline bool contains(const char *key) const
+	{
+		Entry tmp;
+		return (find(key,tmp) != (const Entry *)0);
+	}
+
+private:
+	static inline uint32_t _hash(const char *k,const unsigned int klen)
+	{
+		uint32_t h = 2166136261U; // FNV-1a
+		for(unsigned int i=0;i<klen;++i) {
+			h ^= (uint32_t)((uint8_t)k[i]);
+			h *= 16777619U;
+		}
+		return h;
+	}
+
+	// Tokenize the line at p, setting e.k to NULL if it has no '=', and return the start of the next line
+	static inline const char *_next(const char *p,const char *const eof,Entry &e)
+	{
+		e.k = p;
+		while ((p < eof)&&(*p)&&(*p != '=')&&(*p != 13)&&(*p != 10))
+			++p;
+		if ((p >= eof)||(*p != '=')) {
+			e.k = (const char *)0;
+		} else {
+			e.klen = (unsigned int)(p - e.k);
+			e.v = ++p;
+			e.escaped = false;
+			while ((p < eof)&&(*p)&&(*p != 13)&&(*p != 10)) {
+				if (*p == '\\')
+					e.escaped = true;
+				++p;
+			}
+			e.vlen = (unsigned int)(p - e.v);
+		}
+		if ((p < eof)&&(*p))
+			++p;
+		else return eof;
+		return p;
+	}
+
+	inline void _index(const char *d,const unsigned int len)
+	{
+		memset(_slots,0,sizeof(_slots));
+		_count = 0;
+		_rest = (const char *)0;
+		_eof = d + len;
+
+		const char *p = d;
+		while (p < _eof) {
+			const char *const line = p;
+			Entry &e = _e[_count];
+			p = _next(p,_eof,e);
+			if (!e.k)
+				continue;
+
+			e.hash = _hash(e.k,e.klen);
+
+			for(unsigned int s=e.hash;;++s) {
+				uint8_t &slot = _slots[s & (sizeof(_slots) - 1)];
+				if (!slot) {
+					if (_count == ZT_DICTIONARY_INDEX_MAX_KEYS) {
+						_rest = line;
+						return;
+					}
+					slot = (uint8_t)++_count;
+					break;
+				}
+				const Entry &ie = _e[slot - 1];
+				if ((ie.hash == e.hash)&&(ie.klen == e.klen)&&(!memcmp(ie.k,e.k,e.klen)))
+					break; // duplicate, first one wins
+			}
+		}
+	}
+
+	Entry _e[ZT_DICTIONARY_INDEX_MAX_KEYS + 1]; // one extra as scratch for the next entry
+	uint8_t _slots[ZT_DICTIONARY_INDEX_MAX_KEYS * 2]; // 1-based index into _e[], or 0 if empty
+	unsigned int _count;
+	const char *_rest; // first line not indexed, or NULL if all were
+	const char *_eof;
+};
+
 } // namespace ZeroTier
 
 #endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2023-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_HASHTREE_HPP
+#define ZT_HASHTREE_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Constants.hpp"
+#include "SHA512.hpp"
+
+/**
+ * Length of hashes in a hash tree (truncated SHA-512)
+ */
+#define ZT_HASHTREE_HASH_LEN 32
+
+/**
+ * Maximum tree depth, and so maximum number of hashes in a proof
+ */
+#define ZT_HASHTREE_MAX_DEPTH 16
+
+namespace ZeroTier {
+
+/**
+ * Binary hash (Merkle) tree over a sequence of data blocks
+ *
+ * This lets a signer sign once over the root hash while each block can be
+ * checked on its own against that root using a short proof, e.g. when a
+ * large object is sent in several separately delivered chunks.
+ *
+ * Leaves and interior nodes are domain separated. A node without a sibling
+ * at some level (the last node of an odd-sized level) is promoted unchanged,
+ * so a proof contains one hash per level at which the node has a sibling.
+ */
+class HashTree
+{
+public:
+	/**
+	 * Compute a leaf hash for a block
+	 *
+	 * @param h Buffer to receive hash (ZT_HASHTREE_HASH_LEN bytes)
+	 * @param position Position of block (e.g. byte offset), bound into the leaf
+	 * @param data Block data
+	 * @param len Length of block
+	 */
+	static inline void leaf(uint8_t h[ZT_HASHTREE_HASH_LEN],const uint32_t position,const void *data,const unsigned int len)
+	{
+		uint8_t tmp[5 + ZT_SHA512_DIGEST_LEN];
+		SHA512::hash(tmp + 5,data,len);
+		tmp[0] = 0x00;
+		tmp[1] = (uint8_t)(position >> 24);
+		tmp[2] = (uint8_t)(position >> 16);
+		tmp[3] = (uint8_t)(position >> 8);
+		tmp[4] = (uint8_t)position;
+		uint8_t d[ZT_SHA512_DIGEST_LEN];
+		SHA512::hash(d,tmp,5 + ZT_HASHTREE_HASH_LEN);
+		memcpy(h,d,ZT_HASHTREE_HASH_LEN);
+	}
+
+	/**
+	 * Build a tree from its leaves
+	 *
+	 * @param leaves Leaf hashes, ZT_HASHTREE_HASH_LEN bytes each
+	 * @param count Number of leaves (must be at least 1)
+	 */
+	HashTree(const uint8_t *leaves,const unsigned int count) :
+		_count(count)
+	{
+		unsigned int total = count;
+		for(unsigned int width=count;width>1;width=(width + 1) >> 1)
+			total += (width + 1) >> 1;
+		_nodes.resize(total * ZT_HASHTREE_HASH_LEN);
+		memcpy(_nodes.data(),leaves,count * ZT_HASHTREE_HASH_LEN);
+		uint8_t *level = _nodes.data();
+		for(unsigned int width=count;width>1;width=(width + 1) >> 1) {
+			uint8_t *const next = level + (width * ZT_HASHTREE_HASH_LEN);
+			for(unsigned int i=0;i<width;i+=2) {
+				if ((i + 1) < width)
+					_node(next + ((i >> 1) * ZT_HASHTREE_HASH_LEN),level + (i * ZT_HASHTREE_HASH_LEN),level + ((i + 1) * ZT_HASHTREE_HASH_LEN));
+				else memcpy(next + ((i >> 1) * ZT_HASHTREE_HASH_LEN),level + (i * ZT_HASHTREE_HASH_LEN),ZT_HASHTREE_HASH_LEN);
+			}
+			level = next;
+		}
+	}
+
+	/**
+	 * @return Root hash (ZT_HASHTREE_HASH_LEN bytes)
+	 */
+	inline const uint8_t *root() const { return _nodes.data() + (_nodes.size() - ZT_HASHTREE_HASH_LEN); }
+
+	/**
+	 * Get the proof for one leaf
+	 *
+	 * @param proof Buffer to receive proof (up to ZT_HASHTREE_MAX_DEPTH hashes)
+	 * @param index Index of leaf
+	 * @return Number of hashes in proof
+	 */
+	inline unsigned int proof(uint8_t *proof,unsigned int index) const
+	{
+		const uint8_t *level = _nodes.data();
+		unsigned int n = 0;
+		for(unsigned int width=_count;width>1;width=(width + 1) >> 1) {
+			const unsigned int sibling = index ^ 1;
+			if (sibling < width)
+				memcpy(proof + ((n++) * ZT_HASHTREE_HASH_LEN),level + (sibling * ZT_HASHTREE_HASH_LEN),ZT_HASHTREE_HASH_LEN);
+			level += width * ZT_HASHTREE_HASH_LEN;
+			index >>= 1;
+		}
+		return n;
+	}
+
+	/**
+	 * Compute the root hash implied by a leaf and its proof
+	 *
+	 * @param root Buffer to receive root hash
+	 * @param leaf Leaf hash
+	 * @param index Index of leaf
+	 * @param count Total number of leaves
+	 * @param proof Proof hashes
+	 * @param proofLen Number of hashes in proof
+	 * @return False if index, count, or proof length are inconsistent
+	 */
+	static inline bool rootFromProof(uint8_t root[ZT_HASHTREE_HASH_LEN],const uint8_t leaf[ZT_HASHTREE_HASH_LEN],unsigned int index,const unsigned int count,const uint8_t *proof,const unsigned int proofLen)
+	{
+		if ((index >= count)||(proofLen > ZT_HASHTREE_MAX_DEPTH))
+			return false;
+		uint8_t h[ZT_HASHTREE_HASH_LEN];
+		memcpy(h,leaf,ZT_HASHTREE_HASH_LEN);
+		unsigned int n = 0;
+		for(unsigned int width=count;width>1;width=(width + 1) >> 1) {
+			if ((index ^ 1) < width) {
+				if (n >= proofLen)
+					return false;
+				if ((index & 1) != 0)
+					_node(h,proof + (n * ZT_HASHTREE_HASH_LEN),h);
+				else _node(h,h,proof + (n * ZT_HASHTREE_HASH_LEN));
+				++n;
+			}
+			index >>= 1;
+		}
+		if (n != proofLen)
+			return false;
+		memcpy(root,h,ZT_HASHTREE_HASH_LEN);
+		return true;
+	}
+
+private:
+	// dest may alias left or right
+	static inline void _node(uint8_t *dest,const uint8_t *left,const uint8_t *right)
+	{
+		uint8_t tmp[1 + (ZT_HASHTREE_HASH_LEN * 2)];
+		tmp[0] = 0x01;
+		memcpy(tmp + 1,left,ZT_HASHTREE_HASH_LEN);
+		memcpy(tmp + 1 + ZT_HASHTREE_HASH_LEN,right,ZT_HASHTREE_HASH_LEN);
+		uint8_t d[ZT_SHA512_DIGEST_LEN];
+		SHA512::hash(d,tmp,sizeof(tmp));
+		memcpy(dest,d,ZT_HASHTREE_HASH_LEN);
+	}
+
+	unsigned int _count;
+	std::vector<uint8_t> _nodes; // all levels, leaves first and root last
+};
+
+} // namespace ZeroTier
+
+#endif
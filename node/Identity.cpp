@@ -16,11 +16,17 @@
 #include <string.h>
 #include <stdint.h>
 
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
 #include "Constants.hpp"
 #include "Identity.hpp"
 #include "SHA512.hpp"
 #include "Salsa20.hpp"
 #include "Utils.hpp"
+#include "Mutex.hpp"
 
 // These can't be changed without a new identity type. They define the
 // parameters of the hashcash hashing/searching algorithm.
@@ -67,28 +73,65 @@ static inline void _computeMemoryHardHash(const void *publicKey,unsigned int pub
 }
 
 // Hashcash generation halting condition -- halt when first byte is less than
-// threshold value.
+// threshold value, or immediately if the halt flag (if any) becomes set.
 struct _Identity_generate_cond
 {
 	_Identity_generate_cond() {}
-	_Identity_generate_cond(unsigned char *sb,char *gm) : digest(sb),genmem(gm) {}
+	_Identity_generate_cond(unsigned char *sb,char *gm,const std::atomic<bool> *h) : digest(sb),genmem(gm),halt(h) {}
 	inline bool operator()(const C25519::Pair &kp) const
 	{
+		if ((halt)&&(halt->load()))
+			return true;
 		_computeMemoryHardHash(kp.pub.data,ZT_C25519_PUBLIC_KEY_LEN,digest,genmem);
 		return (digest[0] < ZT_IDENTITY_GEN_HASHCASH_FIRST_BYTE_LESS_THAN);
 	}
 	unsigned char *digest;
 	char *genmem;
+	const std::atomic<bool> *halt;
 };
 
-void Identity::generate()
+// State shared by the threads of Identity::generateMany()
+struct _Identity_generateMany_state
 {
+	bool (*handler)(void *,const Identity &);
+	void *arg;
+	unsigned long count;
+	std::atomic<bool> halt; // read without the lock by generating threads
+	Mutex lock;
+};
+
+void Identity::_generateManyWorker(void *stptr)
+{
+	_Identity_generateMany_state *const st = reinterpret_cast<_Identity_generateMany_state *>(stptr);
 	unsigned char digest[64];
 	char *genmem = new char[ZT_IDENTITY_GEN_MEMORY];
+	Identity id;
+	while (!st->halt.load()) {
+		if (!id._generate(digest,genmem,&(st->halt)))
+			break;
+		Mutex::Lock _l(st->lock);
+		if (st->halt.load())
+			break;
+		++st->count;
+		if (!st->handler(st->arg,id))
+			st->halt.store(true);
+	}
+	delete [] genmem;
+}
+
+static bool _Identity_generate_first(void *arg,const Identity &id)
+{
+	*(reinterpret_cast<Identity *>(arg)) = id;
+	return false;
+}
 
+bool Identity::_generate(unsigned char *digest,char *genmem,const std::atomic<bool> *halt)
+{
 	C25519::Pair kp;
 	do {
-		kp = C25519::generateSatisfying(_Identity_generate_cond(digest,genmem));
+		kp = C25519::generateSatisfying(_Identity_generate_cond(digest,genmem,halt));
+		if ((halt)&&(halt->load()))
+			return false;
 		_address.setTo(digest + 59,ZT_ADDRESS_LENGTH); // last 5 bytes are address
 	} while (_address.isReserved());
 
@@ -97,9 +140,45 @@ void Identity::generate()
 		_privateKey = new C25519::Private();
 	*_privateKey = kp.priv;
 
+	return true;
+}
+
+void Identity::generate()
+{
+	unsigned char digest[64];
+	char *genmem = new char[ZT_IDENTITY_GEN_MEMORY];
+	_generate(digest,genmem,(const std::atomic<bool> *)0);
 	delete [] genmem;
 }
 
+void Identity::generate(unsigned int threads)
+{
+	if (threads == 1)
+		generate();
+	else generateMany(threads,&_Identity_generate_first,this);
+}
+
+unsigned long Identity::generateMany(unsigned int threads,bool (*handler)(void *,const Identity &),void *arg)
+{
+	if (!threads)
+		threads = std::max(std::thread::hardware_concurrency(),1U);
+
+	_Identity_generateMany_state st;
+	st.handler = handler;
+	st.arg = arg;
+	st.count = 0;
+	st.halt.store(false);
+
+	std::vector<std::thread> t;
+	for(unsigned int i=1;i<threads;++i)
+		t.push_back(std::thread(&Identity::_generateManyWorker,(void *)&st));
+	_generateManyWorker((void *)&st);
+	for(std::vector<std::thread>::iterator i(t.begin());i!=t.end();++i)
+		i->join();
+
+	return st.count;
+}
+
 bool Identity::locallyValidate() const
 {
 	if (_address.isReserved())
@@ -17,6 +17,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <atomic>
+
 #include "Constants.hpp"
 #include "Utils.hpp"
 #include "Address.hpp"
@@ -97,6 +99,30 @@ public:
 	 */
 	void generate();
 
+	/**
+	 * Generate a new identity using several threads
+	 *
+	 * Each thread searches independently with its own memory-hard hash
+	 * buffer and the first satisfying key pair found is used.
+	 *
+	 * @param threads Number of threads to use (0 for one per core)
+	 */
+	void generate(unsigned int threads);
+
+	/**
+	 * Generate many identities using several threads
+	 *
+	 * Each new identity is passed to the handler as it is found. Handler calls
+	 * are serialized, so the handler does not need to be thread safe. Generation
+	 * stops when the handler returns false.
+	 *
+	 * @param threads Number of threads to use (0 for one per core)
+	 * @param handler Function called with each new identity, returns false to stop
+	 * @param arg Arbitrary argument passed to handler
+	 * @return Number of identities passed to handler
+	 */
+	static unsigned long generateMany(unsigned int threads,bool (*handler)(void *,const Identity &),void *arg);
+
 	/**
 	 * Check the validity of this identity's pairing of key to address
 	 *
@@ -301,6 +327,9 @@ public:
 	inline bool operator>=(const Identity &id) const { return !(*this < id); }
 
 private:
+	bool _generate(unsigned char *digest,char *genmem,const std::atomic<bool> *halt);
+	static void _generateManyWorker(void *st);
+
 	Address _address;
 	C25519::Public _publicKey;
 	C25519::Private *_privateKey;
@@ -12,6 +12,7 @@
 /****/
 
 #include <algorithm>
+#include <chrono>
 
 #include "Constants.hpp"
 #include "RuntimeEnvironment.hpp"
@@ -25,8 +26,82 @@
 #include "Node.hpp"
 #include "Network.hpp"
 
+// Slots in the member sampler's on-stack swap table (larger draws use the heap)
+#define ZT_MULTICASTER_SAMPLER_STACK_SLOTS 256
+
 namespace ZeroTier {
 
+// Draws indexes in [0,n) in random order without replacement. This is a lazy
+// Fisher-Yates shuffle: only drawn positions are swapped, and displaced values
+// are remembered in a small open addressed table. Drawing k of n costs O(k)
+// time and memory instead of O(n) to build and shuffle a full index array.
+class _MulticastMemberSampler
+{
+public:
+	_MulticastMemberSampler(const RuntimeEnvironment *renv,unsigned long n,unsigned long maxDraws) :
+		RR(renv),
+		_n(n),
+		_drawn(0),
+		_maxDraws((maxDraws < n) ? maxDraws : n),
+		_mask(15),
+		_tab(_stab)
+	{
+		while (_mask < (_maxDraws << 1))
+			_mask = (_mask << 1) | 1;
+		if (_mask >= ZT_MULTICASTER_SAMPLER_STACK_SLOTS)
+			_tab = new _Slot[_mask + 1];
+		for(unsigned long i=0;i<=_mask;++i)
+			_tab[i].k = ~((unsigned long)0);
+	}
+
+	~_MulticastMemberSampler()
+	{
+		if (_tab != _stab)
+			delete [] _tab;
+	}
+
+	inline bool next(unsigned long &idx)
+	{
+		if (_drawn >= _maxDraws)
+			return false;
+		const unsigned long j = _drawn + (unsigned long)(RR->node->prng() % (uint64_t)(_n - _drawn));
+		idx = _get(j);
+		_set(j,_get(_drawn)); // position _drawn is never read again, so it needn't be set
+		++_drawn;
+		return true;
+	}
+
+private:
+	struct _Slot { unsigned long k,v; };
+
+	inline _Slot *_find(const unsigned long k) const
+	{
+		for(unsigned long i=k & _mask;;i=(i + 1) & _mask) {
+			if ((_tab[i].k == k)||(_tab[i].k == ~((unsigned long)0)))
+				return &(_tab[i]);
+		}
+	}
+	inline unsigned long _get(const unsigned long k) const
+	{
+		const _Slot *const s = _find(k);
+		return (s->k == k) ? s->v : k;
+	}
+	inline void _set(const unsigned long k,const unsigned long v)
+	{
+		_Slot *const s = _find(k);
+		s->k = k;
+		s->v = v;
+	}
+
+	const RuntimeEnvironment *const RR;
+	const unsigned long _n;
+	unsigned long _drawn;
+	const unsigned long _maxDraws;
+	unsigned long _mask;
+	_Slot *_tab;
+	_Slot _stab[ZT_MULTICASTER_SAMPLER_STACK_SLOTS];
+};
+
 Multicaster::Multicaster(const RuntimeEnvironment *renv) :
 	RR(renv),
 	_groups(32)
@@ -54,20 +129,18 @@ void Multicaster::remove(uint64_t nwid,const MulticastGroup &mg,const Address &m
 	Mutex::Lock _l(_groups_m);
 	MulticastGroupStatus *s = _groups.get(Multicaster::Key(nwid,mg));
 	if (s) {
-		for(std::vector<MulticastGroupMember>::iterator m(s->members.begin());m!=s->members.end();++m) {
-			if (m->address == member) {
-				s->members.erase(m);
-				break;
-			}
-		}
+		std::vector<MulticastGroupMember>::iterator m(std::lower_bound(s->members.begin(),s->members.end(),member));
+		if ((m != s->members.end())&&(m->address == member))
+			s->members.erase(m);
 	}
 }
 
 unsigned int Multicaster::gather(const Address &queryingPeer,uint64_t nwid,const MulticastGroup &mg,Buffer<ZT_PROTO_MAX_PACKET_LENGTH> &appendTo,unsigned int limit) const
 {
 	unsigned char *p;
-	unsigned int added = 0,i,k,rptr,totalKnown = 0;
-	uint64_t a,picked[(ZT_PROTO_MAX_PACKET_LENGTH / 5) + 2];
+	unsigned int added = 0,totalKnown = 0;
+	unsigned long idx;
+	uint64_t a;
 
 	if (!limit)
 		return 0;
@@ -95,20 +168,11 @@ unsigned int Multicaster::gather(const Address &queryingPeer,uint64_t nwid,const
 		totalKnown += (unsigned int)s->members.size();
 
 		// Members are returned in random order so that repeated gather queries
-		// will return different subsets of a large multicast group.
-		k = 0;
-		while ((added < limit)&&(k < s->members.size())&&((appendTo.size() + ZT_ADDRESS_LENGTH) <= ZT_PROTO_MAX_PACKET_LENGTH)) {
-			rptr = (unsigned int)RR->node->prng();
-
-restart_member_scan:
-			a = s->members[rptr % (unsigned int)s->members.size()].address.toInt();
-			for(i=0;i<k;++i) {
-				if (picked[i] == a) {
-					++rptr;
-					goto restart_member_scan;
-				}
-			}
-			picked[k++] = a;
+		// will return different subsets of a large multicast group. One extra
+		// draw is allowed in case the querying peer is drawn and skipped.
+		_MulticastMemberSampler sampler(RR,(unsigned long)s->members.size(),(unsigned long)(limit - added) + 1);
+		while ((added < limit)&&((appendTo.size() + ZT_ADDRESS_LENGTH) <= ZT_PROTO_MAX_PACKET_LENGTH)&&(sampler.next(idx))) {
+			a = s->members[idx].address.toInt();
 
 			if (queryingPeer.toInt() != a) { // do not return the peer that is making the request as a result
 				p = (unsigned char *)appendTo.appendField(ZT_ADDRESS_LENGTH);
@@ -154,9 +218,6 @@ void Multicaster::send(
 	const void *data,
 	unsigned int len)
 {
-	unsigned long idxbuf[4096];
-	unsigned long *indexes = idxbuf;
-
 	// If we're in hub-and-spoke designated multicast replication mode, see if we
 	// have a multicast replicator active. If so, pick the best and send it
 	// there. If we are a multicast replicator or if none are alive, fall back
@@ -202,64 +263,42 @@ void Multicaster::send(
 		}
 	}
 
+	Address activeBridges[ZT_MAX_NETWORK_SPECIALISTS];
+	const unsigned int activeBridgeCount = network->config().activeBridges(activeBridges);
+	const unsigned int limit = network->config().multicastLimit;
+
+	// Recipients are drawn from the group's members in random order. Members
+	// can be skipped only if they are bridges (already sent to) or the origin,
+	// so that many extra draws is enough to fill the limit if possible.
+	const unsigned long maxDraws = (unsigned long)limit + (unsigned long)activeBridgeCount + 1;
+
+	// If we are replicating on behalf of another member, use the replication
+	// fast path and keep per-group statistics.
+	const bool replicating = ((origin)&&(network->config().isMulticastReplicator(RR->identity.address())));
+	const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+
+	std::vector<Address> recipients;
 	try {
 		Mutex::Lock _l(_groups_m);
 		MulticastGroupStatus &gs = _groups[Multicaster::Key(network->id(),mg)];
-
-		if (!gs.members.empty()) {
-			// Allocate a memory buffer if group is monstrous
-			if (gs.members.size() > (sizeof(idxbuf) / sizeof(unsigned long)))
-				indexes = new unsigned long[gs.members.size()];
-
-			// Generate a random permutation of member indexes
-			for(unsigned long i=0;i<gs.members.size();++i)
-				indexes[i] = i;
-			for(unsigned long i=(unsigned long)gs.members.size()-1;i>0;--i) {
-				unsigned long j = (unsigned long)RR->node->prng() % (i + 1);
-				unsigned long tmp = indexes[j];
-				indexes[j] = indexes[i];
-				indexes[i] = tmp;
-			}
-		}
-
-		Address activeBridges[ZT_MAX_NETWORK_SPECIALISTS];
-		const unsigned int activeBridgeCount = network->config().activeBridges(activeBridges);
-		const unsigned int limit = network->config().multicastLimit;
+		_MulticastMemberSampler sampler(RR,(unsigned long)gs.members.size(),maxDraws);
+		unsigned long idx;
 
 		if (gs.members.size() >= limit) {
-			// Skip queue if we already have enough members to complete the send operation
-			OutboundMulticast out;
-
-			out.init(
-				RR,
-				now,
-				network->id(),
-				network->config().disableCompression(),
-				limit,
-				1, // we'll still gather a little from peers to keep multicast list fresh
-				src,
-				mg,
-				etherType,
-				data,
-				len);
-
-			unsigned int count = 0;
-
+			// Skip queue if we already have enough members to complete the send operation.
+			// Recipients are picked here and sent to below, after the lock is released.
+			recipients.reserve(limit);
 			for(unsigned int i=0;i<activeBridgeCount;++i) {
 				if ((activeBridges[i] != RR->identity.address())&&(activeBridges[i] != origin)) {
-					out.sendOnly(RR,tPtr,activeBridges[i]); // optimization: don't use dedup log if it's a one-pass send
-					if (++count >= limit)
+					recipients.push_back(activeBridges[i]);
+					if (recipients.size() >= limit)
 						break;
 				}
 			}
-
-			unsigned long idx = 0;
-			while ((count < limit)&&(idx < gs.members.size())) {
-				const Address ma(gs.members[indexes[idx++]].address);
-				if ((std::find(activeBridges,activeBridges + activeBridgeCount,ma) == (activeBridges + activeBridgeCount))&&(ma != origin)) {
-					out.sendOnly(RR,tPtr,ma); // optimization: don't use dedup log if it's a one-pass send
-					++count;
-				}
+			while ((recipients.size() < limit)&&(sampler.next(idx))) {
+				const Address &ma = gs.members[idx].address;
+				if ((std::find(activeBridges,activeBridges + activeBridgeCount,ma) == (activeBridges + activeBridgeCount))&&(ma != origin))
+					recipients.push_back(ma);
 			}
 		} else {
 			if (gs.txQueue.size() >= ZT_TX_QUEUE_SIZE) {
@@ -353,20 +392,76 @@ void Multicaster::send(
 				}
 			}
 
-			unsigned long idx = 0;
-			while ((count < limit)&&(idx < gs.members.size())) {
-				Address ma(gs.members[indexes[idx++]].address);
+			while ((count < limit)&&(sampler.next(idx))) {
+				const Address &ma = gs.members[idx].address;
 				if (std::find(activeBridges,activeBridges + activeBridgeCount,ma) == (activeBridges + activeBridgeCount)) {
 					out.sendAndLog(RR,tPtr,ma);
 					++count;
 				}
 			}
+
+			if (replicating)
+				_logReplication(gs.replication,now,count,0,(uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+	} catch ( ... ) { // sanity check to catch any failures
+		return;
+	}
+
+	if (!recipients.empty()) {
+		OutboundMulticast out;
+
+		out.init(
+			RR,
+			now,
+			network->id(),
+			network->config().disableCompression(),
+			limit,
+			1, // we'll still gather a little from peers to keep multicast list fresh
+			src,
+			mg,
+			etherType,
+			data,
+			len);
+
+		if (replicating) {
+			unsigned long directPackets = 0;
+			for(std::vector<Address>::const_iterator r(recipients.begin());r!=recipients.end();++r) {
+				if (out.replicateTo(RR,tPtr,network,*r,now))
+					++directPackets;
+			}
+
+			const uint64_t micros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+			Mutex::Lock _l(_groups_m);
+			MulticastGroupStatus *const gs = _groups.get(Multicaster::Key(network->id(),mg));
+			if (gs)
+				_logReplication(gs->replication,now,(unsigned long)recipients.size(),directPackets,micros);
+		} else {
+			for(std::vector<Address>::const_iterator r(recipients.begin());r!=recipients.end();++r)
+				out.sendOnly(RR,tPtr,*r); // optimization: don't use dedup log if it's a one-pass send
 		}
-	} catch ( ... ) {} // this is a sanity check to catch any failures and make sure indexes[] still gets deleted
+	}
+}
 
-	// Free allocated memory buffer if any
-	if (indexes != idxbuf)
-		delete [] indexes;
+void Multicaster::replicationStats(uint64_t nwid,std::vector<ZT_MulticastReplicationStats> &st) const
+{
+	Mutex::Lock _l(_groups_m);
+	Hashtable<Multicaster::Key,MulticastGroupStatus>::Iterator i(const_cast<Multicaster *>(this)->_groups);
+	Multicaster::Key *k = (Multicaster::Key *)0;
+	MulticastGroupStatus *s = (MulticastGroupStatus *)0;
+	while (i.next(k,s)) {
+		if ((k->nwid == nwid)&&(s->replication.frames)) {
+			st.push_back(ZT_MulticastReplicationStats());
+			ZT_MulticastReplicationStats &rs = st.back();
+			rs.mac = k->mg.mac().toInt();
+			rs.adi = k->mg.adi();
+			rs.frames = s->replication.frames;
+			rs.packets = s->replication.packets;
+			rs.directPackets = s->replication.directPackets;
+			rs.totalMicros = s->replication.totalMicros;
+			rs.maxMicros = s->replication.maxMicros;
+			rs.lastReplicated = s->replication.lastReplicated;
+		}
+	}
 }
 
 void Multicaster::clean(int64_t now)
@@ -137,6 +137,14 @@ public:
 		const void *data,
 		unsigned int len);
 
+	/**
+	 * Get replication statistics for groups this node replicates for
+	 *
+	 * @param nwid Network ID
+	 * @param st Vector to fill with statistics for each group with replicated frames
+	 */
+	void replicationStats(uint64_t nwid,std::vector<ZT_MulticastReplicationStats> &st) const;
+
 	/**
 	 * Clean up and resort database
 	 *
@@ -175,17 +183,41 @@ private:
 		uint64_t timestamp; // time of last notification
 	};
 
+	struct ReplicationStats
+	{
+		ReplicationStats() : frames(0),packets(0),directPackets(0),totalMicros(0),maxMicros(0),lastReplicated(0) {}
+
+		uint64_t frames;
+		uint64_t packets;
+		uint64_t directPackets;
+		uint64_t totalMicros;
+		uint64_t maxMicros;
+		int64_t lastReplicated;
+	};
+
 	struct MulticastGroupStatus
 	{
 		MulticastGroupStatus() : lastExplicitGather(0) {}
 
 		uint64_t lastExplicitGather;
+		ReplicationStats replication; // only used if we are a multicast replicator
 		std::list<OutboundMulticast> txQueue; // pending outbound multicasts
 		std::vector<MulticastGroupMember> members; // members of this group
 	};
 
 	void _add(void *tPtr,int64_t now,uint64_t nwid,const MulticastGroup &mg,MulticastGroupStatus &gs,const Address &member);
 
+	static inline void _logReplication(ReplicationStats &rs,int64_t now,unsigned long packets,unsigned long directPackets,uint64_t micros)
+	{
+		++rs.frames;
+		rs.packets += packets;
+		rs.directPackets += directPackets;
+		rs.totalMicros += micros;
+		if (micros > rs.maxMicros)
+			rs.maxMicros = micros;
+		rs.lastReplicated = now;
+	}
+
 	const RuntimeEnvironment *const RR;
 
 	Hashtable<Multicaster::Key,MulticastGroupStatus> _groups;
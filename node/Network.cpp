@@ -427,8 +427,8 @@ static _doZtFilterResult _doZtFilter(
 			case ZT_NETWORK_RULE_MATCH_TAGS_BITWISE_OR:
 			case ZT_NETWORK_RULE_MATCH_TAGS_BITWISE_XOR:
 			case ZT_NETWORK_RULE_MATCH_TAGS_EQUAL: {
-				const Tag *const localTag = std::lower_bound(&(nconf.tags[0]),&(nconf.tags[nconf.tagCount]),rules[rn].v.tag.id,Tag::IdComparePredicate());
-				if ((localTag != &(nconf.tags[nconf.tagCount]))&&(localTag->id() == rules[rn].v.tag.id)) {
+				const Tag *const localTag = std::lower_bound(nconf.tags.data(),nconf.tags.data() + nconf.tagCount,rules[rn].v.tag.id,Tag::IdComparePredicate());
+				if ((localTag != (nconf.tags.data() + nconf.tagCount))&&(localTag->id() == rules[rn].v.tag.id)) {
 					const Tag *const remoteTag = ((membership) ? membership->getTag(nconf,rules[rn].v.tag.id) : (const Tag *)0);
 					if (remoteTag) {
 						const uint32_t ltv = localTag->value();
@@ -481,8 +481,8 @@ static _doZtFilterResult _doZtFilter(
 						}
 					}
 				} else { // sender and outbound or receiver and inbound
-					const Tag *const localTag = std::lower_bound(&(nconf.tags[0]),&(nconf.tags[nconf.tagCount]),rules[rn].v.tag.id,Tag::IdComparePredicate());
-					if ((localTag != &(nconf.tags[nconf.tagCount]))&&(localTag->id() == rules[rn].v.tag.id)) {
+					const Tag *const localTag = std::lower_bound(nconf.tags.data(),nconf.tags.data() + nconf.tagCount,rules[rn].v.tag.id,Tag::IdComparePredicate());
+					if ((localTag != (nconf.tags.data() + nconf.tagCount))&&(localTag->id() == rules[rn].v.tag.id)) {
 						thisRuleMatches = (uint8_t)(localTag->value() == rules[rn].v.tag.value);
 					} else {
 						thisRuleMatches = 0;
@@ -630,7 +630,7 @@ bool Network::filterOutgoingPacket(
 
 	Membership *const membership = (ztDest) ? _memberships.get(ztDest) : (Membership *)0;
 
-	switch(_doZtFilter(RR,rrl,_config,membership,false,ztSource,ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules,_config.ruleCount,cc,ccLength,ccWatch,qosBucket)) {
+	switch(_doZtFilter(RR,rrl,_config,membership,false,ztSource,ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules.data(),_config.ruleCount,cc,ccLength,ccWatch,qosBucket)) {
 
 		case DOZTFILTER_NO_MATCH: {
 			for(unsigned int c=0;c<_config.capabilityCount;++c) {
@@ -747,7 +747,7 @@ int Network::filterIncomingPacket(
 
 	Membership &membership = _membership(sourcePeer->address());
 
-	switch (_doZtFilter(RR,rrl,_config,&membership,true,sourcePeer->address(),ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules,_config.ruleCount,cc,ccLength,ccWatch,qosBucket)) {
+	switch (_doZtFilter(RR,rrl,_config,&membership,true,sourcePeer->address(),ztFinalDest,macSource,macDest,frameData,frameLen,etherType,vlanId,_config.rules.data(),_config.ruleCount,cc,ccLength,ccWatch,qosBucket)) {
 
 		case DOZTFILTER_NO_MATCH: {
 			Membership::CapabilityIterator mci(membership,_config);
@@ -875,35 +875,63 @@ uint64_t Network::handleConfigChunk(void *tPtr,const uint64_t packetId,const Add
 
 	NetworkConfig *nc = (NetworkConfig *)0;
 	uint64_t configUpdateId;
+	bool deltaFailed = false;
 	{
 		Mutex::Lock _l(_lock);
 
 		_IncomingConfigChunk *c = (_IncomingConfigChunk *)0;
 		uint64_t chunkId = 0;
 		unsigned long totalLength,chunkIndex;
+		bool treeSigned = false;
+		uint8_t treeRoot[ZT_HASHTREE_HASH_LEN];
+		uint8_t flags = 0;
 		if (ptr < chunk.size()) {
-			const bool fastPropagate = ((chunk[ptr++] & 0x01) != 0);
+			flags = chunk[ptr++];
+			const bool fastPropagate = ((flags & 0x01) != 0);
 			configUpdateId = chunk.at<uint64_t>(ptr); ptr += 8;
 			totalLength = chunk.at<uint32_t>(ptr); ptr += 4;
 			chunkIndex = chunk.at<uint32_t>(ptr); ptr += 4;
 
 			if (((chunkIndex + chunkLen) > totalLength)||(totalLength >= ZT_NETWORKCONFIG_DICT_CAPACITY)) // >= since we need room for a null at the end
 				return 0;
-			if ((chunk[ptr] != 1)||(chunk.at<uint16_t>(ptr + 1) != ZT_C25519_SIGNATURE_LEN))
+
+			// Chunks of a config signed once over a hash tree carry their proof, and
+			// are checked against the root; otherwise every chunk is signed.
+			unsigned int chunkCount = 0;
+			if ((flags & 0x02) != 0) {
+				const unsigned int chunkNo = chunk.at<uint16_t>(ptr); ptr += 2;
+				chunkCount = chunk.at<uint16_t>(ptr); ptr += 2;
+				const unsigned int proofLen = chunk[ptr++];
+				const uint8_t *proof = reinterpret_cast<const uint8_t *>(chunk.field(ptr,proofLen * ZT_HASHTREE_HASH_LEN)); ptr += proofLen * ZT_HASHTREE_HASH_LEN;
+				if (chunkCount > ZT_NETWORK_MAX_UPDATE_CHUNKS)
+					return 0;
+				uint8_t leaf[ZT_HASHTREE_HASH_LEN];
+				HashTree::leaf(leaf,(uint32_t)chunkIndex,chunkData,chunkLen);
+				if (!HashTree::rootFromProof(treeRoot,leaf,chunkNo,chunkCount,proof,proofLen))
+					return 0;
+				if ((chunk[ptr] != 2)||(chunk.at<uint16_t>(ptr + 1) != ZT_C25519_SIGNATURE_LEN))
+					return 0;
+
+				// The signature is the same for all chunks, so use the leaf as the per-chunk ID
+				memcpy(&chunkId,leaf,8);
+			} else if ((chunk[ptr] != 1)||(chunk.at<uint16_t>(ptr + 1) != ZT_C25519_SIGNATURE_LEN)) {
 				return 0;
+			}
 			const uint8_t *sig = reinterpret_cast<const uint8_t *>(chunk.field(ptr + 3,ZT_C25519_SIGNATURE_LEN));
 
 			// We can use the signature, which is unique per chunk, to get a per-chunk ID for local deduplication use
-			for(unsigned int i=0;i<16;++i)
-				reinterpret_cast<uint8_t *>(&chunkId)[i & 7] ^= sig[i];
+			if (!chunkCount) {
+				for(unsigned int i=0;i<16;++i)
+					reinterpret_cast<uint8_t *>(&chunkId)[i & 7] ^= sig[i];
+			}
 
 			// Find existing or new slot for this update and check if this is a duplicate chunk
 			for(int i=0;i<ZT_NETWORK_MAX_INCOMING_UPDATES;++i) {
 				if (_incomingConfigChunks[i].updateId == configUpdateId) {
 					c = &(_incomingConfigChunks[i]);
 
-					for(unsigned long j=0;j<c->haveChunks;++j) {
-						if (c->haveChunkIds[j] == chunkId)
+					for(std::vector<uint64_t>::const_iterator j(c->haveChunkIds.begin());j!=c->haveChunkIds.end();++j) {
+						if (*j == chunkId)
 							return 0;
 					}
 
@@ -913,12 +941,33 @@ uint64_t Network::handleConfigChunk(void *tPtr,const uint64_t packetId,const Add
 				}
 			}
 
-			// If it's not a duplicate, check chunk signature
-			const Identity controllerId(RR->topology->getIdentity(tPtr,controller()));
-			if (!controllerId) // we should always have the controller identity by now, otherwise how would we have queried it the first time?
-				return 0;
-			if (!controllerId.verify(chunk.field(start,ptr - start),ptr - start,sig,ZT_C25519_SIGNATURE_LEN))
-				return 0;
+			// If it's not a duplicate, check chunk signature (once per update for hash tree signed chunks)
+			if (chunkCount) {
+				treeSigned = true;
+				if ((c->updateId != configUpdateId)||(!c->treeVerified)||(c->treeFlags != flags)||(memcmp(c->treeRoot,treeRoot,ZT_HASHTREE_HASH_LEN) != 0)) {
+					if ((c->updateId == configUpdateId)&&(c->treeVerified))
+						return 0; // a different root or flags for an update we're already assembling can't be valid
+					const Identity controllerId(RR->topology->getIdentity(tPtr,controller()));
+					if (!controllerId)
+						return 0;
+					Buffer<64> signedRoot;
+					signedRoot.append(_id);
+					signedRoot.append((uint16_t)0xffff);
+					signedRoot.append((uint64_t)configUpdateId);
+					signedRoot.append((uint32_t)totalLength);
+					signedRoot.append((uint16_t)chunkCount);
+					signedRoot.append(flags); // so fast propagation can't be turned on by a relay
+					signedRoot.append(treeRoot,ZT_HASHTREE_HASH_LEN);
+					if (!controllerId.verify(signedRoot.data(),signedRoot.size(),sig,ZT_C25519_SIGNATURE_LEN))
+						return 0;
+				}
+			} else {
+				const Identity controllerId(RR->topology->getIdentity(tPtr,controller()));
+				if (!controllerId) // we should always have the controller identity by now, otherwise how would we have queried it the first time?
+					return 0;
+				if (!controllerId.verify(chunk.field(start,ptr - start),ptr - start,sig,ZT_C25519_SIGNATURE_LEN))
+					return 0;
+			}
 
 			// New properly verified chunks can be flooded "virally" through the network
 			if (fastPropagate) {
@@ -956,29 +1005,61 @@ uint64_t Network::handleConfigChunk(void *tPtr,const uint64_t packetId,const Add
 
 		if (c->updateId != configUpdateId) {
 			c->updateId = configUpdateId;
-			c->haveChunks = 0;
+			c->haveChunkIds.clear();
 			c->haveBytes = 0;
+			c->treeVerified = false;
+			c->data.assign(totalLength,(char)0);
+		} else if (c->data.length() != totalLength) {
+			return 0; // every chunk of an update has the same total length
+		}
+		if (treeSigned) {
+			memcpy(c->treeRoot,treeRoot,ZT_HASHTREE_HASH_LEN);
+			c->treeFlags = flags;
+			c->treeVerified = true;
 		}
-		if (c->haveChunks >= ZT_NETWORK_MAX_UPDATE_CHUNKS)
+		if (c->haveChunkIds.size() >= ZT_NETWORK_MAX_UPDATE_CHUNKS)
 			return false;
-		c->haveChunkIds[c->haveChunks++] = chunkId;
+		c->haveChunkIds.push_back(chunkId);
 
-		memcpy(c->data.unsafeData() + chunkIndex,chunkData,chunkLen);
+		if (chunkLen)
+			memcpy(&(c->data[chunkIndex]),chunkData,chunkLen);
 		c->haveBytes += chunkLen;
 
 		if (c->haveBytes == totalLength) {
-			c->data.unsafeData()[c->haveBytes] = (char)0; // ensure null terminated
+			Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *const received = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+			memcpy(received->unsafeData(),c->data.data(),c->haveBytes); // null terminated since totalLength < capacity
+			std::string().swap(c->data); // chunk IDs are kept to keep ignoring duplicates
+
+			// A delta is rebuilt into a full config against the last one we received. If
+			// we don't have what it was made against, ask the controller for a full one.
+			Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *full = received;
+			if (NetworkConfig::isDelta(*received)) {
+				full = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+				if (!NetworkConfig::applyDelta(_configDict.data(),(unsigned int)_configDict.length(),*received,*full)) {
+					delete full;
+					full = (Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *)0;
+					_configDict.clear();
+					deltaFailed = true;
+				}
+			}
 
-			nc = new NetworkConfig();
-			try {
-				if (!nc->fromDictionary(c->data)) {
+			if (full) {
+				nc = new NetworkConfig();
+				try {
+					if (nc->fromDictionary(*full)) {
+						_configDict.assign(full->data(),full->sizeBytes());
+					} else {
+						delete nc;
+						nc = (NetworkConfig *)0;
+					}
+				} catch ( ... ) {
 					delete nc;
 					nc = (NetworkConfig *)0;
 				}
-			} catch ( ... ) {
-				delete nc;
-				nc = (NetworkConfig *)0;
+				if (full != received)
+					delete full;
 			}
+			delete received;
 		}
 	}
 
@@ -987,6 +1068,8 @@ uint64_t Network::handleConfigChunk(void *tPtr,const uint64_t packetId,const Add
 		delete nc;
 		return configUpdateId;
 	} else {
+		if (deltaFailed)
+			this->requestConfiguration(tPtr);
 		return 0;
 	}
 
@@ -1188,7 +1271,12 @@ void Network::requestConfiguration(void *tPtr)
 	rmd.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_MAX_NETWORK_CAPABILITIES,(uint64_t)ZT_MAX_NETWORK_CAPABILITIES);
 	rmd.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_MAX_CAPABILITY_RULES,(uint64_t)ZT_MAX_CAPABILITY_RULES);
 	rmd.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_MAX_NETWORK_TAGS,(uint64_t)ZT_MAX_NETWORK_TAGS);
-	rmd.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_FLAGS,(uint64_t)0);
+	rmd.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_FLAGS,(uint64_t)(ZT_NETWORKCONFIG_REQUEST_FLAG_HASH_TREE_CHUNKS | ZT_NETWORKCONFIG_REQUEST_FLAG_DELTA_CONFIGS));
+	{
+		Mutex::Lock _l(_lock);
+		if (!_configDict.empty())
+			rmd.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_CONFIG_HASH,NetworkConfig::dictionaryHash(_configDict.data(),(unsigned int)_configDict.length()));
+	}
 	rmd.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_RULES_ENGINE_REV,(uint64_t)ZT_RULES_ENGINE_REVISION);
 
 	RR->t->networkConfigRequestSent(tPtr,*this,ctrl);
@@ -36,6 +36,7 @@
 #include "Multicaster.hpp"
 #include "Membership.hpp"
 #include "NetworkConfig.hpp"
+#include "HashTree.hpp"
 #include "CertificateOfMembership.hpp"
 
 #define ZT_NETWORK_MAX_INCOMING_UPDATES 3
@@ -415,17 +416,22 @@ private:
 	Hashtable< MAC,Address > _remoteBridgeRoutes; // remote addresses where given MACs are reachable (for tracking devices behind remote bridges)
 
 	NetworkConfig _config;
+	std::string _configDict; // last full config received from the controller, the base for delta configs
 	uint64_t _lastConfigUpdate;
 
+	// An update being assembled from chunks, buffered at its actual size with
+	// the buffer released once it's complete
 	struct _IncomingConfigChunk
 	{
-		_IncomingConfigChunk() { memset(this,0,sizeof(_IncomingConfigChunk)); }
+		_IncomingConfigChunk() : ts(0),updateId(0),haveBytes(0),treeVerified(false),treeFlags(0) { memset(treeRoot,0,sizeof(treeRoot)); }
 		uint64_t ts;
 		uint64_t updateId;
-		uint64_t haveChunkIds[ZT_NETWORK_MAX_UPDATE_CHUNKS];
-		unsigned long haveChunks;
+		std::vector<uint64_t> haveChunkIds;
 		unsigned long haveBytes;
-		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> data;
+		bool treeVerified; // treeRoot's signature has been checked for this update
+		uint8_t treeFlags; // chunk flags signed with treeRoot
+		uint8_t treeRoot[ZT_HASHTREE_HASH_LEN];
+		std::string data; // the update's total length once its first chunk arrives
 	};
 	_IncomingConfigChunk _incomingConfigChunks[ZT_NETWORK_MAX_INCOMING_UPDATES];
 
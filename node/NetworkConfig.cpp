@@ -16,9 +16,41 @@
 #include <algorithm>
 
 #include "NetworkConfig.hpp"
+#include "SHA512.hpp"
 
 namespace ZeroTier {
 
+// Get the next entry of a serialized dictionary, advancing p past it and its line feed
+static inline bool _nextDictionaryEntry(const char *&p,const char *const eof,const char *&entry,unsigned int &entryLen,unsigned int &keyLen)
+{
+	while ((p < eof)&&(*p == (char)10))
+		++p;
+	if (p >= eof)
+		return false;
+	entry = p;
+	const char *eq = (const char *)0;
+	while ((p < eof)&&(*p != (char)10)) {
+		if ((!eq)&&(*p == '='))
+			eq = p;
+		++p;
+	}
+	entryLen = (unsigned int)(p - entry);
+	keyLen = (eq) ? (unsigned int)(eq - entry) : entryLen;
+	return true;
+}
+
+// Find the first entry with a given key in a serialized dictionary
+static inline bool _findDictionaryEntry(const char *d,const unsigned int len,const char *key,const unsigned int keyLen,const char *&entry,unsigned int &entryLen)
+{
+	const char *p = d;
+	unsigned int kl;
+	while (_nextDictionaryEntry(p,d + len,entry,entryLen,kl)) {
+		if ((kl == keyLen)&&(!memcmp(entry,key,keyLen)))
+			return true;
+	}
+	return false;
+}
+
 bool NetworkConfig::toDictionary(Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &d,bool includeLegacy) const
 {
 	Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY> *tmp = new Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY>();
@@ -170,7 +202,7 @@ bool NetworkConfig::toDictionary(Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &d,b
 
 		if (this->ruleCount) {
 			tmp->clear();
-			Capability::serializeRules(*tmp,rules,ruleCount);
+			Capability::serializeRules(*tmp,rules.data(),ruleCount);
 			if (tmp->size()) {
 				if (!d.add(ZT_NETWORKCONFIG_DICT_KEY_RULES,*tmp)) return false;
 			}
@@ -185,9 +217,24 @@ bool NetworkConfig::toDictionary(Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &d,b
 	return true;
 }
 
-bool NetworkConfig::fromDictionary(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &d)
+bool NetworkConfig::operator==(const NetworkConfig &nc) const
+{
+	return ((networkId == nc.networkId)&&(timestamp == nc.timestamp)&&(credentialTimeMaxDelta == nc.credentialTimeMaxDelta)&&(revision == nc.revision)&&
+	        (issuedTo == nc.issuedTo)&&(remoteTraceTarget == nc.remoteTraceTarget)&&(flags == nc.flags)&&(remoteTraceLevel == nc.remoteTraceLevel)&&
+	        (mtu == nc.mtu)&&(multicastLimit == nc.multicastLimit)&&(type == nc.type)&&(strcmp(name,nc.name) == 0)&&(com == nc.com)&&
+	        (specialistCount == nc.specialistCount)&&((!specialistCount)||(memcmp(specialists,nc.specialists,sizeof(uint64_t) * specialistCount) == 0))&&
+	        (routeCount == nc.routeCount)&&(routes.equals(nc.routes,routeCount))&&
+	        (staticIpCount == nc.staticIpCount)&&((!staticIpCount)||(memcmp(staticIps,nc.staticIps,sizeof(InetAddress) * staticIpCount) == 0))&&
+	        (ruleCount == nc.ruleCount)&&(rules.equals(nc.rules,ruleCount))&&
+	        (capabilityCount == nc.capabilityCount)&&(capabilities.equals(nc.capabilities,capabilityCount))&&
+	        (tagCount == nc.tagCount)&&(tags.equals(nc.tags,tagCount))&&
+	        (certificateOfOwnershipCount == nc.certificateOfOwnershipCount)&&(certificatesOfOwnership.equals(nc.certificatesOfOwnership,certificateOfOwnershipCount)));
+}
+
+bool NetworkConfig::fromDictionary(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &dict)
 {
 	static const NetworkConfig NIL_NC;
+	const DictionaryIndex d(dict); // tokenize once instead of scanning the whole dictionary for every key
 	Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY> *tmp = new Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY>();
 
 	try {
@@ -289,25 +336,25 @@ bool NetworkConfig::fromDictionary(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACI
 			if (d.get(ZT_NETWORKCONFIG_DICT_KEY_CAPABILITIES,*tmp)) {
 				try {
 					unsigned int p = 0;
-					while (p < tmp->size()) {
+					while ((p < tmp->size())&&(this->capabilityCount < ZT_MAX_NETWORK_CAPABILITIES)) {
 						Capability cap;
 						p += cap.deserialize(*tmp,p);
 						this->capabilities[this->capabilityCount++] = cap;
 					}
 				} catch ( ... ) {}
-				std::sort(&(this->capabilities[0]),&(this->capabilities[this->capabilityCount]));
+				std::sort(this->capabilities.data(),this->capabilities.data() + this->capabilityCount);
 			}
 
 			if (d.get(ZT_NETWORKCONFIG_DICT_KEY_TAGS,*tmp)) {
 				try {
 					unsigned int p = 0;
-					while (p < tmp->size()) {
+					while ((p < tmp->size())&&(this->tagCount < ZT_MAX_NETWORK_TAGS)) {
 						Tag tag;
 						p += tag.deserialize(*tmp,p);
 						this->tags[this->tagCount++] = tag;
 					}
 				} catch ( ... ) {}
-				std::sort(&(this->tags[0]),&(this->tags[this->tagCount]));
+				std::sort(this->tags.data(),this->tags.data() + this->tagCount);
 			}
 
 			if (d.get(ZT_NETWORKCONFIG_DICT_KEY_CERTIFICATES_OF_OWNERSHIP,*tmp)) {
@@ -352,11 +399,13 @@ bool NetworkConfig::fromDictionary(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACI
 			if (d.get(ZT_NETWORKCONFIG_DICT_KEY_RULES,*tmp)) {
 				this->ruleCount = 0;
 				unsigned int p = 0;
-				Capability::deserializeRules(*tmp,p,this->rules,this->ruleCount,ZT_MAX_NETWORK_RULES);
+				this->rules.resize(ZT_MAX_NETWORK_RULES);
+				Capability::deserializeRules(*tmp,p,this->rules.data(),this->ruleCount,ZT_MAX_NETWORK_RULES);
+				this->rules.assign(this->rules.data(),this->ruleCount);
 			}
 		}
 
-		//printf("~~~\n%s\n~~~\n",d.data());
+		//printf("~~~\n%s\n~~~\n",dict.data());
 		//dump();
 		//printf("~~~\n");
 
@@ -368,4 +417,164 @@ bool NetworkConfig::fromDictionary(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACI
 	}
 }
 
+uint64_t NetworkConfig::dictionaryHash(const char *d,const unsigned int len)
+{
+	uint8_t h[64];
+	SHA512::hash(h,d,len);
+	uint64_t r = 0;
+	for(unsigned int i=0;i<8;++i)
+		r = (r << 8) | (uint64_t)h[i];
+	return r;
+}
+
+bool NetworkConfig::dictionaryEntryHashes(const char *d,const unsigned int len,std::vector<DictionaryEntryHash> &entries)
+{
+	entries.clear();
+	const char *p = d;
+	const char *entry;
+	unsigned int entryLen,keyLen;
+	while (_nextDictionaryEntry(p,d + len,entry,entryLen,keyLen)) {
+		if (keyLen >= sizeof(DictionaryEntryHash::key))
+			return false;
+		entries.push_back(DictionaryEntryHash());
+		memcpy(entries.back().key,entry,keyLen);
+		entries.back().key[keyLen] = (char)0;
+		entries.back().hash = dictionaryHash(entry,entryLen);
+	}
+	return true;
+}
+
+bool NetworkConfig::encodeDelta(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &full,const uint64_t baseHash,const std::vector<DictionaryEntryHash> &baseEntries,const char *known,const unsigned int knownLen,Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &delta)
+{
+	const char *const fd = full.data();
+	const unsigned int flen = full.sizeBytes();
+	const char *p,*entry,*e2;
+	unsigned int entryLen,keyLen,e2Len;
+
+	// Keys must be unique and fit in the key list for the recipient to put entries back in order
+	char keys[1024];
+	unsigned int kl = 0;
+	p = fd;
+	while (_nextDictionaryEntry(p,fd + flen,entry,entryLen,keyLen)) {
+		if ((!keyLen)||(keyLen >= sizeof(DictionaryEntryHash::key))||((kl + keyLen + 1) >= sizeof(keys))||(memchr(entry,',',keyLen)))
+			return false;
+		if (_findDictionaryEntry(fd,(unsigned int)(entry - fd),entry,keyLen,e2,e2Len))
+			return false;
+		if (kl)
+			keys[kl++] = ',';
+		memcpy(keys + kl,entry,keyLen);
+		kl += keyLen;
+	}
+	keys[kl] = (char)0;
+
+	delta.clear();
+	if (!delta.add(ZT_NETWORKCONFIG_DICT_KEY_DELTA_BASE,baseHash)) return false;
+	if (!delta.add(ZT_NETWORKCONFIG_DICT_KEY_DELTA_HASH,dictionaryHash(fd,flen))) return false;
+	if (!delta.add(ZT_NETWORKCONFIG_DICT_KEY_DELTA_KEYS,keys)) return false;
+
+	std::vector<char> patch;
+	p = fd;
+	while (_nextDictionaryEntry(p,fd + flen,entry,entryLen,keyLen)) {
+		const DictionaryEntryHash *base = (const DictionaryEntryHash *)0;
+		for(std::vector<DictionaryEntryHash>::const_iterator b(baseEntries.begin());b!=baseEntries.end();++b) {
+			if ((!strncmp(b->key,entry,keyLen))&&(!b->key[keyLen])) {
+				base = &(*b);
+				break;
+			}
+		}
+		if ((base)&&(base->hash == dictionaryHash(entry,entryLen)))
+			continue;
+
+		// If we know the recipient's version of this entry, send only the bytes between what's in common
+		if ((base)&&(known)&&(_findDictionaryEntry(known,knownLen,entry,keyLen,e2,e2Len))&&(base->hash == dictionaryHash(e2,e2Len))) {
+			unsigned int prefix = 0,suffix = 0;
+			const unsigned int common = std::min(entryLen,e2Len);
+			while ((prefix < common)&&(entry[prefix] == e2[prefix]))
+				++prefix;
+			while (((prefix + suffix) < common)&&(entry[entryLen - (suffix + 1)] == e2[e2Len - (suffix + 1)]))
+				++suffix;
+			const unsigned int middle = entryLen - (prefix + suffix);
+			if ((8 + middle) < entryLen) {
+				patch.resize(8 + middle);
+				for(unsigned int i=0;i<4;++i) {
+					patch[i] = (char)((prefix >> (24 - (i * 8))) & 0xff);
+					patch[4 + i] = (char)((suffix >> (24 - (i * 8))) & 0xff);
+				}
+				if (middle)
+					memcpy(patch.data() + 8,entry + prefix,middle);
+				char pk[sizeof(DictionaryEntryHash::key) + 1];
+				memcpy(pk,ZT_NETWORKCONFIG_DICT_KEY_DELTA_PATCH_PREFIX,1);
+				memcpy(pk + 1,entry,keyLen);
+				pk[keyLen + 1] = (char)0;
+				if (!delta.add(pk,patch.data(),(int)patch.size()))
+					return false;
+				continue;
+			}
+		}
+
+		if (!delta.addEncoded(entry,entryLen))
+			return false;
+	}
+
+	return (delta.sizeBytes() < flen);
+}
+
+bool NetworkConfig::applyDelta(const char *base,const unsigned int baseLen,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &delta,Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &full)
+{
+	if (dictionaryHash(base,baseLen) != delta.getUI(ZT_NETWORKCONFIG_DICT_KEY_DELTA_BASE,0))
+		return false;
+	char keys[1024];
+	if (delta.get(ZT_NETWORKCONFIG_DICT_KEY_DELTA_KEYS,keys,sizeof(keys)) <= 0)
+		return false;
+
+	const char *const dd = delta.data();
+	const unsigned int dlen = delta.sizeBytes();
+	const char *entry;
+	unsigned int entryLen;
+	std::vector<char> patch,patched;
+	full.clear();
+	for(const char *k=keys;*k;) {
+		const char *ke = k;
+		while ((*ke)&&(*ke != ','))
+			++ke;
+		const unsigned int keyLen = (unsigned int)(ke - k);
+		if ((!keyLen)||(keyLen >= sizeof(DictionaryEntryHash::key)))
+			return false;
+
+		if (!_findDictionaryEntry(dd,dlen,k,keyLen,entry,entryLen)) {
+			if (!_findDictionaryEntry(base,baseLen,k,keyLen,entry,entryLen))
+				return false;
+
+			char pk[sizeof(DictionaryEntryHash::key) + 1];
+			memcpy(pk,ZT_NETWORKCONFIG_DICT_KEY_DELTA_PATCH_PREFIX,1);
+			memcpy(pk + 1,k,keyLen);
+			pk[keyLen + 1] = (char)0;
+			if (delta.contains(pk)) {
+				patch.resize(dlen + 1);
+				const int pl = delta.get(pk,patch.data(),(unsigned int)patch.size());
+				if (pl < 8)
+					return false;
+				unsigned int prefix = 0,suffix = 0;
+				for(unsigned int i=0;i<4;++i) {
+					prefix = (prefix << 8) | (unsigned int)((uint8_t)patch[i]);
+					suffix = (suffix << 8) | (unsigned int)((uint8_t)patch[4 + i]);
+				}
+				if ((prefix > entryLen)||(suffix > (entryLen - prefix))) // not (prefix + suffix), which can wrap
+					return false;
+				patched.assign(entry,entry + prefix);
+				patched.insert(patched.end(),patch.data() + 8,patch.data() + pl);
+				patched.insert(patched.end(),entry + (entryLen - suffix),entry + entryLen);
+				entry = patched.data();
+				entryLen = (unsigned int)patched.size();
+			}
+		}
+
+		if (!full.addEncoded(entry,entryLen))
+			return false;
+		k = (*ke) ? (ke + 1) : ke;
+	}
+
+	return (dictionaryHash(full.data(),full.sizeBytes()) == delta.getUI(ZT_NETWORKCONFIG_DICT_KEY_DELTA_HASH,0));
+}
+
 } // namespace ZeroTier
@@ -129,6 +129,13 @@ namespace ZeroTier {
 #define ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_AUTH "a"
 // Network configuration meta-data flags
 #define ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_FLAGS "f"
+// Hash of the last full config received, if any (see NetworkConfig::dictionaryHash())
+#define ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_CONFIG_HASH "ch"
+
+// Request flag: node accepts multi-chunk configs signed once over a hash tree (see Packet.hpp)
+#define ZT_NETWORKCONFIG_REQUEST_FLAG_HASH_TREE_CHUNKS 0x0000000000000001ULL
+// Request flag: node can apply configs sent as a delta against the last full config it received
+#define ZT_NETWORKCONFIG_REQUEST_FLAG_DELTA_CONFIGS 0x0000000000000002ULL
 
 // These dictionary keys are short so they don't take up much room.
 // By convention we use upper case for binary blobs, but it doesn't really matter.
@@ -176,6 +183,17 @@ namespace ZeroTier {
 // tags (binary blobs)
 #define ZT_NETWORKCONFIG_DICT_KEY_CERTIFICATES_OF_OWNERSHIP "COO"
 
+// Delta config fields -- a delta holds these followed by only the entries that changed
+
+// hash of the full config this delta applies to
+#define ZT_NETWORKCONFIG_DICT_KEY_DELTA_BASE "db"
+// hash of the full config this delta produces
+#define ZT_NETWORKCONFIG_DICT_KEY_DELTA_HASH "dh"
+// key[,key,...] of all entries of the full config, in order
+#define ZT_NETWORKCONFIG_DICT_KEY_DELTA_KEYS "dk"
+// <[4] prefix length><[4] suffix length><[...] middle>, replacing the entry named by the rest of the key
+#define ZT_NETWORKCONFIG_DICT_KEY_DELTA_PATCH_PREFIX "~"
+
 // Legacy fields -- these are obsoleted but are included when older clients query
 
 // boolean (now a flag)
@@ -199,11 +217,124 @@ namespace ZeroTier {
 
 // End legacy fields
 
+/**
+ * Array of up to C network config entries that allocates only what is used
+ *
+ * Writing to an entry at or past the end through a non-const array grows it
+ * to include that entry, so configs are filled in as they were with fixed
+ * size arrays (e.g. rules[ruleCount++] = r). Reads through a const array
+ * past size() throw. Copies allocate exactly size() entries, so assigning
+ * to an array can free the entries a reader is looking at.
+ *
+ * @tparam T Entry type
+ * @tparam C Maximum entries (growth is not limited to this, callers check it)
+ */
+template<typename T,unsigned int C>
+class NetworkConfigArray
+{
+public:
+	NetworkConfigArray() : _p((T *)0),_size(0),_capacity(0) {}
+	NetworkConfigArray(const NetworkConfigArray &a) : _p((T *)0),_size(0),_capacity(0) { *this = a; }
+	~NetworkConfigArray() { delete [] _p; }
+
+	inline NetworkConfigArray &operator=(const NetworkConfigArray &a)
+	{
+		if (&a != this)
+			assign(a._p,a._size);
+		return *this;
+	}
+
+	inline T &operator[](const unsigned int i)
+	{
+		if (i >= _size)
+			resize(i + 1);
+		return _p[i];
+	}
+	inline const T &operator[](const unsigned int i) const
+	{
+		if (unlikely(i >= _size))
+			throw ZT_EXCEPTION_OUT_OF_BOUNDS;
+		return _p[i];
+	}
+
+	inline T *data() { return _p; }
+	inline const T *data() const { return _p; }
+	inline unsigned int size() const { return _size; }
+
+	/**
+	 * Replace contents with a copy of n entries, allocating exactly n
+	 *
+	 * @param p Entries (may be this array's own, e.g. to release unused room)
+	 * @param n Number of entries
+	 */
+	inline void assign(const T *p,const unsigned int n)
+	{
+		if (_capacity != n) {
+			T *const np = (n) ? new T[n] : (T *)0; // p may point into this array
+			for(unsigned int i=0;i<n;++i)
+				np[i] = p[i];
+			delete [] _p;
+			_p = np;
+			_capacity = n;
+		} else if (p != _p) {
+			for(unsigned int i=0;i<n;++i)
+				_p[i] = p[i];
+		}
+		_size = n;
+	}
+
+	/**
+	 * Set size, allocating more room if needed (new entries are value-initialized)
+	 *
+	 * @param n New size
+	 */
+	inline void resize(const unsigned int n)
+	{
+		if (n > _capacity) {
+			unsigned int c = (_capacity) ? (_capacity * 2) : 4;
+			if (c > C)
+				c = C;
+			if (c < n)
+				c = n;
+			T *const p = new T[c]();
+			for(unsigned int i=0;i<_size;++i)
+				p[i] = _p[i];
+			delete [] _p;
+			_p = p;
+			_capacity = c;
+		}
+		_size = n;
+	}
+
+	/**
+	 * Compare the first n entries byte for byte, as fixed size arrays were
+	 *
+	 * @param a Other array
+	 * @param n Entries to compare (must not exceed either size())
+	 * @return True if equal
+	 */
+	inline bool equals(const NetworkConfigArray &a,const unsigned int n) const { return ((!n)||(memcmp(_p,a._p,sizeof(T) * n) == 0)); }
+
+	/**
+	 * @return Bytes allocated for entries
+	 */
+	inline unsigned long memoryUsage() const { return (unsigned long)(sizeof(T) * _capacity); }
+
+private:
+	T *_p;
+	unsigned int _size;
+	unsigned int _capacity;
+};
+
 /**
  * Network configuration received from network controller nodes
  *
- * This is a memcpy()'able structure and is safe (in a crash sense) to modify
- * without locks.
+ * Rules, routes, and credentials are held in NetworkConfigArray, so a config
+ * takes only as much memory as they need and copies cost the same. Those
+ * arrays are reallocated when a config is assigned, so they must only be
+ * read under the owning Network's lock. Specialists and static IPs are small
+ * and are read without that lock (e.g. by Switch and Node), so they stay
+ * fixed size arrays.
  */
 class NetworkConfig
 {
@@ -248,6 +379,69 @@ public:
 	 */
 	bool fromDictionary(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &d);
 
+	/**
+	 * Key and hash of one entry in a serialized config
+	 */
+	struct DictionaryEntryHash
+	{
+		char key[16];
+		uint64_t hash;
+	};
+
+	/**
+	 * Hash a serialized config to identify it as the base for delta configs
+	 *
+	 * @param d Serialized dictionary
+	 * @param len Length of d in bytes
+	 * @return First 64 bits of SHA-512 of d
+	 */
+	static uint64_t dictionaryHash(const char *d,const unsigned int len);
+
+	/**
+	 * Get the key and hash of each entry in a serialized config, in order
+	 *
+	 * @param d Serialized dictionary
+	 * @param len Length of d in bytes
+	 * @param entries Vector to fill (any existing contents are replaced)
+	 * @return False if an entry's key is too long to be referenced by a delta
+	 */
+	static bool dictionaryEntryHashes(const char *d,const unsigned int len,std::vector<DictionaryEntryHash> &entries);
+
+	/**
+	 * Encode a full config as a delta against a config the recipient already has
+	 *
+	 * The delta lists the full config's keys and carries only the entries
+	 * whose key or value differs from the base. If the caller knows the bytes
+	 * of some of the recipient's entries (e.g. the previous revision's rules),
+	 * changed entries that have a known base are sent as a patch against it.
+	 *
+	 * @param full Full config
+	 * @param baseHash dictionaryHash() of the recipient's config
+	 * @param baseEntries dictionaryEntryHashes() of the recipient's config
+	 * @param known Serialized entries the recipient may have, or NULL if none
+	 * @param knownLen Length of known in bytes
+	 * @param delta Dictionary to fill
+	 * @return True if the delta was encoded and is smaller than the full config
+	 */
+	static bool encodeDelta(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &full,const uint64_t baseHash,const std::vector<DictionaryEntryHash> &baseEntries,const char *known,const unsigned int knownLen,Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &delta);
+
+	/**
+	 * @param d Dictionary
+	 * @return True if d is a delta config made by encodeDelta()
+	 */
+	static inline bool isDelta(const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &d) { return d.contains(ZT_NETWORKCONFIG_DICT_KEY_DELTA_BASE); }
+
+	/**
+	 * Rebuild a full config from a delta and the config it was made against
+	 *
+	 * @param base Serialized config the recipient has
+	 * @param baseLen Length of base in bytes
+	 * @param delta Delta config
+	 * @param full Dictionary to fill with the full config
+	 * @return False if base isn't the delta's base or the result doesn't match the delta's hash
+	 */
+	static bool applyDelta(const char *base,const unsigned int baseLen,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &delta,Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &full);
+
 	/**
 	 * @return True if broadcast (ff:ff:ff:ff:ff:ff) address should work on this network
 	 */
@@ -398,9 +592,17 @@ public:
 	}
 
 	inline operator bool() const { return (networkId != 0); }
-	inline bool operator==(const NetworkConfig &nc) const { return (memcmp(this,&nc,sizeof(NetworkConfig)) == 0); }
+	bool operator==(const NetworkConfig &nc) const;
 	inline bool operator!=(const NetworkConfig &nc) const { return (!(*this == nc)); }
 
+	/**
+	 * @return Bytes used by this config, including what its arrays allocate
+	 */
+	inline unsigned long memoryUsage() const
+	{
+		return (unsigned long)sizeof(NetworkConfig) + routes.memoryUsage() + rules.memoryUsage() + capabilities.memoryUsage() + tags.memoryUsage() + certificatesOfOwnership.memoryUsage();
+	}
+
 	/**
 	 * Add a specialist or mask flags if already present
 	 *
@@ -541,7 +743,7 @@ public:
 	/**
 	 * Statically defined "pushed" routes (including default gateways)
 	 */
-	ZT_VirtualNetworkRoute routes[ZT_MAX_NETWORK_ROUTES];
+	NetworkConfigArray<ZT_VirtualNetworkRoute,ZT_MAX_NETWORK_ROUTES> routes;
 
 	/**
 	 * Static IP assignments
@@ -551,22 +753,22 @@ public:
 	/**
 	 * Base network rules
 	 */
-	ZT_VirtualNetworkRule rules[ZT_MAX_NETWORK_RULES];
+	NetworkConfigArray<ZT_VirtualNetworkRule,ZT_MAX_NETWORK_RULES> rules;
 
 	/**
 	 * Capabilities for this node on this network, in ascending order of capability ID
 	 */
-	Capability capabilities[ZT_MAX_NETWORK_CAPABILITIES];
+	NetworkConfigArray<Capability,ZT_MAX_NETWORK_CAPABILITIES> capabilities;
 
 	/**
 	 * Tags for this node on this network, in ascending order of tag ID
 	 */
-	Tag tags[ZT_MAX_NETWORK_TAGS];
+	NetworkConfigArray<Tag,ZT_MAX_NETWORK_TAGS> tags;
 
 	/**
 	 * Certificates of ownership for this network member
 	 */
-	CertificateOfOwnership certificatesOfOwnership[ZT_MAX_CERTIFICATES_OF_OWNERSHIP];
+	NetworkConfigArray<CertificateOfOwnership,ZT_MAX_CERTIFICATES_OF_OWNERSHIP> certificatesOfOwnership;
 
 	/**
 	 * Network type (currently just public or private)
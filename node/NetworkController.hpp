@@ -55,8 +55,23 @@ public:
 		 * @param destination Destination peer Address
 		 * @param nc Network configuration to send
 		 * @param sendLegacyFormatConfig If true, send an old-format network config
+		 * @param hashTreeChunks If true, sign multi-chunk configs once over a hash tree (recipient must support it)
 		 */
-		virtual void ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig) = 0;
+		virtual void ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig,bool hashTreeChunks) = 0;
+
+		/**
+		 * Send an already serialized configuration to a remote peer
+		 *
+		 * This lets controllers build parts of the config dictionary ahead of
+		 * time. It can't be used to send a config to ourselves.
+		 *
+		 * @param nwid Network ID
+		 * @param requestPacketId Request packet ID to send OK(NETWORK_CONFIG_REQUEST) or 0 to send NETWORK_CONFIG (push)
+		 * @param destination Destination peer Address
+		 * @param dconf Network configuration in dictionary form
+		 * @param hashTreeChunks If true, sign multi-chunk configs once over a hash tree (recipient must support it)
+		 */
+		virtual void ncSendConfigDictionary(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &dconf,bool hashTreeChunks) = 0;
 
 		/**
 		 * Send revocation to a node
@@ -34,6 +34,7 @@
 #include "SelfAwareness.hpp"
 #include "Network.hpp"
 #include "Trace.hpp"
+#include "HashTree.hpp"
 
 namespace ZeroTier {
 
@@ -354,6 +355,7 @@ ZT_ResultCode Node::processBackgroundTasks(void *tptr,int64_t now,volatile int64
 	}
 
 	try {
+		RR->t->flush(tptr);
 		*nextBackgroundTaskDeadline = now + (int64_t)std::max(std::min(timeUntilNextPingCheck,RR->sw->doTimerTasks(tptr,now)),(unsigned long)ZT_CORE_TIMER_TASK_GRANULARITY);
 	} catch ( ... ) {
 		return ZT_RESULT_FATAL_ERROR_INTERNAL;
@@ -475,6 +477,9 @@ ZT_PeerList *Node::peers() const
 		if (p->latency >= 0xffff)
 			p->latency = -1;
 		p->role = RR->topology->role(pi->second->identity().address());
+		p->compressionHits = pi->second->compression().hits();
+		p->compressionMisses = pi->second->compression().misses();
+		p->compressionSkipped = pi->second->compression().skipped();
 
 		std::vector< SharedPtr<Path> > paths(pi->second->paths(_now));
 		SharedPtr<Path> bestp(pi->second->getAppropriatePath(_now,false));
@@ -537,6 +542,76 @@ ZT_VirtualNetworkList *Node::networks() const
 	return nl;
 }
 
+ZT_MulticastReplicationStatsList *Node::multicastReplicationStats(uint64_t nwid) const
+{
+	std::vector<ZT_MulticastReplicationStats> st;
+	RR->mc->replicationStats(nwid,st);
+
+	char *buf = (char *)::malloc(sizeof(ZT_MulticastReplicationStatsList) + (sizeof(ZT_MulticastReplicationStats) * st.size()));
+	if (!buf)
+		return (ZT_MulticastReplicationStatsList *)0;
+	ZT_MulticastReplicationStatsList *sl = (ZT_MulticastReplicationStatsList *)buf;
+	sl->groups = (ZT_MulticastReplicationStats *)(buf + sizeof(ZT_MulticastReplicationStatsList));
+
+	sl->groupCount = 0;
+	for(std::vector<ZT_MulticastReplicationStats>::const_iterator i(st.begin());i!=st.end();++i)
+		sl->groups[sl->groupCount++] = *i;
+
+	return sl;
+}
+
+void Node::setLocalTraceLevel(int level)
+{
+	RR->t->setLocalLevel(level);
+}
+
+ZT_TraceEventList *Node::traceEvents(uint64_t since) const
+{
+	std::vector< std::pair< uint64_t,Trace::Record > > events;
+	uint64_t counters[4];
+	RR->t->localEvents(since,events,counters);
+
+	// Encode first so the list, events, and their text can be one allocation
+	Dictionary<ZT_TRACE_MAX_RECORD_SIZE> d;
+	std::string text;
+	std::vector<unsigned int> lengths;
+	lengths.reserve(events.size());
+	for(std::vector< std::pair< uint64_t,Trace::Record > >::const_iterator e(events.begin());e!=events.end();++e) {
+		if (!e->second.toDictionary(d))
+			d.clear();
+		lengths.push_back(d.sizeBytes());
+		text.append(d.data(),d.sizeBytes() + 1);
+	}
+
+	char *buf = (char *)::malloc(sizeof(ZT_TraceEventList) + (sizeof(ZT_TraceEvent) * events.size()) + text.length());
+	if (!buf)
+		return (ZT_TraceEventList *)0;
+	ZT_TraceEventList *el = (ZT_TraceEventList *)buf;
+	el->events = (ZT_TraceEvent *)(buf + sizeof(ZT_TraceEventList));
+	char *const data = buf + sizeof(ZT_TraceEventList) + (sizeof(ZT_TraceEvent) * events.size());
+	if (text.length() > 0)
+		memcpy(data,text.data(),text.length());
+
+	el->eventCount = 0;
+	unsigned long ptr = 0;
+	for(std::vector< std::pair< uint64_t,Trace::Record > >::const_iterator e(events.begin());e!=events.end();++e) {
+		ZT_TraceEvent &te = el->events[el->eventCount];
+		te.sequence = e->first;
+		te.timestamp = e->second.timestamp;
+		te.event = e->second.event;
+		te.data = data + ptr;
+		te.len = lengths[el->eventCount];
+		ptr += te.len + 1;
+		++el->eventCount;
+	}
+	el->recorded = counters[0];
+	el->dropped = counters[1];
+	el->remoteRecords = counters[2];
+	el->remotePackets = counters[3];
+
+	return el;
+}
+
 void Node::freeQueryResult(void *qr)
 {
 	if (qr)
@@ -641,58 +716,129 @@ std::vector<World> Node::moons() const
 	return RR->topology->moons();
 }
 
-void Node::ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig)
+void Node::ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig,bool hashTreeChunks)
 {
-	_localControllerAuthorizations_m.lock();
-	_localControllerAuthorizations[_LocalControllerAuth(nwid,destination)] = now();
-	_localControllerAuthorizations_m.unlock();
-
 	if (destination == RR->identity.address()) {
+		_localControllerAuthorizations_m.lock();
+		_localControllerAuthorizations[_LocalControllerAuth(nwid,destination)] = now();
+		_localControllerAuthorizations_m.unlock();
+
 		SharedPtr<Network> n(network(nwid));
 		if (!n) return;
 		n->setConfiguration((void *)0,nc,true);
 	} else {
 		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *dconf = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
 		try {
-			if (nc.toDictionary(*dconf,sendLegacyFormatConfig)) {
-				uint64_t configUpdateId = prng();
-				if (!configUpdateId) ++configUpdateId;
-
-				const unsigned int totalSize = dconf->sizeBytes();
-				unsigned int chunkIndex = 0;
-				while (chunkIndex < totalSize) {
-					const unsigned int chunkLen = std::min(totalSize - chunkIndex,(unsigned int)(ZT_PROTO_MAX_PACKET_LENGTH - (ZT_PACKET_IDX_PAYLOAD + 256)));
-					Packet outp(destination,RR->identity.address(),(requestPacketId) ? Packet::VERB_OK : Packet::VERB_NETWORK_CONFIG);
-					if (requestPacketId) {
-						outp.append((unsigned char)Packet::VERB_NETWORK_CONFIG_REQUEST);
-						outp.append(requestPacketId);
-					}
+			if (nc.toDictionary(*dconf,sendLegacyFormatConfig))
+				ncSendConfigDictionary(nwid,requestPacketId,destination,*dconf,hashTreeChunks);
+			delete dconf;
+		} catch ( ... ) {
+			delete dconf;
+			throw;
+		}
+	}
+}
 
-					const unsigned int sigStart = outp.size();
-					outp.append(nwid);
-					outp.append((uint16_t)chunkLen);
-					outp.append((const void *)(dconf->data() + chunkIndex),chunkLen);
+void Node::ncSendConfigDictionary(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &dconf,bool hashTreeChunks)
+{
+	_localControllerAuthorizations_m.lock();
+	_localControllerAuthorizations[_LocalControllerAuth(nwid,destination)] = now();
+	_localControllerAuthorizations_m.unlock();
 
-					outp.append((uint8_t)0); // no flags
-					outp.append((uint64_t)configUpdateId);
-					outp.append((uint32_t)totalSize);
-					outp.append((uint32_t)chunkIndex);
+	if (destination == RR->identity.address())
+		return;
 
-					C25519::Signature sig(RR->identity.sign(reinterpret_cast<const uint8_t *>(outp.data()) + sigStart,outp.size() - sigStart));
-					outp.append((uint8_t)1);
-					outp.append((uint16_t)ZT_C25519_SIGNATURE_LEN);
-					outp.append(sig.data,ZT_C25519_SIGNATURE_LEN);
+	uint64_t configUpdateId = prng();
+	if (!configUpdateId) ++configUpdateId;
 
-					outp.compress();
-					RR->sw->send((void *)0,outp,true);
-					chunkIndex += chunkLen;
-				}
+	const unsigned int totalSize = dconf.sizeBytes();
+	const unsigned int maxChunkLen = ZT_PROTO_MAX_PACKET_LENGTH - (ZT_PACKET_IDX_PAYLOAD + 256);
+
+	if ((hashTreeChunks)&&(totalSize > maxChunkLen)) {
+		// Sign once over a hash tree of all chunks instead of once per chunk. Chunks
+		// are a bit smaller to leave room for their proofs.
+		const unsigned int treeChunkLen = maxChunkLen - (5 + (ZT_HASHTREE_HASH_LEN * 8));
+		const unsigned int chunkCount = (totalSize + (treeChunkLen - 1)) / treeChunkLen;
+		std::vector<uint8_t> leaves(chunkCount * ZT_HASHTREE_HASH_LEN);
+		for(unsigned int c=0;c<chunkCount;++c) {
+			const unsigned int chunkIndex = c * treeChunkLen;
+			HashTree::leaf(leaves.data() + (c * ZT_HASHTREE_HASH_LEN),chunkIndex,dconf.data() + chunkIndex,std::min(totalSize - chunkIndex,treeChunkLen));
+		}
+
+		// Chunk flags are signed too, so a relay can't turn on fast propagation
+		const uint8_t chunkFlags = 0x02; // signed over hash tree
+		Buffer<64> signedRoot;
+		signedRoot.append(nwid);
+		signedRoot.append((uint16_t)0xffff);
+		signedRoot.append((uint64_t)configUpdateId);
+		signedRoot.append((uint32_t)totalSize);
+		signedRoot.append((uint16_t)chunkCount);
+		signedRoot.append(chunkFlags);
+		const HashTree tree(leaves.data(),chunkCount);
+		signedRoot.append(tree.root(),ZT_HASHTREE_HASH_LEN);
+		const C25519::Signature sig(RR->identity.sign(signedRoot.data(),signedRoot.size()));
+
+		uint8_t proof[ZT_HASHTREE_HASH_LEN * ZT_HASHTREE_MAX_DEPTH];
+		for(unsigned int c=0;c<chunkCount;++c) {
+			const unsigned int chunkIndex = c * treeChunkLen;
+			const unsigned int chunkLen = std::min(totalSize - chunkIndex,treeChunkLen);
+			Packet outp(destination,RR->identity.address(),(requestPacketId) ? Packet::VERB_OK : Packet::VERB_NETWORK_CONFIG);
+			if (requestPacketId) {
+				outp.append((unsigned char)Packet::VERB_NETWORK_CONFIG_REQUEST);
+				outp.append(requestPacketId);
 			}
-			delete dconf;
-		} catch ( ... ) {
-			delete dconf;
-			throw;
+
+			outp.append(nwid);
+			outp.append((uint16_t)chunkLen);
+			outp.append((const void *)(dconf.data() + chunkIndex),chunkLen);
+
+			outp.append(chunkFlags);
+			outp.append((uint64_t)configUpdateId);
+			outp.append((uint32_t)totalSize);
+			outp.append((uint32_t)chunkIndex);
+			outp.append((uint16_t)c);
+			outp.append((uint16_t)chunkCount);
+			const unsigned int proofLen = tree.proof(proof,c);
+			outp.append((uint8_t)proofLen);
+			outp.append(proof,proofLen * ZT_HASHTREE_HASH_LEN);
+
+			outp.append((uint8_t)2);
+			outp.append((uint16_t)ZT_C25519_SIGNATURE_LEN);
+			outp.append(sig.data,ZT_C25519_SIGNATURE_LEN);
+
+			outp.compress();
+			RR->sw->send((void *)0,outp,true);
 		}
+		return;
+	}
+
+	unsigned int chunkIndex = 0;
+	while (chunkIndex < totalSize) {
+		const unsigned int chunkLen = std::min(totalSize - chunkIndex,maxChunkLen);
+		Packet outp(destination,RR->identity.address(),(requestPacketId) ? Packet::VERB_OK : Packet::VERB_NETWORK_CONFIG);
+		if (requestPacketId) {
+			outp.append((unsigned char)Packet::VERB_NETWORK_CONFIG_REQUEST);
+			outp.append(requestPacketId);
+		}
+
+		const unsigned int sigStart = outp.size();
+		outp.append(nwid);
+		outp.append((uint16_t)chunkLen);
+		outp.append((const void *)(dconf.data() + chunkIndex),chunkLen);
+
+		outp.append((uint8_t)0); // no flags
+		outp.append((uint64_t)configUpdateId);
+		outp.append((uint32_t)totalSize);
+		outp.append((uint32_t)chunkIndex);
+
+		C25519::Signature sig(RR->identity.sign(reinterpret_cast<const uint8_t *>(outp.data()) + sigStart,outp.size() - sigStart));
+		outp.append((uint8_t)1);
+		outp.append((uint16_t)ZT_C25519_SIGNATURE_LEN);
+		outp.append(sig.data,ZT_C25519_SIGNATURE_LEN);
+
+		outp.compress();
+		RR->sw->send((void *)0,outp,true);
+		chunkIndex += chunkLen;
 	}
 }
 
@@ -932,6 +1078,31 @@ ZT_VirtualNetworkList *ZT_Node_networks(ZT_Node *node)
 	}
 }
 
+ZT_MulticastReplicationStatsList *ZT_Node_multicastReplicationStats(ZT_Node *node,uint64_t nwid)
+{
+	try {
+		return reinterpret_cast<ZeroTier::Node *>(node)->multicastReplicationStats(nwid);
+	} catch ( ... ) {
+		return (ZT_MulticastReplicationStatsList *)0;
+	}
+}
+
+void ZT_Node_setLocalTraceLevel(ZT_Node *node,int level)
+{
+	try {
+		reinterpret_cast<ZeroTier::Node *>(node)->setLocalTraceLevel(level);
+	} catch ( ... ) {}
+}
+
+ZT_TraceEventList *ZT_Node_traceEvents(ZT_Node *node,uint64_t since)
+{
+	try {
+		return reinterpret_cast<ZeroTier::Node *>(node)->traceEvents(since);
+	} catch ( ... ) {
+		return (ZT_TraceEventList *)0;
+	}
+}
+
 void ZT_Node_freeQueryResult(ZT_Node *node,void *qr)
 {
 	try {
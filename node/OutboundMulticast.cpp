@@ -47,6 +47,9 @@ void OutboundMulticast::init(
 	}
 	_macDest = dest.mac();
 	_limit = limit;
+	_alreadySentTo.clear();
+	_alreadySentToCount = 0;
+	_growSentLog();
 	_frameLen = (len < ZT_MAX_MTU) ? len : ZT_MAX_MTU;
 	_etherType = etherType;
 
@@ -82,4 +85,58 @@ void OutboundMulticast::sendOnly(const RuntimeEnvironment *RR,void *tPtr,const A
 	}
 }
 
+bool OutboundMulticast::replicateTo(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Network> &nw,const Address &toAddr,int64_t now)
+{
+	const SharedPtr<Peer> peer(RR->topology->getPeerNoCache(toAddr));
+	if (peer) {
+		const SharedPtr<Path> viaPath(peer->getAppropriatePath(now,false));
+		if (viaPath) {
+			unsigned int mtu = ZT_DEFAULT_PHYSMTU;
+			uint64_t trustedPathId = 0;
+			RR->topology->getOutboundPathInfo(viaPath->address(),mtu,trustedPathId);
+			if (_packet.size() <= mtu) {
+				uint8_t QoSBucket = 255; // Dummy value
+				if (!nw->filterOutgoingPacket(tPtr,true,RR->identity.address(),toAddr,_macSrc,_macDest,_frameData,_frameLen,_etherType,0,QoSBucket))
+					return false;
+				nw->pushCredentialsIfNeeded(tPtr,toAddr,now);
+
+				// Copy only the used part of the packet, not its whole buffer
+				_tmp.copyFrom(_packet.data(),_packet.size());
+				_tmp.newInitializationVector();
+				_tmp.setDestination(toAddr);
+				_tmp.setFragmented(false);
+				RR->node->expectReplyTo(_tmp.packetId());
+
+				peer->recordOutgoingPacket(viaPath,_tmp.packetId(),_tmp.payloadLength(),_tmp.verb(),now);
+				if (trustedPathId) {
+					_tmp.setTrusted(trustedPathId);
+				} else {
+					_tmp.armor(peer->key(),true);
+				}
+				viaPath->send(RR,tPtr,_tmp.data(),_tmp.size(),now);
+				return true;
+			}
+		}
+	}
+	sendOnly(RR,tPtr,toAddr);
+	return false;
+}
+
+void OutboundMulticast::_growSentLog()
+{
+	unsigned long cap = 16;
+	while (cap <= ((_alreadySentToCount + 1) << 1))
+		cap <<= 1;
+	if (cap <= (unsigned long)_alreadySentTo.size())
+		cap = (unsigned long)_alreadySentTo.size() << 1;
+	std::vector<uint64_t> old;
+	old.swap(_alreadySentTo);
+	_alreadySentTo.resize(cap,0);
+	_alreadySentToCount = 0;
+	for(std::vector<uint64_t>::const_iterator a(old.begin());a!=old.end();++a) {
+		if (*a)
+			_logAsSent(*a);
+	}
+}
+
 } // namespace ZeroTier
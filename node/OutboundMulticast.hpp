@@ -24,11 +24,13 @@
 #include "MulticastGroup.hpp"
 #include "Address.hpp"
 #include "Packet.hpp"
+#include "SharedPtr.hpp"
 
 namespace ZeroTier {
 
 class CertificateOfMembership;
 class RuntimeEnvironment;
+class Network;
 
 /**
  * An outbound multicast packet
@@ -88,7 +90,7 @@ public:
 	/**
 	 * @return True if this outbound multicast has been sent to enough peers
 	 */
-	inline bool atLimit() const { return (_alreadySentTo.size() >= _limit); }
+	inline bool atLimit() const { return (_alreadySentToCount >= _limit); }
 
 	/**
 	 * Just send without checking log
@@ -99,6 +101,23 @@ public:
 	 */
 	void sendOnly(const RuntimeEnvironment *RR,void *tPtr,const Address &toAddr);
 
+	/**
+	 * Send directly via a recipient's best path without checking log
+	 *
+	 * This is the fast path used by designated multicast replicators. If the
+	 * recipient has a direct path and the packet fits its MTU, the packet is
+	 * armored and sent in place, skipping the switch's TX queue and the full
+	 * packet buffer copy. Otherwise this falls back to sendOnly().
+	 *
+	 * @param RR Runtime environment
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 * @param nw Network this multicast belongs to
+	 * @param toAddr Destination address
+	 * @param now Current time
+	 * @return True if packet was sent directly, false if it was handed to the switch or filtered
+	 */
+	bool replicateTo(const RuntimeEnvironment *RR,void *tPtr,const SharedPtr<Network> &nw,const Address &toAddr,int64_t now);
+
 	/**
 	 * Just send and log but do not check sent log
 	 *
@@ -108,7 +127,7 @@ public:
 	 */
 	inline void sendAndLog(const RuntimeEnvironment *RR,void *tPtr,const Address &toAddr)
 	{
-		_alreadySentTo.push_back(toAddr);
+		_logAsSent(toAddr.toInt());
 		sendOnly(RR,tPtr,toAddr);
 	}
 
@@ -119,7 +138,7 @@ public:
 	 */
 	inline void logAsSent(const Address &toAddr)
 	{
-		_alreadySentTo.push_back(toAddr);
+		_logAsSent(toAddr.toInt());
 	}
 
 	/**
@@ -132,8 +151,8 @@ public:
 	 */
 	inline bool sendIfNew(const RuntimeEnvironment *RR,void *tPtr,const Address &toAddr)
 	{
-		if (std::find(_alreadySentTo.begin(),_alreadySentTo.end(),toAddr) == _alreadySentTo.end()) {
-			sendAndLog(RR,tPtr,toAddr);
+		if (_logAsSent(toAddr.toInt())) {
+			sendOnly(RR,tPtr,toAddr);
 			return true;
 		} else {
 			return false;
@@ -141,6 +160,25 @@ public:
 	}
 
 private:
+	// Sent log is an open addressed hash set of 40-bit addresses, with zero
+	// (never a valid address) marking empty slots. Returns false if present.
+	inline bool _logAsSent(const uint64_t a)
+	{
+		if ((_alreadySentToCount << 1) >= (unsigned long)_alreadySentTo.size())
+			_growSentLog();
+		const unsigned long mask = (unsigned long)_alreadySentTo.size() - 1;
+		for(unsigned long i=(unsigned long)(a ^ (a >> 17)) & mask;;i=(i + 1) & mask) {
+			if (_alreadySentTo[i] == a)
+				return false;
+			if (!_alreadySentTo[i]) {
+				_alreadySentTo[i] = a;
+				++_alreadySentToCount;
+				return true;
+			}
+		}
+	}
+	void _growSentLog();
+
 	uint64_t _timestamp;
 	uint64_t _nwid;
 	MAC _macSrc;
@@ -149,7 +187,8 @@ private:
 	unsigned int _frameLen;
 	unsigned int _etherType;
 	Packet _packet,_tmp;
-	std::vector<Address> _alreadySentTo;
+	std::vector<uint64_t> _alreadySentTo;
+	unsigned long _alreadySentToCount;
 	uint8_t _frameData[ZT_MAX_MTU];
 };
 
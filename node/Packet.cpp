@@ -971,12 +971,19 @@ void Packet::cryptField(const void *key,unsigned int start,unsigned int len)
 
 bool Packet::compress()
 {
+	// LZ4 state and output space are kept per thread instead of in a ~20KB
+	// stack frame for every packet. The state is still reset on each call:
+	// this LZ4 doesn't bounds check stale hash table entries left by another
+	// packet, so they can't be reused.
+	static thread_local LZ4_stream_t lz4State;
+	static thread_local char buf[ZT_PROTO_MAX_PACKET_LENGTH];
+
 	char *const data = reinterpret_cast<char *>(unsafeData());
-	char buf[ZT_PROTO_MAX_PACKET_LENGTH * 2];
 
-	if ((!compressed())&&(size() > (ZT_PACKET_IDX_PAYLOAD + 64))) { // don't bother compressing tiny packets
+	if ((!compressed())&&(size() > (ZT_PACKET_IDX_PAYLOAD + ZT_PROTO_MIN_COMPRESSIBLE_PAYLOAD_LENGTH))) { // don't bother compressing tiny packets
 		int pl = (int)(size() - ZT_PACKET_IDX_PAYLOAD);
-		int cl = LZ4_compress_fast(data + ZT_PACKET_IDX_PAYLOAD,buf,pl,ZT_PROTO_MAX_PACKET_LENGTH * 2,1);
+		// Output is limited to less than the input, so LZ4 gives up as soon as it knows it can't win
+		int cl = LZ4_compress_fast_extState(&lz4State,data + ZT_PACKET_IDX_PAYLOAD,buf,pl,pl - 1,1);
 		if ((cl > 0)&&(cl < pl)) {
 			data[ZT_PACKET_IDX_VERB] |= (char)ZT_PROTO_VERB_FLAG_COMPRESSED;
 			setSize((unsigned int)cl + ZT_PACKET_IDX_PAYLOAD);
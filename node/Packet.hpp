@@ -220,6 +220,11 @@
  */
 #define ZT_PROTO_MIN_PACKET_LENGTH ZT_PACKET_IDX_PAYLOAD
 
+/**
+ * Payloads this short or shorter are never compressed
+ */
+#define ZT_PROTO_MIN_COMPRESSIBLE_PAYLOAD_LENGTH 64
+
 // Indexes of fields in fragment header
 #define ZT_PACKET_FRAGMENT_IDX_PACKET_ID 0
 #define ZT_PACKET_FRAGMENT_IDX_DEST 8
@@ -766,6 +771,24 @@ public:
 		 * Each config chunk is signed to prevent memory exhaustion or
 		 * traffic crowding DOS attacks against config fragment assembly.
 		 *
+		 * If flag 0x02 is set, the config is signed once over the root of a
+		 * hash tree of its chunks (see HashTree.hpp) instead of per chunk,
+		 * and the chunk index is followed by:
+		 *   <[2] 16-bit number of this chunk>
+		 *   <[2] 16-bit total number of chunks>
+		 *   <[1] 8-bit number of proof hashes>
+		 *   <[...] proof hashes, 32 bytes each>
+		 * The signature type is then hash tree ed25519 (2), which signs:
+		 *   <[8] 64-bit network ID>
+		 *   <[2] 0xffff (never a valid chunk length)>
+		 *   <[8] 64-bit config update ID>
+		 *   <[4] 32-bit total length of assembled dictionary>
+		 *   <[2] 16-bit total number of chunks>
+		 *   <[32] hash tree root>
+		 * Leaves are computed over each chunk's data and index. This is only
+		 * sent to nodes that set ZT_NETWORKCONFIG_REQUEST_FLAG_HASH_TREE_CHUNKS
+		 * in their request meta-data.
+		 *
 		 * If the packet is from the network controller it is permitted to end
 		 * before the config update ID or other chunking related or signature
 		 * fields. This is to support older controllers that don't include
@@ -799,6 +822,7 @@ public:
 		 *
 		 * Flags:
 		 *   0x01 - Use fast propagation
+		 *   0x02 - Signed over a hash tree (see NETWORK_CONFIG_REQUEST)
 		 *
 		 * An OK should be sent if the config is successfully received and
 		 * accepted.
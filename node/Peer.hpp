@@ -31,6 +31,7 @@
 #include "AtomicCounter.hpp"
 #include "Hashtable.hpp"
 #include "Mutex.hpp"
+#include "CompressionTracker.hpp"
 
 #define ZT_PEER_MAX_SERIALIZED_STATE_SIZE (sizeof(Peer) + 32 + (sizeof(Path) * 2))
 
@@ -377,6 +378,12 @@ public:
 	 */
 	inline const unsigned char *key() const { return _key; }
 
+	/**
+	 * @return Adaptive compression state and statistics for frames sent to this peer
+	 */
+	inline CompressionTracker &compression() { return _compression; }
+	inline const CompressionTracker &compression() const { return _compression; }
+
 	/**
 	 * Set the currently known remote version of this peer's client
 	 *
@@ -666,6 +673,8 @@ private:
 	int64_t _lastAggregateStatsReport;
 	int64_t _lastAggregateAllocation;
 
+	CompressionTracker _compression;
+
 	char _interfaceListStr[256]; // 16 characters * 16 paths in a link
 };
 
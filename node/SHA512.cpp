@@ -359,6 +359,175 @@ void SHA512::hash(void *digest,const void *data,unsigned int len)
 
 #endif // !ZT_HAVE_NATIVE_SHA512
 
+/* Multi-buffer SHA-512 --------------------------------------------------- */
+
+#if defined(__GNUC__) && (defined(__amd64) || defined(__amd64__) || defined(__x86_64) || defined(__x86_64__) || defined(__AMD64) || defined(__AMD64__))
+#define ZT_SHA512_AVX2_MULTIBUFFER 1
+#include <immintrin.h>
+#endif
+
+namespace ZeroTier {
+
+#ifdef ZT_SHA512_AVX2_MULTIBUFFER
+
+// AVX2 is detected at runtime so builds without -mavx2 still get this path
+class _SHA512Avx2Checker
+{
+public:
+	_SHA512Avx2Checker()
+	{
+		__builtin_cpu_init();
+		canHas = (__builtin_cpu_supports("avx2") != 0);
+	}
+	bool canHas;
+};
+static const _SHA512Avx2Checker _ZT_SHA512_AVX2_CHECK;
+
+static const uint64_t _sha512x4K[80] = {
+	0x428a2f98d728ae22ULL,0x7137449123ef65cdULL,0xb5c0fbcfec4d3b2fULL,0xe9b5dba58189dbbcULL,0x3956c25bf348b538ULL,0x59f111f1b605d019ULL,0x923f82a4af194f9bULL,0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL,0x12835b0145706fbeULL,0x243185be4ee4b28cULL,0x550c7dc3d5ffb4e2ULL,0x72be5d74f27b896fULL,0x80deb1fe3b1696b1ULL,0x9bdc06a725c71235ULL,0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL,0xefbe4786384f25e3ULL,0x0fc19dc68b8cd5b5ULL,0x240ca1cc77ac9c65ULL,0x2de92c6f592b0275ULL,0x4a7484aa6ea6e483ULL,0x5cb0a9dcbd41fbd4ULL,0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL,0xa831c66d2db43210ULL,0xb00327c898fb213fULL,0xbf597fc7beef0ee4ULL,0xc6e00bf33da88fc2ULL,0xd5a79147930aa725ULL,0x06ca6351e003826fULL,0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL,0x2e1b21385c26c926ULL,0x4d2c6dfc5ac42aedULL,0x53380d139d95b3dfULL,0x650a73548baf63deULL,0x766a0abb3c77b2a8ULL,0x81c2c92e47edaee6ULL,0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL,0xa81a664bbc423001ULL,0xc24b8b70d0f89791ULL,0xc76c51a30654be30ULL,0xd192e819d6ef5218ULL,0xd69906245565a910ULL,0xf40e35855771202aULL,0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL,0x1e376c085141ab53ULL,0x2748774cdf8eeb99ULL,0x34b0bcb5e19b48a8ULL,0x391c0cb3c5c95a63ULL,0x4ed8aa4ae3418acbULL,0x5b9cca4f7763e373ULL,0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL,0x78a5636f43172f60ULL,0x84c87814a1f0ab72ULL,0x8cc702081a6439ecULL,0x90befffa23631e28ULL,0xa4506cebde82bde9ULL,0xbef9a3f7b2c67915ULL,0xc67178f2e372532bULL,
+	0xca273eceea26619cULL,0xd186b8c721c0c207ULL,0xeada7dd6cde0eb1eULL,0xf57d4f7fee6ed178ULL,0x06f067aa72176fbaULL,0x0a637dc5a2c898a6ULL,0x113f9804bef90daeULL,0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL,0x32caab7b40c72493ULL,0x3c9ebe0a15c9bebcULL,0x431d67c49c100d4cULL,0x4cc5d4becb3e42b6ULL,0x597f299cfc657e2aULL,0x5fcb6fab3ad6faecULL,0x6c44198c4a475817ULL
+};
+
+static const uint64_t _sha512x4IV[8] = {
+	0x6a09e667f3bcc908ULL,0xbb67ae8584caa73bULL,0x3c6ef372fe94f82bULL,0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL,0x9b05688c2b3e6c1fULL,0x1f83d9abfb41bd6bULL,0x5be0cd19137e2179ULL
+};
+
+// One message being hashed in one of the four SIMD lanes
+struct _SHA512x4Lane
+{
+	const unsigned char *in;
+	unsigned long fullBlocks;
+	unsigned long totalBlocks;
+	unsigned char tail[256]; // final one or two padded blocks
+};
+
+#define ZT_SHA512X4_ROTR(x,c) _mm256_or_si256(_mm256_srli_epi64((x),(c)),_mm256_slli_epi64((x),64 - (c)))
+#define ZT_SHA512X4_SIGMA0(x) _mm256_xor_si256(_mm256_xor_si256(ZT_SHA512X4_ROTR(x,28),ZT_SHA512X4_ROTR(x,34)),ZT_SHA512X4_ROTR(x,39))
+#define ZT_SHA512X4_SIGMA1(x) _mm256_xor_si256(_mm256_xor_si256(ZT_SHA512X4_ROTR(x,14),ZT_SHA512X4_ROTR(x,18)),ZT_SHA512X4_ROTR(x,41))
+#define ZT_SHA512X4_sigma0(x) _mm256_xor_si256(_mm256_xor_si256(ZT_SHA512X4_ROTR(x,1),ZT_SHA512X4_ROTR(x,8)),_mm256_srli_epi64((x),7))
+#define ZT_SHA512X4_sigma1(x) _mm256_xor_si256(_mm256_xor_si256(ZT_SHA512X4_ROTR(x,19),ZT_SHA512X4_ROTR(x,61)),_mm256_srli_epi64((x),6))
+
+__attribute__((target("avx2")))
+static void _sha512x4Avx2(void *const digest[4],const void *const data[4],const unsigned int len[4])
+{
+	_SHA512x4Lane lanes[4];
+	unsigned long maxBlocks = 0;
+	for(unsigned int l=0;l<4;++l) {
+		_SHA512x4Lane &ln = lanes[l];
+		const uint64_t bytes = len[l];
+		const unsigned int rem = len[l] & 127;
+		ln.in = reinterpret_cast<const unsigned char *>(data[l]);
+		ln.fullBlocks = len[l] >> 7;
+		memset(ln.tail,0,sizeof(ln.tail));
+		memcpy(ln.tail,ln.in + (ln.fullBlocks << 7),rem);
+		ln.tail[rem] = 0x80;
+		const unsigned int tailLen = (rem < 112) ? 128 : 256;
+		*reinterpret_cast<uint64_t *>(ln.tail + tailLen - 16) = Utils::hton((uint64_t)(bytes >> 61));
+		*reinterpret_cast<uint64_t *>(ln.tail + tailLen - 8) = Utils::hton((uint64_t)(bytes << 3));
+		ln.totalBlocks = ln.fullBlocks + (tailLen >> 7);
+		if (ln.totalBlocks > maxBlocks)
+			maxBlocks = ln.totalBlocks;
+	}
+
+	__m256i st[8];
+	for(unsigned int i=0;i<8;++i)
+		st[i] = _mm256_set1_epi64x((long long)_sha512x4IV[i]);
+
+	__m256i w[80];
+	for(unsigned long blk=0;blk<maxBlocks;++blk) {
+		const uint64_t *p[4];
+		long long active[4];
+		for(unsigned int l=0;l<4;++l) {
+			const _SHA512x4Lane &ln = lanes[l];
+			if (blk < ln.fullBlocks) {
+				p[l] = reinterpret_cast<const uint64_t *>(ln.in + (blk << 7));
+				active[l] = -1LL;
+			} else if (blk < ln.totalBlocks) {
+				p[l] = reinterpret_cast<const uint64_t *>(ln.tail + ((blk - ln.fullBlocks) << 7));
+				active[l] = -1LL;
+			} else {
+				p[l] = reinterpret_cast<const uint64_t *>(ln.tail); // lane finished, result discarded
+				active[l] = 0;
+			}
+		}
+		const __m256i mask = _mm256_set_epi64x(active[3],active[2],active[1],active[0]);
+
+		for(unsigned int t=0;t<16;++t)
+			w[t] = _mm256_set_epi64x((long long)Utils::ntoh(p[3][t]),(long long)Utils::ntoh(p[2][t]),(long long)Utils::ntoh(p[1][t]),(long long)Utils::ntoh(p[0][t]));
+		for(unsigned int t=16;t<80;++t)
+			w[t] = _mm256_add_epi64(_mm256_add_epi64(ZT_SHA512X4_sigma1(w[t-2]),w[t-7]),_mm256_add_epi64(ZT_SHA512X4_sigma0(w[t-15]),w[t-16]));
+
+		__m256i a = st[0],b = st[1],c = st[2],d = st[3],e = st[4],f = st[5],g = st[6],h = st[7];
+		for(unsigned int t=0;t<80;++t) {
+			const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e,f),_mm256_andnot_si256(e,g));
+			const __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a,b),_mm256_and_si256(a,c)),_mm256_and_si256(b,c));
+			const __m256i T1 = _mm256_add_epi64(_mm256_add_epi64(_mm256_add_epi64(h,ZT_SHA512X4_SIGMA1(e)),_mm256_add_epi64(ch,_mm256_set1_epi64x((long long)_sha512x4K[t]))),w[t]);
+			const __m256i T2 = _mm256_add_epi64(ZT_SHA512X4_SIGMA0(a),maj);
+			h = g;
+			g = f;
+			f = e;
+			e = _mm256_add_epi64(d,T1);
+			d = c;
+			c = b;
+			b = a;
+			a = _mm256_add_epi64(T1,T2);
+		}
+
+		st[0] = _mm256_blendv_epi8(st[0],_mm256_add_epi64(st[0],a),mask);
+		st[1] = _mm256_blendv_epi8(st[1],_mm256_add_epi64(st[1],b),mask);
+		st[2] = _mm256_blendv_epi8(st[2],_mm256_add_epi64(st[2],c),mask);
+		st[3] = _mm256_blendv_epi8(st[3],_mm256_add_epi64(st[3],d),mask);
+		st[4] = _mm256_blendv_epi8(st[4],_mm256_add_epi64(st[4],e),mask);
+		st[5] = _mm256_blendv_epi8(st[5],_mm256_add_epi64(st[5],f),mask);
+		st[6] = _mm256_blendv_epi8(st[6],_mm256_add_epi64(st[6],g),mask);
+		st[7] = _mm256_blendv_epi8(st[7],_mm256_add_epi64(st[7],h),mask);
+	}
+
+	for(unsigned int i=0;i<8;++i) {
+		uint64_t tmp[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(tmp),st[i]);
+		for(unsigned int l=0;l<4;++l)
+			reinterpret_cast<uint64_t *>(digest[l])[i] = Utils::hton(tmp[l]);
+	}
+
+	for(unsigned int l=0;l<4;++l)
+		Utils::burn(lanes[l].tail,sizeof(lanes[l].tail));
+}
+
+#endif // ZT_SHA512_AVX2_MULTIBUFFER
+
+void SHA512::hash4(void *const digest[4],const void *const data[4],const unsigned int len[4])
+{
+#ifdef ZT_SHA512_AVX2_MULTIBUFFER
+	if (_ZT_SHA512_AVX2_CHECK.canHas) {
+		_sha512x4Avx2(digest,data,len);
+		return;
+	}
+#endif
+	for(unsigned int l=0;l<4;++l)
+		hash(digest[l],data[l],len[l]);
+}
+
+bool SHA512::hash4Accelerated()
+{
+#ifdef ZT_SHA512_AVX2_MULTIBUFFER
+	return _ZT_SHA512_AVX2_CHECK.canHas;
+#else
+	return false;
+#endif
+}
+
+} // namespace ZeroTier
+
 // Internally re-export to included C code, which includes some fast crypto code ported in on some platforms.
 // This eliminates the need to link against a third party SHA512() from this code
 extern "C" void ZT_sha512internal(void *digest,const void *data,unsigned int len)
@@ -25,6 +25,24 @@ class SHA512
 {
 public:
 	static void hash(void *digest,const void *data,unsigned int len);
+
+	/**
+	 * Compute the SHA-512 digests of four independent messages at once
+	 *
+	 * On x64 CPUs with AVX2 the four messages are hashed together, one per
+	 * SIMD lane. Otherwise this is the same as calling hash() four times.
+	 * Messages may differ in length. Output buffers must not overlap inputs.
+	 *
+	 * @param digest Four buffers to receive ZT_SHA512_DIGEST_LEN byte digests
+	 * @param data Four messages to hash
+	 * @param len Lengths of the four messages in bytes
+	 */
+	static void hash4(void *const digest[4],const void *const data[4],const unsigned int len[4]);
+
+	/**
+	 * @return True if hash4() runs all four messages in parallel on this CPU
+	 */
+	static bool hash4Accelerated();
 };
 
 } // namespace ZeroTier
@@ -414,16 +414,22 @@ void Switch::onLocalEthernet(void *tPtr,const SharedPtr<Network> &network,const
 			from.appendTo(outp);
 			outp.append((uint16_t)etherType);
 			outp.append(data,len);
-			if (!network->config().disableCompression())
-				outp.compress();
+			if (!network->config().disableCompression()) {
+				if (toPeer)
+					toPeer->compression().compress(outp,RR->node->now());
+				else outp.compress();
+			}
 			aqm_enqueue(tPtr,network,outp,true,qosBucket);
 		} else {
 			Packet outp(toZT,RR->identity.address(),Packet::VERB_FRAME);
 			outp.append(network->id());
 			outp.append((uint16_t)etherType);
 			outp.append(data,len);
-			if (!network->config().disableCompression())
-				outp.compress();
+			if (!network->config().disableCompression()) {
+				if (toPeer)
+					toPeer->compression().compress(outp,RR->node->now());
+				else outp.compress();
+			}
 			aqm_enqueue(tPtr,network,outp,true,qosBucket);
 		}
 	} else {
@@ -478,8 +484,12 @@ void Switch::onLocalEthernet(void *tPtr,const SharedPtr<Network> &network,const
 				from.appendTo(outp);
 				outp.append((uint16_t)etherType);
 				outp.append(data,len);
-				if (!network->config().disableCompression())
-					outp.compress();
+				if (!network->config().disableCompression()) {
+					const SharedPtr<Peer> bridgePeer(RR->topology->getPeerNoCache(bridges[b]));
+					if (bridgePeer)
+						bridgePeer->compression().compress(outp,RR->node->now());
+					else outp.compress();
+				}
 				aqm_enqueue(tPtr,network,outp,true,qosBucket);
 			} else {
 				RR->t->outgoingNetworkFrameDropped(tPtr,network,from,to,etherType,vlanId,len,"filter blocked (bridge replication)");
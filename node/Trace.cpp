@@ -16,6 +16,8 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#include <algorithm>
+
 #include "Trace.hpp"
 #include "RuntimeEnvironment.hpp"
 #include "Switch.hpp"
@@ -48,49 +50,41 @@ static void ZT_LOCAL_TRACE(void *const tPtr,const RuntimeEnvironment *const RR,c
 
 void Trace::resettingPathsInScope(void *const tPtr,const Address &reporter,const InetAddress &reporterPhysicalAddress,const InetAddress &myPhysicalAddress,const InetAddress::IpScope scope)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 
 	ZT_LOCAL_TRACE(tPtr,RR,"RESET and revalidate paths in scope %d; new phy address %s reported by trusted peer %.10llx",(int)scope,myPhysicalAddress.toIpString(tmp),reporter.toInt());
 
-	Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-	d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__RESETTING_PATHS_IN_SCOPE_S);
-	d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,reporter);
-	d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,reporterPhysicalAddress.toString(tmp));
-	d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_PHYADDR,myPhysicalAddress.toString(tmp));
-	d.add(ZT_REMOTE_TRACE_FIELD__IP_SCOPE,(uint64_t)scope);
-
-	if (_globalTarget)
-		_send(tPtr,d,_globalTarget);
-	_spamToAllNetworks(tPtr,d,Trace::LEVEL_NORMAL);
+	if (_wanted(Trace::LEVEL_NORMAL,0,Record::FLAG_ALL_NETWORKS)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__RESETTING_PATHS_IN_SCOPE,Trace::LEVEL_NORMAL,Record::FLAG_ALL_NETWORKS);
+		r.set(Record::F_REMOTE_ZTADDR,reporter.toInt());
+		r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,reporterPhysicalAddress);
+		r.setPhysicalAddress(Record::F_LOCAL_PHYADDR,myPhysicalAddress);
+		r.set(Record::F_IP_SCOPE,(uint64_t)scope);
+		_record(r);
+	}
 }
 
 void Trace::peerConfirmingUnknownPath(void *const tPtr,const uint64_t networkId,Peer &peer,const SharedPtr<Path> &path,const uint64_t packetId,const Packet::Verb verb)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 	if (!path) return; // sanity check
 
 	ZT_LOCAL_TRACE(tPtr,RR,"trying unknown path %s to %.10llx (packet %.16llx verb %d local socket %lld network %.16llx)",path->address().toString(tmp),peer.address().toInt(),packetId,(double)verb,path->localSocket(),networkId);
 
-	std::pair<Address,Trace::Level> byn;
-	if (networkId) { Mutex::Lock l(_byNet_m); _byNet.get(networkId,byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__PEER_CONFIRMING_UNKNOWN_PATH_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,packetId);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_VERB,(uint64_t)verb);
+	if (_wanted(Trace::LEVEL_NORMAL,networkId,0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__PEER_CONFIRMING_UNKNOWN_PATH,Trace::LEVEL_NORMAL,0);
+		r.set(Record::F_PACKET_ID,packetId);
+		r.set(Record::F_PACKET_VERB,(uint64_t)verb);
 		if (networkId)
-			d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,networkId);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,peer.address());
-		if (path) {
-			d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,path->address().toString(tmp));
-			d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,path->localSocket());
-		}
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.set(Record::F_NETWORK_ID,networkId);
+		r.set(Record::F_REMOTE_ZTADDR,peer.address().toInt());
+		r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,path->address());
+		r.set(Record::F_LOCAL_SOCKET,(uint64_t)path->localSocket());
+		_record(r);
 	}
 }
 
@@ -116,54 +110,42 @@ void Trace::peerLinkAggregateStatistics(void *const tPtr,Peer &peer)
 
 void Trace::peerLearnedNewPath(void *const tPtr,const uint64_t networkId,Peer &peer,const SharedPtr<Path> &newPath,const uint64_t packetId)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 	if (!newPath) return; // sanity check
 
 	ZT_LOCAL_TRACE(tPtr,RR,"learned new path %s to %.10llx (packet %.16llx local socket %lld network %.16llx)",newPath->address().toString(tmp),peer.address().toInt(),packetId,newPath->localSocket(),networkId);
 
-	std::pair<Address,Trace::Level> byn;
-	if (networkId) { Mutex::Lock l(_byNet_m); _byNet.get(networkId,byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__PEER_LEARNED_NEW_PATH_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,packetId);
+	if (_wanted(Trace::LEVEL_NORMAL,networkId,0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__PEER_LEARNED_NEW_PATH,Trace::LEVEL_NORMAL,0);
+		r.set(Record::F_PACKET_ID,packetId);
 		if (networkId)
-			d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,networkId);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,peer.address());
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,newPath->address().toString(tmp));
-		d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,newPath->localSocket());
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.set(Record::F_NETWORK_ID,networkId);
+		r.set(Record::F_REMOTE_ZTADDR,peer.address().toInt());
+		r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,newPath->address());
+		r.set(Record::F_LOCAL_SOCKET,(uint64_t)newPath->localSocket());
+		_record(r);
 	}
 }
 
 void Trace::peerRedirected(void *const tPtr,const uint64_t networkId,Peer &peer,const SharedPtr<Path> &newPath)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 	if (!newPath) return; // sanity check
 
 	ZT_LOCAL_TRACE(tPtr,RR,"explicit redirect from %.10llx to path %s",peer.address().toInt(),newPath->address().toString(tmp));
 
-	std::pair<Address,Trace::Level> byn;
-	if (networkId) { Mutex::Lock l(_byNet_m); _byNet.get(networkId,byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__PEER_REDIRECTED_S);
+	if (_wanted(Trace::LEVEL_NORMAL,networkId,0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__PEER_REDIRECTED,Trace::LEVEL_NORMAL,0);
 		if (networkId)
-			d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,networkId);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,peer.address());
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,newPath->address().toString(tmp));
-		d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,newPath->localSocket());
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.set(Record::F_NETWORK_ID,networkId);
+		r.set(Record::F_REMOTE_ZTADDR,peer.address().toInt());
+		r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,newPath->address());
+		r.set(Record::F_LOCAL_SOCKET,(uint64_t)newPath->localSocket());
+		_record(r);
 	}
 }
 
@@ -176,171 +158,151 @@ void Trace::outgoingNetworkFrameDropped(void *const tPtr,const SharedPtr<Network
 
 	ZT_LOCAL_TRACE(tPtr,RR,"%.16llx DROP frame %s -> %s etherType %.4x size %u (%s)",network->id(),sourceMac.toString(tmp),destMac.toString(tmp2),etherType,frameLen,(reason) ? reason : "unknown reason");
 
-	std::pair<Address,Trace::Level> byn;
-	{ Mutex::Lock l(_byNet_m); _byNet.get(network->id(),byn); }
-
-	if ( ((_globalTarget)&&((int)_globalLevel >= (int)Trace::LEVEL_VERBOSE)) || ((byn.first)&&((int)byn.second >= (int)Trace::LEVEL_VERBOSE)) ) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__OUTGOING_NETWORK_FRAME_DROPPED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,network->id());
-		d.add(ZT_REMOTE_TRACE_FIELD__SOURCE_MAC,sourceMac.toInt());
-		d.add(ZT_REMOTE_TRACE_FIELD__DEST_MAC,destMac.toInt());
-		d.add(ZT_REMOTE_TRACE_FIELD__ETHERTYPE,(uint64_t)etherType);
-		d.add(ZT_REMOTE_TRACE_FIELD__VLAN_ID,(uint64_t)vlanId);
-		d.add(ZT_REMOTE_TRACE_FIELD__FRAME_LENGTH,(uint64_t)frameLen);
+	if (_wanted(Trace::LEVEL_VERBOSE,network->id(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__OUTGOING_NETWORK_FRAME_DROPPED,Trace::LEVEL_VERBOSE,0);
+		r.set(Record::F_NETWORK_ID,network->id());
+		r.set(Record::F_SOURCE_MAC,sourceMac.toInt());
+		r.set(Record::F_DEST_MAC,destMac.toInt());
+		r.set(Record::F_ETHERTYPE,(uint64_t)etherType);
+		r.set(Record::F_VLAN_ID,(uint64_t)vlanId);
+		r.set(Record::F_FRAME_LENGTH,(uint64_t)frameLen);
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		if ((_globalTarget)&&((int)_globalLevel >= (int)Trace::LEVEL_VERBOSE))
-			_send(tPtr,d,_globalTarget);
-		if ((byn.first)&&((int)byn.second >= (int)Trace::LEVEL_VERBOSE))
-			_send(tPtr,d,byn.first);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::incomingNetworkAccessDenied(void *const tPtr,const SharedPtr<Network> &network,const SharedPtr<Path> &path,const uint64_t packetId,const unsigned int packetLength,const Address &source,const Packet::Verb verb,bool credentialsRequested)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 	if (!network) return; // sanity check
 
 	ZT_LOCAL_TRACE(tPtr,RR,"%.16llx DENIED packet from %.10llx(%s) verb %d size %u%s",network->id(),source.toInt(),(path) ? (path->address().toString(tmp)) : "???",(int)verb,packetLength,credentialsRequested ? " (credentials requested)" : " (credentials not requested)");
 
-	std::pair<Address,Trace::Level> byn;
-	{ Mutex::Lock l(_byNet_m); _byNet.get(network->id(),byn); }
-
-	if ( ((_globalTarget)&&((int)_globalLevel >= (int)Trace::LEVEL_VERBOSE)) || ((byn.first)&&((int)byn.second >= (int)Trace::LEVEL_VERBOSE)) ) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__INCOMING_NETWORK_ACCESS_DENIED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,packetId);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_VERB,(uint64_t)verb);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,source);
+	if (_wanted(Trace::LEVEL_VERBOSE,network->id(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__INCOMING_NETWORK_ACCESS_DENIED,Trace::LEVEL_VERBOSE,0);
+		r.set(Record::F_PACKET_ID,packetId);
+		r.set(Record::F_PACKET_VERB,(uint64_t)verb);
+		r.set(Record::F_REMOTE_ZTADDR,source.toInt());
 		if (path) {
-			d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,path->address().toString(tmp));
-			d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,path->localSocket());
+			r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,path->address());
+			r.set(Record::F_LOCAL_SOCKET,(uint64_t)path->localSocket());
 		}
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,network->id());
-
-		if ((_globalTarget)&&((int)_globalLevel >= (int)Trace::LEVEL_VERBOSE))
-			_send(tPtr,d,_globalTarget);
-		if ((byn.first)&&((int)byn.second >= (int)Trace::LEVEL_VERBOSE))
-			_send(tPtr,d,byn.first);
+		r.set(Record::F_NETWORK_ID,network->id());
+		_record(r);
 	}
 }
 
 void Trace::incomingNetworkFrameDropped(void *const tPtr,const SharedPtr<Network> &network,const SharedPtr<Path> &path,const uint64_t packetId,const unsigned int packetLength,const Address &source,const Packet::Verb verb,const MAC &sourceMac,const MAC &destMac,const char *reason)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 	if (!network) return; // sanity check
 
 	ZT_LOCAL_TRACE(tPtr,RR,"%.16llx DROPPED frame from %.10llx(%s) verb %d size %u",network->id(),source.toInt(),(path) ? (path->address().toString(tmp)) : "???",(int)verb,packetLength);
 
-	std::pair<Address,Trace::Level> byn;
-	{ Mutex::Lock l(_byNet_m); _byNet.get(network->id(),byn); }
-
-	if ( ((_globalTarget)&&((int)_globalLevel >= (int)Trace::LEVEL_VERBOSE)) || ((byn.first)&&((int)byn.second >= (int)Trace::LEVEL_VERBOSE)) ) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__INCOMING_NETWORK_FRAME_DROPPED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,packetId);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_VERB,(uint64_t)verb);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,source);
+	if (_wanted(Trace::LEVEL_VERBOSE,network->id(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__INCOMING_NETWORK_FRAME_DROPPED,Trace::LEVEL_VERBOSE,0);
+		r.set(Record::F_PACKET_ID,packetId);
+		r.set(Record::F_PACKET_VERB,(uint64_t)verb);
+		r.set(Record::F_REMOTE_ZTADDR,source.toInt());
 		if (path) {
-			d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,path->address().toString(tmp));
-			d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,path->localSocket());
+			r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,path->address());
+			r.set(Record::F_LOCAL_SOCKET,(uint64_t)path->localSocket());
 		}
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,network->id());
-		d.add(ZT_REMOTE_TRACE_FIELD__SOURCE_MAC,sourceMac.toInt());
-		d.add(ZT_REMOTE_TRACE_FIELD__DEST_MAC,destMac.toInt());
+		r.set(Record::F_NETWORK_ID,network->id());
+		r.set(Record::F_SOURCE_MAC,sourceMac.toInt());
+		r.set(Record::F_DEST_MAC,destMac.toInt());
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		if ((_globalTarget)&&((int)_globalLevel >= (int)Trace::LEVEL_VERBOSE))
-			_send(tPtr,d,_globalTarget);
-		if ((byn.first)&&((int)byn.second >= (int)Trace::LEVEL_VERBOSE))
-			_send(tPtr,d,byn.first);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::incomingPacketMessageAuthenticationFailure(void *const tPtr,const SharedPtr<Path> &path,const uint64_t packetId,const Address &source,const unsigned int hops,const char *reason)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 
 	ZT_LOCAL_TRACE(tPtr,RR,"MAC failed for packet %.16llx from %.10llx(%s)",packetId,source.toInt(),(path) ? path->address().toString(tmp) : "???");
 
-	if ((_globalTarget)&&((int)_globalLevel >= Trace::LEVEL_DEBUG)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__PACKET_MAC_FAILURE_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,packetId);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_HOPS,(uint64_t)hops);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,source);
+	if (_wanted(Trace::LEVEL_DEBUG,0,Record::FLAG_GLOBAL_ONLY)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__PACKET_MAC_FAILURE,Trace::LEVEL_DEBUG,Record::FLAG_GLOBAL_ONLY);
+		r.set(Record::F_PACKET_ID,packetId);
+		r.set(Record::F_PACKET_HOPS,(uint64_t)hops);
+		r.set(Record::F_REMOTE_ZTADDR,source.toInt());
 		if (path) {
-			d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,path->address().toString(tmp));
-			d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,path->localSocket());
+			r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,path->address());
+			r.set(Record::F_LOCAL_SOCKET,(uint64_t)path->localSocket());
 		}
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		_send(tPtr,d,_globalTarget);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::incomingPacketInvalid(void *const tPtr,const SharedPtr<Path> &path,const uint64_t packetId,const Address &source,const unsigned int hops,const Packet::Verb verb,const char *reason)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 
 	ZT_LOCAL_TRACE(tPtr,RR,"INVALID packet %.16llx from %.10llx(%s) (%s)",packetId,source.toInt(),(path) ? path->address().toString(tmp) : "???",(reason) ? reason : "unknown reason");
 
-	if ((_globalTarget)&&((int)_globalLevel >= Trace::LEVEL_DEBUG)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__PACKET_INVALID_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,packetId);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_VERB,(uint64_t)verb);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,source);
+	if (_wanted(Trace::LEVEL_DEBUG,0,Record::FLAG_GLOBAL_ONLY)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__PACKET_INVALID,Trace::LEVEL_DEBUG,Record::FLAG_GLOBAL_ONLY);
+		r.set(Record::F_PACKET_ID,packetId);
+		r.set(Record::F_PACKET_VERB,(uint64_t)verb);
+		r.set(Record::F_REMOTE_ZTADDR,source.toInt());
 		if (path) {
-			d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,path->address().toString(tmp));
-			d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,path->localSocket());
+			r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,path->address());
+			r.set(Record::F_LOCAL_SOCKET,(uint64_t)path->localSocket());
 		}
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_HOPS,(uint64_t)hops);
+		r.set(Record::F_PACKET_HOPS,(uint64_t)hops);
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		_send(tPtr,d,_globalTarget);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::incomingPacketDroppedHELLO(void *const tPtr,const SharedPtr<Path> &path,const uint64_t packetId,const Address &source,const char *reason)
 {
+#ifdef ZT_TRACE
 	char tmp[128];
+#endif
 
 	ZT_LOCAL_TRACE(tPtr,RR,"DROPPED HELLO from %.10llx(%s) (%s)",source.toInt(),(path) ? path->address().toString(tmp) : "???",(reason) ? reason : "???");
 
-	if ((_globalTarget)&&((int)_globalLevel >= Trace::LEVEL_DEBUG)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__PACKET_INVALID_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,packetId);
-		d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,source);
+	if (_wanted(Trace::LEVEL_DEBUG,0,Record::FLAG_GLOBAL_ONLY)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__PACKET_INVALID,Trace::LEVEL_DEBUG,Record::FLAG_GLOBAL_ONLY);
+		r.set(Record::F_PACKET_ID,packetId);
+		r.set(Record::F_REMOTE_ZTADDR,source.toInt());
 		if (path) {
-			d.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,path->address().toString(tmp));
-			d.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,path->localSocket());
+			r.setPhysicalAddress(Record::F_REMOTE_PHYADDR,path->address());
+			r.set(Record::F_LOCAL_SOCKET,(uint64_t)path->localSocket());
 		}
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		_send(tPtr,d,_globalTarget);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::networkConfigRequestSent(void *const tPtr,const Network &network,const Address &controller)
 {
 	ZT_LOCAL_TRACE(tPtr,RR,"requesting configuration for network %.16llx",network.id());
-	if ((_globalTarget)&&((int)_globalLevel >= Trace::LEVEL_DEBUG)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__NETWORK_CONFIG_REQUEST_SENT_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,network.id());
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_CONTROLLER_ID,controller);
-		_send(tPtr,d,_globalTarget);
+	if (_wanted(Trace::LEVEL_DEBUG,0,Record::FLAG_GLOBAL_ONLY)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__NETWORK_CONFIG_REQUEST_SENT,Trace::LEVEL_DEBUG,Record::FLAG_GLOBAL_ONLY);
+		r.set(Record::F_NETWORK_ID,network.id());
+		r.set(Record::F_NETWORK_CONTROLLER_ID,controller.toInt());
+		_record(r);
 	}
 }
 
+
 void Trace::networkFilter(
 	void *const tPtr,
 	const Network &network,
@@ -393,119 +355,80 @@ void Trace::networkFilter(
 
 void Trace::credentialRejected(void *const tPtr,const CertificateOfMembership &c,const char *reason)
 {
-	std::pair<Address,Trace::Level> byn;
-	if (c.networkId()) { Mutex::Lock l(_byNet_m); _byNet.get(c.networkId(),byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,c.networkId());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TYPE,(uint64_t)c.credentialType());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ID,(uint64_t)c.id());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TIMESTAMP,c.timestamp());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ISSUED_TO,c.issuedTo());
+	if (_wanted(Trace::LEVEL_NORMAL,c.networkId(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED,Trace::LEVEL_NORMAL,0);
+		r.set(Record::F_NETWORK_ID,c.networkId());
+		r.set(Record::F_CREDENTIAL_TYPE,(uint64_t)c.credentialType());
+		r.set(Record::F_CREDENTIAL_ID,(uint64_t)c.id());
+		r.set(Record::F_CREDENTIAL_TIMESTAMP,(uint64_t)c.timestamp());
+		r.set(Record::F_CREDENTIAL_ISSUED_TO,c.issuedTo().toInt());
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::credentialRejected(void *const tPtr,const CertificateOfOwnership &c,const char *reason)
 {
-	std::pair<Address,Trace::Level> byn;
-	if (c.networkId()) { Mutex::Lock l(_byNet_m); _byNet.get(c.networkId(),byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,c.networkId());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TYPE,(uint64_t)c.credentialType());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ID,(uint64_t)c.id());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TIMESTAMP,c.timestamp());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ISSUED_TO,c.issuedTo());
+	if (_wanted(Trace::LEVEL_NORMAL,c.networkId(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED,Trace::LEVEL_NORMAL,0);
+		r.set(Record::F_NETWORK_ID,c.networkId());
+		r.set(Record::F_CREDENTIAL_TYPE,(uint64_t)c.credentialType());
+		r.set(Record::F_CREDENTIAL_ID,(uint64_t)c.id());
+		r.set(Record::F_CREDENTIAL_TIMESTAMP,(uint64_t)c.timestamp());
+		r.set(Record::F_CREDENTIAL_ISSUED_TO,c.issuedTo().toInt());
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::credentialRejected(void *const tPtr,const Capability &c,const char *reason)
 {
-	std::pair<Address,Trace::Level> byn;
-	if (c.networkId()) { Mutex::Lock l(_byNet_m); _byNet.get(c.networkId(),byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,c.networkId());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TYPE,(uint64_t)c.credentialType());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ID,(uint64_t)c.id());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TIMESTAMP,c.timestamp());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ISSUED_TO,c.issuedTo());
+	if (_wanted(Trace::LEVEL_NORMAL,c.networkId(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED,Trace::LEVEL_NORMAL,0);
+		r.set(Record::F_NETWORK_ID,c.networkId());
+		r.set(Record::F_CREDENTIAL_TYPE,(uint64_t)c.credentialType());
+		r.set(Record::F_CREDENTIAL_ID,(uint64_t)c.id());
+		r.set(Record::F_CREDENTIAL_TIMESTAMP,(uint64_t)c.timestamp());
+		r.set(Record::F_CREDENTIAL_ISSUED_TO,c.issuedTo().toInt());
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::credentialRejected(void *const tPtr,const Tag &c,const char *reason)
 {
-	std::pair<Address,Trace::Level> byn;
-	if (c.networkId()) { Mutex::Lock l(_byNet_m); _byNet.get(c.networkId(),byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,c.networkId());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TYPE,(uint64_t)c.credentialType());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ID,(uint64_t)c.id());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TIMESTAMP,c.timestamp());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ISSUED_TO,c.issuedTo());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_INFO,(uint64_t)c.value());
+	if (_wanted(Trace::LEVEL_NORMAL,c.networkId(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED,Trace::LEVEL_NORMAL,0);
+		r.set(Record::F_NETWORK_ID,c.networkId());
+		r.set(Record::F_CREDENTIAL_TYPE,(uint64_t)c.credentialType());
+		r.set(Record::F_CREDENTIAL_ID,(uint64_t)c.id());
+		r.set(Record::F_CREDENTIAL_TIMESTAMP,(uint64_t)c.timestamp());
+		r.set(Record::F_CREDENTIAL_ISSUED_TO,c.issuedTo().toInt());
+		r.set(Record::F_CREDENTIAL_INFO,(uint64_t)c.value());
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
 void Trace::credentialRejected(void *const tPtr,const Revocation &c,const char *reason)
 {
-	std::pair<Address,Trace::Level> byn;
-	if (c.networkId()) { Mutex::Lock l(_byNet_m); _byNet.get(c.networkId(),byn); }
-
-	if ((_globalTarget)||(byn.first)) {
-		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> d;
-		d.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED_S);
-		d.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,c.networkId());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TYPE,(uint64_t)c.credentialType());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ID,(uint64_t)c.id());
-		d.add(ZT_REMOTE_TRACE_FIELD__CREDENTIAL_REVOCATION_TARGET,c.target());
+	if (_wanted(Trace::LEVEL_NORMAL,c.networkId(),0)) {
+		Record r(ZT_REMOTE_TRACE_EVENT__CREDENTIAL_REJECTED,Trace::LEVEL_NORMAL,0);
+		r.set(Record::F_NETWORK_ID,c.networkId());
+		r.set(Record::F_CREDENTIAL_TYPE,(uint64_t)c.credentialType());
+		r.set(Record::F_CREDENTIAL_ID,(uint64_t)c.id());
+		r.set(Record::F_CREDENTIAL_REVOCATION_TARGET,c.target().toInt());
 		if (reason)
-			d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason);
-
-		if (_globalTarget)
-			_send(tPtr,d,_globalTarget);
-		if (byn.first)
-			_send(tPtr,d,byn.first);
+			r.setReason(reason);
+		_record(r);
 	}
 }
 
+
 void Trace::updateMemoizedSettings()
 {
 	_globalTarget = RR->node->remoteTraceTarget();
@@ -525,24 +448,184 @@ void Trace::updateMemoizedSettings()
 	}
 }
 
-void Trace::_send(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Address &dest)
+bool Trace::Record::toDictionary(Dictionary<ZT_TRACE_MAX_RECORD_SIZE> &d) const
 {
-	Packet outp(dest,RR->identity.address(),Packet::VERB_REMOTE_TRACE);
-	outp.appendCString(d.data());
-	outp.compress();
-	RR->sw->send(tPtr,outp,true);
+	static const char *const NUMERIC_FIELD_NAMES[F_NUMERIC_COUNT] = {
+		ZT_REMOTE_TRACE_FIELD__PACKET_ID,
+		ZT_REMOTE_TRACE_FIELD__PACKET_VERB,
+		ZT_REMOTE_TRACE_FIELD__PACKET_HOPS,
+		ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,
+		ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,
+		ZT_REMOTE_TRACE_FIELD__IP_SCOPE,
+		ZT_REMOTE_TRACE_FIELD__NETWORK_ID,
+		ZT_REMOTE_TRACE_FIELD__NETWORK_CONTROLLER_ID,
+		ZT_REMOTE_TRACE_FIELD__SOURCE_MAC,
+		ZT_REMOTE_TRACE_FIELD__DEST_MAC,
+		ZT_REMOTE_TRACE_FIELD__ETHERTYPE,
+		ZT_REMOTE_TRACE_FIELD__VLAN_ID,
+		ZT_REMOTE_TRACE_FIELD__FRAME_LENGTH,
+		ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TYPE,
+		ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ID,
+		ZT_REMOTE_TRACE_FIELD__CREDENTIAL_TIMESTAMP,
+		ZT_REMOTE_TRACE_FIELD__CREDENTIAL_ISSUED_TO,
+		ZT_REMOTE_TRACE_FIELD__CREDENTIAL_INFO,
+		ZT_REMOTE_TRACE_FIELD__CREDENTIAL_REVOCATION_TARGET
+	};
+	char tmp[128];
+
+	d.clear();
+	if (!d.add(ZT_REMOTE_TRACE_FIELD__EVENT,Utils::hex((uint16_t)event,tmp))) return false;
+	for(unsigned int f=0;f<F_NUMERIC_COUNT;++f) {
+		if ((fields & (1UL << f)) != 0) {
+			// Local sockets and credential timestamps are signed
+			const bool ok = ((f == F_LOCAL_SOCKET)||(f == F_CREDENTIAL_TIMESTAMP)) ? d.add(NUMERIC_FIELD_NAMES[f],(int64_t)values[f]) : d.add(NUMERIC_FIELD_NAMES[f],values[f]);
+			if (!ok)
+				return false;
+		}
+	}
+	for(unsigned int f=F_REMOTE_PHYADDR;f<=F_LOCAL_PHYADDR;++f) {
+		if ((fields & (1UL << f)) != 0) {
+			const uint8_t *const pa = phy[f - F_REMOTE_PHYADDR];
+			const InetAddress a((pa[0]) ? (const void *)(pa + 3) : (const void *)0,(pa[0] == 6) ? 16 : ((pa[0] == 4) ? 4 : 0),((unsigned int)pa[1] << 8) | (unsigned int)pa[2]);
+			if (!d.add((f == F_REMOTE_PHYADDR) ? ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR : ZT_REMOTE_TRACE_FIELD__LOCAL_PHYADDR,a.toString(tmp))) return false;
+		}
+	}
+	if ((fields & (1UL << F_REASON)) != 0) {
+		if (!d.add(ZT_REMOTE_TRACE_FIELD__REASON,reason)) return false;
+	}
+	return true;
+}
+
+void Trace::flush(void *const tPtr)
+{
+	Mutex::Lock fl(_flush_m);
+
+	Record r;
+	std::vector<Address> dests;
+	std::vector< std::pair< Address,Packet * > > batches;
+	Dictionary<ZT_TRACE_MAX_RECORD_SIZE> *d = (Dictionary<ZT_TRACE_MAX_RECORD_SIZE> *)0;
+
+	while (_ring.pop(r)) {
+		if ((int)_localLevel >= (int)r.level) {
+			Mutex::Lock l(_local_m);
+			if (_local)
+				_local[(_localSeq++) % ZT_TRACE_LOCAL_HISTORY] = r;
+		}
+
+		dests.clear();
+		if ((_globalTarget)&&((int)_globalLevel >= (int)r.level))
+			dests.push_back(_globalTarget);
+		if ((r.flags & Record::FLAG_GLOBAL_ONLY) == 0) {
+			Mutex::Lock l(_byNet_m);
+			if ((r.flags & Record::FLAG_ALL_NETWORKS) != 0) {
+				Hashtable< uint64_t,std::pair< Address,Trace::Level > >::Iterator i(_byNet);
+				uint64_t *k = (uint64_t *)0;
+				std::pair<Address,Trace::Level> *v = (std::pair<Address,Trace::Level> *)0;
+				while (i.next(k,v)) {
+					if ((v->first)&&((int)v->second >= (int)r.level)&&(std::find(dests.begin(),dests.end(),v->first) == dests.end()))
+						dests.push_back(v->first);
+				}
+			} else if ((r.fields & (1UL << Record::F_NETWORK_ID)) != 0) {
+				const std::pair<Address,Trace::Level> *const v = _byNet.get(r.values[Record::F_NETWORK_ID]);
+				if ((v)&&(v->first)&&((int)v->second >= (int)r.level)&&(std::find(dests.begin(),dests.end(),v->first) == dests.end()))
+					dests.push_back(v->first);
+			}
+		}
+		if (dests.empty())
+			continue;
+
+		if (!d)
+			d = new Dictionary<ZT_TRACE_MAX_RECORD_SIZE>();
+		if (!r.toDictionary(*d))
+			continue;
+		const unsigned int len = d->sizeBytes() + 1; // each record is sent with its terminating 0
+
+		// Append to a packet per destination, sending it once full
+		for(std::vector<Address>::const_iterator dest(dests.begin());dest!=dests.end();++dest) {
+			Packet *outp = (Packet *)0;
+			for(std::vector< std::pair< Address,Packet * > >::iterator b(batches.begin());b!=batches.end();++b) {
+				if (b->first == *dest) {
+					outp = b->second;
+					break;
+				}
+			}
+			if (!outp) {
+				outp = new Packet(*dest,RR->identity.address(),Packet::VERB_REMOTE_TRACE);
+				batches.push_back(std::pair< Address,Packet * >(*dest,outp));
+			} else if ((outp->payloadLength() + len) > ZT_TRACE_MAX_BATCH_BYTES) {
+				outp->compress();
+				RR->sw->send(tPtr,*outp,true);
+				++_remotePackets;
+				outp->reset(*dest,RR->identity.address(),Packet::VERB_REMOTE_TRACE);
+			}
+			outp->append(d->data(),len);
+			++_remoteRecords;
+		}
+	}
+
+	for(std::vector< std::pair< Address,Packet * > >::iterator b(batches.begin());b!=batches.end();++b) {
+		b->second->compress();
+		RR->sw->send(tPtr,*(b->second),true);
+		++_remotePackets;
+		delete b->second;
+	}
+	delete d;
+}
+
+void Trace::setLocalLevel(const int level)
+{
+	Mutex::Lock l(_local_m);
+	if ((level >= 0)&&(!_local))
+		_local = new Record[ZT_TRACE_LOCAL_HISTORY];
+	_localLevel = level;
 }
 
-void Trace::_spamToAllNetworks(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Level level)
+void Trace::localEvents(const uint64_t since,std::vector< std::pair< uint64_t,Record > > &events,uint64_t counters[4]) const
 {
+	Mutex::Lock l(_local_m);
+	if (_local) {
+		uint64_t seq = (_localSeq > ZT_TRACE_LOCAL_HISTORY) ? (_localSeq - ZT_TRACE_LOCAL_HISTORY) : 0;
+		if (seq < since)
+			seq = since;
+		while (seq < _localSeq) {
+			events.push_back(std::pair< uint64_t,Record >(seq + 1,_local[seq % ZT_TRACE_LOCAL_HISTORY]));
+			++seq;
+		}
+	}
+	counters[0] = _ring.pushed();
+	counters[1] = _ring.dropped();
+	counters[2] = _remoteRecords;
+	counters[3] = _remotePackets;
+}
+
+bool Trace::_wanted(const Level level,const uint64_t networkId,const unsigned int flags)
+{
+	if (((int)_localLevel >= (int)level)||((_globalTarget)&&((int)_globalLevel >= (int)level)))
+		return true;
+	if ((flags & Record::FLAG_GLOBAL_ONLY) != 0)
+		return false;
 	Mutex::Lock l(_byNet_m);
-	Hashtable< uint64_t,std::pair< Address,Trace::Level > >::Iterator i(_byNet);
-	uint64_t *k = (uint64_t *)0;
-	std::pair<Address,Trace::Level> *v = (std::pair<Address,Trace::Level> *)0;
-	while (i.next(k,v)) {
-		if ((v)&&(v->first)&&((int)v->second >= (int)level))
-			_send(tPtr,d,v->first);
+	if ((flags & Record::FLAG_ALL_NETWORKS) != 0)
+		return (_byNet.size() > 0);
+	if (networkId) {
+		const std::pair<Address,Trace::Level> *const v = _byNet.get(networkId);
+		return ((v)&&(v->first)&&((int)v->second >= (int)level));
 	}
+	return false;
+}
+
+void Trace::_record(Record &r)
+{
+	r.timestamp = RR->node->now();
+	_ring.push(r);
+}
+
+void Trace::_send(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Address &dest)
+{
+	Packet outp(dest,RR->identity.address(),Packet::VERB_REMOTE_TRACE);
+	outp.appendCString(d.data());
+	outp.compress();
+	RR->sw->send(tPtr,outp,true);
 }
 
 } // namespace ZeroTier
@@ -19,6 +19,9 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <vector>
+#include <utility>
+
 #include "../include/ZeroTierOne.h"
 
 #include "Constants.hpp"
@@ -29,6 +32,19 @@
 #include "Dictionary.hpp"
 #include "Mutex.hpp"
 #include "Hashtable.hpp"
+#include "TraceRing.hpp"
+
+// Trace records buffered between events and flush(), a power of two
+#define ZT_TRACE_RING_SIZE 512
+
+// Most recent trace records kept for local reading when local tracing is on
+#define ZT_TRACE_LOCAL_HISTORY 1024
+
+// Maximum size of a record in dictionary form
+#define ZT_TRACE_MAX_RECORD_SIZE 1024
+
+// Maximum payload of a VERB_REMOTE_TRACE packet carrying a batch of records
+#define ZT_TRACE_MAX_BATCH_BYTES 4096
 
 namespace ZeroTier {
 
@@ -48,6 +64,14 @@ class Capability;
 
 /**
  * Remote tracing and trace logging handler
+ *
+ * Events are captured as fixed-size binary records in a lock-free ring, so
+ * the thread reporting one never allocates, formats text, or sends a packet.
+ * flush() later turns them into dictionaries and sends them to remote trace
+ * targets, several per VERB_REMOTE_TRACE packet, and keeps the most recent
+ * for local reading if local tracing is on. Events nobody wants at their
+ * level are not recorded at all. Rule filter traces, which carry frame data
+ * and rule logs, are still sent as they happen.
  */
 class Trace
 {
@@ -99,12 +123,110 @@ public:
 		uint8_t _l[ZT_MAX_NETWORK_RULES / 2];
 	};
 
+	/**
+	 * A trace event in binary form
+	 */
+	struct Record
+	{
+		// Fields, in the order they appear in a record's dictionary
+		enum Field
+		{
+			F_PACKET_ID = 0,
+			F_PACKET_VERB,
+			F_PACKET_HOPS,
+			F_REMOTE_ZTADDR,
+			F_LOCAL_SOCKET,
+			F_IP_SCOPE,
+			F_NETWORK_ID,
+			F_NETWORK_CONTROLLER_ID,
+			F_SOURCE_MAC,
+			F_DEST_MAC,
+			F_ETHERTYPE,
+			F_VLAN_ID,
+			F_FRAME_LENGTH,
+			F_CREDENTIAL_TYPE,
+			F_CREDENTIAL_ID,
+			F_CREDENTIAL_TIMESTAMP,
+			F_CREDENTIAL_ISSUED_TO,
+			F_CREDENTIAL_INFO,
+			F_CREDENTIAL_REVOCATION_TARGET,
+			F_NUMERIC_COUNT, // fields above are held in values[]
+			F_REMOTE_PHYADDR = F_NUMERIC_COUNT,
+			F_LOCAL_PHYADDR,
+			F_REASON
+		};
+
+		enum
+		{
+			FLAG_GLOBAL_ONLY = 0x01, // only for the node's own trace target, not networks'
+			FLAG_ALL_NETWORKS = 0x02 // for the trace targets of all networks
+		};
+
+		Record() {}
+		Record(const unsigned int e,const Level l,const unsigned int f) :
+			fields(0),
+			event((uint16_t)e),
+			level((uint8_t)l),
+			flags((uint8_t)f) {}
+
+		inline void set(const Field f,const uint64_t v)
+		{
+			fields |= (1UL << (unsigned int)f);
+			values[f] = v;
+		}
+
+		inline void setPhysicalAddress(const Field f,const InetAddress &a)
+		{
+			uint8_t *const pa = phy[f - F_REMOTE_PHYADDR];
+			const unsigned int port = a.port();
+			pa[0] = (a.ss_family == AF_INET6) ? 6 : ((a.ss_family == AF_INET) ? 4 : 0);
+			pa[1] = (uint8_t)(port >> 8);
+			pa[2] = (uint8_t)port;
+			if (pa[0])
+				memcpy(pa + 3,a.rawIpData(),(pa[0] == 6) ? 16 : 4);
+			fields |= (1UL << (unsigned int)f);
+		}
+
+		inline void setReason(const char *r)
+		{
+			Utils::scopy(reason,sizeof(reason),r);
+			fields |= (1UL << (unsigned int)F_REASON);
+		}
+
+		/**
+		 * Encode as a dictionary, the form sent to remote trace targets
+		 *
+		 * @param d Dictionary to fill
+		 * @return False if it didn't fit
+		 */
+		bool toDictionary(Dictionary<ZT_TRACE_MAX_RECORD_SIZE> &d) const;
+
+		int64_t timestamp;
+		uint32_t fields; // bit per field present
+		uint16_t event;  // ZT_REMOTE_TRACE_EVENT__*
+		uint8_t level;   // minimum trace level at which this is reported
+		uint8_t flags;
+		uint64_t values[F_NUMERIC_COUNT];
+		uint8_t phy[2][19]; // remote and local physical address: IP version (4, 6, or 0), port, IP
+		char reason[48];
+	};
+
 	Trace(const RuntimeEnvironment *renv) :
 		RR(renv),
-		_byNet(8)
+		_byNet(8),
+		_localLevel(-1),
+		_local((Record *)0),
+		_localSeq(0),
+		_remoteRecords(0),
+		_remotePackets(0)
 	{
 	}
 
+	~Trace()
+	{
+		delete [] _local;
+	}
+
 	void resettingPathsInScope(void *const tPtr,const Address &reporter,const InetAddress &reporterPhysicalAddress,const InetAddress &myPhysicalAddress,const InetAddress::IpScope scope);
 
 	void peerConfirmingUnknownPath(void *const tPtr,const uint64_t networkId,Peer &peer,const SharedPtr<Path> &path,const uint64_t packetId,const Packet::Verb verb);
@@ -152,16 +274,51 @@ public:
 
 	void updateMemoizedSettings();
 
+	/**
+	 * Deliver buffered records to remote trace targets and the local history
+	 *
+	 * @param tPtr Thread pointer to be handed through to any callbacks called as a result of this call
+	 */
+	void flush(void *const tPtr);
+
+	/**
+	 * Set the level up to which events are recorded for local reading
+	 *
+	 * @param level Trace level or -1 to turn local tracing off
+	 */
+	void setLocalLevel(const int level);
+
+	/**
+	 * Get records from the local history
+	 *
+	 * @param since Return only records with a sequence number above this
+	 * @param events Vector to fill with sequence numbers and records, oldest first
+	 * @param counters Filled with records accepted, records dropped (buffer full), records sent to remote targets, and packets sent
+	 */
+	void localEvents(const uint64_t since,std::vector< std::pair< uint64_t,Record > > &events,uint64_t counters[4]) const;
+
 private:
 	const RuntimeEnvironment *const RR;
 
+	bool _wanted(const Level level,const uint64_t networkId,const unsigned int flags);
+	void _record(Record &r);
 	void _send(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Address &dest);
-	void _spamToAllNetworks(void *const tPtr,const Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> &d,const Level level);
 
 	Address _globalTarget;
 	Trace::Level _globalLevel;
 	Hashtable< uint64_t,std::pair< Address,Trace::Level > > _byNet;
 	Mutex _byNet_m;
+
+	TraceRing< Record,ZT_TRACE_RING_SIZE > _ring;
+	Mutex _flush_m; // only one thread may read _ring
+
+	volatile int _localLevel;
+	Record *_local; // ZT_TRACE_LOCAL_HISTORY records, allocated when local tracing is first turned on
+	uint64_t _localSeq;
+	mutable Mutex _local_m;
+
+	uint64_t _remoteRecords;
+	uint64_t _remotePackets;
 };
 
 } // namespace ZeroTier
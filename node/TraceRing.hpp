@@ -0,0 +1,123 @@
+/*
+ * Copyright (c)2019 ZeroTier, Inc.
+ *
+ * Use of this software is governed by the Business Source License included
+ * in the LICENSE.TXT file in the project's root directory.
+ *
+ * Change Date: 2023-01-01
+ *
+ * On the date above, in accordance with the Business Source License, use
+ * of this software will be governed by version 2.0 of the Apache License.
+ */
+/****/
+
+#ifndef ZT_TRACERING_HPP
+#define ZT_TRACERING_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace ZeroTier {
+
+/**
+ * Bounded lock-free queue of fixed-size records with many writers and one reader
+ *
+ * Writers claim a slot by advancing the head with a compare-and-swap, copy
+ * their record in, and publish it by bumping that slot's sequence number.
+ * They never wait: if the ring is full the record is dropped and counted.
+ * The reader takes published records in order and hands their slots back.
+ *
+ * Only one thread may call pop() at a time.
+ *
+ * @tparam T Record type (must be copyable without allocating)
+ * @tparam S Number of slots, a power of two
+ */
+template<typename T,unsigned int S>
+class TraceRing
+{
+public:
+	TraceRing() :
+		_head(0),
+		_dropped(0),
+		_tail(0)
+	{
+		for(unsigned int i=0;i<S;++i)
+			_s[i].seq.store((uint64_t)i,std::memory_order_relaxed);
+	}
+
+	/**
+	 * Add a record (safe to call from any thread)
+	 *
+	 * @param r Record to copy into the ring
+	 * @return False if the ring was full and the record was dropped
+	 */
+	inline bool push(const T &r)
+	{
+		uint64_t pos = _head.load(std::memory_order_relaxed);
+		for(;;) {
+			_Slot &s = _s[pos & (S - 1)];
+			const int64_t d = (int64_t)(s.seq.load(std::memory_order_acquire) - pos);
+			if (d == 0) {
+				if (_head.compare_exchange_weak(pos,pos + 1,std::memory_order_relaxed)) {
+					s.r = r;
+					s.seq.store(pos + 1,std::memory_order_release);
+					return true;
+				}
+			} else if (d < 0) {
+				_dropped.fetch_add(1,std::memory_order_relaxed);
+				return false;
+			} else {
+				pos = _head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Take the oldest published record (single reader only)
+	 *
+	 * @param r Record to fill
+	 * @return False if there is nothing to read
+	 */
+	inline bool pop(T &r)
+	{
+		_Slot &s = _s[_tail & (S - 1)];
+		if (s.seq.load(std::memory_order_acquire) != (_tail + 1))
+			return false;
+		r = s.r;
+		s.seq.store(_tail + S,std::memory_order_release);
+		++_tail;
+		return true;
+	}
+
+	/**
+	 * @return Number of records accepted since creation
+	 */
+	inline uint64_t pushed() const { return _head.load(std::memory_order_relaxed); }
+
+	/**
+	 * @return Number of records dropped because the ring was full
+	 */
+	inline uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+	/**
+	 * @return Value of S template parameter
+	 */
+	inline unsigned int capacity() const { return S; }
+
+private:
+	struct _Slot
+	{
+		std::atomic<uint64_t> seq; // == position + 1 when published, position + S when free again
+		T r;
+	};
+
+	_Slot _s[S];
+	std::atomic<uint64_t> _head;
+	std::atomic<uint64_t> _dropped;
+	uint64_t _tail;
+};
+
+} // namespace ZeroTier
+
+#endif
@@ -808,6 +808,7 @@ static void idtoolPrintHelp(FILE *out,const char *pn)
 		LICENSE_GRANT ZT_EOL_S);
 	fprintf(out,"Usage: %s <command> [<args>]" ZT_EOL_S"" ZT_EOL_S"Commands:" ZT_EOL_S,pn);
 	fprintf(out,"  generate [<identity.secret>] [<identity.public>] [<vanity>]" ZT_EOL_S);
+	fprintf(out,"  generatebatch <count> [<threads>] [<vanity>]" ZT_EOL_S);
 	fprintf(out,"  validate <identity.secret/public>" ZT_EOL_S);
 	fprintf(out,"  getpublic <identity.secret>" ZT_EOL_S);
 	fprintf(out,"  sign <identity.secret> <file>" ZT_EOL_S);
@@ -816,6 +817,44 @@ static void idtoolPrintHelp(FILE *out,const char *pn)
 	fprintf(out,"  genmoon <moon json>" ZT_EOL_S);
 }
 
+struct IdtoolGenerateState
+{
+	uint64_t vanity;
+	int vanityBits;
+	unsigned long count;
+	unsigned long found;
+	Identity id;
+};
+
+// Handler for Identity::generateMany() that stops on the first vanity match
+static bool idtoolGenerateOne(void *arg,const Identity &id)
+{
+	IdtoolGenerateState *const st = reinterpret_cast<IdtoolGenerateState *>(arg);
+	if ((id.address().toInt() >> (40 - st->vanityBits)) == st->vanity) {
+		if (st->vanityBits > 0) {
+			fprintf(stderr,"vanity address: found %.10llx !\n",(unsigned long long)id.address().toInt());
+		}
+		st->id = id;
+		return false;
+	} else {
+		fprintf(stderr,"vanity address: tried %.10llx looking for first %d bits of %.10llx\n",(unsigned long long)id.address().toInt(),st->vanityBits,(unsigned long long)(st->vanity << (40 - st->vanityBits)));
+		return true;
+	}
+}
+
+// Handler for Identity::generateMany() that prints identities until count vanity matches are found
+static bool idtoolGenerateBatch(void *arg,const Identity &id)
+{
+	IdtoolGenerateState *const st = reinterpret_cast<IdtoolGenerateState *>(arg);
+	if ((id.address().toInt() >> (40 - st->vanityBits)) == st->vanity) {
+		char idtmp[1024];
+		printf("%s" ZT_EOL_S,id.toString(true,idtmp));
+		fflush(stdout);
+		++st->found;
+	}
+	return (st->found < st->count);
+}
+
 static Identity getIdFromArg(char *arg)
 {
 	Identity id;
@@ -844,28 +883,21 @@ static int idtool(int argc,char **argv)
 	}
 
 	if (!strcmp(argv[1],"generate")) {
-		uint64_t vanity = 0;
-		int vanityBits = 0;
+		IdtoolGenerateState st;
+		st.vanity = 0;
+		st.vanityBits = 0;
+		st.count = 1;
+		st.found = 0;
 		if (argc >= 5) {
-			vanity = Utils::hexStrToU64(argv[4]) & 0xffffffffffULL;
-			vanityBits = 4 * (int)strlen(argv[4]);
-			if (vanityBits > 40)
-				vanityBits = 40;
-		}
-
-		Identity id;
-		for(;;) {
-			id.generate();
-			if ((id.address().toInt() >> (40 - vanityBits)) == vanity) {
-				if (vanityBits > 0) {
-					fprintf(stderr,"vanity address: found %.10llx !\n",(unsigned long long)id.address().toInt());
-				}
-				break;
-			} else {
-				fprintf(stderr,"vanity address: tried %.10llx looking for first %d bits of %.10llx\n",(unsigned long long)id.address().toInt(),vanityBits,(unsigned long long)(vanity << (40 - vanityBits)));
-			}
+			st.vanity = Utils::hexStrToU64(argv[4]) & 0xffffffffffULL;
+			st.vanityBits = 4 * (int)strlen(argv[4]);
+			if (st.vanityBits > 40)
+				st.vanityBits = 40;
 		}
 
+		Identity::generateMany(0,&idtoolGenerateOne,&st);
+		const Identity &id = st.id;
+
 		char idtmp[1024];
 		std::string idser = id.toString(true,idtmp);
 		if (argc >= 3) {
@@ -881,6 +913,33 @@ static int idtool(int argc,char **argv)
 				} else printf("%s written" ZT_EOL_S,argv[3]);
 			}
 		} else printf("%s",idser.c_str());
+	} else if (!strcmp(argv[1],"generatebatch")) {
+		if (argc < 3) {
+			idtoolPrintHelp(stdout,argv[0]);
+			return 1;
+		}
+
+		IdtoolGenerateState st;
+		st.vanity = 0;
+		st.vanityBits = 0;
+		st.count = strtoul(argv[2],(char **)0,10);
+		st.found = 0;
+		unsigned int threads = 0;
+		if (argc >= 4)
+			threads = (unsigned int)strtoul(argv[3],(char **)0,10);
+		if (argc >= 5) {
+			st.vanity = Utils::hexStrToU64(argv[4]) & 0xffffffffffULL;
+			st.vanityBits = 4 * (int)strlen(argv[4]);
+			if (st.vanityBits > 40)
+				st.vanityBits = 40;
+		}
+
+		if (st.count > 0) {
+			const int64_t start = OSUtils::now();
+			const unsigned long tried = Identity::generateMany(threads,&idtoolGenerateBatch,&st);
+			const int64_t elapsed = std::max(OSUtils::now() - start,(int64_t)1);
+			fprintf(stderr,"generated %lu identities (%lu tried) in %lldms (%.2f/sec)" ZT_EOL_S,st.found,tried,(long long)elapsed,((double)tried * 1000.0) / (double)elapsed);
+		}
 	} else if (!strcmp(argv[1],"validate")) {
 		if (argc < 3) {
 			idtoolPrintHelp(stdout,argv[0]);
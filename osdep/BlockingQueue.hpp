@@ -15,6 +15,7 @@
 #define ZT_BLOCKINGQUEUE_HPP
 
 #include <queue>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
@@ -81,6 +82,33 @@ public:
 		return true;
 	}
 
+	/**
+	 * Wait for at least one item and then take up to a maximum number of items
+	 *
+	 * @param values Vector to fill (existing contents are replaced)
+	 * @param max Maximum number of items to take
+	 * @return False if queue was stopped
+	 */
+	inline bool getBatch(std::vector<T> &values,const unsigned long max)
+	{
+		values.clear();
+		std::unique_lock<std::mutex> lock(m);
+		if (!r) return false;
+		while (q.empty()) {
+			c.wait(lock);
+			if (!r) {
+				gc.notify_all();
+				return false;
+			}
+		}
+		while ((!q.empty())&&(values.size() < max)) {
+			values.push_back(q.front());
+			q.pop();
+		}
+		gc.notify_all();
+		return true;
+	}
+
 	enum TimedWaitResult
 	{
 		OK,
@@ -21,6 +21,10 @@
 #include <string>
 #include <vector>
 #include <thread>
+#include <algorithm>
+#include <condition_variable>
+#include <unordered_map>
+#include <atomic>
 
 #include "node/Constants.hpp"
 #include "node/Hashtable.hpp"
@@ -30,23 +34,35 @@
 #include "node/Identity.hpp"
 #include "node/Buffer.hpp"
 #include "node/Packet.hpp"
+#include "node/CompressionTracker.hpp"
 #include "node/Salsa20.hpp"
 #include "node/MAC.hpp"
 #include "node/NetworkConfig.hpp"
 #include "node/Peer.hpp"
 #include "node/Dictionary.hpp"
 #include "node/SHA512.hpp"
+#include "node/HashTree.hpp"
 #include "node/C25519.hpp"
 #include "node/Poly1305.hpp"
 #include "node/CertificateOfMembership.hpp"
 #include "node/Node.hpp"
 #include "node/IncomingPacket.hpp"
+#include "node/Trace.hpp"
+#include "node/TraceRing.hpp"
+
+#include "controller/DB.hpp"
+#include "controller/EmbeddedNetworkController.hpp"
+#include "controller/FileDB.hpp"
+#include "controller/DBMirrorSet.hpp"
+#include "controller/LFDB.hpp"
 
 #include "osdep/OSUtils.hpp"
 #include "osdep/Phy.hpp"
 #include "osdep/PortMapper.hpp"
 #include "osdep/Thread.hpp"
 
+#include "ext/cpp-httplib/httplib.h"
+
 #ifdef ZT_USE_X64_ASM_SALSA2012
 #include "ext/x64-salsa2012-asm/salsa2012.h"
 #endif
@@ -60,6 +76,24 @@
 
 using namespace ZeroTier;
 
+// Counts heap allocations so benchmarks can report them. These are kept out of
+// line so compilers don't pair malloc() and free() across inlined call sites.
+#ifdef __GNUC__
+#define ZT_SELFTEST_NOINLINE __attribute__((noinline))
+#else
+#define ZT_SELFTEST_NOINLINE
+#endif
+static std::atomic<unsigned long> s_allocations(0);
+ZT_SELFTEST_NOINLINE void *operator new(std::size_t size)
+{
+	++s_allocations;
+	void *const p = malloc((size) ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+ZT_SELFTEST_NOINLINE void operator delete(void *p) noexcept { free(p); }
+
 //////////////////////////////////////////////////////////////////////////////
 
 #define KNOWN_GOOD_IDENTITY "8e4df28b72:0:ac3d46abe0c21f3cfe7a6c8d6a85cfcffcb82fbd55af6a4d6350657c68200843fa2e16f9418bbd9702cae365f2af5fb4c420908b803a681d4daef6114d78a2d7:bd8dd6e4ce7022d2f812797a80c6ee8ad180dc4ebf301dec8b06d1be08832bddd63a2f1cfa7b2c504474c75bdc8898ba476ef92e8e2d0509f8441985171ff16e"
@@ -263,6 +297,89 @@ static int testCrypto()
 	}
 	std::cout << "PASS" << std::endl;
 
+	std::cout << "[crypto] Testing SHA-512 multi-buffer (" << (SHA512::hash4Accelerated() ? "AVX2" : "scalar") << ")... "; std::cout.flush();
+	for(unsigned int k=0;k<sizeof(buf2);++k)
+		buf2[k] = (unsigned char)rand();
+	for(unsigned int l=0;l<400;++l) {
+		unsigned char d4[4][64];
+		void *dp[4];
+		const void *ip[4];
+		unsigned int il[4];
+		for(unsigned int i=0;i<4;++i) {
+			dp[i] = d4[i];
+			ip[i] = buf2 + (i * 1024);
+			il[i] = (i & 1) ? ((l * 7) % 1000) : l; // lanes of different lengths
+		}
+		SHA512::hash4(dp,ip,il);
+		for(unsigned int i=0;i<4;++i) {
+			SHA512::hash(buf1,ip[i],il[i]);
+			if (memcmp(buf1,d4[i],64)) {
+				std::cout << "FAIL (length " << il[i] << ")" << std::endl;
+				return -1;
+			}
+		}
+	}
+	std::cout << "PASS" << std::endl;
+
+	std::cout << "[crypto] Benchmarking SHA-512 (64-byte messages, single vs. multi-buffer)... "; std::cout.flush();
+	{
+		unsigned char d4[4][64];
+		void *dp[4] = { d4[0],d4[1],d4[2],d4[3] };
+		const void *ip[4] = { buf2,buf2 + 64,buf2 + 128,buf2 + 192 };
+		const unsigned int il[4] = { 64,64,64,64 };
+		uint64_t start = OSUtils::now();
+		for(unsigned int i=0;i<200000;++i) {
+			SHA512::hash(d4[0],buf2,64);
+			SHA512::hash(d4[1],buf2 + 64,64);
+			SHA512::hash(d4[2],buf2 + 128,64);
+			SHA512::hash(d4[3],buf2 + 192,64);
+		}
+		uint64_t end = OSUtils::now();
+		std::cout << (800000.0 / ((double)std::max(end - start,(uint64_t)1) / 1000.0)) << " vs. ";
+		start = OSUtils::now();
+		for(unsigned int i=0;i<200000;++i)
+			SHA512::hash4(dp,ip,il);
+		end = OSUtils::now();
+		std::cout << (800000.0 / ((double)std::max(end - start,(uint64_t)1) / 1000.0)) << " hashes/second" << std::endl;
+	}
+
+	std::cout << "[crypto] Testing hash tree proofs... "; std::cout.flush();
+	{
+		uint8_t leaves[19 * ZT_HASHTREE_HASH_LEN],root[ZT_HASHTREE_HASH_LEN],root2[ZT_HASHTREE_HASH_LEN],proof[ZT_HASHTREE_HASH_LEN * ZT_HASHTREE_MAX_DEPTH];
+		for(unsigned int i=0;i<19;++i)
+			HashTree::leaf(leaves + (i * ZT_HASHTREE_HASH_LEN),i * 100,buf2 + i,100);
+		for(unsigned int count=1;count<=19;++count) {
+			const HashTree tree(leaves,count);
+			memcpy(root,tree.root(),ZT_HASHTREE_HASH_LEN);
+			for(unsigned int i=0;i<count;++i) {
+				const unsigned int proofLen = tree.proof(proof,i);
+				if ((!HashTree::rootFromProof(root2,leaves + (i * ZT_HASHTREE_HASH_LEN),i,count,proof,proofLen))||(memcmp(root,root2,ZT_HASHTREE_HASH_LEN) != 0)) {
+					std::cout << "FAILED (proof " << i << " of " << count << ")" << std::endl;
+					return -1;
+				}
+				if ((count > 1)&&(HashTree::rootFromProof(root2,leaves + (((i + 1) % count) * ZT_HASHTREE_HASH_LEN),i,count,proof,proofLen))&&(memcmp(root,root2,ZT_HASHTREE_HASH_LEN) == 0)) {
+					std::cout << "FAILED (wrong leaf accepted)" << std::endl;
+					return -1;
+				}
+				if (HashTree::rootFromProof(root2,leaves + (i * ZT_HASHTREE_HASH_LEN),i,count,proof,proofLen + 1)) {
+					std::cout << "FAILED (bad proof length accepted)" << std::endl;
+					return -1;
+				}
+			}
+		}
+		HashTree::leaf(root2,100,buf2 + 1,100);
+		if (memcmp(root2,leaves + ZT_HASHTREE_HASH_LEN,ZT_HASHTREE_HASH_LEN) != 0) {
+			std::cout << "FAILED (leaf)" << std::endl;
+			return -1;
+		}
+		HashTree::leaf(root2,101,buf2 + 1,100);
+		if (memcmp(root2,leaves + ZT_HASHTREE_HASH_LEN,ZT_HASHTREE_HASH_LEN) == 0) {
+			std::cout << "FAILED (leaf position not bound)" << std::endl;
+			return -1;
+		}
+	}
+	std::cout << "PASS" << std::endl;
+
 	std::cout << "[crypto] Testing Poly1305... "; std::cout.flush();
 	Poly1305::compute(buf1,poly1305TV0Input,sizeof(poly1305TV0Input),poly1305TV0Key);
 	if (memcmp(buf1,poly1305TV0Tag,16)) {
@@ -406,6 +523,55 @@ static int testCrypto()
 	}
 	std::cout << "PASS" << std::endl;
 
+	std::cout << "[crypto] Testing Ed25519 batch verification... "; std::cout.flush();
+	{
+		C25519::Pair kp[7];
+		C25519::Signature sigs[7];
+		const C25519::Public *pub[7];
+		const void *msg[7];
+		unsigned int len[7];
+		const void *sig[7];
+		for(unsigned int i=0;i<7;++i) {
+			kp[i] = C25519::generate();
+			pub[i] = &(kp[i].pub);
+			msg[i] = buf1 + (i * 100);
+			len[i] = 100 + (i * 50);
+			sigs[i] = C25519::sign(kp[i],msg[i],len[i]);
+			sig[i] = sigs[i].data;
+		}
+		for(unsigned int n=0;n<=7;++n) {
+			if (!C25519::verifyMany(pub,msg,len,sig,n)) {
+				std::cout << "FAIL (1)" << std::endl;
+				return -1;
+			}
+		}
+		for(unsigned int i=0;i<7;++i) {
+			C25519::Signature bad(sigs[i]);
+			bad.data[rand() % ZT_C25519_SIGNATURE_LEN] ^= (unsigned char)(1 << (rand() & 7));
+			sig[i] = bad.data;
+			if (C25519::verifyMany(pub,msg,len,sig,7)) {
+				std::cout << "FAIL (2)" << std::endl;
+				return -1;
+			}
+			sig[i] = sigs[i].data;
+		}
+		std::cout << "PASS" << std::endl;
+
+		std::cout << "[crypto] Benchmarking Ed25519 verification (single vs. batch)... "; std::cout.flush();
+		st = OSUtils::now();
+		for(int k=0;k<50;++k) {
+			for(unsigned int i=0;i<4;++i)
+				C25519::verify(*pub[i],msg[i],len[i],sig[i]);
+		}
+		et = OSUtils::now();
+		std::cout << ((double)(et - st) / 200.0) << "ms vs. ";
+		st = OSUtils::now();
+		for(int k=0;k<50;++k)
+			C25519::verifyMany(pub,msg,len,sig,4);
+		et = OSUtils::now();
+		std::cout << ((double)(et - st) / 200.0) << "ms per signature" << std::endl;
+	}
+
 	std::cout << "[crypto] Benchmarking Ed25519 ECC signatures... "; std::cout.flush();
 	st = OSUtils::now();
 	for(int k=0;k<1000;++k) {
@@ -418,6 +584,19 @@ static int testCrypto()
 	return 0;
 }
 
+struct IdentityGenerateManyTest
+{
+	unsigned long wanted;
+	std::vector<Identity> ids;
+};
+
+static bool identityGenerateManyHandler(void *arg,const Identity &id)
+{
+	IdentityGenerateManyTest *const t = reinterpret_cast<IdentityGenerateManyTest *>(arg);
+	t->ids.push_back(id);
+	return (t->ids.size() < t->wanted);
+}
+
 static int testIdentity()
 {
 	Identity id;
@@ -465,6 +644,41 @@ static int testIdentity()
 		}
 	}
 
+	{
+		std::cout << "[identity] Generate identity (multithreaded)... "; std::cout.flush();
+		Identity id2;
+		id2.generate(2);
+		if ((!id2.hasPrivate())||(!id2.locallyValidate())) {
+			std::cout << "FAIL" << std::endl;
+			return -1;
+		}
+		std::cout << id2.address().toString(buf2) << " PASS" << std::endl;
+
+		const unsigned int hwc = std::max(std::thread::hardware_concurrency(),1U);
+		for(unsigned int threads=1;;threads<<=1) {
+			if (threads > hwc)
+				threads = hwc;
+			std::cout << "[identity] Benchmarking batch generation with " << threads << " thread(s)... "; std::cout.flush();
+			IdentityGenerateManyTest t;
+			t.wanted = threads * 4;
+			const int64_t genstart = OSUtils::now();
+			const unsigned long n = Identity::generateMany(threads,&identityGenerateManyHandler,&t);
+			const int64_t genend = OSUtils::now();
+			unsigned long valid = 0;
+			for(std::vector<Identity>::const_iterator i(t.ids.begin());i!=t.ids.end();++i) {
+				if (i->locallyValidate())
+					++valid;
+			}
+			if ((n != t.wanted)||(valid != t.wanted)) {
+				std::cout << "FAIL (" << n << " generated, " << valid << " valid)" << std::endl;
+				return -1;
+			}
+			std::cout << ((double)n * 1000.0) / (double)std::max(genend - genstart,(int64_t)1) << " identities/second" << std::endl;
+			if (threads >= hwc)
+				break;
+		}
+	}
+
 	{
 		Identity id2;
 		buf.clear();
@@ -624,9 +838,97 @@ static int testPacket()
 	}
 
 	std::cout << "PASS" << std::endl;
+
+	std::cout << "[packet] Testing adaptive compression bypass... "; std::cout.flush();
+	{
+		unsigned char frame[1400];
+		for(unsigned int i=0;i<sizeof(frame);++i)
+			frame[i] = (unsigned char)rand();
+		CompressionTracker ct;
+		int64_t now = 1000;
+		for(unsigned int i=0;i<ZT_PEER_COMPRESSION_MISS_THRESHOLD;++i) {
+			a.reset(Address(),Address(),Packet::VERB_FRAME);
+			a.append(frame,sizeof(frame));
+			ct.compress(a,now);
+		}
+		if ((!ct.bypassed())||(ct.misses() != ZT_PEER_COMPRESSION_MISS_THRESHOLD)) {
+			std::cout << "FAIL (not bypassed after misses)" << std::endl;
+			return -1;
+		}
+		a.reset(Address(),Address(),Packet::VERB_HELLO);
+		for(int i=0;i<32;++i)
+			a.append("supercalifragilisticexpealidocious",(unsigned int)strlen("supercalifragilisticexpealidocious"));
+		if ((ct.compress(a,now))||(ct.skipped() != 1)) {
+			std::cout << "FAIL (compressed while bypassed)" << std::endl;
+			return -1;
+		}
+		now += ZT_PEER_COMPRESSION_PROBE_INTERVAL;
+		if ((!ct.compress(a,now))||(ct.bypassed())) {
+			std::cout << "FAIL (probe did not resume compression)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+
+		std::cout << "[packet] Benchmarking compression of incompressible 1400-byte frames (always vs. adaptive)... "; std::cout.flush();
+		CompressionTracker ct2;
+		double t[2];
+		for(int k=0;k<2;++k) {
+			const uint64_t start = OSUtils::now();
+			for(unsigned int i=0;i<100000;++i) {
+				a.reset(Address(),Address(),Packet::VERB_FRAME);
+				a.append(frame,sizeof(frame));
+				if (k == 0)
+					a.compress();
+				else ct2.compress(a,(int64_t)OSUtils::now());
+			}
+			t[k] = ((double)(OSUtils::now() - start) * 1000.0) / 100000.0;
+		}
+		std::cout << t[0] << "us vs. " << t[1] << "us per frame (" << ct2.misses() << " tried, " << ct2.skipped() << " skipped)" << std::endl;
+	}
+
 	return 0;
 }
 
+// Fill in a config with the given numbers of rules, capabilities and tags
+static void _makeNetworkConfig(NetworkConfig &nc,const unsigned int ruleCount,const unsigned int capabilityCount,const unsigned int tagCount)
+{
+	const uint64_t nwid = 0x8056c2e21c000001ULL;
+	const Address issuedTo(0x1234567890ULL);
+	nc.networkId = nwid;
+	nc.timestamp = 1000;
+	nc.credentialTimeMaxDelta = ZT_NETWORKCONFIG_DEFAULT_CREDENTIAL_TIME_MAX_MAX_DELTA;
+	nc.revision = 1;
+	nc.issuedTo = issuedTo;
+	nc.flags = ZT_NETWORKCONFIG_FLAG_ENABLE_BROADCAST;
+	nc.mtu = ZT_DEFAULT_MTU;
+	nc.multicastLimit = 32;
+	nc.type = ZT_NETWORK_TYPE_PRIVATE;
+	Utils::scopy(nc.name,sizeof(nc.name),"selftest");
+	for(unsigned int i=0;i<ruleCount;++i) {
+		memset(&(nc.rules[i]),0,sizeof(ZT_VirtualNetworkRule));
+		if ((i & 1) == 0) {
+			nc.rules[i].t = (uint8_t)ZT_NETWORK_RULE_MATCH_ETHERTYPE;
+			nc.rules[i].v.etherType = (uint16_t)(0x0800 + i);
+		} else {
+			nc.rules[i].t = (uint8_t)ZT_NETWORK_RULE_ACTION_ACCEPT;
+		}
+	}
+	nc.ruleCount = ruleCount;
+	for(unsigned int i=0;i<capabilityCount;++i)
+		nc.capabilities[nc.capabilityCount++] = Capability(i + 1,nwid,1000,1,nc.rules.data(),std::min(ruleCount,(unsigned int)ZT_MAX_CAPABILITY_RULES));
+	for(unsigned int i=0;i<tagCount;++i)
+		nc.tags[nc.tagCount++] = Tag(nwid,1000,issuedTo,i + 1,i * 7);
+	nc.staticIps[nc.staticIpCount++] = InetAddress::makeIpv66plane(nwid,issuedTo.toInt());
+	nc.staticIps[nc.staticIpCount++] = InetAddress("10.1.2.3/24");
+	memset(&(nc.routes[0]),0,sizeof(ZT_VirtualNetworkRoute));
+	*reinterpret_cast<InetAddress *>(&(nc.routes[0].target)) = InetAddress("10.1.2.0/24");
+	nc.routeCount = 1;
+	nc.certificatesOfOwnership[0] = CertificateOfOwnership(nwid,1000,issuedTo,1);
+	nc.certificatesOfOwnership[0].addThing(nc.staticIps[1]);
+	nc.certificateOfOwnershipCount = 1;
+	nc.addSpecialist(Address(0xaabbccddeeULL),ZT_NETWORKCONFIG_SPECIALIST_TYPE_ACTIVE_BRIDGE);
+}
+
 static int testOther()
 {
 	char buf[1024];
@@ -874,6 +1176,352 @@ static int testOther()
 	}
 	std::cout << "PASS (junk value to prevent optimization-out of test: " << foo << ")" << std::endl;
 
+	std::cout << "[other] Testing/fuzzing DictionaryIndex against Dictionary... "; std::cout.flush();
+	for(int k=0;k<2000;++k) {
+		// Small alphabets so keys collide, repeat, and run into escapes and separators
+		char text[2048];
+		const int tl = rand() % (int)sizeof(text);
+		for(int q=0;q<tl;++q)
+			text[q] = ("ab=\\\r\nnre0")[rand() % 10];
+		text[tl] = (char)0;
+		Dictionary<2048> *test = new Dictionary<2048>(text);
+		const DictionaryIndex idx(*test);
+		for(unsigned int q=0;q<64;++q) {
+			char key[4];
+			const int kl = rand() % 4;
+			for(int x=0;x<kl;++x)
+				key[x] = ("abnr")[rand() % 4];
+			key[kl] = (char)0;
+			char v1[2048],v2[2048];
+			const unsigned int vl = (q & 1) ? (unsigned int)sizeof(v1) : (unsigned int)((rand() % 8) + 1);
+			memset(v1,1,sizeof(v1));
+			memset(v2,1,sizeof(v2));
+			const int r1 = test->get(key,v1,vl);
+			const int r2 = idx.get(key,v2,vl);
+			if ((r1 != r2)||(memcmp(v1,v2,(r1 >= 0) ? (r1 + 1) : 1))) {
+				std::cout << "FAILED (key '" << key << "': " << r1 << " != " << r2 << ")" << std::endl;
+				return -1;
+			}
+		}
+		delete test;
+	}
+	{
+		// More distinct keys than the index holds
+		Dictionary<8194> *test = new Dictionary<8194>();
+		char key[16];
+		for(unsigned int q=0;q<(ZT_DICTIONARY_INDEX_MAX_KEYS * 2);++q)
+			test->add(Utils::hex((uint32_t)q,key),(uint64_t)q);
+		test->add(Utils::hex((uint32_t)(ZT_DICTIONARY_INDEX_MAX_KEYS + 1),key),(uint64_t)0);
+		const DictionaryIndex idx(*test);
+		for(unsigned int q=0;q<(ZT_DICTIONARY_INDEX_MAX_KEYS * 2);++q) {
+			if ((idx.getUI(Utils::hex((uint32_t)q,key),0xffff) != q)||(idx.size() != ZT_DICTIONARY_INDEX_MAX_KEYS)) {
+				std::cout << "FAILED (key " << q << " past index capacity)" << std::endl;
+				return -1;
+			}
+		}
+		delete test;
+	}
+	std::cout << "PASS" << std::endl;
+
+	{
+		std::cout << "[other] Testing variable size NetworkConfig round trip, copy and compare... "; std::cout.flush();
+		NetworkConfig *nc = new NetworkConfig();
+		_makeNetworkConfig(*nc,20,3,5);
+		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *d = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		NetworkConfig *parsed = new NetworkConfig();
+		// Credentials and addresses have padding that deserialization doesn't define, so check those by field
+		bool ok = ((nc->toDictionary(*d,false))&&(parsed->fromDictionary(*d)));
+		ok = ((ok)&&(parsed->ruleCount == 20)&&(parsed->rules.equals(nc->rules,20))&&(parsed->tagCount == 5)&&(parsed->tags.equals(nc->tags,5))&&(parsed->routeCount == 1)&&(parsed->routes.equals(nc->routes,1)));
+		ok = ((ok)&&(parsed->staticIpCount == 2)&&(parsed->staticIps[0] == nc->staticIps[0])&&(parsed->staticIps[1] == nc->staticIps[1])&&(parsed->specialistCount == 1)&&(parsed->specialists[0] == nc->specialists[0]));
+		ok = ((ok)&&(parsed->capabilityCount == 3)&&(parsed->capabilities[2].id() == 3)&&(parsed->capabilities[2].ruleCount() == 20)&&(parsed->certificateOfOwnershipCount == 1)&&(parsed->certificatesOfOwnership[0].owns(nc->staticIps[1])));
+		NetworkConfig copy(*parsed);
+		ok = ((ok)&&(copy.rules.equals(parsed->rules,20))&&(copy.tags.equals(parsed->tags,5))&&(copy.capabilities[2].id() == 3)&&(copy.staticIps[1] == nc->staticIps[1])&&(copy.rules.size() == 20)&&(copy.capabilities.size() == 3)&&(copy.tags.size() == 5)&&(copy.memoryUsage() < parsed->memoryUsage()));
+		copy.rules[6].v.etherType ^= 1;
+		ok = ((ok)&&(copy != *parsed));
+		copy = NetworkConfig();
+		ok = ((ok)&&(copy.memoryUsage() == sizeof(NetworkConfig))&&(!copy.rules.data()));
+		delete parsed;
+		delete d;
+		delete nc;
+		if (!ok) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[other] Testing NetworkConfig deltas and malformed patches... "; std::cout.flush();
+		std::unique_ptr< Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> > base(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>()),next(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>());
+		std::unique_ptr< Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> > delta(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>()),full(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>());
+		base->add("a",(uint64_t)1);
+		base->add("r","0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz");
+		next->add("a",(uint64_t)1);
+		next->add("r","0123456789abcdefghijklmnopqrstuvwxyz0123456789ABCDEFghijklmnopqrstuvwxyz");
+		const uint64_t baseHash = NetworkConfig::dictionaryHash(base->data(),base->sizeBytes());
+		std::vector<NetworkConfig::DictionaryEntryHash> baseEntries;
+		bool ok = ((NetworkConfig::dictionaryEntryHashes(base->data(),base->sizeBytes(),baseEntries))&&
+			(NetworkConfig::encodeDelta(*next,baseHash,baseEntries,base->data(),base->sizeBytes(),*delta))&&(delta->contains("~r"))&&
+			(NetworkConfig::applyDelta(base->data(),base->sizeBytes(),*delta,*full))&&
+			(full->sizeBytes() == next->sizeBytes())&&(memcmp(full->data(),next->data(),next->sizeBytes()) == 0));
+		// Patches whose prefix and suffix lengths overflow when added must be rejected
+		static const uint32_t bad[3][2] = { { 0xffffffffU,2 },{ 2,0xffffffffU },{ 0x80000000U,0x80000000U } };
+		for(unsigned int b=0;b<3;++b) {
+			char patch[12];
+			for(unsigned int i=0;i<4;++i) {
+				patch[i] = (char)((bad[b][0] >> (24 - (i * 8))) & 0xff);
+				patch[4 + i] = (char)((bad[b][1] >> (24 - (i * 8))) & 0xff);
+			}
+			memcpy(patch + 8,"XYZW",4);
+			delta->clear();
+			delta->add(ZT_NETWORKCONFIG_DICT_KEY_DELTA_BASE,baseHash);
+			delta->add(ZT_NETWORKCONFIG_DICT_KEY_DELTA_HASH,NetworkConfig::dictionaryHash(next->data(),next->sizeBytes()));
+			delta->add(ZT_NETWORKCONFIG_DICT_KEY_DELTA_KEYS,"a,r");
+			delta->add("~r",patch,(int)sizeof(patch));
+			ok = ((ok)&&(!NetworkConfig::applyDelta(base->data(),base->sizeBytes(),*delta,*full)));
+		}
+		if (!ok) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		static const unsigned int shapes[2][3] = { { 40,2,4 },{ ZT_MAX_NETWORK_RULES,64,64 } }; // rules, capabilities, tags
+		// Specialists and static IPs are inline and already in sizeof(NetworkConfig); the other five arrays were inline too
+		const unsigned long fullCapacity = (unsigned long)(sizeof(NetworkConfig) - sizeof(NetworkConfigArray<uint64_t,1>) * 5) +
+			(sizeof(ZT_VirtualNetworkRoute) * ZT_MAX_NETWORK_ROUTES) +
+			(sizeof(ZT_VirtualNetworkRule) * ZT_MAX_NETWORK_RULES) + (sizeof(Capability) * ZT_MAX_NETWORK_CAPABILITIES) + (sizeof(Tag) * ZT_MAX_NETWORK_TAGS) +
+			(sizeof(CertificateOfOwnership) * ZT_MAX_CERTIFICATES_OF_OWNERSHIP) + ((unsigned long)ZT_NETWORKCONFIG_DICT_CAPACITY * ZT_NETWORK_MAX_INCOMING_UPDATES);
+		for(unsigned int sh=0;sh<2;++sh) {
+			std::cout << "[other] Benchmarking NetworkConfig with " << shapes[sh][0] << " rules, " << shapes[sh][1] << " capabilities and " << shapes[sh][2] << " tags... "; std::cout.flush();
+			NetworkConfig *nc = new NetworkConfig();
+			_makeNetworkConfig(*nc,shapes[sh][0],shapes[sh][1],shapes[sh][2]);
+			Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *d = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+			nc->toDictionary(*d,false);
+			const unsigned int dictLen = d->sizeBytes();
+
+			// What a joined network holds: the applied config plus the last config dictionary
+			NetworkConfig *applied = new NetworkConfig();
+			NetworkConfig *parsed = new NetworkConfig();
+			const unsigned int iterations = (sh == 0) ? 2000 : 100;
+			int64_t parseNanos = 0,copyNanos = 0;
+			for(unsigned int i=0;i<iterations;++i) {
+				const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+				parsed->fromDictionary(*d);
+				const std::chrono::steady_clock::time_point parsedAt(std::chrono::steady_clock::now());
+				*applied = *parsed;
+				parseNanos += (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(parsedAt - start).count();
+				copyNanos += (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - parsedAt).count();
+			}
+			const bool ok = ((applied->ruleCount == nc->ruleCount)&&(applied->rules.equals(nc->rules,nc->ruleCount))&&(applied->capabilityCount == nc->capabilityCount)&&(applied->tagCount == nc->tagCount));
+			const unsigned long perNetwork = applied->memoryUsage() + dictLen;
+			delete parsed;
+			delete applied;
+			delete d;
+			delete nc;
+			if (!ok) {
+				std::cout << "FAILED" << std::endl;
+				return -1;
+			}
+			std::cout << perNetwork << " bytes per network vs " << fullCapacity << " at full capacity, " << (parseNanos / iterations / 1000) << "us parse, " << (copyNanos / iterations / 1000) << "us apply copy" << std::endl;
+		}
+	}
+
+	{
+		std::cout << "[other] Benchmarking Dictionary lookups on a max-size network config... "; std::cout.flush();
+		NetworkConfig *nc = new NetworkConfig();
+		_makeNetworkConfig(*nc,ZT_MAX_NETWORK_RULES,ZT_MAX_NETWORK_CAPABILITIES,ZT_MAX_NETWORK_TAGS);
+		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *d = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY> *b = new Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		if (!nc->toDictionary(*d,false)) {
+			std::cout << "FAILED (config too large)" << std::endl;
+			return -1;
+		}
+
+		// Every key in the config plus one that isn't, the way fromDictionary() reads them
+		std::vector<std::string> keys;
+		{
+			const DictionaryIndex idx(*d);
+			for(unsigned int i=0;i<idx.size();++i)
+				keys.push_back(std::string(idx.entry(i).k,idx.entry(i).klen));
+			keys.push_back("notakey");
+		}
+
+		const unsigned int iterations = 50;
+		unsigned long linearBytes = 0,indexedBytes = 0;
+		const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+		for(unsigned int i=0;i<iterations;++i) {
+			for(std::vector<std::string>::const_iterator k(keys.begin());k!=keys.end();++k) {
+				d->get(k->c_str(),*b);
+				linearBytes += b->size();
+			}
+		}
+		const std::chrono::steady_clock::time_point linearDone(std::chrono::steady_clock::now());
+		for(unsigned int i=0;i<iterations;++i) {
+			const DictionaryIndex idx(*d);
+			for(std::vector<std::string>::const_iterator k(keys.begin());k!=keys.end();++k) {
+				idx.get(k->c_str(),*b);
+				indexedBytes += b->size();
+			}
+		}
+		const std::chrono::steady_clock::time_point indexedDone(std::chrono::steady_clock::now());
+		NetworkConfig *parsed = new NetworkConfig();
+		for(unsigned int i=0;i<iterations;++i)
+			parsed->fromDictionary(*d);
+		const std::chrono::steady_clock::time_point parseDone(std::chrono::steady_clock::now());
+
+		const bool ok = ((linearBytes == indexedBytes)&&(parsed->ruleCount == nc->ruleCount)&&(parsed->capabilityCount == nc->capabilityCount)&&(parsed->tagCount == nc->tagCount));
+		const unsigned int dictLen = d->sizeBytes();
+		delete parsed;
+		delete b;
+		delete d;
+		delete nc;
+		if (!ok) {
+			std::cout << "FAILED (lookups differ)" << std::endl;
+			return -1;
+		}
+		std::cout << keys.size() << " keys in " << dictLen << " bytes: " <<
+			(std::chrono::duration_cast<std::chrono::microseconds>(linearDone - start).count() / iterations) << "us linear, " <<
+			(std::chrono::duration_cast<std::chrono::microseconds>(indexedDone - linearDone).count() / iterations) << "us indexed, " <<
+			(std::chrono::duration_cast<std::chrono::microseconds>(parseDone - indexedDone).count() / iterations) << "us fromDictionary()" << std::endl;
+	}
+
+	{
+		std::cout << "[other] Testing TraceRing with concurrent writers... "; std::cout.flush();
+		const unsigned int writers = 4;
+		const uint64_t perWriter = 100000;
+		TraceRing<uint64_t,64> *ring = new TraceRing<uint64_t,64>();
+		std::atomic<unsigned int> running(writers);
+		std::atomic<uint64_t> failed(0);
+		std::vector<std::thread> threads;
+		for(unsigned int t=0;t<writers;++t) {
+			threads.push_back(std::thread([ring,&running,&failed,t,perWriter]() {
+				// Retry when full so every record gets through the ring at some point
+				for(uint64_t i=1;i<=perWriter;++i) {
+					while (!ring->push(((uint64_t)t << 32) | i)) {
+						++failed;
+						std::this_thread::yield();
+					}
+				}
+				--running;
+			}));
+		}
+
+		// Records from each writer must come out once each and in the order written
+		uint64_t last[writers];
+		memset(last,0,sizeof(last));
+		uint64_t popped = 0,r = 0;
+		bool ordered = true;
+		for(;;) {
+			if (ring->pop(r)) {
+				const unsigned int t = (unsigned int)(r >> 32);
+				if ((t >= writers)||((r & 0xffffffffULL) <= last[t]))
+					ordered = false;
+				else last[t] = r & 0xffffffffULL;
+				++popped;
+			} else if (running.load() == 0) {
+				while (ring->pop(r))
+					++popped;
+				break;
+			}
+		}
+		for(std::vector<std::thread>::iterator t(threads.begin());t!=threads.end();++t)
+			t->join();
+		const uint64_t pushed = ring->pushed(),dropped = ring->dropped();
+		delete ring;
+		if ((!ordered)||(popped != pushed)||(pushed != (writers * perWriter))||(dropped != failed.load())) {
+			std::cout << "FAILED (" << popped << " read, " << pushed << " accepted, " << dropped << " dropped" << (ordered ? "" : ", out of order") << ")" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS (" << pushed << " records, " << dropped << " pushes refused while full)" << std::endl;
+	}
+
+	{
+		std::cout << "[other] Testing trace record dictionary encoding... "; std::cout.flush();
+		Trace::Record r(ZT_REMOTE_TRACE_EVENT__INCOMING_NETWORK_FRAME_DROPPED,Trace::LEVEL_VERBOSE,0);
+		r.set(Trace::Record::F_PACKET_ID,0x0123456789abcdefULL);
+		r.set(Trace::Record::F_REMOTE_ZTADDR,0xdeadbeef01ULL);
+		r.set(Trace::Record::F_LOCAL_SOCKET,(uint64_t)((int64_t)-1));
+		r.set(Trace::Record::F_NETWORK_ID,0x8056c2e21c000001ULL);
+		r.setPhysicalAddress(Trace::Record::F_REMOTE_PHYADDR,InetAddress("10.1.2.3/9993"));
+		r.setPhysicalAddress(Trace::Record::F_LOCAL_PHYADDR,InetAddress("fd00::1/9994"));
+		r.setReason("a reason with = and \r\n in it");
+
+		// Same fields added the way events used to be encoded
+		char tmp[128];
+		Dictionary<ZT_MAX_REMOTE_TRACE_SIZE> expected;
+		expected.add(ZT_REMOTE_TRACE_FIELD__EVENT,ZT_REMOTE_TRACE_EVENT__INCOMING_NETWORK_FRAME_DROPPED_S);
+		expected.add(ZT_REMOTE_TRACE_FIELD__PACKET_ID,(uint64_t)0x0123456789abcdefULL);
+		expected.add(ZT_REMOTE_TRACE_FIELD__REMOTE_ZTADDR,Address(0xdeadbeef01ULL));
+		expected.add(ZT_REMOTE_TRACE_FIELD__LOCAL_SOCKET,(int64_t)-1);
+		expected.add(ZT_REMOTE_TRACE_FIELD__NETWORK_ID,(uint64_t)0x8056c2e21c000001ULL);
+		expected.add(ZT_REMOTE_TRACE_FIELD__REMOTE_PHYADDR,InetAddress("10.1.2.3/9993").toString(tmp));
+		expected.add(ZT_REMOTE_TRACE_FIELD__LOCAL_PHYADDR,InetAddress("fd00::1/9994").toString(tmp));
+		expected.add(ZT_REMOTE_TRACE_FIELD__REASON,"a reason with = and \r\n in it");
+
+		Dictionary<ZT_TRACE_MAX_RECORD_SIZE> d;
+		if (!r.toDictionary(d)) {
+			std::cout << "FAILED (encode)" << std::endl;
+			return -1;
+		}
+		const DictionaryIndex di(d),ei(expected);
+		char v1[ZT_TRACE_MAX_RECORD_SIZE],v2[ZT_TRACE_MAX_RECORD_SIZE];
+		bool same = (di.size() == ei.size());
+		for(unsigned int i=0;(same)&&(i<ei.size());++i) {
+			const DictionaryIndex::Entry &e = ei.entry(i);
+			const std::string k(e.k,e.klen);
+			DictionaryIndex::Entry tmpe;
+			const DictionaryIndex::Entry *const f = di.find(k.c_str(),tmpe);
+			same = ((f)&&(DictionaryIndex::value(e,v1,sizeof(v1)) == DictionaryIndex::value(*f,v2,sizeof(v2)))&&(strcmp(v1,v2) == 0));
+		}
+		if (!same) {
+			std::cout << "FAILED (got " << d.data() << ")" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[other] Benchmarking trace event recording... "; std::cout.flush();
+		const unsigned int iterations = 1000000;
+		TraceRing<Trace::Record,ZT_TRACE_RING_SIZE> *ring = new TraceRing<Trace::Record,ZT_TRACE_RING_SIZE>();
+		Trace::Record r(ZT_REMOTE_TRACE_EVENT__OUTGOING_NETWORK_FRAME_DROPPED,Trace::LEVEL_VERBOSE,0),out;
+		r.set(Trace::Record::F_NETWORK_ID,0x8056c2e21c000001ULL);
+		r.set(Trace::Record::F_SOURCE_MAC,0x0123456789abULL);
+		r.set(Trace::Record::F_DEST_MAC,0xffffffffffffULL);
+		r.set(Trace::Record::F_ETHERTYPE,0x0800);
+		r.set(Trace::Record::F_VLAN_ID,0);
+		r.set(Trace::Record::F_FRAME_LENGTH,1400);
+		r.setReason("filter blocked");
+
+		unsigned long n = 0;
+		const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+		for(unsigned int i=0;i<iterations;++i) {
+			r.set(Trace::Record::F_FRAME_LENGTH,i);
+			ring->push(r);
+			if ((i & (ZT_TRACE_RING_SIZE - 1)) == (ZT_TRACE_RING_SIZE - 1)) {
+				while (ring->pop(out))
+					++n;
+			}
+		}
+		const std::chrono::steady_clock::time_point pushDone(std::chrono::steady_clock::now());
+		Dictionary<ZT_TRACE_MAX_RECORD_SIZE> *d = new Dictionary<ZT_TRACE_MAX_RECORD_SIZE>();
+		unsigned long bytes = 0;
+		for(unsigned int i=0;i<(iterations / 10);++i) {
+			r.set(Trace::Record::F_FRAME_LENGTH,i);
+			r.toDictionary(*d);
+			bytes += d->sizeBytes();
+		}
+		const std::chrono::steady_clock::time_point encodeDone(std::chrono::steady_clock::now());
+		const uint64_t dropped = ring->dropped();
+		delete d;
+		delete ring;
+		std::cout << (std::chrono::duration_cast<std::chrono::nanoseconds>(pushDone - start).count() / iterations) << "ns per recorded event (" << n << " read, " << dropped << " dropped), " <<
+			(std::chrono::duration_cast<std::chrono::nanoseconds>(encodeDone - pushDone).count() / (iterations / 10)) << "ns to encode one for sending (" << (bytes / (iterations / 10)) << " bytes)" << std::endl;
+	}
+
 	return 0;
 }
 
@@ -1025,6 +1673,1496 @@ static int testPhy()
 	return 0;
 }
 
+// In-memory controller DB for exercising the common DB index code
+class SelftestDB : public DB
+{
+public:
+	virtual bool waitForReady() { return true; }
+	virtual bool isReady() { return true; }
+	virtual bool save(nlohmann::json &record,bool notifyListeners)
+	{
+		if (OSUtils::jsonString(record["objtype"],"") == "network") {
+			nlohmann::json old;
+			get(OSUtils::jsonIntHex(record["id"],0ULL),old);
+			if ((old.is_object())&&(_compareRecords(old,record)))
+				return false;
+			record["revision"] = OSUtils::jsonInt(record["revision"],0ULL) + 1ULL;
+			_networkChanged(old,record,notifyListeners);
+			return true;
+		}
+		nlohmann::json network,old;
+		if (!get(OSUtils::jsonIntHex(record["nwid"],0ULL),network,OSUtils::jsonIntHex(record["id"],0ULL),old))
+			old = nlohmann::json();
+		if ((old.is_object())&&(_compareRecords(old,record)))
+			return false;
+		record["revision"] = OSUtils::jsonInt(record["revision"],0ULL) + 1ULL;
+		_memberChanged(old,record,notifyListeners);
+		return true;
+	}
+	virtual unsigned long saveMembers(const uint64_t networkId,std::vector<nlohmann::json> &records,bool notifyListeners)
+	{
+		std::vector<unsigned long> changed;
+		_membersChanged(networkId,records,changed,notifyListeners);
+		return (unsigned long)changed.size();
+	}
+	virtual void eraseNetwork(const uint64_t networkId) {}
+	virtual void eraseMember(const uint64_t networkId,const uint64_t memberId)
+	{
+		nlohmann::json network,old,nullJson;
+		if (get(networkId,network,memberId,old))
+			_memberChanged(old,nullJson,false);
+	}
+
+	typedef DB::_OnlineMap OnlineMap;
+	inline void takeOnline(OnlineMap &online) { _takeOnline(online); }
+	inline void returnOnline(const OnlineMap &online) { _returnOnline(online); }
+
+	inline void addNetwork(uint64_t nwid)
+	{
+		char tmp[24];
+		OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)nwid);
+		nlohmann::json old,network;
+		network["id"] = tmp;
+		network["nwid"] = tmp;
+		network["objtype"] = "network";
+		network["revision"] = 0ULL;
+		_networkChanged(old,network,false);
+	}
+
+	static inline nlohmann::json member(uint64_t nwid,uint64_t id,uint32_t ip)
+	{
+		char tmp[64];
+		nlohmann::json m;
+		OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)nwid);
+		m["nwid"] = tmp;
+		OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx",(unsigned long long)id);
+		m["id"] = tmp;
+		m["authorized"] = true;
+		m["ipAssignments"] = nlohmann::json::array();
+		m["ipAssignments"].push_back(InetAddress(Utils::hton(ip),0).toIpString(tmp));
+		return m;
+	}
+};
+
+// Counts what the controller sends so tests can wait for responses to requests
+class SelftestSender : public NetworkController::Sender
+{
+public:
+	SelftestSender() : configs(0),errors(0),revocations(0) {}
+	virtual void ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig,bool hashTreeChunks) { _sent(configs); }
+	virtual void ncSendConfigDictionary(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &dconf,bool hashTreeChunks) { _sent(configs); }
+	virtual void ncSendRevocation(const Address &destination,const Revocation &rev) { _sent(revocations); }
+	virtual void ncSendError(uint64_t nwid,uint64_t requestPacketId,const Address &destination,NetworkController::ErrorCode errorCode) { _sent(errors); }
+
+	inline bool wait(const unsigned long n)
+	{
+		std::unique_lock<std::mutex> l(_l);
+		return _c.wait_for(l,std::chrono::seconds(30),[this,n]() { return ((configs + errors) >= n); });
+	}
+
+	inline bool waitRevocations(const unsigned long n)
+	{
+		std::unique_lock<std::mutex> l(_l);
+		return _c.wait_for(l,std::chrono::seconds(30),[this,n]() { return (revocations >= n); });
+	}
+
+	unsigned long configs,errors,revocations;
+
+private:
+	inline void _sent(unsigned long &n)
+	{
+		std::lock_guard<std::mutex> l(_l);
+		++n;
+		_c.notify_all();
+	}
+	std::mutex _l;
+	std::condition_variable _c;
+};
+
+// Simulated fleet of members that rebuilds and parses every config it's sent
+class SelftestFleet : public NetworkController::Sender
+{
+public:
+	SelftestFleet() : fullConfigs(0),deltaConfigs(0),failures(0),deltaBytes(0),fullBytes(0),rebuiltBytes(0),deltaApplyMicros(0),fullApplyMicros(0) {}
+	virtual void ncSendConfig(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const NetworkConfig &nc,bool sendLegacyFormatConfig,bool hashTreeChunks) { _done(failures); }
+	virtual void ncSendConfigDictionary(uint64_t nwid,uint64_t requestPacketId,const Address &destination,const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> &dconf,bool hashTreeChunks)
+	{
+		std::unique_ptr< Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> > rebuilt;
+		std::unique_ptr<NetworkConfig> nc(new NetworkConfig());
+		const bool delta = NetworkConfig::isDelta(dconf);
+		std::string base;
+		if (delta) {
+			std::lock_guard<std::mutex> l(_l);
+			base = _configs[destination.toInt()];
+		}
+		const std::chrono::steady_clock::time_point start(std::chrono::steady_clock::now());
+		const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *full = &dconf;
+		if (delta) {
+			rebuilt.reset(new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>());
+			full = (NetworkConfig::applyDelta(base.data(),(unsigned int)base.length(),dconf,*rebuilt)) ? rebuilt.get() : (const Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *)0;
+		}
+		const bool ok = ((full)&&(nc->fromDictionary(*full))&&(nc->networkId == nwid)&&(nc->issuedTo == destination));
+		const uint64_t micros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> l(_l);
+		if (ok) {
+			_configs[destination.toInt()].assign(full->data(),full->sizeBytes());
+			if (delta) {
+				++deltaConfigs;
+				deltaBytes += dconf.sizeBytes();
+				deltaApplyMicros += micros;
+			} else {
+				++fullConfigs;
+				fullBytes += dconf.sizeBytes();
+				fullApplyMicros += micros;
+			}
+			rebuiltBytes += full->sizeBytes();
+		} else ++failures;
+		_c.notify_all();
+	}
+	virtual void ncSendRevocation(const Address &destination,const Revocation &rev) {}
+	virtual void ncSendError(uint64_t nwid,uint64_t requestPacketId,const Address &destination,NetworkController::ErrorCode errorCode) { _done(failures); }
+
+	inline bool wait(const unsigned long n)
+	{
+		std::unique_lock<std::mutex> l(_l);
+		return _c.wait_for(l,std::chrono::seconds(60),[this,n]() { return ((fullConfigs + deltaConfigs + failures) >= n); });
+	}
+
+	// Wait until nothing has been sent for a while, e.g. pushes triggered by member saves
+	inline void settle()
+	{
+		std::unique_lock<std::mutex> l(_l);
+		for(;;) {
+			const unsigned long n = fullConfigs + deltaConfigs + failures;
+			if (!_c.wait_for(l,std::chrono::milliseconds(500),[this,n]() { return ((fullConfigs + deltaConfigs + failures) != n); }))
+				return;
+		}
+	}
+
+	inline uint64_t configHash(const uint64_t memberId)
+	{
+		std::lock_guard<std::mutex> l(_l);
+		const std::string &c = _configs[memberId];
+		return NetworkConfig::dictionaryHash(c.data(),(unsigned int)c.length());
+	}
+
+	inline void reset()
+	{
+		std::lock_guard<std::mutex> l(_l);
+		fullConfigs = deltaConfigs = failures = deltaBytes = fullBytes = rebuiltBytes = deltaApplyMicros = fullApplyMicros = 0;
+	}
+
+	unsigned long fullConfigs,deltaConfigs,failures;
+	uint64_t deltaBytes,fullBytes,rebuiltBytes;
+	uint64_t deltaApplyMicros,fullApplyMicros;
+
+private:
+	inline void _done(unsigned long &n)
+	{
+		std::lock_guard<std::mutex> l(_l);
+		++n;
+		_c.notify_all();
+	}
+	std::unordered_map<uint64_t,std::string> _configs;
+	std::mutex _l;
+	std::condition_variable _c;
+};
+
+// Rough heap footprint of a JSON DOM as held by nlohmann::json (std::map objects, std::vector arrays)
+static unsigned long _jsonMemoryUsage(const nlohmann::json &j)
+{
+	unsigned long m = (unsigned long)sizeof(nlohmann::json);
+	if (j.is_object()) {
+		m += (unsigned long)sizeof(nlohmann::json::object_t);
+		for(auto i=j.begin();i!=j.end();++i) {
+			m += 32 + (unsigned long)sizeof(std::string); // red-black tree node
+			if (i.key().length() > 15) m += (unsigned long)i.key().length() + 1;
+			m += _jsonMemoryUsage(i.value());
+		}
+	} else if (j.is_array()) {
+		m += (unsigned long)sizeof(nlohmann::json::array_t);
+		for(auto i=j.begin();i!=j.end();++i)
+			m += _jsonMemoryUsage(*i);
+	} else if (j.is_string()) {
+		m += (unsigned long)sizeof(std::string);
+		const std::string &s = j.get_ref<const std::string &>();
+		if (s.length() > 15) m += (unsigned long)s.length() + 1;
+	}
+	return m;
+}
+
+static int testController()
+{
+	const uint64_t nwid = 0x8056c2e21c000001ULL;
+
+	{
+		std::cout << "[controller] Testing DB IP allocation index... "; std::cout.flush();
+		SelftestDB db;
+		db.addNetwork(nwid);
+		nlohmann::json m1(SelftestDB::member(nwid,1,0x0a000001)),m2(SelftestDB::member(nwid,2,0x0a000001)),m3(SelftestDB::member(nwid,3,0x0a000003));
+		db.save(m1,false);
+		db.save(m2,false);
+		db.save(m3,false);
+		const InetAddress a1(Utils::hton((uint32_t)0x0a000001),0),a2(Utils::hton((uint32_t)0x0a000002),0),a3(Utils::hton((uint32_t)0x0a000003),24);
+		if ((!db.ipAllocated(nwid,a1))||(db.ipAllocated(nwid,a2))||(!db.ipAllocated(nwid,a3))) {
+			std::cout << "FAILED (lookup)" << std::endl;
+			return -1;
+		}
+		db.eraseMember(nwid,1);
+		if (!db.ipAllocated(nwid,a1)) {
+			std::cout << "FAILED (shared IP released while still assigned)" << std::endl;
+			return -1;
+		}
+		db.eraseMember(nwid,2);
+		m3 = SelftestDB::member(nwid,3,0x0a000002);
+		db.save(m3,false);
+		if ((db.ipAllocated(nwid,a1))||(!db.ipAllocated(nwid,a2))||(db.ipAllocated(nwid,a3))||(db.ipAllocated(nwid + 1,a2))) {
+			std::cout << "FAILED (release)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing member change detection... "; std::cout.flush();
+		nlohmann::json stored(SelftestDB::member(nwid,1,0x0a000001));
+		DB::initMember(stored);
+		DB::cleanMember(stored);
+		nlohmann::json m(stored);
+		m["revision"] = OSUtils::jsonInt(m["revision"],0ULL) + 1ULL;
+		if (DB::memberChangeType(stored,m) != DB::MEMBER_UNCHANGED) {
+			std::cout << "FAILED (revision only)" << std::endl;
+			return -1;
+		}
+		m["vMajor"] = 1;
+		m["vProto"] = 11;
+		if (DB::memberChangeType(stored,m) != DB::MEMBER_CHANGED_VOLATILE) {
+			std::cout << "FAILED (volatile)" << std::endl;
+			return -1;
+		}
+		m["authorized"] = !OSUtils::jsonBool(stored["authorized"],false);
+		if (DB::memberChangeType(stored,m) != DB::MEMBER_CHANGED) {
+			std::cout << "FAILED (material)" << std::endl;
+			return -1;
+		}
+		m = stored;
+		m["name"] = "x";
+		if ((DB::memberChangeType(stored,m) != DB::MEMBER_CHANGED)||(DB::memberChangeType(nlohmann::json(),stored) != DB::MEMBER_CHANGED)) {
+			std::cout << "FAILED (new field or new member)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing commit coalescing with mixed deletes... "; std::cout.flush();
+		std::vector< std::pair<nlohmann::json,bool> > batch;
+		auto rec = [&batch](const char *objtype,const char *nwid,const char *id,bool notify) {
+			std::pair<nlohmann::json,bool> r;
+			if (nwid) r.first["nwid"] = nwid;
+			r.first["id"] = id;
+			r.first["objtype"] = objtype;
+			r.second = notify;
+			batch.push_back(r);
+		};
+		rec("network",(const char *)0,"8056c2e21c000001",true);          // 0: replaced by 4
+		rec("member","8056c2e21c000001","0000000001",true);              // 1: replaced by 3
+		rec("member","8056c2e21c000001","0000000002",false);             // 2
+		rec("_delete_member","8056c2e21c000001","0000000001",false);     // 3
+		rec("_delete_network",(const char *)0,"8056c2e21c000001",false); // 4
+		rec("network",(const char *)0,"8056c2e21c000002",false);         // 5: replaced by 7
+		rec("member","8056c2e21c000002","0000000002",false);             // 6: other network than 2
+		rec("_delete_network",(const char *)0,"8056c2e21c000002",false); // 7: kept ahead of 9
+		rec("network",(const char *)0,"8056c2e21c000002",false);         // 8: replaced by 9
+		rec("network",(const char *)0,"8056c2e21c000002",true);          // 9
+		const bool kept[10] = { false,false,true,true,true,false,true,true,false,true };
+		const bool notify[10] = { false,false,false,true,true,false,false,false,false,true };
+		DB::coalesceCommits(batch);
+		for(unsigned int i=0;i<10;++i) {
+			if ((batch[i].first.is_object() != kept[i])||((kept[i])&&(batch[i].second != notify[i]))) {
+				std::cout << "FAILED (record " << i << ")" << std::endl;
+				return -1;
+			}
+			if ((kept[i])&&(batch[i].first.size() != ((batch[i].first.count("nwid")) ? 3U : 2U))) {
+				std::cout << "FAILED (record " << i << " modified)" << std::endl;
+				return -1;
+			}
+		}
+		if ((batch[4].first.count("nwid"))||(batch[7].first.count("nwid"))) {
+			std::cout << "FAILED (network delete gained nwid)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing compact member round trip... "; std::cout.flush();
+		char tmp[256];
+		nlohmann::json m(SelftestDB::member(nwid,0x1234567890ULL,0x0a000001));
+		DB::initMember(m);
+		m["ipAssignments"].push_back("fd80:56c2:e21c:0:199:9312:3456:7890");
+		m["capabilities"].push_back(1);
+		m["tags"].push_back(nlohmann::json::array({ 1000,42 }));
+		m["lastAuthorizedCredentialType"] = "api";
+		m["vMajor"] = 1;
+		for(unsigned int i=0;i<64;++i)
+			tmp[i] = (char)(i * 7);
+		std::string id("1234567890:0:");
+		id.append(Utils::hex(tmp,64,tmp + 64));
+		m["identity"] = id;
+		m["name"] = "extra field";
+		CompactMember cm;
+		cm.fromJson(nwid,0x1234567890ULL,m);
+		nlohmann::json m2;
+		cm.toJson(nwid,0x1234567890ULL,m2);
+		if (m2 != m) {
+			std::cout << "FAILED (" << OSUtils::jsonDump(m2,-1) << ")" << std::endl;
+			return -1;
+		}
+		// Non-canonical values must survive unchanged
+		m["identity"] = "1234567890:0:ABCD";
+		m["ipAssignments"].push_back("10.0.0.2/24");
+		m["tags"].push_back(1);
+		m["vMinor"] = "x";
+		cm.fromJson(nwid,0x1234567890ULL,m);
+		CompactMember cm2(cm);
+		cm = CompactMember();
+		cm2.toJson(nwid,0x1234567890ULL,m2);
+		if (m2 != m) {
+			std::cout << "FAILED (" << OSUtils::jsonDump(m2,-1) << ")" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing compact member parse from JSON text... "; std::cout.flush();
+		char tmp[256];
+		nlohmann::json m(SelftestDB::member(nwid,0x1234567890ULL,0x0a000001));
+		DB::initMember(m);
+		m["ipAssignments"].push_back("fd80:56c2:e21c:0:199:9312:3456:7890");
+		m["capabilities"].push_back(1);
+		m["tags"].push_back(nlohmann::json::array({ 1000,42 }));
+		m["lastAuthorizedCredentialType"] = "api";
+		m["lastDeauthorizedTime"] = 12345;
+		m["authorized"] = false;
+		m["activeBridge"] = true;
+		for(unsigned int i=0;i<64;++i)
+			tmp[i] = (char)(i * 11);
+		std::string id("1234567890:0:");
+		id.append(Utils::hex(tmp,64,tmp + 64));
+		m["identity"] = id;
+		m["name"] = "extra field";
+		m["nested"]["a"] = nlohmann::json::array({ 1,"two",nlohmann::json::object(),3.5 });
+		std::vector<std::string> texts;
+		texts.push_back(OSUtils::jsonDump(m,-1));
+		texts.push_back(OSUtils::jsonDump(m,2));
+		// Non-canonical values must end up where fromJson() puts them
+		m["identity"] = "1234567890:0:ABCD";
+		m["ipAssignments"].push_back("10.0.0.2/24");
+		m["tags"].push_back(1);
+		m["vMinor"] = "x";
+		m["authorized"] = "true";
+		m["lastDeauthorizedTime"] = "999";
+		m["address"] = "1234567891";
+		texts.push_back(OSUtils::jsonDump(m,-1));
+		for(auto t=texts.begin();t!=texts.end();++t) {
+			CompactMember a,b;
+			a.fromJson(nwid,0x1234567890ULL,OSUtils::jsonParse(*t));
+			const uint64_t memberId = b.fromJsonText(nwid,t->data(),(unsigned long)t->length());
+			nlohmann::json ma,mb;
+			a.toJson(nwid,0x1234567890ULL,ma);
+			b.toJson(nwid,0x1234567890ULL,mb);
+			std::vector<InetAddress> ipsa,ipsb;
+			a.ipAssignments(ipsa);
+			b.ipAssignments(ipsb);
+			if ((memberId != 0x1234567890ULL)||(ma != mb)||(ipsa != ipsb)||(a.authorized() != b.authorized())||(a.activeBridge() != b.activeBridge())||(a.lastDeauthorizedTime() != b.lastDeauthorizedTime())) {
+				std::cout << "FAILED (" << OSUtils::jsonDump(mb,-1) << ")" << std::endl;
+				return -1;
+			}
+		}
+		if ((texts.back().find("\"authorized\":\"true\"") == std::string::npos)||(!CompactMember().fromJsonText(nwid,texts.back().data(),(unsigned long)texts.back().length()))) {
+			std::cout << "FAILED (non-canonical)" << std::endl;
+			return -1;
+		}
+		CompactMember cm;
+		cm.fromJsonText(nwid,texts.back().data(),(unsigned long)texts.back().length());
+		std::vector<InetAddress> ips;
+		cm.ipAssignments(ips);
+		if ((!cm.authorized())||(cm.lastDeauthorizedTime() != 999)||(ips.size() != 3)||(ips[2] != InetAddress("10.0.0.2/0"))) {
+			std::cout << "FAILED (accessors)" << std::endl;
+			return -1;
+		}
+		// Text the fast path leaves to the DOM
+		const char *const rejected[7] = {
+			"[1,2,3]",
+			"\"member\"",
+			"{\"id\":\"1234567890\",\"nwid\":\"8056c2e21c000001\",\"authorized\":true,\"authorized\":false}",
+			"{\"id\":\"1234567890\",\"nwid\":\"8056c2e21c000001\",\"authorized\":tru}",
+			"{\"id\":\"123456789A\",\"nwid\":\"8056c2e21c000001\"}",
+			"{\"id\":\"1234567890\",\"nwid\":\"8056c2e21c000002\"}",
+			"{\"id\":\"1234567890\",\"nwid\":\"8056c2e21c000001\"} x"
+		};
+		for(unsigned int i=0;i<7;++i) {
+			if (cm.fromJsonText(nwid,rejected[i],(unsigned long)strlen(rejected[i])) != 0) {
+				std::cout << "FAILED (accepted " << rejected[i] << ")" << std::endl;
+				return -1;
+			}
+		}
+		cm.toJson(nwid,0x1234567890ULL,m);
+		if ((!m.empty())||(cm.revision() != 0)) {
+			std::cout << "FAILED (not reset)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing paged member listing... "; std::cout.flush();
+		SelftestDB db;
+		db.addNetwork(nwid);
+		for(unsigned long i=1;i<=1000;++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i * 3,0x0a000000 + (uint32_t)i));
+			m["authorized"] = ((i & 1) != 0);
+			m["revision"] = (uint64_t)i;
+			db.save(m,false);
+		}
+		unsigned long listed = 0,authorized = 0,pages = 0;
+		uint64_t after = 0,prev = 0;
+		for(;;) {
+			unsigned long n = 0;
+			db.eachMember(nwid,after,false,0,[&](const uint64_t memberId,const uint64_t revision,const bool auth) -> bool {
+				if (n >= 64)
+					return false;
+				if ((memberId <= prev)||(revision != ((memberId / 3) + 1))) {
+					listed = 0;
+					return false;
+				}
+				prev = after = memberId;
+				++n;
+				++listed;
+				authorized += (unsigned long)auth;
+				return true;
+			});
+			if (!n)
+				break;
+			++pages;
+		}
+		unsigned long filtered = 0;
+		db.eachMember(nwid,0,true,901,[&](const uint64_t memberId,const uint64_t revision,const bool auth) -> bool {
+			if ((auth)&&(revision >= 901))
+				++filtered;
+			return true;
+		});
+		if ((listed != 1000)||(authorized != 500)||(pages != 16)||(filtered != 50)||(db.eachMember(nwid + 1,0,false,0,[](uint64_t,uint64_t,bool) -> bool { return true; }))) {
+			std::cout << "FAILED (" << listed << " listed, " << authorized << " authorized, " << pages << " pages, " << filtered << " filtered)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing batched member save... "; std::cout.flush();
+		SelftestDB db;
+		db.addNetwork(nwid);
+		std::vector<nlohmann::json> batch;
+		for(unsigned long i=1;i<=100;++i)
+			batch.push_back(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)((i + 1) / 2))); // pairs share an IP
+		if (db.saveMembers(nwid,batch,false) != 100) {
+			std::cout << "FAILED (initial save)" << std::endl;
+			return -1;
+		}
+		for(unsigned long i=0;i<100;i+=2) {
+			batch[i]["ipAssignments"] = nlohmann::json::array();
+			batch[i]["authorized"] = false;
+		}
+		const InetAddress a1(Utils::hton((uint32_t)0x0a000001),0);
+		nlohmann::json network,m;
+		const unsigned long n = db.saveMembers(nwid,batch,false);
+		const bool stillAllocated = db.ipAllocated(nwid,a1);
+		for(unsigned long i=1;i<100;i+=2)
+			batch[i]["ipAssignments"] = nlohmann::json::array();
+		db.saveMembers(nwid,batch,false);
+		if ((n != 50)||(!stillAllocated)||(db.ipAllocated(nwid,a1))||(db.isAuthorized(nwid,1))||(!db.isAuthorized(nwid,2))||(!db.get(nwid,network,1,m))||(OSUtils::jsonInt(m["revision"],0ULL) != 2)) {
+			std::cout << "FAILED (" << n << " changed)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing config with pre-encoded rules entry... "; std::cout.flush();
+		NetworkConfig *nc = new NetworkConfig();
+		nc->networkId = nwid;
+		nc->timestamp = 1;
+		nc->revision = 1;
+		nc->issuedTo = Address(0x1122334455ULL);
+		nc->ruleCount = ZT_MAX_NETWORK_RULES;
+		for(unsigned int i=0;i<nc->ruleCount;++i) {
+			nc->rules[i].t = ((i & 1) == 0) ? (uint8_t)ZT_NETWORK_RULE_MATCH_ETHERTYPE : (uint8_t)ZT_NETWORK_RULE_ACTION_ACCEPT;
+			nc->rules[i].v.etherType = (uint16_t)(0x0800 + i); // includes bytes that need escaping
+		}
+		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *full = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *rulesOnly = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY> *spliced = new Dictionary<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY> *tmp = new Buffer<ZT_NETWORKCONFIG_DICT_CAPACITY>();
+		NetworkConfig *nc2 = new NetworkConfig();
+		NetworkConfig *nc3 = new NetworkConfig();
+		Capability::serializeRules(*tmp,nc->rules.data(),nc->ruleCount);
+		rulesOnly->add(ZT_NETWORKCONFIG_DICT_KEY_RULES,*tmp);
+		const std::string rulesEntry(rulesOnly->data(),rulesOnly->sizeBytes());
+
+		nc->toDictionary(*full,false);
+		const unsigned int ruleCount = nc->ruleCount;
+		nc->ruleCount = 0;
+		nc->toDictionary(*spliced,false);
+		spliced->addEncoded(rulesEntry.data(),(unsigned int)rulesEntry.length());
+		nc->ruleCount = ruleCount;
+		const bool ok = ((nc2->fromDictionary(*full))&&(nc3->fromDictionary(*spliced))&&(*nc2 == *nc3)&&(nc3->ruleCount == ruleCount));
+
+		const unsigned int benchIterations = 2000;
+		int64_t start = OSUtils::now();
+		for(unsigned int i=0;i<benchIterations;++i)
+			nc->toDictionary(*full,false);
+		const int64_t fullTime = OSUtils::now() - start;
+		nc->ruleCount = 0;
+		start = OSUtils::now();
+		for(unsigned int i=0;i<benchIterations;++i) {
+			nc->toDictionary(*spliced,false);
+			spliced->addEncoded(rulesEntry.data(),(unsigned int)rulesEntry.length());
+		}
+		const int64_t splicedTime = OSUtils::now() - start;
+
+		delete nc3;
+		delete nc2;
+		delete tmp;
+		delete spliced;
+		delete rulesOnly;
+		delete full;
+		delete nc;
+		if (!ok) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS (" << ZT_MAX_NETWORK_RULES << " rules: " << ((double)fullTime * 1000.0 / (double)benchIterations) << "us full, " << ((double)splicedTime * 1000.0 / (double)benchIterations) << "us pre-encoded)" << std::endl;
+	}
+
+	{
+		// Same chunking as Node::ncSendConfigDictionary()
+		Identity signer;
+		signer.fromString(KNOWN_GOOD_IDENTITY);
+		const unsigned int maxChunkLen = ZT_PROTO_MAX_PACKET_LENGTH - (ZT_PACKET_IDX_PAYLOAD + 256);
+		const unsigned int treeChunkLen = maxChunkLen - (5 + (ZT_HASHTREE_HASH_LEN * 8));
+		const unsigned int sizes[2] = { ZT_NETWORKCONFIG_DICT_CAPACITY / 4,ZT_NETWORKCONFIG_DICT_CAPACITY - 1 };
+		std::vector<uint8_t> dict(ZT_NETWORKCONFIG_DICT_CAPACITY);
+		Utils::getSecureRandom(dict.data(),(unsigned int)dict.size());
+		for(unsigned int s=0;s<2;++s) {
+			const unsigned int totalSize = sizes[s];
+			std::cout << "[controller] Benchmarking config chunk signing (" << totalSize << " bytes)... "; std::cout.flush();
+			const unsigned int configs = 200;
+
+			unsigned long legacySigs = 0;
+			int64_t start = OSUtils::now();
+			for(unsigned int n=0;n<configs;++n) {
+				for(unsigned int chunkIndex=0;chunkIndex<totalSize;chunkIndex+=maxChunkLen) {
+					signer.sign(dict.data() + chunkIndex,std::min(totalSize - chunkIndex,maxChunkLen));
+					++legacySigs;
+				}
+			}
+			const int64_t legacyTime = std::max(OSUtils::now() - start,(int64_t)1);
+
+			unsigned long treeSigs = 0;
+			const unsigned int chunkCount = (totalSize + (treeChunkLen - 1)) / treeChunkLen;
+			std::vector<uint8_t> leaves(chunkCount * ZT_HASHTREE_HASH_LEN);
+			uint8_t proof[ZT_HASHTREE_HASH_LEN * ZT_HASHTREE_MAX_DEPTH];
+			start = OSUtils::now();
+			for(unsigned int n=0;n<configs;++n) {
+				for(unsigned int c=0;c<chunkCount;++c)
+					HashTree::leaf(leaves.data() + (c * ZT_HASHTREE_HASH_LEN),c * treeChunkLen,dict.data() + (c * treeChunkLen),std::min(totalSize - (c * treeChunkLen),treeChunkLen));
+				const HashTree tree(leaves.data(),chunkCount);
+				signer.sign(tree.root(),ZT_HASHTREE_HASH_LEN);
+				++treeSigs;
+				for(unsigned int c=0;c<chunkCount;++c)
+					tree.proof(proof,c);
+			}
+			const int64_t treeTime = std::max(OSUtils::now() - start,(int64_t)1);
+
+			const double legacyRate = (double)configs / ((double)legacyTime / 1000.0);
+			const double treeRate = (double)configs / ((double)treeTime / 1000.0);
+			std::cout << ((double)legacySigs / (double)configs) << " vs. " << ((double)treeSigs / (double)configs) << " signatures/config, " << legacyRate << " vs. " << treeRate << " configs/second, " << (((double)(legacySigs - treeSigs) / (double)configs) * treeRate) << " signatures/second saved" << std::endl;
+		}
+	}
+
+	{
+		std::cout << "[controller] Benchmarking compact member storage with 10000 members... "; std::cout.flush();
+		SelftestDB db;
+		db.addNetwork(nwid);
+		unsigned long jsonBytes = 0,compactBytes = 0;
+		for(unsigned long i=1;i<=10000;++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+			DB::initMember(m);
+			m["lastAuthorizedCredentialType"] = "api";
+			m["identity"] = m["id"].get<std::string>() + ":0:" + std::string(128,'a');
+			CompactMember cm;
+			cm.fromJson(nwid,i,m);
+			jsonBytes += _jsonMemoryUsage(m);
+			compactBytes += cm.memoryUsage();
+			db.save(m,false);
+		}
+		const unsigned long lookups = 100000;
+		unsigned long found = 0;
+		const int64_t start = OSUtils::now();
+		for(unsigned long i=0;i<lookups;++i) {
+			nlohmann::json network,member;
+			if (db.get(nwid,network,(i % 10000) + 1,member))
+				found += (unsigned long)OSUtils::jsonBool(member["authorized"],false);
+		}
+		const int64_t end = OSUtils::now();
+		if (found != lookups) {
+			std::cout << "FAILED (lookup)" << std::endl;
+			return -1;
+		}
+		std::cout << (jsonBytes / 10000) << " vs. " << (compactBytes / 10000) << " bytes/member (JSON vs. compact), " << ((double)lookups / ((double)(end - start) / 1000.0)) << " lookups/second" << std::endl;
+	}
+
+	{
+		const unsigned long count = 10000;
+		std::cout << "[controller] Benchmarking member JSON parse with " << count << " member files... "; std::cout.flush();
+		std::vector<std::string> texts;
+		unsigned long bytes = 0;
+		for(unsigned long i=1;i<=count;++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+			DB::initMember(m);
+			m["lastAuthorizedCredentialType"] = "api";
+			m["identity"] = m["id"].get<std::string>() + ":0:" + std::string(128,'a');
+			m["revision"] = i;
+			texts.push_back(OSUtils::jsonDump(m,-1));
+			bytes += (unsigned long)texts.back().length();
+		}
+		std::vector<CompactMember> dom(count),sax(count);
+		unsigned long allocs = s_allocations.load();
+		int64_t start = OSUtils::now();
+		for(unsigned long i=0;i<count;++i)
+			dom[i].fromJson(nwid,i + 1,OSUtils::jsonParse(texts[i]));
+		const int64_t domTime = std::max(OSUtils::now() - start,(int64_t)1);
+		const unsigned long domAllocs = s_allocations.load() - allocs;
+		allocs = s_allocations.load();
+		start = OSUtils::now();
+		for(unsigned long i=0;i<count;++i)
+			sax[i].fromJsonText(nwid,texts[i].data(),(unsigned long)texts[i].length());
+		const int64_t saxTime = std::max(OSUtils::now() - start,(int64_t)1);
+		const unsigned long saxAllocs = s_allocations.load() - allocs;
+		unsigned long dumped = 0;
+		start = OSUtils::now();
+		for(unsigned long i=0;i<count;++i) {
+			nlohmann::json m;
+			sax[i].toJson(nwid,i + 1,m);
+			dumped += (unsigned long)OSUtils::jsonDump(m,-1).length();
+		}
+		const int64_t dumpTime = std::max(OSUtils::now() - start,(int64_t)1);
+		if ((dumped != bytes)||(sax[count - 1].revision() != count)) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		const double mb = (double)bytes / 1048576.0;
+		std::cout << (mb / ((double)domTime / 1000.0)) << " MB/s and " << (domAllocs / count) << " allocations/member with DOM, " << (mb / ((double)saxTime / 1000.0)) << " MB/s and " << (saxAllocs / count) << " allocations/member from text, " << (mb / ((double)dumpTime / 1000.0)) << " MB/s dump" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Benchmarking API member import of 5000 members into FileDB... "; std::cout.flush();
+		const char *const dbPath = "selftest-controller.tmp";
+		OSUtils::rmDashRf(dbPath);
+		Identity signer;
+		signer.fromString(KNOWN_GOOD_IDENTITY);
+		std::vector<std::string> path;
+		std::map<std::string,std::string> urlArgs,headers;
+		std::string responseBody,responseContentType;
+		char nwids[2][24],tmp[256];
+		OSUtils::ztsnprintf(nwids[0],sizeof(nwids[0]),"%.16llx",(unsigned long long)nwid);
+		OSUtils::ztsnprintf(nwids[1],sizeof(nwids[1]),"%.16llx",(unsigned long long)(nwid + 1));
+		int64_t oneTime,bulkTime;
+		nlohmann::json result;
+		{
+			EmbeddedNetworkController enc((Node *)0,dbPath,dbPath,0,(MQConfig *)0);
+			enc.init(signer,(NetworkController::Sender *)0);
+			for(int n=0;n<2;++n) {
+				path = { "network",nwids[n] };
+				enc.handleControlPlaneHttpPOST(path,urlArgs,headers,"{}",responseBody,responseContentType);
+			}
+
+			int64_t start = OSUtils::now();
+			for(unsigned long i=1;i<=5000;++i) {
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx",(unsigned long long)i);
+				path = { "network",nwids[0],"member",tmp };
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"{\"authorized\":true,\"ipAssignments\":[\"10.%lu.%lu.%lu\"]}",(i >> 16) & 0xff,(i >> 8) & 0xff,i & 0xff);
+				enc.handleControlPlaneHttpPOST(path,urlArgs,headers,tmp,responseBody,responseContentType);
+			}
+			oneTime = std::max(OSUtils::now() - start,(int64_t)1);
+
+			std::string body;
+			for(unsigned long i=1;i<=5000;++i) {
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"{\"id\":\"%.10llx\",\"authorized\":true,\"ipAssignments\":[\"10.%lu.%lu.%lu\"]}\n",(unsigned long long)i,(i >> 16) & 0xff,(i >> 8) & 0xff,i & 0xff);
+				body.append(tmp);
+			}
+			start = OSUtils::now();
+			path = { "network",nwids[1],"member" };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,body,responseBody,responseContentType);
+			bulkTime = std::max(OSUtils::now() - start,(int64_t)1);
+			result = OSUtils::jsonParse(responseBody);
+		}
+		OSUtils::rmDashRf(dbPath);
+		if ((OSUtils::jsonInt(result["changed"],0ULL) != 5000)||(OSUtils::jsonInt(result["failed"],1ULL) != 0)) {
+			std::cout << "FAILED (" << responseBody << ")" << std::endl;
+			return -1;
+		}
+		std::cout << (5000.0 / ((double)oneTime / 1000.0)) << " members/second one POST per member, " << (5000.0 / ((double)bulkTime / 1000.0)) << " members/second bulk" << std::endl;
+	}
+
+	{
+		const unsigned long ruleCount = 600,requests = 300;
+		std::cout << "[controller] Benchmarking config requests for a network with " << ruleCount << " rules and 4 capabilities... "; std::cout.flush();
+		const char *const dbPath = "selftest-controller.tmp";
+		OSUtils::rmDashRf(dbPath);
+		Identity signer,requester;
+		signer.fromString(KNOWN_GOOD_IDENTITY);
+		requester.generate();
+		const uint64_t rnwid = (signer.address().toInt() << 24) | 1ULL;
+		char nwids[24],ids[24];
+		OSUtils::ztsnprintf(nwids,sizeof(nwids),"%.16llx",(unsigned long long)rnwid);
+		requester.address().toString(ids);
+		nlohmann::json network,rule;
+		network["private"] = true;
+		network["rules"] = nlohmann::json::array();
+		for(unsigned long i=0;i<ruleCount;++i) {
+			rule = nlohmann::json::object();
+			switch(i % 4) {
+				case 0: rule["type"] = "MATCH_ETHERTYPE"; rule["etherType"] = 0x0800; break;
+				case 1: rule["type"] = "MATCH_IPV4_DEST"; rule["ip"] = std::string("10.") + std::to_string(i & 0xff) + ".0.0/16"; break;
+				case 2: rule["type"] = "MATCH_IP_DEST_PORT_RANGE"; rule["start"] = i; rule["end"] = i + 10; break;
+				default: rule["type"] = "ACTION_ACCEPT"; break;
+			}
+			network["rules"].push_back(rule);
+		}
+		network["capabilities"] = nlohmann::json::array();
+		for(unsigned int c=1;c<=4;++c) {
+			nlohmann::json cap;
+			cap["id"] = c;
+			cap["default"] = true;
+			for(unsigned int i=0;i<50;++i) {
+				rule = nlohmann::json::object();
+				rule["type"] = ((i & 1) == 0) ? "MATCH_IPV4_SOURCE" : "ACTION_ACCEPT";
+				if ((i & 1) == 0)
+					rule["ip"] = std::string("192.168.") + std::to_string(i) + ".0/24";
+				cap["rules"].push_back(rule);
+			}
+			network["capabilities"].push_back(cap);
+		}
+		Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> metaData;
+		metaData.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_VERSION,(uint64_t)ZT_NETWORKCONFIG_VERSION);
+		metaData.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_RULES_ENGINE_REV,(uint64_t)ZT_RULES_ENGINE_REVISION);
+		SelftestSender sender;
+		std::vector<std::string> path;
+		std::map<std::string,std::string> urlArgs,headers;
+		std::string responseBody,responseContentType;
+		nlohmann::json status;
+		{
+			EmbeddedNetworkController enc((Node *)0,dbPath,dbPath,0,(MQConfig *)0);
+			enc.init(signer,&sender);
+			path = { "network",nwids };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,OSUtils::jsonDump(network,-1),responseBody,responseContentType);
+			path = { "network",nwids,"member",ids };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,"{\"authorized\":true}",responseBody,responseContentType);
+			for(unsigned long i=1;i<=requests;++i) {
+				enc.request(rnwid,InetAddress(),0,requester,metaData); // packet ID 0 (a push) isn't rate limited
+				if (!sender.wait(i))
+					break;
+			}
+			path = { "controller" };
+			enc.handleControlPlaneHttpGET(path,urlArgs,headers,std::string(),responseBody,responseContentType);
+			status = OSUtils::jsonParse(responseBody);
+		}
+		OSUtils::rmDashRf(dbPath);
+		nlohmann::json &rq = status["requests"];
+		if ((sender.configs != requests)||(OSUtils::jsonInt(rq["templateCacheMisses"],0ULL) != 1)) {
+			std::cout << "FAILED (" << sender.configs << " configs, " << sender.errors << " errors, " << OSUtils::jsonDump(rq,-1) << ")" << std::endl;
+			return -1;
+		}
+		std::cout << OSUtils::jsonInt(rq["meanLatencyMicros"],0ULL) << "us mean per request" << std::endl;
+	}
+
+	{
+		const unsigned long ruleCount = 100,memberCount = 10000;
+		std::cout << "[controller] Benchmarking a one-rule change pushed to " << memberCount << " members as delta configs... "; std::cout.flush();
+		const char *const dbPath = "selftest-controller.tmp";
+		OSUtils::rmDashRf(dbPath);
+		Identity signer,keys;
+		signer.fromString(KNOWN_GOOD_IDENTITY);
+		keys.generate();
+		const uint64_t rnwid = (signer.address().toInt() << 24) | 2ULL;
+		char nwids[24],tmp[ZT_IDENTITY_STRING_BUFFER_LENGTH];
+		OSUtils::ztsnprintf(nwids,sizeof(nwids),"%.16llx",(unsigned long long)rnwid);
+
+		// Members share one public key; the controller doesn't check that it matches the address
+		const std::string publicKey(strrchr(keys.toString(false,tmp),':') + 1);
+		std::vector<Identity> fleet(memberCount);
+		std::string bulk;
+		for(unsigned long i=0;i<memberCount;++i) {
+			const uint64_t a = 0x1000000000ULL + i;
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx:0:%s",(unsigned long long)a,publicKey.c_str());
+			fleet[i].fromString(tmp);
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"{\"id\":\"%.10llx\",\"authorized\":true}\n",(unsigned long long)a);
+			bulk.append(tmp);
+		}
+
+		nlohmann::json network,rule;
+		network["private"] = true;
+		network["rules"] = nlohmann::json::array();
+		for(unsigned long i=0;i<ruleCount;++i) {
+			rule = nlohmann::json::object();
+			if ((i & 1) == 0) {
+				rule["type"] = "MATCH_IPV4_DEST";
+				rule["ip"] = std::string("10.") + std::to_string(i) + ".0.0/16";
+			} else rule["type"] = "ACTION_ACCEPT";
+			network["rules"].push_back(rule);
+		}
+
+		Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> metaData;
+		metaData.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_VERSION,(uint64_t)ZT_NETWORKCONFIG_VERSION);
+		metaData.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_RULES_ENGINE_REV,(uint64_t)ZT_RULES_ENGINE_REVISION);
+		metaData.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_FLAGS,(uint64_t)(ZT_NETWORKCONFIG_REQUEST_FLAG_HASH_TREE_CHUNKS | ZT_NETWORKCONFIG_REQUEST_FLAG_DELTA_CONFIGS));
+
+		SelftestFleet sender;
+		std::vector<std::string> path;
+		std::map<std::string,std::string> urlArgs,headers;
+		std::string responseBody,responseContentType;
+		unsigned long pushFull = 0,pushDelta = 0,pushFailures = 0;
+		uint64_t pushDeltaBytes = 0,pushRebuiltBytes = 0,pushDeltaMicros = 0,joinFullMicros = 0;
+		int64_t pushTime = 0;
+		bool fallbackOk = false;
+		OSUtils::mkdir(dbPath);
+		OSUtils::writeFile((std::string(dbPath) + ZT_PATH_SEPARATOR_S "local.conf").c_str(),"{\"settings\":{\"controllerPushWindow\":0}}"); // push all at once
+		{
+			EmbeddedNetworkController enc((Node *)0,dbPath,dbPath,0,(MQConfig *)0);
+			enc.init(signer,&sender);
+			path = { "network",nwids };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,OSUtils::jsonDump(network,-1),responseBody,responseContentType);
+			path = { "network",nwids,"member" };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,bulk,responseBody,responseContentType);
+
+			// Every member joins and gets a full config
+			for(unsigned long i=0;i<memberCount;++i)
+				enc.request(rnwid,InetAddress(),i + 1,fleet[i],metaData);
+			sender.wait(memberCount);
+			sender.settle();
+			joinFullMicros = (sender.fullConfigs) ? (sender.fullApplyMicros / sender.fullConfigs) : 0;
+			sender.reset();
+
+			// Change one rule, which pushes the new config to every online member
+			network["rules"][ruleCount / 2]["ip"] = "172.16.0.0/12";
+			const int64_t start = OSUtils::now();
+			path = { "network",nwids };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,OSUtils::jsonDump(network,-1),responseBody,responseContentType);
+			sender.wait(memberCount);
+			pushTime = OSUtils::now() - start;
+			sender.settle();
+			pushFull = sender.fullConfigs;
+			pushDelta = sender.deltaConfigs;
+			pushFailures = sender.failures;
+			pushDeltaBytes = sender.deltaBytes;
+			pushRebuiltBytes = sender.rebuiltBytes;
+			pushDeltaMicros = (sender.deltaConfigs) ? (sender.deltaApplyMicros / sender.deltaConfigs) : 0;
+			sender.reset();
+
+			// A member reporting the config it has gets a delta, one that doesn't gets a full config
+			Thread::sleep(1100); // past the per-member request rate limit
+			Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> md(metaData);
+			md.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_CONFIG_HASH,sender.configHash(fleet[0].address().toInt()));
+			enc.request(rnwid,InetAddress(),memberCount + 1,fleet[0],md);
+			sender.wait(1);
+			sender.settle();
+			md = metaData;
+			md.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_CONFIG_HASH,(uint64_t)1);
+			enc.request(rnwid,InetAddress(),memberCount + 2,fleet[1],md);
+			sender.wait(2);
+			sender.settle();
+			fallbackOk = ((sender.deltaConfigs == 1)&&(sender.fullConfigs == 1)&&(sender.failures == 0));
+		}
+		OSUtils::rmDashRf(dbPath);
+		if ((pushDelta != memberCount)||(pushFull)||(pushFailures)||(!fallbackOk)||(pushDeltaBytes >= pushRebuiltBytes)) {
+			std::cout << "FAILED (" << pushDelta << " delta, " << pushFull << " full, " << pushFailures << " failed, fallback " << (fallbackOk ? "ok" : "failed") << ")" << std::endl;
+			return -1;
+		}
+		std::cout << pushDeltaBytes << " bytes vs " << pushRebuiltBytes << " as full configs, " << pushTime << "ms, member apply " << pushDeltaMicros << "us vs " << joinFullMicros << "us full" << std::endl;
+	}
+
+	{
+		const unsigned long memberCount = 2000;
+		const int64_t window = 2000;
+		std::cout << "[controller] Testing paced config pushes and revocation priority... "; std::cout.flush();
+		const char *const dbPath = "selftest-controller.tmp";
+		OSUtils::rmDashRf(dbPath);
+		OSUtils::mkdir(dbPath);
+		OSUtils::writeFile((std::string(dbPath) + ZT_PATH_SEPARATOR_S "local.conf").c_str(),std::string("{\"settings\":{\"controllerPushWindow\":") + std::to_string(window) + "}}");
+		Identity signer,keys;
+		signer.fromString(KNOWN_GOOD_IDENTITY);
+		keys.generate();
+		const uint64_t rnwid = (signer.address().toInt() << 24) | 3ULL;
+		char nwids[24],tmp[ZT_IDENTITY_STRING_BUFFER_LENGTH];
+		OSUtils::ztsnprintf(nwids,sizeof(nwids),"%.16llx",(unsigned long long)rnwid);
+
+		const std::string publicKey(strrchr(keys.toString(false,tmp),':') + 1);
+		std::vector<Identity> fleet(memberCount);
+		std::string bulk;
+		for(unsigned long i=0;i<memberCount;++i) {
+			const uint64_t a = 0x2000000000ULL + i;
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx:0:%s",(unsigned long long)a,publicKey.c_str());
+			fleet[i].fromString(tmp);
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"{\"id\":\"%.10llx\",\"authorized\":true}\n",(unsigned long long)a);
+			bulk.append(tmp);
+		}
+
+		Dictionary<ZT_NETWORKCONFIG_METADATA_DICT_CAPACITY> metaData;
+		metaData.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_VERSION,(uint64_t)ZT_NETWORKCONFIG_VERSION);
+		metaData.add(ZT_NETWORKCONFIG_REQUEST_METADATA_KEY_RULES_ENGINE_REV,(uint64_t)ZT_RULES_ENGINE_REVISION);
+
+		SelftestSender sender;
+		std::vector<std::string> path;
+		std::map<std::string,std::string> urlArgs,headers;
+		std::string responseBody,responseContentType;
+		nlohmann::json network,pushes;
+		network["private"] = true;
+		int64_t pushTime = 0;
+		unsigned long sentAtRevocation = 0;
+		double peakRate = 0.0;
+		{
+			EmbeddedNetworkController enc((Node *)0,dbPath,dbPath,0,(MQConfig *)0);
+			enc.init(signer,&sender);
+			path = { "network",nwids };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,OSUtils::jsonDump(network,-1),responseBody,responseContentType);
+			path = { "network",nwids,"member" };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,bulk,responseBody,responseContentType);
+			for(unsigned long i=0;i<memberCount;++i)
+				enc.request(rnwid,InetAddress(),i + 1,fleet[i],metaData);
+			sender.wait(memberCount);
+			Thread::sleep(500);
+
+			// An edit schedules a push to every online member, released over the window
+			network["name"] = "paced";
+			const int64_t start = OSUtils::now();
+			path = { "network",nwids };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,OSUtils::jsonDump(network,-1),responseBody,responseContentType);
+
+			// Deauthorizing a member revokes it on every online member ahead of the pending pushes
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.10llx",(unsigned long long)fleet[0].address().toInt());
+			path = { "network",nwids,"member",tmp };
+			enc.handleControlPlaneHttpPOST(path,urlArgs,headers,"{\"authorized\":false}",responseBody,responseContentType);
+			sender.waitRevocations(memberCount);
+			path = { "controller" };
+			enc.handleControlPlaneHttpGET(path,urlArgs,headers,std::string(),responseBody,responseContentType);
+			sentAtRevocation = (unsigned long)OSUtils::jsonInt(OSUtils::jsonParse(responseBody)["pushes"]["released"],0ULL);
+
+			for(;;) {
+				enc.handleControlPlaneHttpGET(path,urlArgs,headers,std::string(),responseBody,responseContentType);
+				pushes = OSUtils::jsonParse(responseBody)["pushes"];
+				const double rate = pushes["rate"].is_number() ? (double)pushes["rate"] : 0.0;
+				if (rate > peakRate)
+					peakRate = rate;
+				if ((OSUtils::jsonInt(pushes["pending"],1ULL) == 0)||((OSUtils::now() - start) > (window * 10)))
+					break;
+				Thread::sleep(50);
+			}
+			pushTime = OSUtils::now() - start;
+		}
+		OSUtils::rmDashRf(dbPath);
+		// One scheduled push is superseded by the immediate push to the deauthorized member
+		if ((OSUtils::jsonInt(pushes["scheduled"],0ULL) != memberCount)||(OSUtils::jsonInt(pushes["released"],0ULL) + OSUtils::jsonInt(pushes["superseded"],0ULL) != memberCount)||
+		    (pushTime < (window - 100))||(sender.revocations != memberCount)||(OSUtils::jsonInt(pushes["revocationsQueued"],0ULL) != memberCount)||(sentAtRevocation >= (memberCount - 1))) {
+			std::cout << "FAILED (" << OSUtils::jsonDump(pushes,-1) << ", " << pushTime << "ms, " << sender.revocations << " revocations)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS (" << memberCount << " pushes over " << pushTime << "ms, peak " << (unsigned long)peakRate << "/s, revocations ahead of " << (memberCount - 1 - sentAtRevocation) << " pending)" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing FileDB parallel load and snapshot... "; std::cout.flush();
+		const char *const dbPath = "selftest-controller.tmp";
+		const std::string snapshotPath(std::string(dbPath) + ZT_PATH_SEPARATOR_S + "snapshot.bin");
+		OSUtils::rmDashRf(dbPath);
+		char tmp[64];
+		std::vector<nlohmann::json> saved;
+		{
+			FileDB fdb(dbPath,true);
+			nlohmann::json network;
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)nwid);
+			network["id"] = tmp;
+			network["nwid"] = tmp;
+			network["objtype"] = "network";
+			fdb.save(network,false);
+			for(unsigned long i=1;i<=1000;++i) {
+				nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)(i % 700)));
+				DB::initMember(m);
+				m["objtype"] = "member";
+				m["authorized"] = ((i % 3) != 0);
+				m["activeBridge"] = (i == 5);
+				m["lastDeauthorizedTime"] = (int64_t)i;
+				if ((i % 100) == 0)
+					m["somethingElse"] = "x";
+				fdb.save(m,false);
+				saved.push_back(m);
+			}
+		}
+		auto check = [&](DB &db) -> bool {
+			for(auto m=saved.begin();m!=saved.end();++m) {
+				nlohmann::json network,member;
+				if ((!db.get(nwid,network,OSUtils::jsonIntHex((*m)["id"],0ULL),member))||(member != *m))
+					return false;
+			}
+			nlohmann::json network,member;
+			DB::NetworkSummaryInfo ns;
+			db.get(nwid,network,1,member,ns);
+			return ((ns.totalMemberCount == 1000)&&(ns.authorizedMemberCount == 667)&&(ns.activeBridges.size() == 1)&&(ns.mostRecentDeauthTime == 999)&&
+				(db.ipAllocated(nwid,InetAddress(Utils::hton((uint32_t)0x0a000000 + 699),0)))&&(!db.ipAllocated(nwid,InetAddress(Utils::hton((uint32_t)0x0a000000 + 700),0))));
+		};
+		bool ok = OSUtils::fileExists(snapshotPath.c_str());
+		{
+			FileDB fdb(dbPath,false); // ignores and removes the snapshot, loads files
+			ok = ((ok)&&(check(fdb))&&(!OSUtils::fileExists(snapshotPath.c_str())));
+		}
+		{
+			FileDB fdb(dbPath,true); // loads files, writes a snapshot
+		}
+		{
+			FileDB fdb(dbPath,true); // loads the snapshot, writes it again
+			ok = ((ok)&&(check(fdb))&&(!OSUtils::fileExists(snapshotPath.c_str())));
+		}
+		{
+			// Corrupt the packed IP count of member 1; the snapshot must be rejected in favor of member files
+			std::string snap,rec;
+			CompactMember cm;
+			cm.fromJson(nwid,1,saved[0]);
+			cm.serialize(rec);
+			// Member 1 has one IPv4 assignment, packed as its count, family, and address
+			uint32_t ipWords[3] = { 1,4,0 };
+			memcpy(ipWords + 2,InetAddress(Utils::hton((uint32_t)0x0a000001),0).rawIpData(),4);
+			const std::string::size_type off = rec.find(std::string((const char *)ipWords,sizeof(ipWords)));
+			const std::string::size_type at = (OSUtils::readFile(snapshotPath.c_str(),snap)) ? snap.find(rec) : std::string::npos;
+			ok = ((ok)&&(off != std::string::npos)&&(at != std::string::npos));
+			if (ok) {
+				const char *p = rec.data();
+				ok = ((cm.deserialize(p,rec.data() + rec.length()))&&(p == rec.data() + rec.length()));
+				const uint32_t badCount = 1000;
+				rec.replace(off,4,(const char *)&badCount,4);
+				p = rec.data();
+				ok = ((ok)&&(!cm.deserialize(p,rec.data() + rec.length())));
+				snap.replace(at,rec.length(),rec);
+				ok = ((ok)&&(OSUtils::writeFile(snapshotPath.c_str(),snap)));
+			}
+		}
+		{
+			FileDB fdb(dbPath,true); // rejects the snapshot, loads files, writes a snapshot
+			ok = ((ok)&&(check(fdb))&&(!OSUtils::fileExists(snapshotPath.c_str())));
+		}
+		{
+			// Member files edited and added by hand while stopped must win over the snapshot
+			ok = ((ok)&&(OSUtils::fileExists(snapshotPath.c_str())));
+			const std::string membersPath(std::string(dbPath) + ZT_PATH_SEPARATOR_S "network" ZT_PATH_SEPARATOR_S + OSUtils::jsonString(saved[1]["nwid"],"") + ZT_PATH_SEPARATOR_S "member" ZT_PATH_SEPARATOR_S);
+			nlohmann::json edited(saved[1]),added(SelftestDB::member(nwid,1001,0x0a0003e9));
+			edited["name"] = "edited by hand";
+			DB::initMember(added);
+			added["objtype"] = "member";
+			ok = ((ok)&&(OSUtils::writeFile((membersPath + OSUtils::jsonString(edited["id"],"") + ".json").c_str(),OSUtils::jsonDump(edited,-1))));
+			ok = ((ok)&&(OSUtils::writeFile((membersPath + OSUtils::jsonString(added["id"],"") + ".json").c_str(),OSUtils::jsonDump(added,-1))));
+			FileDB fdb(dbPath,true); // storage no longer matches the snapshot's fingerprint, loads files
+			nlohmann::json network,member;
+			ok = ((ok)&&(fdb.get(nwid,network,2,member))&&(member == edited)&&(fdb.get(nwid,network,1001,member))&&(!OSUtils::fileExists(snapshotPath.c_str())));
+		}
+		OSUtils::rmDashRf(dbPath);
+		if (!ok) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	static const unsigned long loadCounts[2] = { 10000,100000 };
+	for(unsigned int c=0;c<2;++c) {
+		std::cout << "[controller] Benchmarking FileDB startup with " << loadCounts[c] << " members... "; std::cout.flush();
+		const char *const dbPath = "selftest-controller.tmp";
+		OSUtils::rmDashRf(dbPath);
+		char nwids[24],tmp[256];
+		OSUtils::ztsnprintf(nwids,sizeof(nwids),"%.16llx",(unsigned long long)nwid);
+		{
+			FileDB fdb(dbPath,false);
+			nlohmann::json network;
+			network["id"] = nwids;
+			network["nwid"] = nwids;
+			network["objtype"] = "network";
+			fdb.save(network,false);
+		}
+		OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s" ZT_PATH_SEPARATOR_S "network" ZT_PATH_SEPARATOR_S "%s",dbPath,nwids);
+		OSUtils::mkdir(tmp);
+		const std::string membersPath(std::string(tmp) + ZT_PATH_SEPARATOR_S "member");
+		OSUtils::mkdir(membersPath.c_str());
+		for(unsigned long i=1;i<=loadCounts[c];++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+			DB::initMember(m);
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%s" ZT_PATH_SEPARATOR_S "%.10llx.json",membersPath.c_str(),(unsigned long long)i);
+			OSUtils::writeFile(tmp,OSUtils::jsonDump(m,-1));
+		}
+		int64_t start = OSUtils::now();
+		int64_t fileTime,snapshotTime;
+		bool ok;
+		{
+			FileDB fdb(dbPath,true);
+			fileTime = OSUtils::now() - start;
+			ok = fdb.isAuthorized(nwid,loadCounts[c]);
+		}
+		start = OSUtils::now();
+		{
+			FileDB fdb(dbPath,true);
+			snapshotTime = OSUtils::now() - start;
+			ok = ((ok)&&(fdb.isAuthorized(nwid,loadCounts[c])));
+		}
+		OSUtils::rmDashRf(dbPath);
+		if (!ok) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << fileTime << "ms from member files, " << snapshotTime << "ms from snapshot" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing incremental mirror sync... "; std::cout.flush();
+		std::shared_ptr<SelftestDB> a(new SelftestDB()),b(new SelftestDB());
+		DBMirrorSet mirror((DB::ChangeListener *)0);
+		mirror.addDB(a);
+		mirror.addDB(b);
+		a->addNetwork(nwid);
+		for(unsigned long i=1;i<=100;++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+			DB::initMember(m);
+			a->save(m,false);
+		}
+		mirror.sync(); // first sync is a full scan
+		bool ok = b->isAuthorized(nwid,100);
+		std::vector<DB::Change> changes;
+		uint64_t latest = 0;
+		ok = ((ok)&&(a->changesSince(0,changes,latest))&&(changes.size() == 101)&&(latest == 101)&&(changes[0].memberId == 0)&&(changes[100].memberId == 100));
+		for(unsigned long i=1;i<=5;++i) {
+			nlohmann::json network,m;
+			a->get(nwid,network,i,m);
+			m["authorized"] = false;
+			m["revision"] = OSUtils::jsonInt(m["revision"],0ULL) + 10ULL; // as if changed elsewhere, e.g. by another controller
+			a->save(m,false);
+			a->save(m,false); // unchanged, not journaled
+		}
+		ok = ((ok)&&(a->changesSince(101,changes,latest))&&(changes.size() == 5)&&(latest == 106));
+		mirror.sync();
+		ok = ((ok)&&(!b->isAuthorized(nwid,5))&&(b->isAuthorized(nwid,6)));
+		for(unsigned long i=0;i<(ZT_DB_CHANGE_JOURNAL_SIZE + 10);++i) {
+			nlohmann::json network,m;
+			a->get(nwid,network,7,m);
+			m["authorized"] = ((i & 1) != 0); // ends up authorized after an even count
+			m["revision"] = OSUtils::jsonInt(m["revision"],0ULL) + 10ULL;
+			a->save(m,false);
+		}
+		nlohmann::json network8,m8;
+		a->get(nwid,network8,8,m8);
+		m8["authorized"] = false;
+		m8["revision"] = OSUtils::jsonInt(m8["revision"],0ULL) + 10ULL;
+		a->save(m8,false);
+		ok = ((ok)&&(!a->changesSince(106,changes,latest))&&(b->isAuthorized(nwid,8)));
+		mirror.sync(); // journal overflowed, so this is a full scan again
+		ok = ((ok)&&(b->isAuthorized(nwid,7))&&(!b->isAuthorized(nwid,8)));
+		if (!ok) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		const unsigned long count = 100000;
+		std::cout << "[controller] Benchmarking mirror sync of two DBs with " << count << " members... "; std::cout.flush();
+		std::shared_ptr<SelftestDB> a(new SelftestDB()),b(new SelftestDB());
+		DBMirrorSet mirror((DB::ChangeListener *)0);
+		mirror.addDB(a);
+		mirror.addDB(b);
+		a->addNetwork(nwid);
+		for(unsigned long i=1;i<=count;++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+			DB::initMember(m);
+			a->save(m,false);
+		}
+		mirror.sync(); // copies everything to b
+		int64_t start,fullTime;
+		{
+			DBMirrorSet fresh((DB::ChangeListener *)0); // first sync is a full scan, which is what every sync used to do
+			fresh.addDB(a);
+			fresh.addDB(b);
+			start = OSUtils::now();
+			fresh.sync();
+			fullTime = OSUtils::now() - start;
+		}
+		for(unsigned long i=1;i<=100;++i) {
+			nlohmann::json network,m;
+			a->get(nwid,network,i * 10,m);
+			m["authorized"] = false;
+			m["revision"] = OSUtils::jsonInt(m["revision"],0ULL) + 10ULL;
+			a->save(m,false);
+		}
+		start = OSUtils::now();
+		mirror.sync();
+		const int64_t incrementalTime = OSUtils::now() - start;
+		if ((b->isAuthorized(nwid,10))||(!b->isAuthorized(nwid,11))) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << fullTime << "ms full scan, " << incrementalTime << "ms for 100 journaled changes, " << ((ZT_DB_CHANGE_JOURNAL_SIZE * sizeof(DB::Change)) / 1024) << "KiB journal per DB" << std::endl;
+	}
+
+	{
+		const unsigned long count = 2000;
+		const int latency = 2; // ms the mock LF node takes per record
+		std::cout << "[controller] Benchmarking LFDB record writes to a mock LF node with " << latency << "ms latency... "; std::cout.flush();
+		std::atomic<unsigned long> records(0);
+		std::atomic<int64_t> firstRecord(0),lastRecord(0);
+		httplib::Server lf;
+		lf.Post("/makerecord",[&](const httplib::Request &req,httplib::Response &res) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+			int64_t zero = 0;
+			firstRecord.compare_exchange_strong(zero,OSUtils::now());
+			lastRecord.store(OSUtils::now());
+			++records;
+			res.set_content("{}","application/json");
+		});
+		lf.Post("/query",[](const httplib::Request &req,httplib::Response &res) {
+			res.set_content("[]","application/json");
+		});
+		const int port = lf.bind_to_any_port("127.0.0.1");
+		std::thread lfThread([&lf]() { lf.listen_after_bind(); });
+		{
+			Identity myId;
+			myId.fromString(KNOWN_GOOD_IDENTITY);
+			LFDB db(myId,"",(const char *)0,(const char *)0,"127.0.0.1",port,false);
+			db.waitForReady();
+			char tmp[24];
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)nwid);
+			nlohmann::json network;
+			network["id"] = tmp;
+			network["nwid"] = tmp;
+			network["objtype"] = "network";
+			db.save(network,false);
+			const int64_t start = OSUtils::now();
+			int64_t saveTime = 0;
+			for(unsigned long i=1;i<=count;++i) {
+				nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+				m["objtype"] = "member";
+				DB::initMember(m);
+				const int64_t s = OSUtils::now();
+				db.save(m,false);
+				saveTime = std::max(saveTime,OSUtils::now() - s);
+			}
+			const int64_t saveEnd = OSUtils::now();
+			while ((records.load() < (count + 1))&&((OSUtils::now() - start) < 60000))
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			if (records.load() < (count + 1)) {
+				std::cout << "FAILED (" << records.load() << " records written)" << std::endl;
+				return -1;
+			}
+			std::cout << ((double)records.load() / ((double)std::max(lastRecord.load() - firstRecord.load(),(int64_t)1) / 1000.0)) << " records/second (one at a time would be at most " << (1000 / latency) << "), " << (saveEnd - start) << "ms to save " << count << " members, " << saveTime << "ms longest save" << std::endl;
+		}
+		lf.stop();
+		lfThread.join();
+	}
+
+	{
+		std::cout << "[controller] Testing LFDB sends queued writes on shutdown... "; std::cout.flush();
+		const unsigned long count = 200;
+		std::atomic<unsigned long> records(0);
+		httplib::Server lf;
+		lf.Post("/makerecord",[&](const httplib::Request &req,httplib::Response &res) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			++records;
+			res.set_content("{}","application/json");
+		});
+		lf.Post("/query",[](const httplib::Request &req,httplib::Response &res) {
+			res.set_content("[]","application/json");
+		});
+		const int port = lf.bind_to_any_port("127.0.0.1");
+		std::thread lfThread([&lf]() { lf.listen_after_bind(); });
+		{
+			Identity myId;
+			myId.fromString(KNOWN_GOOD_IDENTITY);
+			LFDB db(myId,"",(const char *)0,(const char *)0,"127.0.0.1",port,false);
+			db.waitForReady();
+			char tmp[24];
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)nwid);
+			nlohmann::json network;
+			network["id"] = tmp;
+			network["nwid"] = tmp;
+			network["objtype"] = "network";
+			db.save(network,false);
+			for(unsigned long i=1;i<=count;++i) {
+				nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+				m["objtype"] = "member";
+				DB::initMember(m);
+				db.save(m,false);
+			}
+		} // destroyed right away, with most records not yet sent
+		lf.stop();
+		lfThread.join();
+		if (records.load() != (count + 1)) {
+			std::cout << "FAILED (" << records.load() << " records written)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Testing online status aggregation... "; std::cout.flush();
+		char tmp[64];
+		SelftestDB db;
+		std::vector<std::thread> threads;
+		for(unsigned int t=0;t<4;++t) {
+			threads.push_back(std::thread([&db,t,nwid]() {
+				for(unsigned long i=0;i<50000;++i)
+					db.nodeIsOnline(nwid,(i % 1000) + 1,((i % 1000) == 7) ? InetAddress() : InetAddress(Utils::hton((uint32_t)(0x01000000 + t)),9993));
+			}));
+		}
+		for(auto t=threads.begin();t!=threads.end();++t)
+			t->join();
+		db.nodeIsOnline(nwid + 1,1,InetAddress());
+		SelftestDB::OnlineMap online,again;
+		db.takeOnline(online);
+		db.takeOnline(again);
+		if ((online.size() != 1001)||(!again.empty())||(online[std::pair<uint64_t,uint64_t>(nwid,8)].physicalAddress)||(!online[std::pair<uint64_t,uint64_t>(nwid,9)].physicalAddress)||(online[std::pair<uint64_t,uint64_t>(nwid,9)].lastSeen <= 0)) {
+			std::cout << "FAILED (aggregate)" << std::endl;
+			return -1;
+		}
+		// A batch that failed to persist is retried, merged under anything seen since
+		const int64_t seen9 = online[std::pair<uint64_t,uint64_t>(nwid,9)].lastSeen;
+		db.returnOnline(online);
+		db.nodeIsOnline(nwid,9,InetAddress());
+		db.takeOnline(again);
+		if ((again.size() != 1001)||(!again[std::pair<uint64_t,uint64_t>(nwid,9)].physicalAddress)||(again[std::pair<uint64_t,uint64_t>(nwid,9)].lastSeen < seen9)||(again[std::pair<uint64_t,uint64_t>(nwid,8)].physicalAddress)) {
+			std::cout << "FAILED (retry)" << std::endl;
+			return -1;
+		}
+
+		const char *const dbPath = "selftest-controller.tmp";
+		OSUtils::rmDashRf(dbPath);
+		int64_t start,end;
+		{
+			FileDB fdb(dbPath);
+			nlohmann::json network;
+			OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)nwid);
+			network["id"] = tmp;
+			network["nwid"] = tmp;
+			network["objtype"] = "network";
+			fdb.save(network,false);
+			start = OSUtils::now();
+			for(unsigned long i=0;i<200000;++i)
+				fdb.nodeIsOnline(nwid,(i % 1000) + 1,InetAddress(Utils::hton((uint32_t)(0x01000000 + (i % 1000))),9993));
+			end = OSUtils::now();
+			fdb.nodeIsOnline(nwid + 1,1,InetAddress());
+		}
+		const std::string onlinePath(std::string(dbPath) + ZT_PATH_SEPARATOR_S + "online.json");
+		std::string buf;
+		nlohmann::json saved;
+		if (OSUtils::readFile(onlinePath.c_str(),buf))
+			saved = OSUtils::jsonParse(buf);
+		OSUtils::ztsnprintf(tmp,sizeof(tmp),"%.16llx",(unsigned long long)nwid);
+		bool ok = ((saved.size() == 1)&&(saved[tmp].size() == 1000)&&(OSUtils::jsonString(saved[tmp]["0000000005"][1],"") == "1.0.0.4/9993")&&(!OSUtils::fileExists((onlinePath + ".tmp").c_str())));
+		if (ok) {
+			// Status not updated in ZT_FILEDB_ONLINE_EXPIRE is dropped on the next flush
+			saved[tmp]["0000000005"][0] = OSUtils::now() - ZT_FILEDB_ONLINE_EXPIRE;
+			ok = OSUtils::writeFile(onlinePath.c_str(),OSUtils::jsonDump(saved,-1));
+			{
+				FileDB fdb(dbPath);
+			}
+			buf.clear();
+			saved = nlohmann::json();
+			if (OSUtils::readFile(onlinePath.c_str(),buf))
+				saved = OSUtils::jsonParse(buf);
+			ok = ((ok)&&(saved.size() == 1)&&(saved[tmp].size() == 999)&&(saved[tmp].count("0000000005") == 0)&&(saved[tmp].count("0000000006") == 1));
+		}
+		OSUtils::rmDashRf(dbPath);
+		if (!ok) {
+			std::cout << "FAILED (FileDB)" << std::endl;
+			return -1;
+		}
+		std::cout << "PASS (" << (200000.0 / ((double)std::max(end - start,(int64_t)1) / 1000.0)) << " updates/second)" << std::endl;
+	}
+
+	{
+		std::cout << "[controller] Benchmarking member listing with 50000 members... "; std::cout.flush();
+		SelftestDB db;
+		db.addNetwork(nwid);
+		for(unsigned long i=1;i<=50000;++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)(i & 0xffff)));
+			DB::initMember(m);
+			db.save(m,false);
+		}
+		unsigned long copied = 0,listed = 0;
+		int64_t start = OSUtils::now();
+		for(int k=0;k<3;++k) {
+			nlohmann::json network;
+			std::vector<nlohmann::json> members;
+			db.get(nwid,network,members);
+			copied += (unsigned long)members.size();
+		}
+		const int64_t copyTime = OSUtils::now() - start;
+		start = OSUtils::now();
+		for(int k=0;k<3;++k) {
+			std::string body;
+			char tmp[64];
+			db.eachMember(nwid,0,false,0,[&](const uint64_t memberId,const uint64_t revision,const bool auth) -> bool {
+				OSUtils::ztsnprintf(tmp,sizeof(tmp),"\"%.10llx\":%llu,",(unsigned long long)memberId,(unsigned long long)revision);
+				body.append(tmp);
+				++listed;
+				return true;
+			});
+		}
+		const int64_t listTime = OSUtils::now() - start;
+		if ((copied != 150000)||(listed != 150000)) {
+			std::cout << "FAILED" << std::endl;
+			return -1;
+		}
+		std::cout << ((double)copyTime / 3.0) << "ms copying records vs. " << ((double)listTime / 3.0) << "ms from index" << std::endl;
+	}
+
+	static const unsigned long memberCounts[3] = { 1000,10000,50000 };
+	for(unsigned int c=0;c<3;++c) {
+		std::cout << "[controller] Benchmarking request summary + IP allocation with " << memberCounts[c] << " members... "; std::cout.flush();
+		SelftestDB db;
+		db.addNetwork(nwid);
+		for(unsigned long i=1;i<=memberCounts[c];++i) {
+			nlohmann::json m(SelftestDB::member(nwid,i,0x0a000000 + (uint32_t)i));
+			db.save(m,false);
+		}
+		const unsigned long requests = 20000;
+		unsigned long allocated = 0;
+		const int64_t start = OSUtils::now();
+		for(unsigned long i=0;i<requests;++i) {
+			nlohmann::json network,member;
+			DB::NetworkSummaryInfo ns;
+			db.get(nwid,network,(i % memberCounts[c]) + 1,member,ns);
+			if (db.ipAllocated(nwid,InetAddress(Utils::hton((uint32_t)(0x0a000000 + (i & 0xffff))),0)))
+				++allocated;
+		}
+		const int64_t end = OSUtils::now();
+		if (!allocated) {
+			std::cout << "FAILED (no allocated IPs found)" << std::endl;
+			return -1;
+		}
+		std::cout << ((double)requests / ((double)(end - start) / 1000.0)) << " requests/second" << std::endl;
+	}
+
+	return 0;
+}
+
 #ifdef __WINDOWS__
 int __cdecl _tmain(int argc, _TCHAR* argv[])
 #else
@@ -1089,6 +3227,7 @@ int main(int argc,char **argv)
 	r |= testIdentity();
 	r |= testCertificate();
 	r |= testPhy();
+	r |= testController();
 	//*/
 
 	if (r)
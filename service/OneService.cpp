@@ -36,6 +36,7 @@
 #include "../node/MAC.hpp"
 #include "../node/Identity.hpp"
 #include "../node/World.hpp"
+#include "../node/Dictionary.hpp"
 #include "../node/Salsa20.hpp"
 #include "../node/Poly1305.hpp"
 #include "../node/SHA512.hpp"
@@ -229,6 +230,59 @@ static void _networkToJson(nlohmann::json &nj,const ZT_VirtualNetworkConfig *nc,
 	nj["multicastSubscriptions"] = mca;
 }
 
+static void _multicastReplicationToJson(nlohmann::json &rj,const ZT_MulticastReplicationStatsList *rsl)
+{
+	char tmp[256];
+
+	rj = nlohmann::json::array();
+	for(unsigned long i=0;i<rsl->groupCount;++i) {
+		const ZT_MulticastReplicationStats &rs = rsl->groups[i];
+		nlohmann::json g;
+		g["mac"] = MAC(rs.mac).toString(tmp);
+		g["adi"] = rs.adi;
+		g["frames"] = rs.frames;
+		g["packets"] = rs.packets;
+		g["directPackets"] = rs.directPackets;
+		g["meanFanOut"] = (rs.frames) ? ((double)rs.packets / (double)rs.frames) : 0.0;
+		g["meanLatencyMicros"] = (rs.frames) ? (rs.totalMicros / rs.frames) : 0;
+		g["maxLatencyMicros"] = rs.maxMicros;
+		g["lastReplicated"] = rs.lastReplicated;
+		rj.push_back(g);
+	}
+}
+
+static void _traceEventsToJson(nlohmann::json &tj,const ZT_TraceEventList *tel)
+{
+	unsigned int maxlen = 0;
+	for(unsigned long i=0;i<tel->eventCount;++i)
+		maxlen = std::max(maxlen,tel->events[i].len);
+	std::vector<char> v(maxlen + 1);
+
+	tj["recorded"] = tel->recorded;
+	tj["dropped"] = tel->dropped;
+	tj["remoteRecords"] = tel->remoteRecords;
+	tj["remotePackets"] = tel->remotePackets;
+	nlohmann::json &ea = tj["events"];
+	ea = nlohmann::json::array();
+	for(unsigned long i=0;i<tel->eventCount;++i) {
+		const ZT_TraceEvent &te = tel->events[i];
+		nlohmann::json e;
+		e["seq"] = te.sequence;
+		e["timestamp"] = te.timestamp;
+		e["event"] = te.event;
+		nlohmann::json &f = e["fields"];
+		f = nlohmann::json::object();
+		const DictionaryIndex d(te.data,te.len);
+		for(unsigned int j=0;j<d.size();++j) {
+			const DictionaryIndex::Entry &de = d.entry(j);
+			const int vlen = DictionaryIndex::value(de,v.data(),maxlen + 1);
+			if ((de.klen > 0)&&(vlen >= 0))
+				f[std::string(de.k,de.klen)] = std::string(v.data(),(unsigned long)vlen);
+		}
+		ea.push_back(e);
+	}
+}
+
 static void _peerToJson(nlohmann::json &pj,const ZT_Peer *peer)
 {
 	char tmp[256];
@@ -250,6 +304,12 @@ static void _peerToJson(nlohmann::json &pj,const ZT_Peer *peer)
 	pj["latency"] = peer->latency;
 	pj["role"] = prole;
 
+	nlohmann::json cj;
+	cj["hits"] = peer->compressionHits;
+	cj["misses"] = peer->compressionMisses;
+	cj["skipped"] = peer->compressionSkipped;
+	pj["compression"] = cj;
+
 	nlohmann::json pa = nlohmann::json::array();
 	for(unsigned int i=0;i<peer->pathCount;++i) {
 		int64_t lastSend = peer->paths[i].lastSend;
@@ -1303,6 +1363,11 @@ public:
 									OneService::NetworkSettings localSettings;
 									getNetworkSettings(nws->networks[i].nwid,localSettings);
 									_networkToJson(res,&(nws->networks[i]),portDeviceName(nws->networks[i].nwid),localSettings);
+									ZT_MulticastReplicationStatsList *rsl = _node->multicastReplicationStats(wantnw);
+									if (rsl) {
+										_multicastReplicationToJson(res["multicastReplication"],rsl);
+										_node->freeQueryResult((void *)rsl);
+									}
 									scode = 200;
 									break;
 								}
@@ -1311,6 +1376,14 @@ public:
 						} else scode = 404;
 						_node->freeQueryResult((void *)nws);
 					} else scode = 500;
+				} else if (ps[0] == "trace") {
+					std::map<std::string,std::string>::const_iterator since(urlArgs.find("since"));
+					ZT_TraceEventList *tel = _node->traceEvents((since != urlArgs.end()) ? Utils::strToU64(since->second.c_str()) : 0);
+					if (tel) {
+						_traceEventsToJson(res,tel);
+						_node->freeQueryResult((void *)tel);
+						scode = 200;
+					} else scode = 500;
 				} else if (ps[0] == "peer") {
 					ZT_PeerList *pl = _node->peers();
 					if (pl) {
@@ -1578,6 +1651,7 @@ public:
 			_allowTcpFallbackRelay = false;
 		}
 		_portMappingEnabled = OSUtils::jsonBool(settings["portMappingEnabled"],true);
+		_node->setLocalTraceLevel(settings["localTraceLevel"].is_number() ? (int)OSUtils::jsonInt(settings["localTraceLevel"],0ULL) : -1);
 
 #ifndef ZT_SDK
 		const std::string up(OSUtils::jsonString(settings["softwareUpdate"],ZT_SOFTWARE_UPDATE_DEFAULT));